@@ -0,0 +1,244 @@
+//
+//  SBAlbumListPager.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBAlbumListPager")
+
+/// Loads a server's album list for the server home a page at a time, ahead of where the grid is scrolled to.
+///
+/// - Pages are sized to cover the viewport, or what gets scrolled past while a page loads if that's more, going by how
+///   long recent pages took and how fast the grid is scrolling.
+/// - Up to two pages are requested at once, until there's a page's worth past the viewport.
+/// - Changing the list type cancels pages still out, so their albums don't end up in the new list.
+///
+/// This is only used from the main thread.
+@objc class SBAlbumListPager: NSObject {
+    /// getAlbumList2 won't return more than this at once.
+    static let maxPageSize = 500
+    static let minPageSize = 20
+    static let maxPagesInFlight = 2
+    /// How long to wait for a page before assuming its request failed.
+    static let pageTimeout: TimeInterval = 30
+    /// How long between measuring how fast the grid is scrolling, since it only moves by whole rows.
+    static let scrollSampleInterval: TimeInterval = 0.25
+    /// How much each new measurement counts for, against the ones before it.
+    static let smoothing = 0.3
+
+    private class Page {
+        let offset: Int
+        let count: Int
+        let requested = Date()
+        var operation: SBSubsonicRequestOperation?
+
+        // checked by the parser, on its own thread
+        private let lock = NSLock()
+        private var cancelled = false
+
+        init(offset: Int, count: Int) {
+            self.offset = offset
+            self.count = count
+        }
+
+        var isCancelled: Bool {
+            lock.lock()
+            defer { lock.unlock() }
+            return cancelled
+        }
+
+        func cancel() {
+            lock.lock()
+            cancelled = true
+            lock.unlock()
+            operation?.cancel()
+        }
+    }
+
+    @objc let server: SBServer
+    private(set) var listType: SBAlbumListType = .random
+
+    private var inFlight: [Page] = []
+    /// Where the next page starts, counting pages still in flight.
+    private var nextOffset = 0
+    /// Later pages add to the server home that the first one resets, so they wait for it.
+    private var firstPageLoaded = false
+    /// If the server returned less than was asked for, there's nothing past it.
+    private var exhausted = false
+
+    // what the grid looks like
+    private var viewportItems = 0
+    private var lastVisibleItem = -1
+    private var lastScrollSample: (date: Date, item: Int)?
+
+    // measured
+    private var latency: TimeInterval = 0.5
+    private var itemsPerSecond: Double = 0
+
+    // for the log
+    private var pagesRequested = 0
+    private var pagesCancelled = 0
+    private var albumsLoaded = 0
+
+    private var observer: NSObjectProtocol?
+
+    @objc init(server: SBServer) {
+        self.server = server
+        super.init()
+        observer = NotificationCenter.default.addObserver(forName: .SBSubsonicAlbumsUpdated, object: nil, queue: .main) { [weak self] notification in
+            self?.pageLoaded(notification)
+        }
+    }
+
+    deinit {
+        if let observer = self.observer {
+            NotificationCenter.default.removeObserver(observer)
+        }
+        for page in inFlight {
+            page.cancel()
+        }
+    }
+
+    // #MARK: - Grid
+
+    /// Starts the list over with the first page of another (or the same) list type.
+    @objc(reloadWithType:) func reload(type: SBAlbumListType) {
+        pagesCancelled += inFlight.count
+        for page in inFlight {
+            page.cancel()
+        }
+        inFlight.removeAll()
+        if pagesRequested > 0 {
+            logStatistics()
+        }
+
+        listType = type
+        nextOffset = 0
+        firstPageLoaded = false
+        exhausted = false
+        lastVisibleItem = -1
+        lastScrollSample = nil
+        itemsPerSecond = 0
+        pagesRequested = 0
+        pagesCancelled = 0
+        albumsLoaded = 0
+        fillLookahead()
+    }
+
+    /// Tells the pager where the grid is scrolled to, requesting more pages if it's getting close to the end.
+    @objc(scrolledToItem:viewportItems:) func scrolled(lastVisibleItem: Int, viewportItems: Int) {
+        self.viewportItems = viewportItems
+        self.lastVisibleItem = lastVisibleItem
+
+        let now = Date()
+        if let sample = lastScrollSample {
+            let interval = now.timeIntervalSince(sample.date)
+            guard interval >= SBAlbumListPager.scrollSampleInterval else {
+                fillLookahead()
+                return
+            }
+            // scrolling back up doesn't need anything loaded
+            let itemsScrolled = Double(max(0, lastVisibleItem - sample.item))
+            itemsPerSecond = smooth(itemsPerSecond, itemsScrolled / interval)
+        }
+        lastScrollSample = (now, lastVisibleItem)
+        fillLookahead()
+    }
+
+    // #MARK: - Pages
+
+    private func smooth(_ average: Double, _ sample: Double) -> Double {
+        average + (sample - average) * SBAlbumListPager.smoothing
+    }
+
+    /// Enough to fill the viewport, or what gets scrolled past while a page loads, whichever is more.
+    var pageSize: Int {
+        let scrolledPast = Int((itemsPerSecond * latency).rounded(.up))
+        let size = max(viewportItems, scrolledPast)
+        return min(max(size, SBAlbumListPager.minPageSize), SBAlbumListPager.maxPageSize)
+    }
+
+    private func fillLookahead() {
+        expireTimedOutPages()
+        guard firstPageLoaded else {
+            if inFlight.isEmpty {
+                request(offset: 0, count: pageSize)
+            }
+            return
+        }
+        guard !exhausted else {
+            return
+        }
+        let pageSize = self.pageSize
+        while inFlight.count < SBAlbumListPager.maxPagesInFlight {
+            // loaded or on the way past the bottom of the viewport
+            let ahead = nextOffset - (max(lastVisibleItem, 0) + 1)
+            if ahead >= viewportItems + pageSize {
+                break
+            }
+            request(offset: nextOffset, count: pageSize)
+        }
+    }
+
+    private func request(offset: Int, count: Int) {
+        let page = Page(offset: offset, count: count)
+        page.operation = server.getAlbumList(type: listType, offset: offset, count: count, isStale: { [weak page] in
+            // if the page is gone, so is whoever wanted it
+            page?.isCancelled ?? true
+        })
+        inFlight.append(page)
+        nextOffset = offset + count
+        pagesRequested += 1
+        logger.debug("Requested \(count) albums at offset \(offset), \(self.inFlight.count) pages in flight")
+    }
+
+    /// Gives up on pages that never came back, so they get requested again.
+    private func expireTimedOutPages() {
+        let cutoff = Date(timeIntervalSinceNow: -SBAlbumListPager.pageTimeout)
+        guard let expired = inFlight.filter({ $0.requested < cutoff }).map({ $0.offset }).min() else {
+            return
+        }
+        logger.warning("Page at offset \(expired) timed out, requesting again")
+        // anything after it would leave a hole, so those go too
+        let dropped = inFlight.filter { $0.offset >= expired }
+        for page in dropped {
+            page.cancel()
+        }
+        pagesCancelled += dropped.count
+        inFlight.removeAll { $0.offset >= expired }
+        nextOffset = expired
+    }
+
+    private func pageLoaded(_ notification: Notification) {
+        guard let serverID = notification.object as? NSManagedObjectID, serverID == server.objectID,
+              let offset = (notification.userInfo?["offset"] as? NSNumber)?.intValue,
+              let count = (notification.userInfo?["count"] as? NSNumber)?.intValue,
+              let type = (notification.userInfo?["type"] as? NSNumber)?.intValue, type == listType.rawValue,
+              let index = inFlight.firstIndex(where: { $0.offset == offset }) else {
+            return
+        }
+        let page = inFlight.remove(at: index)
+        // includes waiting in the queue and parsing, since that's what the user waits for too
+        let elapsed = Date().timeIntervalSince(page.requested)
+        latency = smooth(latency, elapsed)
+        albumsLoaded += count
+        if offset == 0 {
+            firstPageLoaded = true
+        }
+        if count < page.count {
+            exhausted = true
+            nextOffset = offset + count
+        }
+        logger.debug("Loaded \(count) albums at offset \(offset) in \(elapsed * 1000, format: .fixed(precision: 1)) ms, next page size \(self.pageSize)")
+        fillLookahead()
+    }
+
+    private func logStatistics() {
+        logger.info("Album list \(self.listType.subsonicParameter(), privacy: .public): \(self.pagesRequested) pages requested, \(self.pagesCancelled) cancelled, \(self.albumsLoaded) albums, latency \(self.latency * 1000, format: .fixed(precision: 1)) ms, \(self.itemsPerSecond, format: .fixed(precision: 1)) items/s scrolled")
+    }
+}
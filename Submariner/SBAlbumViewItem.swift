@@ -76,6 +76,10 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
         return representedObject as? SBAlbum
     }
     
+    var coverPixelSize: Int {
+        return (collectionView as? SBCollectionView)?.coverPixelSize ?? SBCoverCache.bucket(pixelSize: 500)
+    }
+    
     // #MARK: - Double-Click
     
     private static let descriptors: [NSSortDescriptor] = [
@@ -119,11 +123,25 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
         
         @State var hovering = false
         
+        // The cover is decoded off the main thread, keep which one it was since the item can be reused for another album
+        @State private var loadedCover: (key: String, image: NSImage?)?
+        
+        private var coverKey: String {
+            "\(album.objectID.uriRepresentation())-\(album.cover?.imagePath ?? "")-\(host.coverPixelSize)"
+        }
+        
+        private var coverImage: NSImage {
+            if let loadedCover = self.loadedCover, loadedCover.key == coverKey {
+                return loadedCover.image ?? SBAlbum.nullCover!
+            }
+            return SBCoverCache.shared.cachedImage(for: album, pixelSize: host.coverPixelSize) ?? SBAlbum.nullCover!
+        }
+        
         var body: some View {
             // Convert to if-expr once CI is newer
             let backgroundColour = host.drawSelection ? (host.isHostingViewFirstResponder && controlActiveState == .key ? Color(nsColor: .selectedContentBackgroundColor) : Color(nsColor: .unemphasizedSelectedContentBackgroundColor)) : .clear
             VStack {
-                Image(nsImage: album.imageRepresentation() as! NSImage)
+                Image(nsImage: coverImage)
                     .interpolation(.medium)
                     .resizable()
                     .scaledToFit()
@@ -170,6 +188,11 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
                     }
                     // XXX: This might not be right, because we might want the overlay to be accessible.
                     .accessibilityHidden(true)
+                    .task(id: coverKey) {
+                        let key = coverKey
+                        let image = await SBCoverCache.shared.loadImage(for: album, pixelSize: host.coverPixelSize)
+                        loadedCover = (key: key, image: image)
+                    }
                 Text(album.itemName ?? "")
                     .controlSize(.small)
                     // lineLimit 2 w/ space reservation is interesting, but requires newer target
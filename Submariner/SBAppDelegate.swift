@@ -39,6 +39,10 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
             "albumSortOrder": "OldestFirst",
             "canLinkImport": NSNumber(value: false),
             "playRate": NSNumber(value: 1.0),
+            "maxConcurrentServerRequests": NSNumber(value: 4),
+            "offlineCacheLimit": NSNumber(value: 0),
+            "maxConcurrentDownloads": NSNumber(value: 3),
+            "recordOperationTelemetry": NSNumber(value: false),
         ]
         UserDefaults.standard.register(defaults: defaults)
         
@@ -78,35 +82,74 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
         // but we should probably invalidate object IDs in the defaults DB. migration should handle OIDs in the store.
         // if we were doing the migration manually we could try to convert the ID, but we don't have this control with
         // NSMigratePersistentStoresAutomaticallyOption.
-        let newURL = SBAppDelegate.storeFileName
-        if let metadata = try? NSPersistentStoreCoordinator.metadataForPersistentStore(type: .sqlite, at: newURL),
-           !self.managedObjectModel.isConfiguration(withName: nil, compatibleWithStoreMetadata: metadata) {
-            // SBDatabaseController defaults to local music for now
-            UserDefaults.standard.removeObject(forKey: "LastViewedResource")
+        if SBAppDelegate.isRunningTests {
+            // every run of the tests starts from an empty library
+            _ = try! self.persistentStoreCoordinator.addPersistentStore(type: .inMemory,
+                                                                        configuration: nil,
+                                                                        at: URL(fileURLWithPath: "/dev/null"),
+                                                                        options: storeOpts)
+        } else {
+            let newURL = SBAppDelegate.storeFileName
+            if let metadata = try? NSPersistentStoreCoordinator.metadataForPersistentStore(type: .sqlite, at: newURL),
+               !self.managedObjectModel.isConfiguration(withName: nil, compatibleWithStoreMetadata: metadata) {
+                // SBDatabaseController defaults to local music for now
+                UserDefaults.standard.removeObject(forKey: "LastViewedResource")
+            }
+            // we no longer migrate from Submariner 1.x stores. use 3.1.1 or older first beforehand
+            _ = try! self.persistentStoreCoordinator.addPersistentStore(type: .sqlite,
+                                                                        configuration: nil,
+                                                                        at: newURL,
+                                                                        options: storeOpts)
         }
-        // we no longer migrate from Submariner 1.x stores. use 3.1.1 or older first beforehand
-        _ = try! self.persistentStoreCoordinator.addPersistentStore(type: .sqlite,
-                                                                    configuration: nil,
-                                                                    at: newURL,
-                                                                    options: storeOpts)
         
         // #MARK: Init Core Data (managed object store)
-        // must be main queue for SwiftUI
-        self.managedObjectContext = NSManagedObjectContext(concurrencyType: .mainQueueConcurrencyType)
-        self.managedObjectContext.persistentStoreCoordinator = self.persistentStoreCoordinator
-        self.managedObjectContext.automaticallyMergesChangesFromParent = true
+        // The main context is a child of a background writer, so saving doesn't write to the store on the main thread
+        self.managedObjectContext = SBPersistence.shared.start(coordinator: self.persistentStoreCoordinator)
         
         // #MARK: Run cleanup steps
-        let cleanupOrphansOperation = SBLibraryCleanupOrphansOperation(managedObjectContext: self.managedObjectContext)
-        OperationQueue.sharedServerQueue.addOperation(cleanupOrphansOperation)
-        let cleanupCoverPathsOperation = SBLibraryCleanupCoverPathsOperation(managedObjectContext: self.managedObjectContext)
-        OperationQueue.sharedServerQueue.addOperation(cleanupCoverPathsOperation)
+        // Tests start from an empty library, with nothing to clean up or pick up from last time
+        if !SBAppDelegate.isRunningTests {
+            SBAppDelegate.startMaintenance(managedObjectContext: self.managedObjectContext)
+        }
+        
+        // Built in the background; searching filters the old way until it's ready
+        SBSearchIndex.shared.start(managedObjectContext: self.managedObjectContext)
         
         // #MARK: Init Window Controllers
         self.databaseController = SBDatabaseController(managedObjectContext: self.managedObjectContext)
         self.preferencesController = SBPreferencesController()
     }
     
+    /// Cleans up the library, and picks up what was left from the last launch.
+    private static func startMaintenance(managedObjectContext: NSManagedObjectContext) {
+        // These need to be done before anything gets parsed, which the scheduler makes parsing wait for
+        let cleanupOrphansOperation = SBLibraryCleanupOrphansOperation(managedObjectContext: managedObjectContext)
+        SBServerScheduler.shared.addMaintenance(cleanupOrphansOperation)
+        let cleanupCoverPathsOperation = SBLibraryCleanupCoverPathsOperation(managedObjectContext: managedObjectContext)
+        SBServerScheduler.shared.addMaintenance(cleanupCoverPathsOperation)
+        let migrateCoverStoreOperation = SBLibraryMigrateCoverStoreOperation(managedObjectContext: managedObjectContext)
+        SBServerScheduler.shared.addMaintenance(migrateCoverStoreOperation)
+        // After anything that can let go of covers, so their files go too
+        let coverGCOperation = SBLibraryCoverGCOperation(managedObjectContext: managedObjectContext)
+        SBServerScheduler.shared.addMaintenance(coverGCOperation)
+        let backfillAlbumServersOperation = SBLibraryBackfillAlbumServersOperation(managedObjectContext: managedObjectContext)
+        SBServerScheduler.shared.addMaintenance(backfillAlbumServersOperation)
+        let migratePlaylistEntriesOperation = SBLibraryMigratePlaylistEntriesOperation(managedObjectContext: managedObjectContext)
+        SBServerScheduler.shared.addMaintenance(migratePlaylistEntriesOperation)
+        // Picks up changes to linked folders since the last launch; imports go through the download queue
+        if SBLibraryRescanOperation.hasRememberedFolders {
+            let rescanOperation = SBLibraryRescanOperation(managedObjectContext: managedObjectContext)
+            rescanOperation.addDependency(cleanupOrphansOperation)
+            OperationQueue.sharedDownloadQueue.addOperation(rescanOperation)
+        }
+        
+        // Counts downloads if they never were, and keeps them under the limit from here on
+        SBOfflineCache.shared.start(managedObjectContext: managedObjectContext)
+        
+        // Sends stars, scrobbles and such that didn't make it to the server before quitting
+        SBMutationOutbox.shared.start(managedObjectContext: managedObjectContext)
+    }
+    
     // #MARK: - NSApplicationDelegate
     
     func applicationSupportsSecureRestorableState(_ app: NSApplication) -> Bool {
@@ -130,12 +173,13 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
             return .terminateNow
         }
         
-        if !managedObjectContext.hasChanges {
-            return .terminateNow
-        }
-        
         do {
-            try managedObjectContext.save()
+            if managedObjectContext.hasChanges {
+                try managedObjectContext.save()
+            }
+            // Whatever operations saved might not be written yet either
+            try SBPersistence.shared.flush()
+            SBMutationOutbox.shared.waitForWrites()
         } catch {
             if NSApplication.shared.presentError(error) {
                 return .terminateCancel
@@ -166,8 +210,19 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
     
     // #MARK: - Application Files/Directories
     
+    /// If the app is hosting unit tests, which get an empty library of their own instead of the user's.
+    static let isRunningTests = ProcessInfo.processInfo.environment["XCTestConfigurationFilePath"] != nil
+    
+    /// Where the library's files go.
+    static var libraryDirectory: URL {
+        if isRunningTests {
+            return FileManager.default.temporaryDirectory.appendingPathComponent("Submariner Tests \(ProcessInfo.processInfo.processIdentifier)")
+        }
+        return FileManager.default.urls(for: .musicDirectory, in: .userDomainMask).last!.appendingPathComponent("Submariner")
+    }
+    
     @objc static var musicDirectory: URL {
-        let path = FileManager.default.urls(for: .musicDirectory, in: .userDomainMask).last!.appendingPathComponent("Submariner/Music")
+        let path = libraryDirectory.appendingPathComponent("Music")
         if !FileManager.default.fileExists(atPath: path.path) {
             do {
                 try FileManager.default.createDirectory(at: path, withIntermediateDirectories: true)
@@ -184,7 +239,7 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
     }
     
     @objc static var coverDirectory: URL {
-        let path = FileManager.default.urls(for: .musicDirectory, in: .userDomainMask).last!.appendingPathComponent("Submariner/Covers")
+        let path = libraryDirectory.appendingPathComponent("Covers")
         if !FileManager.default.fileExists(atPath: path.path) {
             do {
                 try FileManager.default.createDirectory(at: path, withIntermediateDirectories: true)
@@ -201,8 +256,8 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
     }
     
     static var storeFileName: URL {
-        let baseURL = FileManager.default.urls(for: .musicDirectory, in: .userDomainMask).last!.appendingPathComponent("Submariner")
-        let path = FileManager.default.urls(for: .musicDirectory, in: .userDomainMask).last!.appendingPathComponent("Submariner/Submariner Library.sqlite")
+        let baseURL = libraryDirectory
+        let path = libraryDirectory.appendingPathComponent("Submariner Library.sqlite")
         if !FileManager.default.fileExists(atPath: baseURL.path) {
             do {
                 try FileManager.default.createDirectory(at: baseURL, withIntermediateDirectories: true)
@@ -375,9 +430,18 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
         databaseController.scanCurrentLibrary(sender)
     }
     
+    @IBAction func rescanLinkedFolders(_ sender: Any?) {
+        // it compares against the linked tracks, including any just changed
+        SBPersistence.shared.saveMainContext()
+        let operation = SBLibraryRescanOperation(managedObjectContext: managedObjectContext)
+        OperationQueue.sharedDownloadQueue.addOperation(operation)
+    }
+    
     @IBAction func purgeLocalLibrary(_ sender: Any?) {
+        // or unsaved changes to what gets purged would bring it back
+        SBPersistence.shared.saveMainContext()
         let operation = SBLibraryPurgeOperation(managedObjectContext: managedObjectContext)
-        OperationQueue.sharedServerQueue.addOperation(operation)
+        SBServerScheduler.shared.addMaintenance(operation)
     }
     
     // #MARK: - Core Data
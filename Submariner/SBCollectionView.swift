@@ -10,6 +10,12 @@
 
 import Cocoa
 
+/// Implemented by data sources that want to start loading items before they scroll into view.
+@objc protocol SBCollectionViewPrefetching {
+    @objc(collectionView:prefetchItemsAtIndexPaths:)
+    func collectionView(_ collectionView: NSCollectionView, prefetchItemsAt indexPaths: [IndexPath])
+}
+
 @objc(SBCollectionView) class SBCollectionView: NSCollectionView {
     // Make it so right-clicking for the menu will select the item under the cursor.
     override func rightMouseDown(with event: NSEvent) {
@@ -36,6 +42,78 @@ import Cocoa
         self.selectItems(at: indexPaths, scrollPosition: scrollPosition)
     }
     
+    // #MARK: - Prefetching
+    
+    private var boundsObserver: NSObjectProtocol?
+    private var lastPrefetchOrigin: CGFloat = 0
+    
+    /// The size in pixels covers in this view should be decoded at.
+    @objc var coverPixelSize: Int {
+        let width = (collectionViewLayout as? NSCollectionViewFlowLayout)?.itemSize.width ?? 250
+        let scale = window?.backingScaleFactor ?? NSScreen.main?.backingScaleFactor ?? 2
+        return SBCoverCache.bucket(pixelSize: width * scale)
+    }
+    
+    /// How many items fit in the visible area, whether or not there are that many yet.
+    @objc var itemsPerViewport: Int {
+        guard let layout = collectionViewLayout as? NSCollectionViewFlowLayout else {
+            return 0
+        }
+        let visible = enclosingScrollView?.contentView.bounds ?? visibleRect
+        let itemWidth = layout.itemSize.width + layout.minimumInteritemSpacing
+        let itemHeight = layout.itemSize.height + layout.minimumLineSpacing
+        guard itemWidth > 0, itemHeight > 0 else {
+            return 0
+        }
+        let columns = max(1, Int(visible.width / itemWidth))
+        let rows = Int((visible.height / itemHeight).rounded(.up))
+        return columns * rows
+    }
+
+    /// The index of the furthest item down that's visible, or -1 if there aren't any.
+    @objc var lastVisibleItem: Int {
+        indexPathsForVisibleItems().map { $0.item }.max() ?? -1
+    }
+
+    override func viewDidMoveToWindow() {
+        super.viewDidMoveToWindow()
+        
+        if let boundsObserver = self.boundsObserver {
+            NotificationCenter.default.removeObserver(boundsObserver)
+            self.boundsObserver = nil
+        }
+        guard window != nil, let clipView = enclosingScrollView?.contentView else {
+            return
+        }
+        clipView.postsBoundsChangedNotifications = true
+        boundsObserver = NotificationCenter.default.addObserver(forName: NSView.boundsDidChangeNotification, object: clipView, queue: .main) { [weak self] _ in
+            self?.prefetchAhead()
+        }
+    }
+    
+    /// Asks the data source to prefetch the screenful past the visible area, in the direction we're scrolling.
+    private func prefetchAhead() {
+        guard let prefetcher = dataSource as? SBCollectionViewPrefetching, let layout = collectionViewLayout else {
+            return
+        }
+        let visible = visibleRect
+        // Don't bother for every pixel scrolled, a fraction of a screen is often enough to be a new row
+        guard abs(visible.minY - lastPrefetchOrigin) > visible.height / 4 else {
+            return
+        }
+        let scrollingDown = visible.minY > lastPrefetchOrigin
+        lastPrefetchOrigin = visible.minY
+        
+        // we're flipped, so down is a bigger Y
+        let ahead = visible.offsetBy(dx: 0, dy: scrollingDown ? visible.height : -visible.height)
+        let indexPaths = layout.layoutAttributesForElements(in: ahead)
+            .filter { $0.representedElementCategory == .item }
+            .compactMap { $0.indexPath }
+        if !indexPaths.isEmpty {
+            prefetcher.collectionView(self, prefetchItemsAt: indexPaths)
+        }
+    }
+    
     // #MARK: - First Responder notification
     
     override func becomeFirstResponder() -> Bool {
@@ -19,6 +19,7 @@ extension SBCover {
 
     //@NSManaged public var imagePath: String?
     @NSManaged public var album: SBAlbum?
+    @NSManaged public var file: SBCoverFile?
     @NSManaged public var track: SBTrack?
 
 }
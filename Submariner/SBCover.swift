@@ -67,8 +67,14 @@ public class SBCover: SBMusicItem {
     // needing to load the file. By overriding the getter, we reduce refactoring.
     //
     // XXX: Why is there a difference between MusicItem.path and Cover.imagePath?
+    //
+    // Covers in SBCoverStore have a file instead, which wins over any path. Setting a path (or nil) takes the cover out
+    // of the store, so set the file after.
     @objc var imagePath: NSString? {
         get {
+            if let url = self.file?.url {
+                return url.path as NSString
+            }
             self.willAccessValue(forKey: "imagePath")
             let currentPath = self.primitiveValue(forKey: "imagePath") as! NSString?
             // XXX: SBImportOperation was setting this, but SBSubsonicParsingOperation was not
@@ -87,12 +93,19 @@ public class SBCover: SBMusicItem {
             return nil
         }
         set {
+            if self.file != nil {
+                self.file = nil
+            }
             self.willChangeValue(forKey: "imagePath")
             self.setPrimitiveValue(newValue, forKey: "imagePath")
             self.didChangeValue(forKey: "imagePath")
         }
     }
     
+    @objc class func keyPathsForValuesAffectingImagePath() -> Set<String> {
+        return ["file"]
+    }
+    
     // #MARK: - Core Data insert compatibility shim
     
     @objc(insertInManagedObjectContext:) class func insertInManagedObjectContext(context: NSManagedObjectContext) -> SBCover {
@@ -0,0 +1,316 @@
+//
+//  SBCoverCache.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import ImageIO
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBCoverCache")
+
+/// Decoded, downsampled cover art, so album grids don't decode full-size images on the main thread while scrolling.
+///
+/// Covers are keyed by cover and the pixel size they were decoded for, and evicted least recently used first once the
+/// decoded size goes over `costLimit`. Decoding happens off the main thread, and straight to the requested size, so a huge
+/// cover never gets decoded at full size.
+@objc class SBCoverCache: NSObject {
+    @objc static let shared = SBCoverCache()
+
+    /// Decoded bytes to keep around before evicting. Halved under memory pressure.
+    var costLimit = 128 * 1024 * 1024
+
+    private struct Key: Hashable {
+        let coverID: String
+        let pixelSize: Int
+    }
+
+    private class Entry {
+        let key: Key
+        let image: NSImage
+        let cost: Int
+        var previous: Entry?
+        var next: Entry?
+
+        init(key: Key, image: NSImage, cost: Int) {
+            self.key = key
+            self.image = image
+            self.cost = cost
+        }
+    }
+
+    private let lock = NSLock()
+    private var entries: [Key: Entry] = [:]
+    // most recently used is the head
+    private var head: Entry?
+    private var tail: Entry?
+    // keys being decoded right now, so prefetches and cells don't decode the same cover twice
+    private var pending: [Key: [(NSImage?) -> Void]] = [:]
+
+    private let decodeQueue: OperationQueue = {
+        let queue = OperationQueue()
+        queue.name = "Cover decoding"
+        queue.qualityOfService = .userInitiated
+        queue.maxConcurrentOperationCount = max(2, ProcessInfo.processInfo.activeProcessorCount / 2)
+        return queue
+    }()
+
+    private var memoryPressureSource: DispatchSourceMemoryPressure?
+
+    // #MARK: - Statistics
+
+    private(set) var hits = 0
+    private(set) var misses = 0
+    private(set) var bytesResident = 0
+
+    var count: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return entries.count
+    }
+
+    private func logStatistics() {
+        let resident = Measurement<UnitInformationStorage>(value: Double(bytesResident), unit: .bytes).converted(to: .megabytes)
+        logger.info("\(self.hits) hits, \(self.misses) misses, \(self.entries.count) covers using \(resident.value, format: .fixed(precision: 1)) MB")
+    }
+
+    private override init() {
+        super.init()
+
+        let source = DispatchSource.makeMemoryPressureSource(eventMask: [.warning, .critical], queue: .main)
+        source.setEventHandler { [weak self] in
+            guard let self = self else { return }
+            let critical = source.data.contains(.critical)
+            self.lock.lock()
+            self.trim(to: critical ? 0 : self.costLimit / 2)
+            self.lock.unlock()
+            logger.info("Trimmed cover cache for memory pressure (critical: \(critical))")
+        }
+        source.resume()
+        memoryPressureSource = source
+    }
+
+    // #MARK: - LRU
+
+    private func unlink(_ entry: Entry) {
+        entry.previous?.next = entry.next
+        entry.next?.previous = entry.previous
+        if head === entry {
+            head = entry.next
+        }
+        if tail === entry {
+            tail = entry.previous
+        }
+        entry.previous = nil
+        entry.next = nil
+    }
+
+    private func pushFront(_ entry: Entry) {
+        entry.next = head
+        head?.previous = entry
+        head = entry
+        if tail == nil {
+            tail = entry
+        }
+    }
+
+    // must hold lock
+    private func trim(to limit: Int) {
+        while bytesResident > limit, let last = tail {
+            unlink(last)
+            entries.removeValue(forKey: last.key)
+            bytesResident -= last.cost
+        }
+    }
+
+    // must hold lock
+    private func store(_ image: NSImage, cost: Int, for key: Key) {
+        if let existing = entries.removeValue(forKey: key) {
+            unlink(existing)
+            bytesResident -= existing.cost
+        }
+        let entry = Entry(key: key, image: image, cost: cost)
+        entries[key] = entry
+        pushFront(entry)
+        bytesResident += cost
+        trim(to: costLimit)
+    }
+
+    // must hold lock
+    /// Only loads count towards the statistics, since views peek with `cachedImage` every time they're drawn.
+    private func lookup(_ key: Key, counting: Bool = true) -> NSImage? {
+        guard let entry = entries[key] else {
+            if counting {
+                misses += 1
+                if misses % 100 == 0 {
+                    logStatistics()
+                }
+            }
+            return nil
+        }
+        if counting {
+            hits += 1
+        }
+        unlink(entry)
+        pushFront(entry)
+        return entry.image
+    }
+
+    // #MARK: - Decoding
+
+    /// The inspector is a fixed width, so it can just use one size.
+    static let inspectorPixelSize = 640
+
+    /// Rounds up so small changes in size (i.e. zooming the grid) don't make new entries for every step.
+    static func bucket(pixelSize: CGFloat) -> Int {
+        let step = 64
+        return max(step, Int((pixelSize / CGFloat(step)).rounded(.up)) * step)
+    }
+
+    private static func decode(path: String, pixelSize: Int) -> (NSImage, Int)? {
+        let url = URL(fileURLWithPath: path)
+        guard let source = CGImageSourceCreateWithURL(url as CFURL, [kCGImageSourceShouldCache: false] as CFDictionary) else {
+            return nil
+        }
+        let options: [CFString: Any] = [
+            kCGImageSourceCreateThumbnailFromImageAlways: true,
+            kCGImageSourceCreateThumbnailWithTransform: true,
+            kCGImageSourceShouldCacheImmediately: true,
+            kCGImageSourceThumbnailMaxPixelSize: pixelSize,
+        ]
+        guard let cgImage = CGImageSourceCreateThumbnailAtIndex(source, 0, options as CFDictionary) else {
+            return nil
+        }
+        let image = NSImage(cgImage: cgImage, size: .zero)
+        return (image, cgImage.bytesPerRow * cgImage.height)
+    }
+
+    /// Decodes on the decode queue, then calls anyone waiting on the key. The key must already be in `pending`.
+    private func startDecoding(key: Key, path: String, priority: Operation.QueuePriority) {
+        let operation = BlockOperation {
+            let decoded = SBCoverCache.decode(path: path, pixelSize: key.pixelSize)
+            self.lock.lock()
+            if let (image, cost) = decoded {
+                self.store(image, cost: cost, for: key)
+            }
+            let handlers = self.pending.removeValue(forKey: key) ?? []
+            self.lock.unlock()
+
+            if !handlers.isEmpty {
+                DispatchQueue.main.async {
+                    handlers.forEach { $0(decoded?.0) }
+                }
+            }
+        }
+        operation.queuePriority = priority
+        decodeQueue.addOperation(operation)
+    }
+
+    private func key(for album: SBAlbum, pixelSize: Int) -> (Key, String)? {
+        guard let cover = album.cover, let path = cover.imagePath as String? else {
+            return nil
+        }
+        // Local covers don't have IDs, but their paths are unique
+        return (Key(coverID: cover.itemId ?? path, pixelSize: pixelSize), path)
+    }
+
+    // #MARK: - Public
+
+    /// Returns the cover if it's already decoded at this size, without decoding it otherwise.
+    ///
+    /// This is meant for view bodies, which can be evaluated any number of times, so it isn't counted as a hit or miss.
+    func cachedImage(for album: SBAlbum, pixelSize: Int) -> NSImage? {
+        guard let (key, _) = key(for: album, pixelSize: pixelSize) else {
+            return nil
+        }
+        lock.lock()
+        defer { lock.unlock() }
+        return lookup(key, counting: false)
+    }
+
+    /// Returns the cover at this size, decoding it on this thread if needed.
+    func image(for album: SBAlbum, pixelSize: Int) -> NSImage? {
+        guard let (key, path) = key(for: album, pixelSize: pixelSize) else {
+            return nil
+        }
+        lock.lock()
+        if let image = lookup(key) {
+            lock.unlock()
+            return image
+        }
+        lock.unlock()
+
+        guard let (image, cost) = SBCoverCache.decode(path: path, pixelSize: pixelSize) else {
+            return nil
+        }
+        lock.lock()
+        store(image, cost: cost, for: key)
+        lock.unlock()
+        return image
+    }
+
+    /// Decodes the cover off the main thread, calling the completion handler on the main thread.
+    ///
+    /// Like the other lookups, this gives nil if the album has no cover or it couldn't be decoded.
+    func loadImage(for album: SBAlbum, pixelSize: Int, completionHandler: @escaping (NSImage?) -> Void) {
+        guard let (key, path) = key(for: album, pixelSize: pixelSize) else {
+            completionHandler(nil)
+            return
+        }
+        lock.lock()
+        if let image = lookup(key) {
+            lock.unlock()
+            completionHandler(image)
+            return
+        }
+        if pending[key] != nil {
+            pending[key]!.append(completionHandler)
+            lock.unlock()
+            return
+        }
+        pending[key] = [completionHandler]
+        lock.unlock()
+
+        startDecoding(key: key, path: path, priority: .normal)
+    }
+
+    func loadImage(for album: SBAlbum, pixelSize: Int) async -> NSImage? {
+        await withCheckedContinuation { continuation in
+            loadImage(for: album, pixelSize: pixelSize) { image in
+                continuation.resume(returning: image)
+            }
+        }
+    }
+
+    /// Starts decoding covers that are likely to be shown soon, at a lower priority than ones being shown now.
+    @objc(prefetchAlbums:pixelSize:) func prefetch(albums: [SBAlbum], pixelSize: Int) {
+        for album in albums {
+            guard let (key, path) = key(for: album, pixelSize: pixelSize) else {
+                continue
+            }
+            lock.lock()
+            if entries[key] != nil || pending[key] != nil {
+                lock.unlock()
+                continue
+            }
+            pending[key] = []
+            lock.unlock()
+
+            startDecoding(key: key, path: path, priority: .low)
+        }
+    }
+
+    /// Forgets every size of a cover, i.e. when its file has been replaced.
+    @objc func invalidate(coverID: String) {
+        lock.lock()
+        defer { lock.unlock() }
+        for (key, entry) in entries where key.coverID == coverID {
+            unlink(entry)
+            entries.removeValue(forKey: key)
+            bytesResident -= entry.cost
+        }
+    }
+}
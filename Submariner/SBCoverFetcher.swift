@@ -0,0 +1,172 @@
+//
+//  SBCoverFetcher.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBCoverFetcher")
+
+/// Coordinates fetching covers from servers, since many parses can want the same covers at once.
+///
+/// - A cover that's already being fetched isn't requested again until that fetch is done, parsed or not.
+/// - Each server has a token bucket, so a grid full of new albums doesn't set off the server's rate limiting. If the
+///   server does rate limit us (HTTP 429), the bucket waits until its Retry-After before handing out more.
+/// - Covers the server says don't exist (HTTP 404 or Subsonic error 70) aren't asked for again for a while, even
+///   across launches.
+class SBCoverFetcher {
+    static let shared = SBCoverFetcher()
+
+    /// How many covers can be requested at once before the rate applies.
+    static let burstSize: Double = 8
+    /// Covers per second, after the burst.
+    static let requestsPerSecond: Double = 4
+    /// How long to remember a cover is missing, in case it gets added later.
+    static let missingExpiry: TimeInterval = 7 * 24 * 60 * 60
+
+    private static let missingDefaultsKey = "missingCoverIDs"
+
+    private struct Key: Hashable {
+        let server: URL
+        let coverID: String
+    }
+
+    private class TokenBucket {
+        private var tokens = SBCoverFetcher.burstSize
+        private var lastRefill = Date()
+        private var pausedUntil: Date?
+
+        /// Takes a token, returning how long to wait before it can be used.
+        func reserve() -> TimeInterval {
+            let now = Date()
+            tokens = min(SBCoverFetcher.burstSize, tokens + now.timeIntervalSince(lastRefill) * SBCoverFetcher.requestsPerSecond)
+            lastRefill = now
+            tokens -= 1
+
+            var delay = tokens >= 0 ? 0 : -tokens / SBCoverFetcher.requestsPerSecond
+            if let pausedUntil = self.pausedUntil {
+                delay = max(delay, pausedUntil.timeIntervalSince(now))
+            }
+            return delay
+        }
+
+        func pause(until date: Date) {
+            pausedUntil = max(pausedUntil ?? date, date)
+        }
+    }
+
+    private let lock = NSLock()
+    private var inFlight = Set<Key>()
+    private var buckets: [URL: TokenBucket] = [:]
+    // server URI -> cover ID -> when it was found to be missing
+    private var missing: [String: [String: Date]]
+
+    private(set) var requested = 0
+    private(set) var coalesced = 0
+    private(set) var skippedMissing = 0
+
+    private init() {
+        let stored = UserDefaults.standard.dictionary(forKey: SBCoverFetcher.missingDefaultsKey) as? [String: [String: Date]] ?? [:]
+        // drop anything old enough to be worth trying again
+        let cutoff = Date().addingTimeInterval(-SBCoverFetcher.missingExpiry)
+        missing = stored.mapValues { $0.filter { $0.value > cutoff } }.filter { !$0.value.isEmpty }
+    }
+
+    // must hold lock
+    private func bucket(for server: URL) -> TokenBucket {
+        if let existing = buckets[server] {
+            return existing
+        }
+        let new = TokenBucket()
+        buckets[server] = new
+        return new
+    }
+
+    // #MARK: - Fetching
+
+    /// Requests a cover, unless it's already being fetched or known to be missing.
+    func fetch(coverID: String, albumID: String?, server: SBServer) {
+        guard server.managedObjectContext != nil, let context = SBPersistence.shared.mainContext else {
+            return
+        }
+        // The request should belong to the main context, not whatever (likely short-lived) context we were called from.
+        let serverID = server.objectID
+        let key = Key(server: serverID.uriRepresentation(), coverID: coverID)
+
+        lock.lock()
+        if missing[key.server.absoluteString]?[coverID] != nil {
+            skippedMissing += 1
+            lock.unlock()
+            return
+        }
+        if inFlight.contains(key) {
+            coalesced += 1
+            lock.unlock()
+            return
+        }
+        inFlight.insert(key)
+        requested += 1
+        let delay = bucket(for: key.server).reserve()
+        lock.unlock()
+
+        if delay > 0 {
+            logger.debug("Delaying cover \(coverID, privacy: .public) by \(delay, format: .fixed(precision: 2)) seconds")
+        }
+        DispatchQueue.main.asyncAfter(deadline: .now() + delay) {
+            context.perform {
+                guard let server = context.object(with: serverID) as? SBServer else {
+                    self.finished(key: key)
+                    return
+                }
+                let request = SBSubsonicRequestOperation(server: server, request: .getCoverArt(id: coverID, forAlbumId: albumID))
+                // The fetch is done when the parser has imported it, or if it never got that far, when the request is done.
+                var handedOff = false
+                let customization = request.customization
+                request.customization = { operation in
+                    handedOff = true
+                    customization?(operation)
+                    operation.completionBlock = {
+                        self.finished(key: key)
+                    }
+                }
+                request.completionBlock = {
+                    if !handedOff {
+                        self.finished(key: key)
+                    }
+                }
+                SBServerScheduler.shared.add(request)
+            }
+        }
+    }
+
+    private func finished(key: Key) {
+        lock.lock()
+        inFlight.remove(key)
+        lock.unlock()
+    }
+
+    // #MARK: - Server feedback
+
+    /// Makes every cover fetch for the server wait until the date, i.e. from a Retry-After.
+    func rateLimited(server: NSManagedObjectID, until date: Date) {
+        lock.lock()
+        bucket(for: server.uriRepresentation()).pause(until: date)
+        lock.unlock()
+        logger.info("Server rate limited us, holding cover fetches until \(date, privacy: .public)")
+    }
+
+    /// Remembers the server doesn't have this cover, so we don't keep asking for it.
+    func markMissing(coverID: String, server: NSManagedObjectID) {
+        lock.lock()
+        missing[server.uriRepresentation().absoluteString, default: [:]][coverID] = Date()
+        let toStore = missing
+        lock.unlock()
+
+        logger.info("Cover \(coverID, privacy: .public) doesn't exist on server, not fetching it again for a while")
+        UserDefaults.standard.set(toStore, forKey: SBCoverFetcher.missingDefaultsKey)
+    }
+}
@@ -0,0 +1,21 @@
+//
+//  SBCoverFile.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+import CoreData
+
+/// An image in `SBCoverStore`. Any number of covers can share one, and when none do, the file can go.
+@objc(SBCoverFile)
+public class SBCoverFile: NSManagedObject {
+    var url: URL? {
+        guard let name = self.name else {
+            return nil
+        }
+        return SBCoverStore.url(forName: name)
+    }
+}
@@ -0,0 +1,95 @@
+//
+//  SBCoverStore.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import CryptoKit
+import UniformTypeIdentifiers
+
+/// Stores cover images named by a hash of their contents, so the same image is only ever on disk once.
+///
+/// Servers like Navidrome give every track its own cover ID, and imports used to write a copy per album, so the same
+/// image could be stored many times over. Files live in `Covers/Store/<first two characters>/<hash>.<extension>`, and
+/// each one has a CoverFile in Core Data, whose covers relationship counts what uses it. Files nothing uses any more
+/// get removed by `SBLibraryCoverGCOperation`.
+class SBCoverStore {
+    static let shared = SBCoverStore()
+
+    // Held while writing or removing files, so the GC can't remove a file between a writer finding it and using it
+    private let lock = NSLock()
+
+    struct StoredFile: Hashable {
+        let name: String
+        let size: Int64
+    }
+
+    static var directory: URL {
+        SBAppDelegate.coverDirectory.appendingPathComponent("Store", isDirectory: true)
+    }
+
+    static func url(forName name: String) -> URL {
+        directory.appendingPathComponent(String(name.prefix(2)), isDirectory: true).appendingPathComponent(name)
+    }
+
+    // #MARK: - Files
+
+    /// Writes an image to the store, unless it's already there. This can be called from any thread.
+    func write(_ data: Data, type: UTType? = nil) throws -> StoredFile {
+        let hash = String.hexStringFrom(bytes: Data(SHA256.hash(data: data)))
+        let type = type ?? data.guessImageType() ?? UTType.jpeg
+        let name = "\(hash).\(type.preferredFilenameExtension ?? "jpg")"
+        let url = SBCoverStore.url(forName: name)
+        lock.lock()
+        defer { lock.unlock() }
+        // the name is the contents, so if it's there, it's the same image
+        if FileManager.default.fileExists(atPath: url.path) {
+            // Touch it, so it gets the same grace period from the GC as a new file until its CoverFile is saved
+            try? FileManager.default.setAttributes([.modificationDate: Date()], ofItemAtPath: url.path)
+        } else {
+            try FileManager.default.createDirectory(at: url.deletingLastPathComponent(), withIntermediateDirectories: true)
+            try data.write(to: url, options: [.atomic])
+        }
+        return StoredFile(name: name, size: Int64(data.count))
+    }
+
+    /// Writes an image file to the store, unless it's already there. This can be called from any thread.
+    func write(contentsOf file: URL) throws -> StoredFile {
+        let data = try Data(contentsOf: file, options: .mappedIfSafe)
+        return try write(data, type: UTType(filenameExtension: file.pathExtension))
+    }
+
+    /// Removes a file, unless it's been written or reused since the cutoff. This can be called from any thread.
+    /// - Returns: If the file was removed.
+    func removeUnused(at url: URL, modifiedBefore cutoff: Date) throws -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        // checked again here, since a writer could have touched it after the caller looked
+        let attributes = try FileManager.default.attributesOfItem(atPath: url.path)
+        if let modified = attributes[.modificationDate] as? Date, modified > cutoff {
+            return false
+        }
+        try FileManager.default.removeItem(at: url)
+        return true
+    }
+
+    // #MARK: - Core Data
+
+    /// Gets the CoverFile for a stored file, inserting one if there isn't one yet. This must be called on the context's
+    /// thread.
+    func file(for stored: StoredFile, in context: NSManagedObjectContext) -> SBCoverFile {
+        let fetchRequest: NSFetchRequest<SBCoverFile> = SBCoverFile.fetchRequest()
+        fetchRequest.predicate = NSPredicate(format: "name == %@", stored.name)
+        fetchRequest.fetchLimit = 1
+        if let existing = try? context.fetch(fetchRequest).first {
+            return existing
+        }
+        let file = SBCoverFile(entity: SBCoverFile.entity(), insertInto: context)
+        file.name = stored.name
+        file.size = NSNumber(value: stored.size)
+        return file
+    }
+}
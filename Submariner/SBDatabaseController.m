@@ -166,7 +166,7 @@
     // remove selection observers
     [[NSNotificationCenter defaultCenter] removeObserver:self name:@"SBTrackSelectionChanged" object:nil];
     // remove queue operations observer
-    [[NSOperationQueue sharedServerQueue] removeObserver:self forKeyPath:@"operationCount"];
+    [[SBServerScheduler shared] removeObserver:self forKeyPath:@"operationCount"];
     [[NSNotificationCenter defaultCenter] removeObserver:self];
     
     // release all object references
@@ -227,10 +227,10 @@
     [self.window.contentView addObserver: self forKeyPath: @"safeAreaInsets" options: NSKeyValueObservingOptionNew context: nil];
     
     // observer number of currently running operations to animate progress
-    [[NSOperationQueue sharedServerQueue] addObserver:self
-                                                  forKeyPath:@"operationCount"
-                                                     options:NSKeyValueObservingOptionNew
-                                                     context:nil];
+    [[SBServerScheduler shared] addObserver:self
+                                 forKeyPath:@"operationCount"
+                                    options:NSKeyValueObservingOptionNew
+                                    context:nil];
     
     [[NSNotificationCenter defaultCenter] addObserver:self
                                              selector:@selector(subsonicPlaylistsUpdatedNotification:)
@@ -420,10 +420,10 @@
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context {
     // queue observer
-    if(object == [NSOperationQueue sharedServerQueue]) {
+    if(object == [SBServerScheduler shared]) {
         // number of currently running operations
         if([keyPath isEqualToString:@"operationCount"]) {
-            if([[NSOperationQueue sharedServerQueue] operationCount] > 0) {
+            if([[SBServerScheduler shared] operationCount] > 0) {
                 [progressIndicator performSelectorOnMainThread: @selector(startAnimation:) withObject: self waitUntilDone: NO];
             } else {
                 [progressIndicator performSelectorOnMainThread: @selector(stopAnimation:) withObject: self waitUntilDone: NO];
@@ -1125,6 +1125,11 @@
 
 - (void)importSheetDidEnd: (NSWindow *)sheet returnCode: (NSInteger)returnCode contextInfo: (NSArray<NSURL*> *)choosedFiles {
     
+    // Imports match against the library, so they need to see any changes to it that haven't been saved
+    if(returnCode == NSAlertFirstButtonReturn || returnCode == NSAlertSecondButtonReturn) {
+        [self.managedObjectContext save:nil];
+    }
+    
     if(returnCode == NSAlertFirstButtonReturn) {
         if(choosedFiles != nil) {
             SBImportOperation *op = [[SBImportOperation alloc]
@@ -1642,7 +1647,7 @@
                                                initWithManagedObjectContext: self.managedObjectContext
                                                trackID: [track objectID]];
             
-            [[NSOperationQueue sharedDownloadQueue] addOperation:op];
+            [[SBDownloadManager shared] addOperation:op];
         }];
     }
     
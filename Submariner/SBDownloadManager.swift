@@ -0,0 +1,145 @@
+//
+//  SBDownloadManager.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+import Combine
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBDownloadManager")
+
+/// Runs track downloads, a few at a time for each server, and keeps track of how fast they're going overall.
+///
+/// Downloads used to share the serial queue with imports, so an album downloaded one track at a time, and each import
+/// waited behind every download queued before it. Now each server gets its own queue, and imports stay on the shared
+/// download queue, so they run while the next tracks download.
+@objc class SBDownloadManager: NSObject, ObservableObject {
+    @objc static let shared = SBDownloadManager()
+
+    /// How often throughput gets worked out.
+    static let sampleInterval: TimeInterval = 1
+    /// How much the latest sample counts towards throughput, so it doesn't jump around.
+    static let smoothing = 0.3
+
+    private let lock = NSLock()
+    private var queues: [NSManagedObjectID: OperationQueue] = [:]
+    // Downloads queued or running, by track, so a track isn't downloaded into the same partial file twice at once.
+    // Only used on the main thread.
+    private var downloads: [NSManagedObjectID: SBSubsonicDownloadOperation] = [:]
+    private var limitObserver: NSKeyValueObservation?
+
+    private var bytesSinceSample = 0
+    private var totalBytes: Int64 = 0
+    private var sampleTimer: Timer?
+
+    // These are only updated on the main thread.
+    /// Bytes per second across all downloads.
+    @Published private(set) var throughput: Double = 0
+    @Published private(set) var activeDownloads = 0
+
+    private override init() {
+        super.init()
+        limitObserver = UserDefaults.standard.observe(\.maxConcurrentDownloads) { [weak self] _, _ in
+            self?.updateQueueLimits()
+        }
+    }
+
+    private var maxConcurrentDownloads: Int {
+        return max(1, UserDefaults.standard.maxConcurrentDownloads)
+    }
+
+    private func updateQueueLimits() {
+        lock.lock()
+        defer { lock.unlock() }
+        for queue in queues.values {
+            queue.maxConcurrentOperationCount = maxConcurrentDownloads
+        }
+    }
+
+    private func queue(for serverID: NSManagedObjectID?) -> OperationQueue {
+        // Downloads without a server fail straight away, so they can go anywhere
+        guard let serverID = serverID else {
+            return OperationQueue.sharedDownloadQueue
+        }
+        lock.lock()
+        defer { lock.unlock() }
+        if let existing = queues[serverID] {
+            return existing
+        }
+        let queue = OperationQueue()
+        queue.name = "Downloads for \(serverID.uriRepresentation().absoluteString)"
+        queue.maxConcurrentOperationCount = maxConcurrentDownloads
+        queues[serverID] = queue
+        return queue
+    }
+
+    // #MARK: - Downloading
+
+    /// Queues a download on its server's queue, unless the track is already being downloaded. This must be called on
+    /// the main thread.
+    @objc(addOperation:) func add(_ operation: SBSubsonicDownloadOperation) {
+        let trackID = operation.trackID
+        if let existing = downloads[trackID], !existing.isFinished {
+            logger.info("Already downloading \(trackID.uriRepresentation(), privacy: .public), not queueing it again")
+            return
+        }
+        downloads[trackID] = operation
+        activeDownloads += 1
+        startSampling()
+        let previousCompletion = operation.completionBlock
+        operation.completionBlock = { [weak operation] in
+            previousCompletion?()
+            DispatchQueue.main.async {
+                self.activeDownloads -= 1
+                if let operation = operation, self.downloads[trackID] === operation {
+                    self.downloads[trackID] = nil
+                }
+            }
+        }
+        operation.enqueuedDate = Date()
+        queue(for: operation.serverID).addOperation(operation)
+    }
+
+    // #MARK: - Throughput
+
+    /// Counts bytes received by a download. This can be called from any thread.
+    func record(bytes: Int) {
+        lock.lock()
+        bytesSinceSample += bytes
+        totalBytes += Int64(bytes)
+        lock.unlock()
+    }
+
+    // must be on the main thread
+    private func startSampling() {
+        guard sampleTimer == nil else {
+            return
+        }
+        sampleTimer = Timer.scheduledTimer(withTimeInterval: SBDownloadManager.sampleInterval, repeats: true) { [weak self] _ in
+            self?.sample()
+        }
+    }
+
+    // must be on the main thread
+    private func sample() {
+        lock.lock()
+        let bytes = bytesSinceSample
+        let total = totalBytes
+        bytesSinceSample = 0
+        lock.unlock()
+
+        let current = Double(bytes) / SBDownloadManager.sampleInterval
+        throughput = throughput * (1 - SBDownloadManager.smoothing) + current * SBDownloadManager.smoothing
+
+        if activeDownloads == 0 {
+            sampleTimer?.invalidate()
+            sampleTimer = nil
+            throughput = 0
+            logger.info("Downloads finished, \(total) bytes downloaded since launch")
+        }
+    }
+}
@@ -82,16 +82,37 @@ import SwiftUI
         }
     }
     
+    struct ThroughputView: View {
+        @ObservedObject var downloadManager = SBDownloadManager.shared
+        
+        var body: some View {
+            if downloadManager.activeDownloads > 0 {
+                HStack {
+                    Text("\(downloadManager.activeDownloads) tracks downloading")
+                    Spacer()
+                    Text("\(ByteCountFormatter.string(fromByteCount: Int64(downloadManager.throughput), countStyle: .file))/s")
+                        .monospacedDigit()
+                }
+                .foregroundColor(.secondary)
+                .padding(.horizontal, 14)
+                .padding(.vertical, 7)
+            }
+        }
+    }
+    
     struct DownloadsContentView: View {
         @ObservedObject var downloadsController: SBDownloadsController
         
         var body: some View {
-            // TODO: It would be nice if this was seamless to the toolbar like NSCollectionView was.
-            // TODO: Consistent row height.
-            List(downloadsController.activities) {
-                DownloadItemView(item: $0)
+            VStack(spacing: 0) {
+                // TODO: It would be nice if this was seamless to the toolbar like NSCollectionView was.
+                // TODO: Consistent row height.
+                List(downloadsController.activities) {
+                    DownloadItemView(item: $0)
+                }
+                .listStyle(.inset(alternatesRowBackgrounds: true))
+                ThroughputView()
             }
-            .listStyle(.inset(alternatesRowBackgrounds: true))
         }
     }
 }
@@ -0,0 +1,97 @@
+//
+//  SBIdentityMap.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+
+/// Maps Subsonic IDs to the managed objects that represent them, for the lifetime of a single operation.
+///
+/// Parsing a large response would otherwise do a single-row fetch for every element. Instead, the IDs a response refers to
+/// are fetched in bulk with `prefetch(ids:in:predicate:)`, and any objects created while parsing are recorded with `insert`.
+///
+/// An ID can map to multiple objects, since some entities (i.e. albums) aren't strictly unique per ID.
+class SBIdentityMap<T: SBMusicItem> {
+    private var objects: [String: [T]] = [:]
+    // IDs we've asked the store about, so a miss means it doesn't exist, rather than we don't know
+    private var knownIDs = Set<String>()
+
+    private(set) var hits = 0
+    private(set) var misses = 0
+
+    /// SQLite has a limit on the number of bound variables, so keep IN predicates under it.
+    static var batchSize: Int { 500 }
+
+    /// Fetches every object with an ID in `ids`, in batches. The predicate is ANDed with `itemId IN %@`.
+    func prefetch(ids: Set<String>, in context: NSManagedObjectContext, entityName: String, predicate: NSPredicate? = nil) throws {
+        let toFetch = Array(ids.subtracting(knownIDs))
+        for start in stride(from: 0, to: toFetch.count, by: SBIdentityMap.batchSize) {
+            let batch = Array(toFetch[start..<min(start + SBIdentityMap.batchSize, toFetch.count)])
+            let fetchRequest = NSFetchRequest<T>(entityName: entityName)
+            let idPredicate = NSPredicate(format: "itemId IN %@", batch)
+            if let predicate = predicate {
+                fetchRequest.predicate = NSCompoundPredicate(andPredicateWithSubpredicates: [idPredicate, predicate])
+            } else {
+                fetchRequest.predicate = idPredicate
+            }
+            fetchRequest.returnsObjectsAsFaults = false
+            for object in try context.fetch(fetchRequest) {
+                insert(object)
+            }
+            knownIDs.formUnion(batch)
+        }
+    }
+
+    /// Returns the candidates for an ID, an empty array if it's known not to exist, or nil if it hasn't been fetched.
+    func candidates(for id: String) -> [T]? {
+        if let found = objects[id] {
+            hits += 1
+            return found
+        } else if knownIDs.contains(id) {
+            hits += 1
+            return []
+        }
+        misses += 1
+        return nil
+    }
+
+    /// If every object for an ID has been fetched, so one that isn't among the candidates doesn't exist.
+    func isKnown(_ id: String) -> Bool {
+        knownIDs.contains(id)
+    }
+
+    /// Records an object that was created or fetched individually. The object must have its ID set.
+    ///
+    /// This doesn't make the ID known, since there could be others with it the store hasn't been asked about.
+    func insert(_ object: T) {
+        guard let id = object.itemId else {
+            return
+        }
+        if objects[id]?.contains(object) != true {
+            objects[id, default: []].append(object)
+        }
+    }
+
+    /// Records that the objects for an ID were looked up individually, even if none were found.
+    func record(_ found: [T], for id: String) {
+        knownIDs.insert(id)
+        for object in found {
+            insert(object)
+        }
+    }
+
+    /// Forgets everything, i.e. when the context has been reset and the objects are no longer valid.
+    func removeAll() {
+        objects.removeAll()
+        knownIDs.removeAll()
+    }
+
+    func remove(_ object: T) {
+        if let id = object.itemId {
+            objects[id]?.removeAll { $0 == object }
+        }
+    }
+}
@@ -8,22 +8,41 @@
 
 import Cocoa
 import UniformTypeIdentifiers
+import os
 
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBImportOperation")
+
+/// Imports files into the local library.
+///
+/// Files go through the import in batches, each batch going through three stages:
+///
+/// 1. Metadata is read from every file in the batch at once, across all cores.
+/// 2. Files are copied into the music directory (if needed) and covers written, a few at a time, since more than that
+///    just makes the disk seek.
+/// 3. The batch is merged into Core Data in one go, using lookup tables built once for the whole import, instead of
+///    fetching the artist, album, and track for every file.
+///
+/// Each batch is saved once merged, so a big import shows up as it goes, and memory use stays bounded.
 @objc class SBImportOperation: SBOperation {
     private let initialPaths: [URL]
-    
+
     var copyFiles = false
     var removeSourceFiles = false
-    
+
     var remoteTrack: SBTrack?
-    
+
+    /// How many files go through the pipeline at once.
+    static let batchSize = 250
+    /// How many files (or covers) are copied at once.
+    static let maxConcurrentCopies = 4
+
     @objc init!(managedObjectContext mainContext: NSManagedObjectContext!, files: [URL], copyFiles: Bool) {
         initialPaths = files
         remoteTrack = nil
         super.init(managedObjectContext: mainContext, name: "Importing Local Files")
         self.copyFiles = copyFiles
     }
-    
+
     init!(managedObjectContext mainContext: NSManagedObjectContext!, file: URL, remoteTrackID: NSManagedObjectID) {
         initialPaths = [file]
         // XXX: can't make it title without making name a published var
@@ -34,7 +53,15 @@ import UniformTypeIdentifiers
         self.removeSourceFiles = true
         self.copyFiles = true
     }
-    
+
+    static func isAudioFile(_ path: URL) -> Bool {
+        guard let type = UTType(filenameExtension: path.pathExtension) else {
+            return false
+        }
+        // M4A gets counted as video instead?
+        return type.conforms(to: .audio) || type.identifier == "public.mpeg-4"
+    }
+
     private func recursiveFiles(paths: [URL]) -> [URL] {
         // kinda ugly
         var finalPathList: [URL] = []
@@ -48,274 +75,615 @@ import UniformTypeIdentifiers
                 if let contents = try? FileManager.default.contentsOfDirectory(at: path, includingPropertiesForKeys: nil) {
                     finalPathList.append(contentsOf: recursiveFiles(paths: contents))
                 }
-            } else {
-                // check if it's an audio file
-                if let type = UTType(filenameExtension: path.pathExtension),
-                   // M4A gets counted as video instead?
-                   (type.conforms(to: .audio) || type.identifier == "public.mpeg-4") {
-                    finalPathList.append(path)
-                }
+            } else if SBImportOperation.isAudioFile(path) {
+                finalPathList.append(path)
             }
         }
         return finalPathList
     }
-    
-    // XXX: Factor this out into sep funcs and clean up the mess
-    private func importFile(path: URL) throws {
-        // #MARK: Step 1: Create Core Data objects
-        var titleString, artistString, albumArtistString, albumString, genreString, contentType: String?
-        var trackNumber, discNumber, durationNumber, bitrateNumber: NSNumber?
+
+    // #MARK: - Pipeline State
+
+    private struct AlbumKey: Hashable {
+        let artist: String
+        let album: String
+    }
+
+    /// Everything we need to know about a file before touching Core Data.
+    private struct ImportedFile {
+        let path: URL
+        var title = "Unknown Track"
+        var artist = "Unknown Artist"
+        var albumArtist = "Unknown Artist"
+        var album = "Unknown Album"
+        var genre, contentType: String?
+        var trackNumber, discNumber, duration, bitrate: NSNumber?
+        // only kept for the first file of an album, so a batch doesn't hold on to the same cover hundreds of times
         var coverData: Data?
-        if let remoteTrack = remoteTrack {
-            titleString = remoteTrack.itemName as String?
-            artistString = remoteTrack.artistName as String?
-            // first case is so that it matches the album's artist on the server
-            if let remoteAlbum = remoteTrack.album, let remoteAlbumArtist = remoteAlbum.artist {
-                albumArtistString = remoteAlbumArtist.itemName
-            } else if let albumArtistMaybe = remoteTrack.artistName as String?,
-               albumArtistMaybe != "" {
-                albumArtistString = albumArtistMaybe
-            } else {
-                albumArtistString = artistString
-            }
-            albumString = remoteTrack.albumString as String?
-            genreString = remoteTrack.genre as String?
-            trackNumber = remoteTrack.trackNumber
-            discNumber = remoteTrack.discNumber
-            durationNumber = remoteTrack.duration
-            bitrateNumber = remoteTrack.bitRate
-            contentType = remoteTrack.contentType
-            coverData = nil
-        } else if let metadata = try? SBAudioMetadata(URL: path as NSURL) {
-            titleString = metadata.title as String?
-            artistString = metadata.artist as String?
+        var size: Int64 = 0
+        var modificationDate: Date?
+
+        // Set by the copy stage. Relative to the music directory if the file was copied.
+        var trackPath: String?
+        var error: Error?
+
+        mutating func readFileAttributes() {
+            let values = try? path.resourceValues(forKeys: [.fileSizeKey, .contentModificationDateKey])
+            size = Int64(values?.fileSize ?? 0)
+            modificationDate = values?.contentModificationDate
+        }
+
+        var albumKey: AlbumKey {
+            AlbumKey(artist: albumArtist, album: album)
+        }
+
+        init(path: URL) {
+            self.path = path
+        }
+    }
+
+    private enum CopyJob {
+        case track(Int)
+        case embeddedCover(AlbumKey, Data)
+        case folderCover(AlbumKey, URL)
+    }
+
+    private let coverLock = NSLock()
+    // albums that already have a cover from a file's embedded art
+    private var claimedCovers = Set<AlbumKey>()
+    // albums we've already looked in the folder for a cover for
+    private var searchedCoverFolders = Set<AlbumKey>()
+    // covers stored by the copy stage, for the merge stage to use
+    private var coverFiles: [AlbumKey: SBCoverStore.StoredFile] = [:]
+    // stored covers we've already got a CoverFile for, only used in the threaded context
+    private var coverFilesByName: [String: SBCoverFile] = [:]
+
+    private struct AlbumLookupKey: Hashable {
+        // the context retains its objects, so their identity is stable for the whole import, unlike temporary IDs
+        let artist: ObjectIdentifier
+        let album: String
+    }
+
+    // Built once per import by the merge stage; objects it inserts are added as it goes.
+    private var library: SBLibrary?
+    private var artistsByName: [String: SBArtist] = [:]
+    private var albumsByArtist: [AlbumLookupKey: SBAlbum] = [:]
+    private var tracksByName: [String: SBTrack] = [:]
+    // linked tracks, so re-importing a changed file updates its track
+    private var tracksByPath: [String: SBTrack] = [:]
+    // albums re-imported tracks were in, which their new tags could have left empty
+    private var previousAlbums = Set<SBAlbum>()
+
+    // #MARK: - Statistics
+
+    struct StageStatistics: CustomStringConvertible {
+        let name: String
+        private(set) var files = 0
+        private(set) var bytes: Int64 = 0
+        private(set) var elapsed: TimeInterval = 0
+
+        init(name: String) {
+            self.name = name
+        }
+
+        mutating func record(files: Int, bytes: Int64, since start: Date) {
+            self.files += files
+            self.bytes += bytes
+            self.elapsed += Date().timeIntervalSince(start)
+        }
+
+        var description: String {
+            let seconds = max(elapsed, 0.001)
+            let filesPerSecond = Double(files) / seconds
+            let megabytesPerSecond = Double(bytes) / 1_000_000 / seconds
+            return String(format: "%@: %d files in %.2f s (%.1f files/s, %.1f MB/s)",
+                          name, files, elapsed, filesPerSecond, megabytesPerSecond)
+        }
+    }
+
+    // Throughput of each stage, logged at the end of the import.
+    private(set) var metadataStatistics = StageStatistics(name: "Metadata")
+    private(set) var copyStatistics = StageStatistics(name: "Copy")
+    private(set) var mergeStatistics = StageStatistics(name: "Merge")
+
+    // #MARK: - Stage 1: Metadata
+
+    private func claimCover(for album: AlbumKey) -> Bool {
+        coverLock.lock()
+        defer { coverLock.unlock() }
+        return claimedCovers.insert(album).inserted
+    }
+
+    private func readMetadata(path: URL) -> ImportedFile {
+        var file = ImportedFile(path: path)
+        if let metadata = try? SBAudioMetadata(URL: path as NSURL) {
+            file.title = metadata.title as String? ?? file.title
+            file.artist = metadata.artist as String? ?? file.artist
             if let albumArtistMaybe = metadata.albumArtist as String?,
                albumArtistMaybe != "" {
-                albumArtistString = albumArtistMaybe
+                file.albumArtist = albumArtistMaybe
             } else {
-                albumArtistString = artistString
-            }
-            albumString = metadata.albumTitle as String?
-            genreString = metadata.genre as String?
-            trackNumber = metadata.trackNumber
-            discNumber = metadata.discNumber
-            durationNumber = metadata.duration
-            bitrateNumber = metadata.bitrate
-            coverData = metadata.albumArt as Data?
+                file.albumArtist = file.artist
+            }
+            file.album = metadata.albumTitle as String? ?? file.album
+            file.genre = metadata.genre as String?
+            file.trackNumber = metadata.trackNumber
+            file.discNumber = metadata.discNumber
+            file.duration = metadata.duration
+            file.bitrate = metadata.bitrate
+            if let albumArt = metadata.albumArt as Data?, claimCover(for: file.albumKey) {
+                file.coverData = albumArt
+            }
             if let extensionType = UTType(filenameExtension: path.pathExtension),
                let mime = extensionType.preferredMIMEType {
-                contentType = mime
+                file.contentType = mime
             }
         }
-        
-        // set these if non-existent
-        titleString = titleString ?? "Unknown Track"
-        albumArtistString = albumArtistString ?? "Unknown Artist"
-        artistString = artistString ?? "Unknown Artist"
-        albumString = albumString ?? "Unknown Album"
-        
-        // create artist if needed
-        let artistRequest: NSFetchRequest<SBArtist> = SBArtist.fetchRequest()
-        artistRequest.predicate = NSPredicate(format: "(itemName == %@) && (server == nil)", albumArtistString!)
-        var newArtist = try? threadedContext.fetch(artistRequest).first
-        if newArtist == nil {
-            newArtist = SBArtist.init(entity: SBArtist.entity(), insertInto: threadedContext)
-            newArtist!.itemName = albumArtistString
+        file.readFileAttributes()
+        return file
+    }
+
+    /// Downloaded tracks use the server's metadata, so they match what's already in the remote library.
+    private func readRemoteMetadata(path: URL, remoteTrack: SBTrack) -> ImportedFile {
+        var file = ImportedFile(path: path)
+        threadedContext.performAndWait {
+            file.title = remoteTrack.itemName ?? file.title
+            file.artist = remoteTrack.artistName ?? file.artist
+            // first case is so that it matches the album's artist on the server
+            if let remoteAlbum = remoteTrack.album, let remoteAlbumArtist = remoteAlbum.artist {
+                file.albumArtist = remoteAlbumArtist.itemName ?? file.albumArtist
+            } else if let albumArtistMaybe = remoteTrack.artistName,
+               albumArtistMaybe != "" {
+                file.albumArtist = albumArtistMaybe
+            } else {
+                file.albumArtist = file.artist
+            }
+            file.album = remoteTrack.albumString ?? file.album
+            file.genre = remoteTrack.genre
+            file.trackNumber = remoteTrack.trackNumber
+            file.discNumber = remoteTrack.discNumber
+            file.duration = remoteTrack.duration
+            file.bitrate = remoteTrack.bitRate
+            file.contentType = remoteTrack.contentType
         }
-        
-        // create album if needed
-        let albumRequest: NSFetchRequest<SBAlbum> = SBAlbum.fetchRequest()
-        albumRequest.predicate = NSPredicate(format: "(itemName == %@) && (artist == %@)", albumString!, newArtist!)
-        var newAlbum = try? threadedContext.fetch(albumRequest).first
-        if newAlbum == nil {
-            newAlbum = SBAlbum.init(entity: SBAlbum.entity(), insertInto: threadedContext)
-            newAlbum!.itemName = albumString
+        file.readFileAttributes()
+        return file
+    }
+
+    private func readMetadata(paths: [URL]) -> [ImportedFile] {
+        if let remoteTrack = self.remoteTrack {
+            return paths.map { readRemoteMetadata(path: $0, remoteTrack: remoteTrack) }
         }
-        
-        // create track if needed
-        let trackRequest: NSFetchRequest<SBTrack> = SBTrack.fetchRequest()
-        trackRequest.predicate = NSPredicate(format: "(itemName == %@) && (server == nil)", titleString!)
-        var newTrack = try? threadedContext.fetch(trackRequest).first
-        if newTrack == nil {
-            newTrack = SBTrack.init(entity: SBTrack.entity(), insertInto: threadedContext)
-            newTrack!.itemName = titleString
-            
-            newTrack!.bitRate = bitrateNumber
-            newTrack!.duration = durationNumber
-            newTrack!.trackNumber = trackNumber
-            newTrack!.discNumber = discNumber
-            newTrack!.genre = genreString
-            newTrack!.contentType = contentType
-            // not the album artist
-            newTrack!.artistName = artistString
-        }
-        
-        if !newAlbum!.tracks!.contains(newTrack!) {
-            newAlbum!.addToTracks(newTrack!)
-        }
-        
-        if !newArtist!.albums!.contains(newAlbum!) {
-            newArtist?.addToAlbums(newAlbum!)
-        }
-        
-        let libraryRequest = NSFetchRequest<SBLibrary>(entityName: "Library")
-        let library = try! threadedContext.fetch(libraryRequest).first!
-        if !library.artists!.contains(newArtist!) {
-            library.addToArtists(newArtist!)
+        var files = paths.map { ImportedFile(path: $0) }
+        files.withUnsafeMutableBufferPointer { buffer in
+            DispatchQueue.concurrentPerform(iterations: buffer.count) { i in
+                buffer[i] = readMetadata(path: buffer[i].path)
+            }
+        }
+        return files
+    }
+
+    // #MARK: - Stage 2: Filesystem
+
+    /// Works out what needs copying. Covers are only written once per album for the whole import.
+    private func copyJobs(files: inout [ImportedFile]) -> [CopyJob] {
+        var jobs: [CopyJob] = []
+        coverLock.lock()
+        defer { coverLock.unlock() }
+        for i in files.indices {
+            if copyFiles || removeSourceFiles {
+                jobs.append(.track(i))
+            }
+            let album = files[i].albumKey
+            if let coverData = files[i].coverData {
+                jobs.append(.embeddedCover(album, coverData))
+                files[i].coverData = nil
+            } else if !claimedCovers.contains(album), searchedCoverFolders.insert(album).inserted {
+                jobs.append(.folderCover(album, files[i].path.deletingLastPathComponent()))
+            }
         }
-        
-        // #MARK: Step 2: Filesystem
+        return jobs
+    }
+
+    private func copyTrack(_ file: inout ImportedFile) throws {
         if copyFiles {
-            let artistPath = albumArtistString!
-            let albumPath = artistPath + "/" + albumString!
+            let artistPath = file.albumArtist
+            let albumPath = artistPath + "/" + file.album
             // Before the refactor, temporaryFileURL provided us a random filename.
             // Let's try to keep the same semantics to avoid i.e. clobbering with
             // re-imports? (Is this needed?)
-            let trackType = UTType(filenameExtension: path.pathExtension) ?? UTType.mp3
+            let trackType = UTType(filenameExtension: file.path.pathExtension) ?? UTType.mp3
             let fileName = UUID().uuidString + "." + trackType.preferredFilenameExtension!
             let trackPath = albumPath + "/" + fileName
-            
+
             let absoluteAlbumURL = SBAppDelegate.musicDirectory.appendingPathComponent(albumPath)
             let absoluteTrackURL = SBAppDelegate.musicDirectory.appendingPathComponent(trackPath)
-            
+
             // create artist and album directory if needed
             try FileManager.default.createDirectory(at: absoluteAlbumURL, withIntermediateDirectories: true)
-            
+
             // copy track to new destination...
-            try FileManager.default.copyItem(at: path, to: absoluteTrackURL)
-            
+            try FileManager.default.copyItem(at: file.path, to: absoluteTrackURL)
+
             // ...but use the relative path. remote paths are already relative
-            newTrack!.path = trackPath
-            newAlbum!.path = albumPath
-            newArtist!.path = artistPath
-        } else {
-            // absolute path ok here
-            newTrack!.path = path.path
-        }
-        
-        // #MARK: Step 3: Cover
-        let coverDir = SBAppDelegate.coverDirectory.appendingPathComponent("Local Library")
-        if let coverData = coverData {
-            var coverType = UTType.jpeg
-            if let coverTypeGuess = coverData.guessImageType() {
-                coverType = coverTypeGuess
-            }
-            let artistCoverDir = coverDir.appendingPathComponent(albumArtistString!)
-            
-            try? FileManager.default.createDirectory(at: artistCoverDir, withIntermediateDirectories: true)
-            
-            let finalPath = artistCoverDir
-                .appendingPathComponent(albumString!)
-                .appendingPathExtension(for: coverType)
-            try coverData.write(to: finalPath, options: [.atomic])
-            
-            let relativePath = "\(albumArtistString!)/\(albumString!).\(coverType.preferredFilenameExtension!)"
-            // HACK: check if cover in album is nil; usually somehow track's isn't
-            if newAlbum!.cover == nil {
-                newAlbum!.cover = SBCover.init(entity: SBCover.entity(), insertInto: threadedContext)
+            file.trackPath = trackPath
+        }
+
+        if removeSourceFiles {
+            try FileManager.default.removeItem(at: file.path)
+        }
+    }
+
+    /// Stores the first image in the track's folder that looks like a front cover.
+    private func copyFolderCover(from folder: URL) throws -> SBCoverStore.StoredFile? {
+        guard let albumFiles = try? FileManager.default.contentsOfDirectory(atPath: folder.path) else {
+            return nil
+        }
+        for fileName in albumFiles.sorted() {
+            let fullPath = folder.appendingPathComponent(fileName)
+            guard let type = UTType(filenameExtension: fullPath.pathExtension),
+                  type.conforms(to: .image),
+                  // XXX: Better heuristic for getting the right cover name
+                  !fileName.contains("back") else {
+                continue
             }
-            newAlbum!.cover!.imagePath = relativePath as NSString?
-            newAlbum!.cover!.isLocal = NSNumber(booleanLiteral: true)
-        } else {
-            // else if track parent directory contains cover file
-            let originalAlbumFolder = path.deletingLastPathComponent()
-            
-            if let albumFiles = try? FileManager.default.contentsOfDirectory(atPath: originalAlbumFolder.path) {
-                for fileName in albumFiles {
-                    let fullPath = originalAlbumFolder
-                        .appendingPathComponent(fileName)
-                    if let type = UTType(filenameExtension: fullPath.pathExtension),
-                       type.conforms(to: .image),
-                       // XXX: Better heuristic for getting the right cover name
-                       !fileName.contains("back") {
-                        // Copy the artwork
-                        let artistCoverDir = coverDir.appendingPathComponent(albumArtistString!)
-                        try? FileManager.default.createDirectory(at: artistCoverDir, withIntermediateDirectories: true)
-                        
-                        let finalPath = artistCoverDir
-                            .appendingPathComponent(fileName)
-                            .appendingPathExtension(for: type)
-                        // if needed overwrite in case of remannts
-                        if FileManager.default.fileExists(atPath: finalPath.path) {
-                            try FileManager.default.removeItem(at: finalPath)
+            // Copy the artwork, unless an album already has the same image
+            return try SBCoverStore.shared.write(contentsOf: fullPath)
+        }
+        return nil
+    }
+
+    /// Runs the copy jobs a few at a time, returning how many bytes of tracks were copied.
+    private func copy(files: inout [ImportedFile], jobs: [CopyJob]) -> Int64 {
+        guard !jobs.isEmpty else {
+            return 0
+        }
+        let lanes = min(SBImportOperation.maxConcurrentCopies, jobs.count)
+        let bytesLock = NSLock()
+        var bytesCopied: Int64 = 0
+
+        files.withUnsafeMutableBufferPointer { buffer in
+            // Each lane takes every nth job, so at most `lanes` copies are running.
+            DispatchQueue.concurrentPerform(iterations: lanes) { lane in
+                for job in stride(from: lane, to: jobs.count, by: lanes).map({ jobs[$0] }) {
+                    switch job {
+                    case .track(let i):
+                        do {
+                            try copyTrack(&buffer[i])
+                            if copyFiles {
+                                bytesLock.lock()
+                                bytesCopied += buffer[i].size
+                                bytesLock.unlock()
+                            }
+                        } catch {
+                            buffer[i].error = error
                         }
-                        try FileManager.default.copyItem(at: fullPath, to: finalPath)
-                        
-                        let relativePath = "\(albumArtistString!)/\(albumString!).\(type.preferredFilenameExtension!)"
-                        
-                        // same as above
-                        if newAlbum!.cover == nil {
-                            newAlbum!.cover = SBCover.init(entity: SBCover.entity(), insertInto: threadedContext)
+                    case .embeddedCover(let album, let coverData):
+                        do {
+                            let stored = try SBCoverStore.shared.write(coverData)
+                            coverLock.lock()
+                            coverFiles[album] = stored
+                            coverLock.unlock()
+                        } catch {
+                            logger.error("Couldn't write cover for \(album.album, privacy: .public): \(error, privacy: .public)")
+                        }
+                    case .folderCover(let album, let folder):
+                        do {
+                            if let stored = try copyFolderCover(from: folder) {
+                                coverLock.lock()
+                                // an embedded cover for the same album wins
+                                if coverFiles[album] == nil {
+                                    coverFiles[album] = stored
+                                }
+                                coverLock.unlock()
+                            }
+                        } catch {
+                            logger.error("Couldn't copy cover for \(album.album, privacy: .public): \(error, privacy: .public)")
                         }
-                        newAlbum!.cover!.imagePath = relativePath as NSString?
-                        newAlbum!.cover!.isLocal = NSNumber(booleanLiteral: true)
-                        // Don't set the track cover, since it's not really used.
                     }
                 }
             }
         }
-        
-        // #MARK: Step 4: Finishing up
-        newTrack!.isLinked = NSNumber.init(booleanLiteral: !copyFiles)
-        newAlbum!.isLinked = NSNumber.init(booleanLiteral: !copyFiles)
-        newArtist!.isLinked = NSNumber.init(booleanLiteral: !copyFiles)
-        newTrack!.isLocal = NSNumber.init(booleanLiteral: true)
-        newAlbum!.isLocal = NSNumber.init(booleanLiteral: true)
-        newArtist!.isLocal = NSNumber.init(booleanLiteral: true)
-        
-        if removeSourceFiles {
-            try FileManager.default.removeItem(at: path)
+        return bytesCopied
+    }
+
+    // #MARK: - Stage 3: Core Data
+
+    /// Loads the local library into lookup tables, so merging doesn't need to fetch for every file.
+    private func buildLookupTables() {
+        let libraryRequest = NSFetchRequest<SBLibrary>(entityName: "Library")
+        library = try! threadedContext.fetch(libraryRequest).first!
+
+        let artistRequest: NSFetchRequest<SBArtist> = SBArtist.fetchRequest()
+        artistRequest.predicate = NSPredicate(format: "server == nil")
+        artistRequest.returnsObjectsAsFaults = false
+        for artist in (try? threadedContext.fetch(artistRequest)) ?? [] {
+            if let name = artist.itemName, artistsByName[name] == nil {
+                artistsByName[name] = artist
+            }
+        }
+
+        let albumRequest: NSFetchRequest<SBAlbum> = SBAlbum.fetchRequest()
+        albumRequest.predicate = NSPredicate(format: "(artist != nil) && (artist.server == nil)")
+        albumRequest.returnsObjectsAsFaults = false
+        for album in (try? threadedContext.fetch(albumRequest)) ?? [] {
+            if let name = album.itemName, let artist = album.artist {
+                let key = AlbumLookupKey(artist: ObjectIdentifier(artist), album: name)
+                if albumsByArtist[key] == nil {
+                    albumsByArtist[key] = album
+                }
+            }
+        }
+
+        let trackRequest: NSFetchRequest<SBTrack> = SBTrack.fetchRequest()
+        trackRequest.predicate = NSPredicate(format: "server == nil")
+        trackRequest.returnsObjectsAsFaults = false
+        for track in (try? threadedContext.fetch(trackRequest)) ?? [] {
+            if let name = track.itemName, tracksByName[name] == nil {
+                tracksByName[name] = track
+            }
+            if track.isLinked?.boolValue == true, let path = track.path {
+                tracksByPath[path] = track
+            }
+        }
+
+        logger.info("Import lookup has \(self.artistsByName.count) artists, \(self.albumsByArtist.count) albums, \(self.tracksByName.count) tracks")
+    }
+
+    private func update(track: SBTrack, from file: ImportedFile) {
+        track.itemName = file.title
+
+        track.bitRate = file.bitrate
+        track.duration = file.duration
+        track.trackNumber = file.trackNumber
+        track.discNumber = file.discNumber
+        track.genre = file.genre
+        track.contentType = file.contentType
+        // not the album artist
+        track.artistName = file.artist
+    }
+
+    private func merge(file: ImportedFile, library: SBLibrary) {
+        // create artist if needed
+        let newArtist: SBArtist
+        if let existing = artistsByName[file.albumArtist] {
+            newArtist = existing
+        } else {
+            newArtist = SBArtist.init(entity: SBArtist.entity(), insertInto: threadedContext)
+            newArtist.itemName = file.albumArtist
+            artistsByName[file.albumArtist] = newArtist
+        }
+
+        // create album if needed
+        let albumKey = AlbumLookupKey(artist: ObjectIdentifier(newArtist), album: file.album)
+        let newAlbum: SBAlbum
+        if let existing = albumsByArtist[albumKey] {
+            newAlbum = existing
+        } else {
+            newAlbum = SBAlbum.init(entity: SBAlbum.entity(), insertInto: threadedContext)
+            newAlbum.itemName = file.album
+            albumsByArtist[albumKey] = newAlbum
+        }
+
+        // create track if needed
+        let newTrack: SBTrack
+        if !copyFiles, let existing = tracksByPath[file.path.path] {
+            // a linked file we already have, which must have changed, so take its tags again
+            newTrack = existing
+            if let previousAlbum = existing.album {
+                previousAlbums.insert(previousAlbum)
+            }
+            update(track: newTrack, from: file)
+        } else if let existing = tracksByName[file.title] {
+            newTrack = existing
+        } else {
+            newTrack = SBTrack.init(entity: SBTrack.entity(), insertInto: threadedContext)
+            update(track: newTrack, from: file)
+            tracksByName[file.title] = newTrack
+        }
+
+        if !newAlbum.tracks!.contains(newTrack) {
+            newAlbum.addToTracks(newTrack)
+        }
+
+        if !newArtist.albums!.contains(newAlbum) {
+            newArtist.addToAlbums(newAlbum)
+        }
+
+        if !library.artists!.contains(newArtist) {
+            library.addToArtists(newArtist)
+        }
+
+        if let trackPath = file.trackPath {
+            newTrack.path = trackPath
+            newAlbum.path = file.albumArtist + "/" + file.album
+            newArtist.path = file.albumArtist
+        } else {
+            // absolute path ok here
+            newTrack.path = file.path.path
+            // so a rescan can tell if the file changed
+            newTrack.size = NSNumber(value: file.size)
+            newTrack.fileModificationDate = file.modificationDate
+            tracksByPath[file.path.path] = newTrack
         }
-        
+
+        coverLock.lock()
+        let storedCover = coverFiles[file.albumKey]
+        coverLock.unlock()
+        if let storedCover = storedCover {
+            // HACK: check if cover in album is nil; usually somehow track's isn't
+            if newAlbum.cover == nil {
+                newAlbum.cover = SBCover.init(entity: SBCover.entity(), insertInto: threadedContext)
+            }
+            if newAlbum.cover!.file?.name != storedCover.name {
+                newAlbum.cover!.imagePath = nil
+                newAlbum.cover!.file = coverFile(for: storedCover)
+            }
+            newAlbum.cover!.isLocal = NSNumber(booleanLiteral: true)
+            // Don't set the track cover, since it's not really used.
+        }
+
+        newTrack.isLinked = NSNumber.init(booleanLiteral: !copyFiles)
+        newAlbum.isLinked = NSNumber.init(booleanLiteral: !copyFiles)
+        newArtist.isLinked = NSNumber.init(booleanLiteral: !copyFiles)
+        newTrack.isLocal = NSNumber.init(booleanLiteral: true)
+        newAlbum.isLocal = NSNumber.init(booleanLiteral: true)
+        newArtist.isLocal = NSNumber.init(booleanLiteral: true)
+
         // Does this come from a stream?
         if let remoteTrack = self.remoteTrack {
             remoteTrack.localTrack = newTrack
-            newTrack!.remoteTrack = remoteTrack
-            
+            newTrack.remoteTrack = remoteTrack
+            // counts against the download limit
+            newTrack.size = NSNumber(value: file.size)
+            SBOfflineCache.shared.didAdd(track: newTrack, bytes: file.size)
+
             // XXX: Does this make sense? ObjC version did it
-            if newAlbum!.cover == nil {
-                newAlbum!.cover = SBCover.init(entity: SBCover.entity(), insertInto: threadedContext)
-            }
-            
-            if let remoteCoverPath = remoteTrack.album?.cover?.imagePath {
-                let basePath = newAlbum!.cover!.coversDir()!
-                let relativePath = "\(albumArtistString!)/\(albumString!).\(remoteCoverPath.pathExtension)"
-                let newAbsolutePath = basePath.appendingPathComponent(relativePath)
-                do {
-                    // Make a copy in local library covers to avoid crossing the streams
-                    try FileManager.default.copyItem(atPath: remoteCoverPath as String, toPath: newAbsolutePath)
-                    newAlbum!.cover!.imagePath = remoteTrack.album?.cover?.imagePath
-                } catch {
-                    // not fatal
+            if newAlbum.cover == nil {
+                newAlbum.cover = SBCover.init(entity: SBCover.entity(), insertInto: threadedContext)
+            }
+
+            // The local album can share the remote cover's file, since it's the same image
+            if let remoteFile = remoteTrack.album?.cover?.file {
+                newAlbum.cover!.imagePath = nil
+                newAlbum.cover!.file = remoteFile
+            } else if let remoteCoverPath = remoteTrack.album?.cover?.imagePath,
+                      let stored = try? SBCoverStore.shared.write(contentsOf: URL(fileURLWithPath: remoteCoverPath as String)) {
+                newAlbum.cover!.imagePath = nil
+                newAlbum.cover!.file = coverFile(for: stored)
+            }
+        }
+    }
+
+    // must be called from the threaded context
+    private func coverFile(for stored: SBCoverStore.StoredFile) -> SBCoverFile {
+        if let existing = coverFilesByName[stored.name] {
+            return existing
+        }
+        let file = SBCoverStore.shared.file(for: stored, in: threadedContext)
+        coverFilesByName[stored.name] = file
+        return file
+    }
+
+    /// Merges the files that made it through the copy stage, returning how many did.
+    private func merge(files: [ImportedFile]) -> Int {
+        var merged = 0
+        threadedContext.performAndWait {
+            if library == nil {
+                buildLookupTables()
+            }
+            for file in files where file.error == nil {
+                merge(file: file, library: library!)
+                merged += 1
+            }
+        }
+        return merged
+    }
+
+    /// Removes albums that re-imported tracks moved out of if they're empty now, and then artists left without albums.
+    /// This is only done at the end, since a later batch could still put tracks in them.
+    private func removeEmptyPreviousAlbums() {
+        guard !previousAlbums.isEmpty else {
+            return
+        }
+        threadedContext.performAndWait {
+            var artists = Set<SBArtist>()
+            for album in previousAlbums where !album.isDeleted && album.tracks?.count == 0 {
+                logger.info("Removing album left empty by re-importing \"\(album.itemName ?? "<nil>", privacy: .public)\"")
+                if let artist = album.artist {
+                    artists.insert(artist)
                 }
+                threadedContext.delete(album)
+            }
+            // the deletes need to be processed for the artists' albums to be empty
+            threadedContext.processPendingChanges()
+            for artist in artists where !artist.isDeleted && artist.server == nil && artist.albums?.count == 0 {
+                logger.info("Removing artist left empty by re-importing \"\(artist.itemName ?? "<nil>", privacy: .public)\"")
+                threadedContext.delete(artist)
             }
         }
+        previousAlbums.removeAll()
     }
-    
+
+    // #MARK: - Operation
+
     override func main() {
         DispatchQueue.main.async {
             self.operationInfo = "Finding files"
         }
         let paths = recursiveFiles(paths: initialPaths)
-        // XXX: do we fail at first error or let the other files continue?
-        do {
-            var i = Float(0)
-            let total = Float(paths.count)
-            for path in paths {
-                DispatchQueue.main.async {
-                    self.operationInfo = "Importing \(path)"
-                    self.progress = .determinate(n: i, outOf: total)
+        let total = Float(paths.count)
+
+        // Other files carry on if one fails; the first failure gets shown at the end.
+        var firstError: Error?
+        var failed = 0
+
+        for batchStart in stride(from: 0, to: paths.count, by: SBImportOperation.batchSize) {
+            if isCancelled {
+                break
+            }
+            let batch = Array(paths[batchStart..<min(batchStart + SBImportOperation.batchSize, paths.count)])
+            let done = Float(batchStart)
+
+            DispatchQueue.main.async {
+                self.operationInfo = "Reading \(batch.count) files"
+                self.progress = .determinate(n: done, outOf: total)
+            }
+            var start = Date()
+            var files = readMetadata(paths: batch)
+            metadataStatistics.record(files: files.count, bytes: files.reduce(0) { $0 + $1.size }, since: start)
+
+            DispatchQueue.main.async {
+                self.operationInfo = self.copyFiles ? "Copying \(batch.count) files" : "Copying covers"
+            }
+            start = Date()
+            let jobs = copyJobs(files: &files)
+            let bytesCopied = copy(files: &files, jobs: jobs)
+            copyStatistics.record(files: copyFiles ? files.count : 0, bytes: bytesCopied, since: start)
+
+            for file in files {
+                if let error = file.error {
+                    logger.error("Couldn't import \(file.path.path, privacy: .public): \(error, privacy: .public)")
+                    failed += 1
+                    firstError = firstError ?? error
                 }
-                try importFile(path: path)
-                i += 1
             }
-        } catch {
+
+            DispatchQueue.main.async {
+                self.operationInfo = "Adding \(batch.count) files to library"
+            }
+            start = Date()
+            let merged = merge(files: files)
+            saveThreadedContext()
+            mergeStatistics.record(files: merged, bytes: 0, since: start)
+        }
+
+        removeEmptyPreviousAlbums()
+
+        if !copyFiles {
+            let folders = initialPaths.filter { (try? $0.resourceValues(forKeys: [.isDirectoryKey]))?.isDirectory == true }
+            if !folders.isEmpty {
+                SBLibraryRescanOperation.remember(folders: folders)
+            }
+        }
+
+        logger.info("Imported \(mergeStatistics.files) of \(paths.count) files, \(failed) failed")
+        logger.info("\(metadataStatistics, privacy: .public)")
+        logger.info("\(copyStatistics, privacy: .public)")
+        logger.info("\(mergeStatistics, privacy: .public)")
+
+        if let error = firstError {
             DispatchQueue.main.async {
                 NSApp.presentError(error)
             }
         }
         // finally
         saveThreadedContext()
+        if remoteTrack != nil {
+            DispatchQueue.main.async {
+                SBOfflineCache.shared.evictIfNeeded()
+            }
+        }
         finish()
     }
 }
@@ -59,13 +59,48 @@ extension NSNotification.Name {
         // used for quick look preview
         @State var coverUrl: URL?
         
+        // The cover is decoded off the main thread, keep which one it was since the selection can change while it is
+        @State private var loadedCover: (path: String, image: NSImage?)?
+        
         // horrific, but basically SBAlbum?? == nil -> difference in album between selection (i.e. in a playlist)
         // SBAlbum? == nil -> nil album in tracks
         let album: SBAlbum??
         
+        private var singularAlbum: SBAlbum? {
+            if let singularAlbum = self.album, let album = singularAlbum {
+                return album
+            }
+            return nil
+        }
+        
+        private var coverPath: String? {
+            singularAlbum?.cover?.imagePath as String?
+        }
+        
+        // the placeholder is shown until it's decoded
+        private var coverImage: NSImage? {
+            guard let album = singularAlbum, let path = coverPath else {
+                return nil
+            }
+            if let loadedCover = self.loadedCover, loadedCover.path == path {
+                return loadedCover.image
+            }
+            return SBCoverCache.shared.cachedImage(for: album, pixelSize: SBCoverCache.inspectorPixelSize) ?? SBAlbum.nullCover
+        }
+        
         var body: some View {
-            if let singularAlbum = self.album,
-               let path = singularAlbum?.cover?.imagePath, let image = NSImage(contentsOfFile: path as String) {
+            albumArt
+                .task(id: coverPath) {
+                    guard let album = singularAlbum, let path = coverPath else {
+                        return
+                    }
+                    let image = await SBCoverCache.shared.loadImage(for: album, pixelSize: SBCoverCache.inspectorPixelSize)
+                    loadedCover = (path: path, image: image)
+                }
+        }
+        
+        @ViewBuilder private var albumArt: some View {
+            if let path = coverPath, let image = coverImage {
                 Image(nsImage: image)
                     .resizable()
                     .scaledToFit()
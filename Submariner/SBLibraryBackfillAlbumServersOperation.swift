@@ -0,0 +1,55 @@
+//
+//  SBLibraryBackfillAlbumServersOperation.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryBackfillAlbumServersOperation")
+
+/// Sets the server on remote albums from before the relationship existed (v11 of the model).
+///
+/// The migration from v10 is lightweight, so it can't fill this in by itself. Album lookups in the parser depend on it,
+/// so this must run before any server requests get parsed.
+class SBLibraryBackfillAlbumServersOperation: SBOperation {
+    init(managedObjectContext: NSManagedObjectContext) {
+        super.init(managedObjectContext: managedObjectContext, name: "Updating Albums")
+    }
+
+    override func main() {
+        defer {
+            saveThreadedContext()
+            finish()
+        }
+        DispatchQueue.main.async {
+            self.operationInfo = "Associating albums with servers"
+        }
+        backfillAlbumServers()
+    }
+
+    private func backfillAlbumServers() {
+        let fetchRequest: NSFetchRequest<SBAlbum> = SBAlbum.fetchRequest()
+        fetchRequest.predicate = NSPredicate(format: "(server == nil) && ((isLocal == NO) || (isLocal == nil))")
+        fetchRequest.relationshipKeyPathsForPrefetching = ["artist"]
+        fetchRequest.fetchBatchSize = 500
+        guard let albums = try? threadedContext.fetch(fetchRequest), albums.count > 0 else {
+            return
+        }
+
+        let startDate = Date()
+        var updated = 0
+        for album in albums {
+            // Artists belong to a server directly, tracks are the fallback if it's somehow missing
+            let tracks = album.tracks as? Set<SBTrack>
+            if let server = album.artist?.server ?? tracks?.first(where: { $0.server != nil })?.server {
+                album.server = server
+                updated += 1
+            }
+        }
+        logger.info("Set the server on \(updated) of \(albums.count) albums in \(Date().timeIntervalSince(startDate), format: .fixed(precision: 2)) seconds")
+    }
+}
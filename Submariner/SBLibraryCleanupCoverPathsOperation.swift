@@ -13,76 +13,134 @@ import os
 
 fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryCleanupCoverPathsOperation")
 
+/// Makes absolute cover paths relative to their cover directory, copying the file there if it's somewhere else.
+///
+/// Each cover ends up with its own path, so this can't be a batch update. Instead, covers are loaded a batch at a time,
+/// their files copied a few at a time, and the context saved and emptied after each batch, so memory use stays bounded.
 class SBLibraryCleanupCoverPathsOperation: SBOperation {
+    static let batchSize = 500
+    
+    private struct Plan {
+        let cover: SBCover
+        let fileName: String
+        // if the file needs to be copied first
+        var copy: (from: String, to: String)?
+    }
+    
     init(managedObjectContext: NSManagedObjectContext) {
         super.init(managedObjectContext: managedObjectContext, name: "Updating Cover Paths")
     }
     
     override func main() {
+        var report = SBMaintenanceReport(name: "Cover path cleanup")
         defer {
             saveThreadedContext()
+            logger.info("\(report, privacy: .public)")
             finish()
         }
         DispatchQueue.main.async {
             self.operationInfo = "Cleaning cover paths"
         }
-        cleanupCoverPaths()
+        cleanupCoverPaths(report: &report)
         // XXX: Do tracks/albums/artists have similar issues?
     }
     
-    private func replaceCoverPath(cover: SBCover, currentPath: NSString, newPath: String, fileName: String) {
+    private func plan(_ cover: SBCover) -> Plan? {
+        let baseCoverDir = SBAppDelegate.coverDirectory
+        let currentPath = cover.primitiveValue(forKey: "imagePath") as! NSString?
+        // XXX: SBImportOperation was setting this, but SBSubsonicParsingOperation was not
+        let fallbackPath = cover.primitiveValue(forKey: "path") as! NSString?
+        guard let currentPath = currentPath ?? fallbackPath, let coversDir = cover.coversDir() else {
+            return nil
+        }
+        // If the path matches the prefix, do it, otherwise move the file
+        let fileName = currentPath.lastPathComponent
+        if currentPath.hasPrefix(coversDir as String) {
+            // Prefix matches, just update the DB entry
+            logger.info("Changing absolute cover path \"\(currentPath)\" to \"\(fileName)\"")
+            return Plan(cover: cover, fileName: fileName)
+        } else if currentPath.hasPrefix(baseCoverDir.path) {
+            // This might be for a different server than ours (or none)
+            // Common case was importing a remote track; we used to just
+            // refer to the path of the cover on remote but now we don't
+            logger.warning("Absolute cover path but for wrong server?: \(currentPath)")
+            // Try to reset a cross-linked path
+            // Remove the prefix (and the / after the prefix), but keep directory structure in case
+            let pathWithoutPrefix = currentPath.substring(from: baseCoverDir.path.count + 1)
+            let newPath = coversDir.appendingPathComponent(pathWithoutPrefix)
+            return Plan(cover: cover, fileName: pathWithoutPrefix, copy: (currentPath as String, newPath))
+        } else {
+            // Prefix doesn't match, move instead
+            let newPath = coversDir.appendingPathComponent(fileName)
+            return Plan(cover: cover, fileName: fileName, copy: (currentPath as String, newPath))
+        }
+    }
+    
+    /// Copies a cover's file to where its new path says, returning if it's there now.
+    private func copy(from currentPath: String, to newPath: String) -> Bool {
+        logger.info("Moving absolute cover path \"\(currentPath)\" to \"\(newPath)\"")
+        // If this exists already, then it might be fine? (XXX: Delete old if new exists?)
+        if FileManager.default.fileExists(atPath: newPath) {
+            return true
+        }
         do {
-            logger.info("Moving absolute cover path \"\(currentPath)\" to \"\(newPath)\", changing filename to \"\(fileName)\"")
-            // If this exists already, then it might be fine? (XXX: Delete old if new exists?)
-            if !FileManager.default.fileExists(atPath: newPath),
-                let lastSlashOfNewPath = newPath.lastIndex(of: "/") {
-                let directory = String(newPath[...lastSlashOfNewPath])
-                try? FileManager.default.createDirectory(atPath: directory, withIntermediateDirectories: true)
-                try FileManager.default.copyItem(atPath: currentPath as String, toPath: newPath)
-            }
-            cover.imagePath = fileName as NSString?
+            let directory = (newPath as NSString).deletingLastPathComponent
+            try? FileManager.default.createDirectory(atPath: directory, withIntermediateDirectories: true)
+            try FileManager.default.copyItem(atPath: currentPath, toPath: newPath)
+            return true
         } catch {
             // XXX: Surface alert?
             logger.error("Error moving file for cover: \(error, privacy: .public)")
+            return false
         }
     }
     
-    private func cleanupCoverPath(_ cover: SBCover) {
-        let baseCoverDir = SBAppDelegate.coverDirectory
-        let currentPath = cover.primitiveValue(forKey: "imagePath") as! NSString?
-        // XXX: SBImportOperation was setting this, but SBSubsonicParsingOperation was not
-        let fallbackPath = cover.primitiveValue(forKey: "path") as! NSString?
-        if let currentPath = currentPath ?? fallbackPath, let coversDir = cover.coversDir() {
-            // If the path matches the prefix, do it, otherwise move the file
-            let fileName = currentPath.lastPathComponent
-            if currentPath.hasPrefix(coversDir as String) {
-                // Prefix matches, just update the DB entry
-                logger.info("Changing absolute cover path \"\(currentPath)\" to \"\(fileName)\"")
-                cover.imagePath = fileName as NSString?
-            } else if currentPath.hasPrefix(baseCoverDir.path) {
-                // This might be for a different server than ours (or none)
-                // Common case was importing a remote track; we used to just
-                // refer to the path of the cover on remote but now we don't
-                logger.warning("Absolute cover path but for wrong server?: \(currentPath)")
-                // Try to reset a cross-linked path
-                // Remove the prefix (and the / after the prefix), but keep directory structure in case
-                let pathWithoutPrefix = currentPath.substring(from: baseCoverDir.path.count + 1)
-                let newPath = coversDir.appendingPathComponent(pathWithoutPrefix)
-                replaceCoverPath(cover: cover, currentPath: currentPath, newPath: newPath, fileName: pathWithoutPrefix)
-            } else {
-                // Prefix doesn't match, move instead
-                let newPath = coversDir.appendingPathComponent(fileName)
-                replaceCoverPath(cover: cover, currentPath: currentPath, newPath: newPath, fileName: fileName)
-            }
+    private func cleanupCoverPaths(report: inout SBMaintenanceReport) {
+        var objectIDs: [NSManagedObjectID] = []
+        report.run("Finding covers") { _ in
+            let fetchRequest = NSFetchRequest<NSManagedObjectID>(entityName: "Cover")
+            fetchRequest.predicate = NSPredicate(format: "imagePath BEGINSWITH %@", "/")
+            fetchRequest.resultType = .managedObjectIDResultType
+            objectIDs = (try? threadedContext.fetch(fetchRequest)) ?? []
         }
-    }
-    
-    private func cleanupCoverPaths() {
-        let fetchRequest: NSFetchRequest<SBCover> = SBCover.fetchRequest()
-        fetchRequest.predicate = NSPredicate(format: "imagePath BEGINSWITH %@", "/")
-        if let covers = try? threadedContext.fetch(fetchRequest) {
-            for cover in covers {
-                cleanupCoverPath(cover)
+        
+        for batchStart in stride(from: 0, to: objectIDs.count, by: SBLibraryCleanupCoverPathsOperation.batchSize) {
+            let batch = Array(objectIDs[batchStart..<min(batchStart + SBLibraryCleanupCoverPathsOperation.batchSize, objectIDs.count)])
+            
+            var plans: [Plan] = []
+            report.run("Planning") { phase in
+                let fetchRequest: NSFetchRequest<SBCover> = SBCover.fetchRequest()
+                fetchRequest.predicate = NSPredicate(format: "self IN %@", batch)
+                // coversDir needs the server
+                fetchRequest.relationshipKeyPathsForPrefetching = ["album.artist.server", "track.server"]
+                let covers = (try? threadedContext.fetch(fetchRequest)) ?? []
+                plans = covers.compactMap { plan($0) }
+                phase.rows = plans.count
+            }
+            
+            var copied = Set<Int>()
+            report.run("Copying files") { phase in
+                let copies = plans.indices.filter { plans[$0].copy != nil }
+                let lock = NSLock()
+                SBOperation.concurrentlyPerform(copies) { i in
+                    let (from, to) = plans[i].copy!
+                    if copy(from: from, to: to) {
+                        lock.lock()
+                        copied.insert(i)
+                        lock.unlock()
+                    }
+                }
+                phase.rows = copied.count
+            }
+            
+            report.run("Updating paths") { phase in
+                for (i, plan) in plans.enumerated() where plan.copy == nil || copied.contains(i) {
+                    plan.cover.imagePath = plan.fileName as NSString?
+                    phase.rows += 1
+                }
+                saveThreadedContext()
+                // the context holds onto everything it's fetched otherwise
+                threadedContext.reset()
             }
         }
     }
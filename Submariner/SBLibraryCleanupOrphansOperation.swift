@@ -13,90 +13,88 @@ import os
 
 fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryCleanupOrphansOperation")
 
+/// Deletes objects that nothing can reach any more.
+///
+/// This runs at every launch, so everything is done with batch requests against the store, rather than loading each
+/// orphan into the context to delete it.
 class SBLibraryCleanupOrphansOperation: SBOperation {
     init(managedObjectContext: NSManagedObjectContext) {
         super.init(managedObjectContext: managedObjectContext, name: "Deleting Orphaned Objects")
     }
     
     override func main() {
+        var report = SBMaintenanceReport(name: "Orphan cleanup")
         defer {
             saveThreadedContext()
+            logger.info("\(report, privacy: .public)")
             finish()
         }
         DispatchQueue.main.async {
             self.operationInfo = "Deleting orphan albums"
         }
-        cleanupOrphanAlbums()
+        report.run("Albums") { phase in
+            // Albums must belong to an artist
+            phase.rows = batchDelete(entityName: "Album", predicate: NSPredicate(format: "(artist == nil)"))
+        }
         DispatchQueue.main.async {
             self.operationInfo = "Deleting orphan playlists"
         }
-        cleanupOrphanPlaylists()
+        report.run("Playlists") { phase in
+            // Server playlists have a server relation, local playlists are in the playlist SBSection
+            phase.rows = batchDelete(entityName: "Playlist", predicate: NSPredicate(format: "(server == nil) && (section == nil)"))
+        }
         DispatchQueue.main.async {
             self.operationInfo = "Deleting orphan covers"
         }
-        cleanupOrphanCovers()
+        cleanupOrphanCovers(report: &report)
         // XXX: Do tracks/albums/artists have similar issues?
     }
     
-    private func cleanupOrphanAlbums() {
-        let fetchRequest: NSFetchRequest<SBAlbum> = SBAlbum.fetchRequest()
-        // Albums must belong to an artist
-        fetchRequest.predicate = NSPredicate(format: "(artist == nil)")
-        if let albums = try? threadedContext.fetch(fetchRequest) {
-            for album in albums {
-                let name = album.itemName ?? "<nil>"
-                logger.info("Deleting orphan album \"\(name, privacy: .public)\"")
-                self.threadedContext.delete(album)
+    /// How many covers not in the cover store use each file name, in one fetch instead of one per orphan.
+    private func legacyFileNameCounts() -> [String: Int] {
+        let fetchRequest = NSFetchRequest<NSDictionary>(entityName: "Cover")
+        fetchRequest.predicate = NSPredicate(format: "(file == nil) && (imagePath != nil)")
+        fetchRequest.resultType = .dictionaryResultType
+        fetchRequest.propertiesToFetch = ["imagePath"]
+        var counts: [String: Int] = [:]
+        for result in (try? threadedContext.fetch(fetchRequest)) ?? [] {
+            if let imagePath = result["imagePath"] as? NSString {
+                counts[imagePath.lastPathComponent, default: 0] += 1
             }
         }
+        return counts
     }
     
-    private func cleanupOrphanPlaylists() {
-        // look for orphaned playlists as part of a delete
-        let fetchRequest: NSFetchRequest<SBPlaylist> = SBPlaylist.fetchRequest()
-        // Server playlists have a server relation, local playlists are in the playlist SBSection
-        fetchRequest.predicate = NSPredicate(format: "(server == nil) && (section == nil)")
-        if let playlists = try? threadedContext.fetch(fetchRequest) {
-            for playlist in playlists {
-                let name = playlist.resourceName ?? "<nil>"
-                logger.info("Deleting orphan playlist \"\(name, privacy: .public)\"")
-                self.threadedContext.delete(playlist)
+    private func cleanupOrphanCovers(report: inout SBMaintenanceReport) {
+        // Covers in the store have no imagePath of their own
+        let orphanPredicate = NSPredicate(format: "((track == nil) && (album == nil)) || ((imagePath == nil) && (file == nil))")
+        
+        // Files in the cover store are left for SBLibraryCoverGCOperation, since other covers can share them. Only
+        // absolute paths can be found without the album or track the cover belonged to.
+        var filesToRemove: [String] = []
+        report.run("Finding cover files") { _ in
+            let pathsRequest = NSFetchRequest<NSDictionary>(entityName: "Cover")
+            pathsRequest.predicate = NSCompoundPredicate(andPredicateWithSubpredicates: [
+                orphanPredicate,
+                NSPredicate(format: "(file == nil) && (imagePath BEGINSWITH %@)", "/")
+            ])
+            pathsRequest.resultType = .dictionaryResultType
+            pathsRequest.propertiesToFetch = ["imagePath"]
+            let paths = ((try? threadedContext.fetch(pathsRequest)) ?? []).compactMap { $0["imagePath"] as? String }
+            if !paths.isEmpty {
+                // avoid deleting if any duplicate filename could possibly exist.
+                // won't get it all, but avoids damage
+                let legacyCounts = legacyFileNameCounts()
+                filesToRemove = paths.filter { legacyCounts[($0 as NSString).lastPathComponent, default: 0] <= 1 }
             }
         }
-    }
-    
-    private func otherCoversUsingFile(_ cover: SBCover) -> Bool {
-        // imagePath returns absolute paths, but play it safe. perhaps we can clean up file orphans not in the DB later
-        guard let imageFile = cover.imagePath?.lastPathComponent else {
-            return false
+        report.run("Covers") { phase in
+            phase.rows = batchDelete(entityName: "Cover", predicate: orphanPredicate)
         }
-        
-        let fetchRequest: NSFetchRequest<SBCover> = SBCover.fetchRequest()
-        fetchRequest.predicate = NSPredicate(format: "(imagePath ENDSWITH %@)", imageFile)
-        if let covers = try? threadedContext.fetch(fetchRequest) {
-            logger.debug("\(covers.count) covers with the filename \(imageFile) found")
-            return covers.count > 1
-        }
-        
-        return false
-    }
-    
-    private func cleanupOrphanCovers() {
-        let fetchRequest: NSFetchRequest<SBCover> = SBCover.fetchRequest()
-        fetchRequest.predicate = NSPredicate(format: "((track == nil) && (album == nil)) || (imagePath == nil)")
-        if let covers = try? threadedContext.fetch(fetchRequest) {
-            for cover in covers {
-                let name = cover.itemId ?? "<nil>"
-                logger.info("Deleting orphan cover \"\(name, privacy: .public)\"")
-                if let path = cover.imagePath as? String, FileManager.default.fileExists(atPath: path),
-                   !otherCoversUsingFile(cover) {
-                    logger.warning("Should delete orphan cover file at \(path)")
-                    // safe to delete - we avoid deleting if any duplicate filename could possibly exist.
-                    // won't get it all, but avoids damage
-                    try? FileManager.default.removeItem(atPath: path)
-                }
-                self.threadedContext.delete(cover)
-            }
+        report.run("Cover files") { phase in
+            let (bytesFreed, failed) = removeFiles(atPaths: filesToRemove)
+            phase.rows = filesToRemove.count - failed.count
+            phase.bytesFreed = bytesFreed
         }
     }
 }
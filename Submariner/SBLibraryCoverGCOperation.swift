@@ -0,0 +1,97 @@
+//
+//  SBLibraryCoverGCOperation.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryCoverGCOperation")
+
+/// Removes files from the cover store that no cover uses any more.
+///
+/// CoverFiles without covers get deleted, then any file in the store without a CoverFile that's still in use is
+/// removed. Going by what's in the store rather than what was deleted also catches files whose CoverFile never got saved.
+class SBLibraryCoverGCOperation: SBOperation {
+    /// Files newer than this are left alone, since whatever wrote them might not have saved its CoverFile yet.
+    static let gracePeriod: TimeInterval = 60 * 60
+
+    init(managedObjectContext: NSManagedObjectContext) {
+        super.init(managedObjectContext: managedObjectContext, name: "Cleaning Up Covers")
+    }
+
+    override func main() {
+        defer {
+            saveThreadedContext()
+            finish()
+        }
+        DispatchQueue.main.async {
+            self.operationInfo = "Removing unused covers"
+        }
+        collect()
+    }
+
+    private func collect() {
+        let start = Date()
+
+        // Unreferenced CoverFiles first, since the store can have more than one for a name if two contexts raced
+        let unusedRequest: NSFetchRequest<SBCoverFile> = SBCoverFile.fetchRequest()
+        unusedRequest.predicate = NSPredicate(format: "covers.@count == 0")
+        let unused = (try? threadedContext.fetch(unusedRequest)) ?? []
+        for file in unused {
+            threadedContext.delete(file)
+        }
+        saveThreadedContext()
+        // names only come from the store, so covers saved by anything else need to be in it
+        do {
+            try SBPersistence.shared.flush()
+        } catch {
+            logger.error("Failed to write pending changes before collecting: \(error, privacy: .public)")
+        }
+
+        let namesRequest = NSFetchRequest<NSDictionary>(entityName: "CoverFile")
+        namesRequest.resultType = .dictionaryResultType
+        namesRequest.propertiesToFetch = ["name"]
+        let liveNames = Set(((try? threadedContext.fetch(namesRequest)) ?? []).compactMap { $0["name"] as? String })
+
+        let keys: [URLResourceKey] = [.isRegularFileKey, .fileSizeKey, .contentModificationDateKey]
+        guard let enumerator = FileManager.default.enumerator(at: SBCoverStore.directory,
+                                                              includingPropertiesForKeys: keys,
+                                                              options: [.skipsHiddenFiles]) else {
+            return
+        }
+        let cutoff = Date(timeIntervalSinceNow: -SBLibraryCoverGCOperation.gracePeriod)
+        var scanned = 0
+        var removed = 0
+        var reclaimed: Int64 = 0
+        for case let url as URL in enumerator {
+            guard let values = try? url.resourceValues(forKeys: Set(keys)), values.isRegularFile == true else {
+                continue
+            }
+            scanned += 1
+            if liveNames.contains(url.lastPathComponent) {
+                continue
+            }
+            if let modified = values.contentModificationDate, modified > cutoff {
+                continue
+            }
+            do {
+                if try SBCoverStore.shared.removeUnused(at: url, modifiedBefore: cutoff) {
+                    removed += 1
+                    reclaimed += Int64(values.fileSize ?? 0)
+                }
+            } catch {
+                logger.warning("Couldn't remove unused cover \(url.path, privacy: .public): \(error, privacy: .public)")
+            }
+        }
+
+        let reclaimedString = ByteCountFormatter.string(fromByteCount: reclaimed, countStyle: .file)
+        logger.info("Deleted \(unused.count) unused cover records, removed \(removed) of \(scanned) stored files, reclaiming \(reclaimedString, privacy: .public) in \(Date().timeIntervalSince(start), format: .fixed(precision: 2)) seconds")
+        DispatchQueue.main.async {
+            self.operationInfo = "Reclaimed \(reclaimedString)"
+        }
+    }
+}
@@ -0,0 +1,111 @@
+//
+//  SBLibraryEvictOperation.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryEvictOperation")
+
+/// Deletes the least recently played downloads until downloads fit in the limit.
+class SBLibraryEvictOperation: SBOperation {
+    static let batchSize = 50
+
+    init(managedObjectContext: NSManagedObjectContext) {
+        super.init(managedObjectContext: managedObjectContext, name: "Freeing Space for Downloads")
+    }
+
+    override func main() {
+        defer {
+            saveThreadedContext()
+            SBOfflineCache.shared.logStatistics()
+            finish()
+        }
+        let cache = SBOfflineCache.shared
+        threadedContext.performAndWait {
+            if cache.usage == nil {
+                DispatchQueue.main.async {
+                    self.operationInfo = "Counting downloaded tracks"
+                }
+                cache.recalculateUsage(in: threadedContext)
+            }
+            evict()
+        }
+    }
+
+    // must be called from the threaded context
+    private func evict() {
+        let limit = UserDefaults.standard.offlineCacheLimit
+        let cache = SBOfflineCache.shared
+        guard limit > 0, let startUsage = cache.usage, startUsage > limit else {
+            return
+        }
+
+        let fetchRequest: NSFetchRequest<SBTrack> = SBTrack.fetchRequest()
+        fetchRequest.predicate = SBOfflineCache.evictablePredicate
+        // never played sorts first, which is what we want, since it's been the longest
+        fetchRequest.sortDescriptors = [NSSortDescriptor(key: "lastAccessDate", ascending: true)]
+        fetchRequest.fetchBatchSize = SBLibraryEvictOperation.batchSize
+        fetchRequest.relationshipKeyPathsForPrefetching = ["remoteTrack"]
+        guard let candidates = try? threadedContext.fetch(fetchRequest) else {
+            return
+        }
+
+        let toFree = Float(startUsage - limit)
+        var evicted = 0
+        var freed: Int64 = 0
+        for track in candidates {
+            guard let usage = cache.usage, usage > limit else {
+                break
+            }
+            DispatchQueue.main.async {
+                self.operationInfo = "Deleting \(track.itemName ?? "untitled track")"
+                self.progress = .determinate(n: Float(freed), outOf: toFree)
+            }
+
+            let bytes = track.size?.int64Value ?? 0
+            if let path = track.path, FileManager.default.fileExists(atPath: path) {
+                do {
+                    try FileManager.default.removeItem(atPath: path)
+                } catch {
+                    logger.warning("Failed to delete track at path \(path, privacy: .public), because of \(error, privacy: .public)")
+                    continue
+                }
+            }
+            track.remoteTrack?.localTrack = nil
+            threadedContext.delete(track)
+            cache.didEvict(bytes: bytes)
+            freed += bytes
+            evicted += 1
+            if evicted % SBLibraryEvictOperation.batchSize == 0 {
+                saveThreadedContext()
+            }
+        }
+
+        removeEmptyDownloadedItems()
+        logger.info("Evicted \(evicted) downloads, freeing \(freed) bytes to fit in \(limit) bytes")
+    }
+
+    // must be called from the threaded context
+    private func removeEmptyDownloadedItems() {
+        // pending deletes need to be processed for the relationships to be empty
+        threadedContext.processPendingChanges()
+
+        let albumRequest: NSFetchRequest<SBAlbum> = SBAlbum.fetchRequest()
+        albumRequest.predicate = NSPredicate(format: "(isLocal == YES) && (isLinked != YES) && (tracks.@count == 0)")
+        for album in (try? threadedContext.fetch(albumRequest)) ?? [] {
+            threadedContext.delete(album)
+        }
+        threadedContext.processPendingChanges()
+
+        let artistRequest: NSFetchRequest<SBArtist> = SBArtist.fetchRequest()
+        artistRequest.predicate = NSPredicate(format: "(server == nil) && (isLinked != YES) && (albums.@count == 0)")
+        for artist in (try? threadedContext.fetch(artistRequest)) ?? [] {
+            threadedContext.delete(artist)
+        }
+    }
+}
@@ -0,0 +1,92 @@
+//
+//  SBLibraryMigrateCoverStoreOperation.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryMigrateCoverStoreOperation")
+
+/// Moves covers from before the cover store (v16 of the model), which had a file per cover ID, into the store.
+///
+/// Covers with the same image end up sharing one file. The old files are removed once the covers using them are saved.
+class SBLibraryMigrateCoverStoreOperation: SBOperation {
+    static let batchSize = 500
+
+    init(managedObjectContext: NSManagedObjectContext) {
+        super.init(managedObjectContext: managedObjectContext, name: "Updating Covers")
+    }
+
+    override func main() {
+        defer {
+            saveThreadedContext()
+            finish()
+        }
+        DispatchQueue.main.async {
+            self.operationInfo = "Moving covers to the cover store"
+        }
+        migrateCovers()
+    }
+
+    private func migrateCovers() {
+        let fetchRequest: NSFetchRequest<SBCover> = SBCover.fetchRequest()
+        fetchRequest.predicate = NSPredicate(format: "(file == nil) && ((imagePath != nil) || (path != nil))")
+        fetchRequest.fetchBatchSize = SBLibraryMigrateCoverStoreOperation.batchSize
+        guard let covers = try? threadedContext.fetch(fetchRequest), covers.count > 0 else {
+            return
+        }
+
+        let start = Date()
+        let total = Float(covers.count)
+        // the same old file is often used by more than one cover, so only hash it once
+        var storedByPath: [String: SBCoverStore.StoredFile] = [:]
+        var filesByName: [String: SBCoverFile] = [:]
+        var oldPaths = Set<String>()
+        var migrated = 0
+        var missing = 0
+
+        for (i, cover) in covers.enumerated() {
+            guard let path = cover.imagePath as String? else {
+                continue
+            }
+            if i % SBLibraryMigrateCoverStoreOperation.batchSize == 0 {
+                DispatchQueue.main.async {
+                    self.progress = .determinate(n: Float(i), outOf: total)
+                }
+            }
+
+            let stored: SBCoverStore.StoredFile
+            if let existing = storedByPath[path] {
+                stored = existing
+            } else if FileManager.default.fileExists(atPath: path),
+                      let newlyStored = try? SBCoverStore.shared.write(contentsOf: URL(fileURLWithPath: path)) {
+                stored = newlyStored
+                storedByPath[path] = stored
+            } else {
+                // the parser fetches it again when it sees there's no file
+                missing += 1
+                continue
+            }
+
+            let file = filesByName[stored.name] ?? SBCoverStore.shared.file(for: stored, in: threadedContext)
+            filesByName[stored.name] = file
+            cover.imagePath = nil
+            // the old fallback for imagePath
+            cover.path = nil
+            cover.file = file
+            oldPaths.insert(path)
+            migrated += 1
+        }
+        saveThreadedContext()
+
+        // only now that nothing points at the old files
+        for path in oldPaths {
+            try? FileManager.default.removeItem(atPath: path)
+        }
+        logger.info("Moved \(migrated) covers into \(filesByName.count) stored files (\(missing) missing) in \(Date().timeIntervalSince(start), format: .fixed(precision: 2)) seconds")
+    }
+}
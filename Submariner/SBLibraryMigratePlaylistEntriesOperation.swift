@@ -0,0 +1,61 @@
+//
+//  SBLibraryMigratePlaylistEntriesOperation.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryMigratePlaylistEntriesOperation")
+
+/// Converts playlists from before entries existed (v14 of the model), which stored an array of track URIs.
+///
+/// The migration from v13 is lightweight, so it can't do this itself. Parsing a playlist replaces its entries, so this
+/// must run before any server requests get parsed.
+class SBLibraryMigratePlaylistEntriesOperation: SBOperation {
+    init(managedObjectContext: NSManagedObjectContext) {
+        super.init(managedObjectContext: managedObjectContext, name: "Updating Playlists")
+    }
+
+    override func main() {
+        defer {
+            saveThreadedContext()
+            finish()
+        }
+        DispatchQueue.main.async {
+            self.operationInfo = "Converting playlists"
+        }
+        migratePlaylists()
+    }
+
+    private func migratePlaylists() {
+        let fetchRequest: NSFetchRequest<SBPlaylist> = SBPlaylist.fetchRequest()
+        fetchRequest.predicate = NSPredicate(format: "trackIDs != nil")
+        guard let playlists = try? threadedContext.fetch(fetchRequest), playlists.count > 0,
+              let coordinator = threadedContext.persistentStoreCoordinator else {
+            return
+        }
+
+        let startDate = Date()
+        var migrated = 0
+        var missing = 0
+        for playlist in playlists {
+            let tracks = (playlist.trackIDs ?? []).compactMap { uri -> SBTrack? in
+                // The old getter skipped tracks that no longer exist, so do the same
+                guard let objectID = coordinator.managedObjectID(forURIRepresentation: uri),
+                      let track = try? threadedContext.existingObject(with: objectID) as? SBTrack else {
+                    missing += 1
+                    return nil
+                }
+                return track
+            }
+            playlist.tracks = tracks
+            playlist.trackIDs = nil
+            migrated += tracks.count
+        }
+        logger.info("Converted \(playlists.count) playlists with \(migrated) tracks (\(missing) missing) in \(Date().timeIntervalSince(startDate), format: .fixed(precision: 2)) seconds")
+    }
+}
@@ -14,7 +14,13 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
 class SBLibraryPurgeOperation: SBOperation {
     fileprivate static let sizeFormatter = ByteCountFormatter()
     
-    var tracks: [SBTrack]?
+    private struct Candidate {
+        let objectID: NSManagedObjectID
+        let path: String?
+    }
+    
+    private var candidates: [Candidate] = []
+    private var report = SBMaintenanceReport(name: "Purge")
     
     init(managedObjectContext: NSManagedObjectContext) {
         super.init(managedObjectContext: managedObjectContext, name: "Deleting Downloaded Tracks")
@@ -25,19 +31,50 @@ class SBLibraryPurgeOperation: SBOperation {
             self.operationInfo = "Counting tracks"
         }
         
-        let fetchRequest: NSFetchRequest<SBTrack> = SBTrack.fetchRequest()
-        // local library tracks that are associated with a remote track
-        // this should exclude linked tracks as well as copied into library files directly imported
-        fetchRequest.predicate = NSPredicate(format: "(server == nil) && (remoteTrack != nil) && (isPlaying == NO)")
-        self.tracks = try? threadedContext.fetch(fetchRequest)
+        var totalSize: Int64 = 0
+        var fetched = false
+        report.run("Counting") { phase in
+            // Only what's needed to delete is fetched, rather than every track as an object
+            let objectIDExpression = NSExpressionDescription()
+            objectIDExpression.name = "objectID"
+            objectIDExpression.expression = NSExpression.expressionForEvaluatedObject()
+            objectIDExpression.expressionResultType = .objectIDAttributeType
+            
+            let fetchRequest = NSFetchRequest<NSDictionary>(entityName: "Track")
+            // local library tracks that are associated with a remote track
+            // this should exclude linked tracks as well as copied into library files directly imported
+            fetchRequest.predicate = NSPredicate(format: "(server == nil) && (remoteTrack != nil) && (isPlaying == NO)")
+            fetchRequest.resultType = .dictionaryResultType
+            fetchRequest.propertiesToFetch = [objectIDExpression, "path", "size"]
+            guard let rows = try? threadedContext.fetch(fetchRequest) else {
+                return
+            }
+            fetched = true
+            
+            for row in rows {
+                guard let objectID = row["objectID"] as? NSManagedObjectID else {
+                    continue
+                }
+                let path = row["path"] as? String
+                // the import records the size, so only stat the files it didn't
+                if let size = (row["size"] as? NSNumber)?.int64Value, size > 0 {
+                    totalSize += size
+                } else if let path = path, let attributes = try? FileManager.default.attributesOfItem(atPath: path) {
+                    totalSize += (attributes[.size] as? NSNumber)?.int64Value ?? 0
+                } else {
+                    logger.warning("Couldn't get the path or size for track ID \(objectID, privacy: .public)")
+                }
+                candidates.append(Candidate(objectID: objectID, path: path))
+            }
+            phase.rows = candidates.count
+        }
         
-        if let tracks = self.tracks {
-            let totalSize = totalSize()
-            let totalSizeString = SBLibraryPurgeOperation.sizeFormatter.string(fromByteCount: Int64(totalSize))
+        if fetched {
+            let totalSizeString = SBLibraryPurgeOperation.sizeFormatter.string(fromByteCount: totalSize)
             
-            logger.info("Proposed purge saves \(totalSizeString, privacy: .public) deleting \(tracks.count) items")
+            logger.info("Proposed purge saves \(totalSizeString, privacy: .public) deleting \(self.candidates.count) items")
             DispatchQueue.main.async {
-                if (tracks.isEmpty) {
+                if (self.candidates.isEmpty) {
                     self.showNothingToDeleteAlert()
                 } else {
                     self.showDeletePrompt(totalSizeString: totalSizeString)
@@ -50,22 +87,6 @@ class SBLibraryPurgeOperation: SBOperation {
         }
     }
     
-    func totalSize() -> UInt64 {
-        if let tracks = self.tracks {
-            return tracks.reduce(0 as UInt64) { partialResult, track in
-                // size exists on track attrib but let's check real fs size
-                if let path = track.path, let fileAttributes = try? FileManager.default.attributesOfItem(atPath: path) {
-                    return partialResult + (fileAttributes[FileAttributeKey.size] as! UInt64)
-                } else if let size = track.size {
-                    logger.warning("Couldn't get the path or size for track ID \(track.objectID, privacy: .public)")
-                    return partialResult + size.uint64Value
-                }
-                return partialResult
-            }
-        }
-        return 0
-    }
-    
     func showNothingToDeleteAlert() {
         let alert = NSAlert()
         alert.alertStyle = .informational
@@ -80,13 +101,16 @@ class SBLibraryPurgeOperation: SBOperation {
     func showDeletePrompt(totalSizeString: String) {
         let alert = NSAlert()
         alert.alertStyle = .informational
-        alert.messageText = "Do you want to delete \(tracks!.count) downloaded items?"
+        alert.messageText = "Do you want to delete \(candidates.count) downloaded items?"
         alert.informativeText = "Tracks downloaded to the library take up \(totalSizeString) of space on disk. Items that were imported to the library outside of a server won't be affected. You can redownload tracks from a server at any time."
         let deleteButton = alert.addButton(withTitle: "Delete Items")
         deleteButton.hasDestructiveAction = true
         alert.addButton(withTitle: "Cancel")
         if alert.runModal() == .alertFirstButtonReturn {
-            self.deleteItems()
+            // don't hold up the main thread with the deletion
+            DispatchQueue.global(qos: .userInitiated).async {
+                self.deleteItems()
+            }
         } else {
             // user cancelled
             self.saveThreadedContext()
@@ -95,71 +119,54 @@ class SBLibraryPurgeOperation: SBOperation {
     }
     
     func deleteItems() {
-        var failedTracks: [SBTrack] = []
-        // we had to get here because it is non-null
-        var i = Float(0)
-        let total = Float(tracks!.count)
-        for track in tracks! {
-            DispatchQueue.main.async {
-                self.operationInfo = "Deleting \(track.itemName ?? "untitled track")"
-                self.progress = .determinate(n: i, outOf: total)
-            }
-            if let path = track.path {
-                do {
-                    // if the file doesn't exist, definitely get rid of it
-                    // we do care about an error removing an existant file though
-                    if FileManager.default.fileExists(atPath: path) {
-                        try FileManager.default.removeItem(atPath: path)
-                    }
-                    track.album?.removeFromTracks(track)
-                    // not strictly needed
-                    track.album = nil
-                    track.remoteTrack?.localTrack = nil
-                    threadedContext.delete(track)
-                } catch {
-                    logger.warning("Failed to delete track at path \(path, privacy: .public), because of \(error, privacy: .public)")
-                    failedTracks.append(track)
+        DispatchQueue.main.async {
+            self.operationInfo = "Deleting \(self.candidates.count) tracks"
+            self.progress = .indeterminate(n: 0)
+        }
+        
+        var failedPaths = Set<String>()
+        report.run("Files") { phase in
+            // if the file doesn't exist, definitely get rid of it
+            // we do care about an error removing an existant file though
+            let paths = candidates.compactMap { $0.path }
+            let removed = removeFiles(atPaths: paths)
+            failedPaths = removed.failed
+            phase.rows = paths.count - failedPaths.count
+            phase.bytesFreed = removed.bytesFreed
+        }
+        
+        report.run("Tracks") { phase in
+            let objectIDs = candidates.filter { candidate in
+                guard let path = candidate.path else {
+                    return true
                 }
-            } else {
-                logger.warning("Couldn't get the path or size for track ID \(track.objectID, privacy: .public)")
-            }
-            i += 1
+                return !failedPaths.contains(path)
+            }.map { $0.objectID }
+            phase.rows = batchDelete(objectIDs: objectIDs)
         }
+        
         // clean out albums and artists locally that are now empty
         DispatchQueue.main.async {
             self.operationInfo = "Removing empty local albums and artists"
-            self.progress = .indeterminate(n: 0)
         }
-        let artistRequest: NSFetchRequest<SBArtist> = SBArtist.fetchRequest()
-        artistRequest.predicate = NSPredicate(format: "(server == nil)")
-        if let localArtists = try? threadedContext.fetch(artistRequest) {
-            for artist in localArtists {
-                // remove albums that are empty first
-                if let albums = artist.albums as! Set<SBAlbum>? {
-                    for album in albums {
-                        if album.tracks?.count == 0 {
-                            artist.removeFromAlbums(album)
-                            album.artist = nil
-                            threadedContext.delete(album)
-                        }
-                    }
-                }
-                
-                // then see if it's empty so we can delete
-                if let albums = artist.albums as! Set<SBAlbum>?, albums.count == 0 {
-                    threadedContext.delete(artist)
-                }
-            }
+        report.run("Albums") { phase in
+            phase.rows = batchDelete(entityName: "Album",
+                                     predicate: NSPredicate(format: "(artist != nil) && (artist.server == nil) && (tracks.@count == 0)"))
+        }
+        report.run("Artists") { phase in
+            phase.rows = batchDelete(entityName: "Artist",
+                                     predicate: NSPredicate(format: "(server == nil) && (albums.@count == 0)"))
         }
         // TODO: Delete covers that are only used locally or unreferenced too
         
         // inform user
+        let failedCount = failedPaths.count
         DispatchQueue.main.async {
             let alert = NSAlert()
             alert.alertStyle = .informational
             alert.messageText = "Tracks Deleted"
-            if failedTracks.count > 0 {
-                alert.informativeText = "Not all tracks could be deleted. \(failedTracks.count) remain."
+            if failedCount > 0 {
+                alert.informativeText = "Not all tracks could be deleted. \(failedCount) remain."
             } else {
                 alert.informativeText = "All cached tracks were deleted."
             }
@@ -167,6 +174,9 @@ class SBLibraryPurgeOperation: SBOperation {
             alert.runModal()
         }
         saveThreadedContext()
+        // whatever's left (i.e. tracks playing) is what counts against the limit now
+        SBOfflineCache.shared.recalculateUsage(in: threadedContext)
+        logger.info("\(self.report, privacy: .public)")
         finish()
     }
 }
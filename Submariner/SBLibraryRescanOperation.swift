@@ -0,0 +1,232 @@
+//
+//  SBLibraryRescanOperation.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBLibraryRescanOperation")
+
+/// Brings linked (not copied) folders up to date with what's on disk.
+///
+/// Only the size and modification date of each file is checked against what was recorded at import, so an unchanged
+/// folder is just a directory walk. New and changed files are handed to an import; tracks whose files are gone are
+/// removed, along with albums and artists left empty.
+class SBLibraryRescanOperation: SBOperation {
+    private static let bookmarksKey = "linkedFolderBookmarks"
+
+    init(managedObjectContext: NSManagedObjectContext) {
+        super.init(managedObjectContext: managedObjectContext, name: "Rescanning Linked Folders")
+    }
+
+    // #MARK: - Remembered Folders
+
+    /// Remembers folders imported as links, so they can be rescanned later. Folders inside one already remembered are skipped.
+    static func remember(folders: [URL]) {
+        var remembered = rememberedFolders()
+        for folder in folders {
+            let path = folder.standardizedFileURL.path
+            if remembered.contains(where: { path == $0.path || path.hasPrefix($0.path + "/") }) {
+                continue
+            }
+            // a new parent replaces its children
+            remembered.removeAll { $0.path.hasPrefix(path + "/") }
+            remembered.append(folder.standardizedFileURL)
+        }
+        store(folders: remembered)
+    }
+
+    private static func store(folders: [URL]) {
+        // Security-scoped, since the sandbox only lets us into folders the user picked while they're running.
+        let bookmarks = folders.compactMap { folder -> Data? in
+            do {
+                return try folder.bookmarkData(options: [.withSecurityScope, .securityScopeAllowOnlyReadAccess])
+            } catch {
+                logger.error("Couldn't make bookmark for \(folder.path, privacy: .public): \(error, privacy: .public)")
+                return nil
+            }
+        }
+        UserDefaults.standard.set(bookmarks, forKey: bookmarksKey)
+    }
+
+    /// If any folders are remembered, without resolving their bookmarks, which can be slow (i.e. for network volumes),
+    /// so it's fine on the main thread.
+    static var hasRememberedFolders: Bool {
+        !(UserDefaults.standard.array(forKey: bookmarksKey)?.isEmpty ?? true)
+    }
+
+    /// Resolves the remembered folders. This can block on the volumes they're on, so it shouldn't be called from the
+    /// main thread.
+    static func rememberedFolders() -> [URL] {
+        let bookmarks = UserDefaults.standard.array(forKey: bookmarksKey) as? [Data] ?? []
+        var anyStale = false
+        let folders = bookmarks.compactMap { bookmark -> URL? in
+            var isStale = false
+            guard let folder = try? URL(resolvingBookmarkData: bookmark, options: .withSecurityScope, bookmarkDataIsStale: &isStale) else {
+                return nil
+            }
+            anyStale = anyStale || isStale
+            return folder
+        }
+        if anyStale {
+            store(folders: folders)
+        }
+        return folders
+    }
+
+    // #MARK: - Scanning
+
+    private struct KnownFile {
+        let objectID: NSManagedObjectID
+        let size: Int64
+        let modificationDate: Date?
+    }
+
+    /// Linked tracks, keyed by absolute path. Fetched as dictionaries so this is cheap for big libraries.
+    private func knownFiles() -> [String: KnownFile] {
+        let objectIDDescription = NSExpressionDescription()
+        objectIDDescription.name = "objectID"
+        objectIDDescription.expression = NSExpression.expressionForEvaluatedObject()
+        objectIDDescription.expressionResultType = .objectIDAttributeType
+
+        let fetchRequest = NSFetchRequest<NSDictionary>(entityName: "Track")
+        fetchRequest.predicate = NSPredicate(format: "(server == nil) && (isLinked == YES) && (path != nil)")
+        fetchRequest.resultType = .dictionaryResultType
+        fetchRequest.propertiesToFetch = [objectIDDescription, "path", "size", "fileModificationDate"]
+
+        var known: [String: KnownFile] = [:]
+        threadedContext.performAndWait {
+            let results = (try? threadedContext.fetch(fetchRequest)) ?? []
+            for result in results {
+                guard let path = result["path"] as? String, let objectID = result["objectID"] as? NSManagedObjectID else {
+                    continue
+                }
+                known[path] = KnownFile(objectID: objectID,
+                                        size: (result["size"] as? NSNumber)?.int64Value ?? 0,
+                                        modificationDate: result["fileModificationDate"] as? Date)
+            }
+        }
+        return known
+    }
+
+    private func isSameFile(_ known: KnownFile, size: Int64, modificationDate: Date) -> Bool {
+        guard let knownDate = known.modificationDate else {
+            return true
+        }
+        return known.size == size && abs(knownDate.timeIntervalSince(modificationDate)) < 0.001
+    }
+
+    override func main() {
+        let folders = SBLibraryRescanOperation.rememberedFolders().filter { $0.startAccessingSecurityScopedResource() }
+        // Only folders we can get to; an unplugged drive shouldn't look like everything on it was deleted.
+        let accessible = folders.filter { FileManager.default.fileExists(atPath: $0.path) }
+        var handedOff = false
+        defer {
+            saveThreadedContext()
+            if !handedOff {
+                folders.forEach { $0.stopAccessingSecurityScopedResource() }
+            }
+            finish()
+        }
+        guard !accessible.isEmpty else {
+            return
+        }
+
+        let start = Date()
+        DispatchQueue.main.async {
+            self.operationInfo = "Checking linked files"
+        }
+        let known = knownFiles()
+
+        var seen = Set<String>()
+        var toImport: [URL] = []
+        var toBackfill: [(NSManagedObjectID, Int64, Date)] = []
+        let keys: [URLResourceKey] = [.isRegularFileKey, .fileSizeKey, .contentModificationDateKey]
+        for folder in accessible {
+            guard let enumerator = FileManager.default.enumerator(at: folder, includingPropertiesForKeys: keys, options: [.skipsHiddenFiles]) else {
+                continue
+            }
+            for case let file as URL in enumerator {
+                guard let values = try? file.resourceValues(forKeys: Set(keys)),
+                      values.isRegularFile == true,
+                      SBImportOperation.isAudioFile(file) else {
+                    continue
+                }
+                let path = file.path
+                let size = Int64(values.fileSize ?? 0)
+                let modificationDate = values.contentModificationDate ?? .distantPast
+                seen.insert(path)
+
+                if let knownFile = known[path] {
+                    if knownFile.modificationDate == nil {
+                        // imported before we kept track; take what's there now as the baseline
+                        toBackfill.append((knownFile.objectID, size, modificationDate))
+                    } else if !isSameFile(knownFile, size: size, modificationDate: modificationDate) {
+                        toImport.append(file)
+                    }
+                } else {
+                    toImport.append(file)
+                }
+            }
+        }
+
+        let missing = known.filter { path, _ in
+            !seen.contains(path) && accessible.contains { path.hasPrefix($0.path + "/") }
+        }
+
+        DispatchQueue.main.async {
+            self.operationInfo = "Removing missing files"
+        }
+        threadedContext.performAndWait {
+            for (objectID, size, modificationDate) in toBackfill {
+                if let track = threadedContext.object(with: objectID) as? SBTrack {
+                    track.size = NSNumber(value: size)
+                    track.fileModificationDate = modificationDate
+                }
+            }
+            for (path, knownFile) in missing {
+                logger.info("Removing track for missing file \(path, privacy: .public)")
+                threadedContext.delete(threadedContext.object(with: knownFile.objectID))
+            }
+            if !missing.isEmpty {
+                removeEmptyLinkedItems()
+            }
+        }
+
+        logger.info("Rescanned \(seen.count) files in \(Date().timeIntervalSince(start), format: .fixed(precision: 2)) s: \(toImport.count) new or changed, \(missing.count) missing, \(toBackfill.count) backfilled")
+
+        if !toImport.isEmpty, let importOperation = SBImportOperation(managedObjectContext: mainContext, files: toImport, copyFiles: false) {
+            // the import needs the folders too, so it gets to stop accessing them
+            handedOff = true
+            importOperation.completionBlock = {
+                folders.forEach { $0.stopAccessingSecurityScopedResource() }
+            }
+            OperationQueue.sharedDownloadQueue.addOperation(importOperation)
+        }
+    }
+
+    // must be called from the threaded context
+    private func removeEmptyLinkedItems() {
+        // pending deletes need to be processed for the relationships to be empty
+        threadedContext.processPendingChanges()
+
+        let albumRequest: NSFetchRequest<SBAlbum> = SBAlbum.fetchRequest()
+        albumRequest.predicate = NSPredicate(format: "(isLinked == YES) && (tracks.@count == 0)")
+        for album in (try? threadedContext.fetch(albumRequest)) ?? [] {
+            logger.info("Removing empty album \"\(album.itemName ?? "<nil>", privacy: .public)\"")
+            threadedContext.delete(album)
+        }
+        threadedContext.processPendingChanges()
+
+        let artistRequest: NSFetchRequest<SBArtist> = SBArtist.fetchRequest()
+        artistRequest.predicate = NSPredicate(format: "(server == nil) && (isLinked == YES) && (albums.@count == 0)")
+        for artist in (try? threadedContext.fetch(artistRequest)) ?? [] {
+            logger.info("Removing empty artist \"\(artist.itemName ?? "<nil>", privacy: .public)\"")
+            threadedContext.delete(artist)
+        }
+    }
+}
@@ -59,6 +59,7 @@
     
     NSArray *artistSortDescriptor;
     NSArray *albumSortDescriptor;
+    NSString *artistFilterString;
 }
 @property (readwrite, strong) NSArray *artistSortDescriptor;
 
@@ -91,6 +91,7 @@
     [artistsController removeObserver:self forKeyPath:@"selectedObjects"];
     [albumsController removeObserver:self forKeyPath:@"selectedObjects"];
     [tracksController removeObserver:self forKeyPath:@"selectedObjects"];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:@"SBSearchIndexChanged" object:nil];
 }
 
 - (void)loadView {
@@ -121,6 +122,19 @@
                                             forKeyPath: @"albumSortOrder"
                                                options: NSKeyValueObservingOptionNew | NSKeyValueObservingOptionInitial
                                                context: nil];
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(searchIndexChanged:)
+                                                 name:@"SBSearchIndexChanged"
+                                               object:nil];
+}
+
+
+- (void)searchIndexChanged:(NSNotification *)notification {
+    // The filter is a list of artists from the index, so it needs to be made again when the index changes
+    if (artistFilterString != nil && [artistFilterString length] > 0) {
+        [self applyArtistFilter];
+    }
 }
 
 
@@ -213,13 +227,19 @@
 
 
 - (IBAction)filterArtist:(id)sender {
-    
+    artistFilterString = [[sender stringValue] copy];
+    [self applyArtistFilter];
+}
+
+- (void)applyArtistFilter {
     NSPredicate *predicate = nil;
-    NSString *searchString = nil;
+    NSString *searchString = artistFilterString;
     
-    searchString = [sender stringValue];
-    
-    if(searchString != nil && [searchString length] > 0) {
+    if(searchString != nil && [searchString length] > 0 && [[SBSearchIndex shared] isReady]) {
+        NSSet<NSManagedObjectID*> *artistIDs = [[SBSearchIndex shared] artistIDsMatching:searchString];
+        predicate = [NSPredicate predicateWithFormat:@"(objectID IN %@) && (server == %@)", artistIDs, nil];
+        [artistsController setFilterPredicate:predicate];
+    } else if(searchString != nil && [searchString length] > 0) {
         predicate = [NSPredicate predicateWithFormat:@"(itemName CONTAINS[cd] %@) && (server == %@)", searchString, nil];
         [artistsController setFilterPredicate:predicate];
     } else {
@@ -37,6 +37,12 @@
 #import "Submariner-Swift.h"
 
 
+@interface SBMusicSearchController () {
+    NSString *currentQuery;
+}
+@end
+
+
 @implementation SBMusicSearchController
 
 
@@ -66,11 +72,25 @@
                       forKeyPath:@"selectedObjects"
                       options:NSKeyValueObservingOptionNew
                       context:nil];
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(searchIndexChanged:)
+                                                 name:@"SBSearchIndexChanged"
+                                               object:nil];
 }
 
 
 - (void)dealloc {
     [tracksController removeObserver:self forKeyPath:@"selectedObjects"];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:@"SBSearchIndexChanged" object:nil];
+}
+
+
+- (void)searchIndexChanged:(NSNotification *)notification {
+    // Results come from the index rather than the context, so they need to be asked for again
+    if (currentQuery != nil && [tracksController automaticallyPreparesContent] == NO) {
+        [self searchString:currentQuery];
+    }
 }
 
 
@@ -106,11 +126,24 @@
     //Remove trailing space
     if ([searchText length] != 0) [searchText replaceOccurrencesOfString:@" " withString:@"" options:0 range:NSMakeRange([searchText length]-1, 1)];
     
+    currentQuery = searchText;
+    
     if ([searchText length] == 0) {
+        [self useFetchedContent];
         [tracksController setFilterPredicate:[NSPredicate predicateWithFormat:@"(isLocal == YES)"]];
         return;
     }
     
+    // The index is ranked and doesn't scan every track, but until it's built, filter like before
+    SBSearchIndex *index = [SBSearchIndex shared];
+    if ([index isReady]) {
+        [tracksController setAutomaticallyPreparesContent:NO];
+        [tracksController setFilterPredicate:nil];
+        [tracksController setContent:[index tracksMatching:searchText inManagedObjectContext:self.managedObjectContext]];
+        return;
+    }
+    [self useFetchedContent];
+    
     NSArray *searchTerms = [searchText componentsSeparatedByString:@" "];
     
     if ([searchTerms count] == 1) {
@@ -129,6 +162,14 @@
 }
 
 
+- (void)useFetchedContent {
+    if ([tracksController automaticallyPreparesContent] == NO) {
+        [tracksController setAutomaticallyPreparesContent:YES];
+        [tracksController fetch:self];
+    }
+}
+
+
 #pragma mark - Properties
 
 - (NSArray<SBTrack*>*) tracks {
@@ -0,0 +1,573 @@
+//
+//  SBMutationOutbox.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import Network
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBMutationOutbox")
+
+/// Sends what the user changes on a server (scrobbles, stars, ratings and playlist edits), keeping it on disk until the
+/// server has it.
+///
+/// - Each server's mutations are written to a file as they're queued, so they survive failed requests and quitting,
+///   and are sent again at launch.
+/// - Mutations are combined where the result is the same. Stars and scrobbles for many items go in one request,
+///   starring then unstarring the same thing cancels out, and later ratings or playlist edits replace earlier ones.
+/// - Mutations go out a moment after they're queued, in order, one request at a time for each server. If one fails,
+///   the rest wait for it, backing off longer each time, or until the network comes back.
+/// - How many are waiting and how long they waited for the server is logged.
+///
+/// This is only used from the main thread.
+class SBMutationOutbox {
+    static let shared = SBMutationOutbox()
+
+    /// How long to wait for more mutations to combine with before sending.
+    static let flushDelay: TimeInterval = 1
+    /// Keeps URLs to a length servers accept.
+    static let maxIDsPerRequest = 100
+    static let initialBackoff: TimeInterval = 2
+    static let maxBackoff: TimeInterval = 5 * 60
+    /// How many times the server can turn a mutation down before giving up on it. Network errors don't count.
+    static let maxRejections = 5
+
+    static var directory: URL {
+        SBAppDelegate.libraryDirectory.appendingPathComponent("Outbox", isDirectory: true)
+    }
+
+    enum Mutation: Codable, Equatable {
+        struct Play: Codable, Equatable {
+            let id: String
+            let time: Date
+        }
+
+        case scrobble(plays: [Play])
+        /// IDs are tracks and directories, which are starred the same way.
+        case star(ids: [String], albumIDs: [String], artistIDs: [String])
+        case unstar(ids: [String], albumIDs: [String], artistIDs: [String])
+        case setRating(id: String, rating: Int)
+        case createPlaylist(name: String, trackIDs: [String])
+        case replacePlaylist(id: String, trackIDs: [String])
+        case updatePlaylist(id: String, name: String?, comment: String?, isPublic: Bool?, appending: [String], removing: [Int])
+        case deletePlaylist(id: String)
+
+        var requestType: SBSubsonicRequestType {
+            switch self {
+            case .scrobble(let plays):
+                return .scrobble(ids: plays.map { $0.id }, times: plays.map { $0.time })
+            case .star(let ids, let albumIDs, let artistIDs):
+                return .star(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs)
+            case .unstar(let ids, let albumIDs, let artistIDs):
+                return .unstar(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs)
+            case .setRating(let id, let rating):
+                return .setRating(id: id, rating: rating)
+            case .createPlaylist(let name, let trackIDs):
+                return .createPlaylist(name: name, trackIDs: trackIDs)
+            case .replacePlaylist(let id, let trackIDs):
+                return .replacePlaylist(id: id, trackIDs: trackIDs)
+            case .updatePlaylist(let id, let name, let comment, let isPublic, let appending, let removing):
+                return .updatePlaylist(id: id, name: name, comment: comment, isPublic: isPublic,
+                                       appending: appending.isEmpty ? nil : appending,
+                                       removing: removing.isEmpty ? nil : removing)
+            case .deletePlaylist(let id):
+                return .deletePlaylist(id: id)
+            }
+        }
+
+        /// How many things the user did this stands for.
+        var count: Int {
+            switch self {
+            case .scrobble(let plays):
+                return plays.count
+            case .star(let ids, let albumIDs, let artistIDs), .unstar(let ids, let albumIDs, let artistIDs):
+                return ids.count + albumIDs.count + artistIDs.count
+            default:
+                return 1
+            }
+        }
+
+        var playlistID: String? {
+            switch self {
+            case .replacePlaylist(let id, _), .updatePlaylist(let id, _, _, _, _, _), .deletePlaylist(let id):
+                return id
+            default:
+                return nil
+            }
+        }
+    }
+
+    /// Something starred or unstarred, with which parameter it goes in.
+    private struct Starrable: Hashable {
+        enum Kind {
+            case id
+            case album
+            case artist
+        }
+
+        let kind: Kind
+        let id: String
+
+        static func from(ids: [String], albumIDs: [String], artistIDs: [String]) -> [Starrable] {
+            ids.map { Starrable(kind: .id, id: $0) }
+                + albumIDs.map { Starrable(kind: .album, id: $0) }
+                + artistIDs.map { Starrable(kind: .artist, id: $0) }
+        }
+
+        static func mutation(starring: Bool, _ items: [Starrable]) -> Mutation {
+            let ids = items.filter { $0.kind == .id }.map { $0.id }
+            let albumIDs = items.filter { $0.kind == .album }.map { $0.id }
+            let artistIDs = items.filter { $0.kind == .artist }.map { $0.id }
+            return starring
+                ? .star(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs)
+                : .unstar(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs)
+        }
+    }
+
+    private struct Entry: Codable {
+        var id = UUID()
+        var mutation: Mutation
+        /// When the oldest mutation combined into this one was queued.
+        var queued = Date()
+        var rejections = 0
+
+        init(_ mutation: Mutation) {
+            self.mutation = mutation
+        }
+
+        var starItems: (starring: Bool, items: [Starrable])? {
+            switch mutation {
+            case .star(let ids, let albumIDs, let artistIDs):
+                return (true, Starrable.from(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs))
+            case .unstar(let ids, let albumIDs, let artistIDs):
+                return (false, Starrable.from(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs))
+            default:
+                return nil
+            }
+        }
+    }
+
+    private struct Stored: Codable {
+        let server: URL
+        let entries: [Entry]
+    }
+
+    private class Outbox {
+        let serverURL: URL
+        var entries: [Entry] = []
+        /// The entry being sent, which can't be changed anymore.
+        var sending: UUID?
+        var failures = 0
+        var pendingFlush: DispatchWorkItem?
+
+        // for the log
+        var queuedMutations = 0
+        var coalescedMutations = 0
+        var sentMutations = 0
+        var requests = 0
+        var longestWait: TimeInterval = 0
+
+        init(serverURL: URL) {
+            self.serverURL = serverURL
+        }
+
+        /// Entries that haven't gone out yet, which can still be combined with.
+        var pendingIndices: [Int] {
+            entries.indices.filter { entries[$0].id != sending }
+        }
+    }
+
+    private var outboxes: [URL: Outbox] = [:]
+    private weak var managedObjectContext: NSManagedObjectContext?
+    // files are only written on here
+    private let diskQueue = DispatchQueue(label: "SBMutationOutbox", qos: .utility)
+    private let pathMonitor = NWPathMonitor()
+    private var networkAvailable = true
+
+    private init() {
+    }
+
+    /// How many requests are waiting to be sent, across every server.
+    var depth: Int {
+        outboxes.values.reduce(0) { $0 + $1.entries.count }
+    }
+
+    /// What's waiting to be sent to a server, in order.
+    func queued(for server: SBServer) -> [Mutation] {
+        outboxes[server.objectID.uriRepresentation()]?.entries.map { $0.mutation } ?? []
+    }
+
+    // #MARK: - Starting
+
+    /// Picks up where the last launch left off, and starts watching for the network to come back.
+    func start(managedObjectContext: NSManagedObjectContext) {
+        self.managedObjectContext = managedObjectContext
+        load()
+
+        pathMonitor.pathUpdateHandler = { [weak self] path in
+            DispatchQueue.main.async {
+                self?.networkChanged(available: path.status == .satisfied)
+            }
+        }
+        pathMonitor.start(queue: DispatchQueue.global(qos: .utility))
+    }
+
+    private func load() {
+        guard let coordinator = managedObjectContext?.persistentStoreCoordinator,
+              let files = try? FileManager.default.contentsOfDirectory(at: SBMutationOutbox.directory, includingPropertiesForKeys: nil) else {
+            return
+        }
+        let decoder = JSONDecoder()
+        for file in files where file.pathExtension == "json" {
+            do {
+                let stored = try decoder.decode(Stored.self, from: Data(contentsOf: file))
+                // the server could have been deleted, or the store replaced, since these were queued
+                guard coordinator.managedObjectID(forURIRepresentation: stored.server) != nil else {
+                    logger.warning("Dropping \(stored.entries.count) queued requests for a server that's gone")
+                    try? FileManager.default.removeItem(at: file)
+                    continue
+                }
+                let outbox = self.outbox(for: stored.server)
+                outbox.entries = stored.entries
+                logger.info("Resending \(stored.entries.count) requests queued for \(stored.server, privacy: .public) before quitting")
+                scheduleFlush(outbox, after: 0)
+            } catch {
+                logger.error("Couldn't read queued requests from \(file.lastPathComponent, privacy: .public): \(error, privacy: .public)")
+            }
+        }
+    }
+
+    private func networkChanged(available: Bool) {
+        let cameBack = available && !networkAvailable
+        networkAvailable = available
+        guard cameBack else {
+            return
+        }
+        for outbox in outboxes.values where !outbox.entries.isEmpty {
+            logger.info("Network is back, sending \(outbox.entries.count) queued requests for \(outbox.serverURL, privacy: .public)")
+            outbox.failures = 0
+            scheduleFlush(outbox, after: 0)
+        }
+    }
+
+    /// Makes sure what's queued is on disk, for quitting.
+    func waitForWrites() {
+        diskQueue.sync {}
+    }
+
+    // #MARK: - Queueing
+
+    private func outbox(for serverURL: URL) -> Outbox {
+        if let existing = outboxes[serverURL] {
+            return existing
+        }
+        let new = Outbox(serverURL: serverURL)
+        outboxes[serverURL] = new
+        return new
+    }
+
+    /// Queues a mutation for a server, combining it with what's already queued if it can.
+    func add(_ mutation: Mutation, for server: SBServer) {
+        guard mutation.count > 0 else {
+            return
+        }
+        let outbox = self.outbox(for: server.objectID.uriRepresentation())
+        let depthBefore = outbox.entries.count
+        outbox.queuedMutations += mutation.count
+
+        switch mutation {
+        case .scrobble(let plays):
+            addScrobble(plays, to: outbox)
+        case .star(let ids, let albumIDs, let artistIDs):
+            addStar(starring: true, Starrable.from(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs), to: outbox)
+        case .unstar(let ids, let albumIDs, let artistIDs):
+            addStar(starring: false, Starrable.from(ids: ids, albumIDs: albumIDs, artistIDs: artistIDs), to: outbox)
+        case .setRating(let id, _):
+            if let i = outbox.pendingIndices.last(where: { outbox.entries[$0].mutation.isRating(for: id) }) {
+                outbox.entries[i].mutation = mutation
+                outbox.coalescedMutations += 1
+            } else {
+                outbox.entries.append(Entry(mutation))
+            }
+        case .updatePlaylist(_, _, _, _, _, _):
+            addPlaylistUpdate(mutation, to: outbox, maxBytes: SBPlaylistSync.maxBytes(for: server))
+        case .replacePlaylist(let id, _):
+            // replacing the tracks makes earlier changes to them moot, but not to the name and such
+            for i in outbox.pendingIndices.reversed() where outbox.entries[i].mutation.playlistID == id {
+                if let details = outbox.entries[i].mutation.withoutTrackChanges {
+                    outbox.entries[i].mutation = details
+                } else {
+                    outbox.entries.remove(at: i)
+                    outbox.coalescedMutations += 1
+                }
+            }
+            outbox.entries.append(Entry(mutation))
+        case .deletePlaylist(let id):
+            for i in outbox.pendingIndices.reversed() where outbox.entries[i].mutation.playlistID == id {
+                outbox.entries.remove(at: i)
+                outbox.coalescedMutations += 1
+            }
+            outbox.entries.append(Entry(mutation))
+        case .createPlaylist(_, _):
+            outbox.entries.append(Entry(mutation))
+        }
+
+        logger.debug("Queued \(mutation.count) mutations for \(outbox.serverURL, privacy: .public), \(depthBefore) -> \(outbox.entries.count) requests waiting")
+        save(outbox)
+        scheduleFlush(outbox, after: SBMutationOutbox.flushDelay)
+    }
+
+    private func addScrobble(_ plays: [Mutation.Play], to outbox: Outbox) {
+        var remaining = plays[...]
+        for i in outbox.pendingIndices {
+            guard case .scrobble(let queued) = outbox.entries[i].mutation, queued.count < SBMutationOutbox.maxIDsPerRequest else {
+                continue
+            }
+            let room = SBMutationOutbox.maxIDsPerRequest - queued.count
+            outbox.entries[i].mutation = .scrobble(plays: queued + remaining.prefix(room))
+            outbox.coalescedMutations += min(room, remaining.count)
+            remaining = remaining.dropFirst(room)
+        }
+        while !remaining.isEmpty {
+            outbox.entries.append(Entry(.scrobble(plays: Array(remaining.prefix(SBMutationOutbox.maxIDsPerRequest)))))
+            remaining = remaining.dropFirst(SBMutationOutbox.maxIDsPerRequest)
+        }
+    }
+
+    private func addStar(starring: Bool, _ items: [Starrable], to outbox: Outbox) {
+        var remaining: [Starrable] = []
+        for item in items where !remaining.contains(item) {
+            remaining.append(item)
+        }
+
+        for i in outbox.pendingIndices {
+            guard let queued = outbox.entries[i].starItems else {
+                continue
+            }
+            let overlap = Set(queued.items).intersection(remaining)
+            guard !overlap.isEmpty else {
+                continue
+            }
+            remaining.removeAll { overlap.contains($0) }
+            if queued.starring == starring {
+                // already going to happen
+                outbox.coalescedMutations += overlap.count
+            } else {
+                // one undoes the other, so neither needs to be sent
+                let left = queued.items.filter { !overlap.contains($0) }
+                outbox.entries[i].mutation = Starrable.mutation(starring: queued.starring, left)
+                outbox.coalescedMutations += overlap.count * 2
+            }
+        }
+        outbox.entries.removeAll { $0.id != outbox.sending && $0.mutation.count == 0 }
+
+        for i in outbox.pendingIndices where !remaining.isEmpty {
+            guard let queued = outbox.entries[i].starItems, queued.starring == starring,
+                  queued.items.count < SBMutationOutbox.maxIDsPerRequest else {
+                continue
+            }
+            let room = SBMutationOutbox.maxIDsPerRequest - queued.items.count
+            outbox.entries[i].mutation = Starrable.mutation(starring: starring, queued.items + remaining.prefix(room))
+            outbox.coalescedMutations += min(room, remaining.count)
+            remaining.removeFirst(min(room, remaining.count))
+        }
+        while !remaining.isEmpty {
+            let chunk = Array(remaining.prefix(SBMutationOutbox.maxIDsPerRequest))
+            outbox.entries.append(Entry(Starrable.mutation(starring: starring, chunk)))
+            remaining.removeFirst(chunk.count)
+        }
+    }
+
+    private func addPlaylistUpdate(_ mutation: Mutation, to outbox: Outbox, maxBytes: Int) {
+        guard case .updatePlaylist(let id, let name, let comment, let isPublic, let appending, let removing) = mutation else {
+            return
+        }
+        // only the last change to the playlist can be combined with, or the order would change
+        guard let i = outbox.pendingIndices.last(where: { outbox.entries[$0].mutation.playlistID == id }),
+              i == outbox.entries.lastIndex(where: { $0.mutation.playlistID == id }) else {
+            outbox.entries.append(Entry(mutation))
+            return
+        }
+        // nor if it'd be too big for the server, since big edits were split to fit
+        let fits = SBPlaylistSync.trackBytes(of: outbox.entries[i].mutation) + SBPlaylistSync.trackBytes(of: mutation) <= maxBytes
+        switch outbox.entries[i].mutation {
+        // The server removes by index from the playlist as it was, then appends. Doing both at once is the same as
+        // one after another if the later one doesn't remove, or the earlier one only changed details.
+        case .updatePlaylist(_, let queuedName, let queuedComment, let queuedPublic, let queuedAppending, let queuedRemoving)
+            where fits && (removing.isEmpty || (queuedAppending.isEmpty && queuedRemoving.isEmpty)):
+            outbox.entries[i].mutation = .updatePlaylist(id: id,
+                                                         name: name ?? queuedName,
+                                                         comment: comment ?? queuedComment,
+                                                         isPublic: isPublic ?? queuedPublic,
+                                                         appending: queuedAppending + appending,
+                                                         removing: queuedRemoving + removing)
+            outbox.coalescedMutations += 1
+        case .replacePlaylist(_, let trackIDs) where fits && removing.isEmpty && name == nil && comment == nil && isPublic == nil:
+            outbox.entries[i].mutation = .replacePlaylist(id: id, trackIDs: trackIDs + appending)
+            outbox.coalescedMutations += 1
+        default:
+            outbox.entries.append(Entry(mutation))
+        }
+    }
+
+    // #MARK: - Sending
+
+    private func scheduleFlush(_ outbox: Outbox, after delay: TimeInterval) {
+        outbox.pendingFlush?.cancel()
+        let work = DispatchWorkItem { [weak self] in
+            outbox.pendingFlush = nil
+            self?.flush(outbox)
+        }
+        outbox.pendingFlush = work
+        DispatchQueue.main.asyncAfter(deadline: .now() + delay, execute: work)
+    }
+
+    private func flush(_ outbox: Outbox) {
+        guard outbox.sending == nil, let entry = outbox.entries.first else {
+            return
+        }
+        guard let context = managedObjectContext,
+              let serverID = context.persistentStoreCoordinator?.managedObjectID(forURIRepresentation: outbox.serverURL),
+              let server = try? context.existingObject(with: serverID) as? SBServer else {
+            logger.warning("Dropping \(outbox.entries.count) queued requests for a server that's gone")
+            outbox.entries.removeAll()
+            save(outbox)
+            return
+        }
+
+        outbox.sending = entry.id
+        let request = SBSubsonicRequestOperation(server: server, request: entry.mutation.requestType)
+        request.presentsErrors = false
+        request.deliveryHandler = { error in
+            DispatchQueue.main.async {
+                self.sent(entry.id, error: error, outbox: outbox)
+            }
+        }
+        // if it never got to run, i.e. it was cancelled, the handler won't be called
+        request.completionBlock = { [weak request] in
+            guard request?.isAwaitingDelivery == true else {
+                return
+            }
+            DispatchQueue.main.async {
+                self.sent(entry.id, error: CocoaError(.userCancelled), outbox: outbox)
+            }
+        }
+        SBServerScheduler.shared.add(request)
+    }
+
+    private func sent(_ entryID: UUID, error: Error?, outbox: Outbox) {
+        guard outbox.sending == entryID, let i = outbox.entries.firstIndex(where: { $0.id == entryID }) else {
+            return
+        }
+        outbox.sending = nil
+
+        guard let error = error else {
+            let entry = outbox.entries.remove(at: i)
+            let wait = Date().timeIntervalSince(entry.queued)
+            outbox.failures = 0
+            outbox.sentMutations += entry.mutation.count
+            outbox.requests += 1
+            outbox.longestWait = max(outbox.longestWait, wait)
+            logger.debug("Sent \(entry.mutation.requestType.name, privacy: .public) with \(entry.mutation.count) mutations \(wait * 1000, format: .fixed(precision: 1)) ms after it was queued")
+            save(outbox)
+            if outbox.entries.isEmpty {
+                logStatistics(outbox)
+            } else {
+                flush(outbox)
+            }
+            return
+        }
+
+        // Not getting to the server isn't the request's fault, but the server turning it down might be
+        if SBMutationOutbox.isRejection(error) {
+            outbox.entries[i].rejections += 1
+            if outbox.entries[i].rejections >= SBMutationOutbox.maxRejections {
+                let entry = outbox.entries.remove(at: i)
+                logger.error("Giving up on \(entry.mutation.requestType.name, privacy: .public) with \(entry.mutation.count) mutations after the server turned it down \(entry.rejections) times: \(error, privacy: .public)")
+                save(outbox)
+                flush(outbox)
+                return
+            }
+            save(outbox)
+        }
+        outbox.failures += 1
+        let backoff = min(SBMutationOutbox.initialBackoff * pow(2, Double(outbox.failures - 1)), SBMutationOutbox.maxBackoff)
+        // so every server's outbox doesn't retry at the same moment
+        let delay = backoff * Double.random(in: 0.8...1.2)
+        logger.warning("Failed to send \(outbox.entries.count) queued requests for \(outbox.serverURL, privacy: .public), trying again in \(delay, format: .fixed(precision: 1)) s: \(error, privacy: .public)")
+        scheduleFlush(outbox, after: delay)
+    }
+
+    /// Errors from not getting to the server at all. HTTP errors are in the URL error domain too, with the status as
+    /// the code, so being a `URLError` isn't enough to tell them apart.
+    static let transportErrorCodes: Set<URLError.Code> = [
+        .cancelled, .timedOut, .notConnectedToInternet, .networkConnectionLost, .cannotConnectToHost, .cannotFindHost,
+        .dnsLookupFailed, .internationalRoamingOff, .dataNotAllowed, .callIsActive, .secureConnectionFailed,
+    ]
+
+    /// If the server got the request and turned it down, rather than it not getting there.
+    static func isRejection(_ error: Error) -> Bool {
+        if let error = error as? URLError {
+            return !transportErrorCodes.contains(error.code)
+        }
+        return !(error is CocoaError)
+    }
+
+    // #MARK: - Disk
+
+    private static func fileURL(for serverURL: URL) -> URL {
+        directory.appendingPathComponent("Server \(serverURL.lastPathComponent).json")
+    }
+
+    private func save(_ outbox: Outbox) {
+        let stored = Stored(server: outbox.serverURL, entries: outbox.entries)
+        diskQueue.async {
+            let fileURL = SBMutationOutbox.fileURL(for: stored.server)
+            do {
+                if stored.entries.isEmpty {
+                    if FileManager.default.fileExists(atPath: fileURL.path) {
+                        try FileManager.default.removeItem(at: fileURL)
+                    }
+                    return
+                }
+                try FileManager.default.createDirectory(at: SBMutationOutbox.directory, withIntermediateDirectories: true)
+                try JSONEncoder().encode(stored).write(to: fileURL, options: [.atomic])
+            } catch {
+                logger.error("Couldn't save queued requests for \(stored.server, privacy: .public): \(error, privacy: .public)")
+            }
+        }
+    }
+
+    // #MARK: - Statistics
+
+    private func logStatistics(_ outbox: Outbox) {
+        logger.info("Sent everything queued for \(outbox.serverURL, privacy: .public): \(outbox.queuedMutations) mutations queued, \(outbox.coalescedMutations) combined away, \(outbox.sentMutations) sent in \(outbox.requests) requests, longest wait \(outbox.longestWait * 1000, format: .fixed(precision: 1)) ms, \(self.depth) requests waiting for other servers")
+        outbox.queuedMutations = 0
+        outbox.coalescedMutations = 0
+        outbox.sentMutations = 0
+        outbox.requests = 0
+        outbox.longestWait = 0
+    }
+}
+
+fileprivate extension SBMutationOutbox.Mutation {
+    func isRating(for id: String) -> Bool {
+        if case .setRating(let ratedID, _) = self {
+            return ratedID == id
+        }
+        return false
+    }
+
+    /// The details of a playlist update with its track changes taken out, or nil if that's all it had.
+    var withoutTrackChanges: SBMutationOutbox.Mutation? {
+        guard case .updatePlaylist(let id, let name, let comment, let isPublic, _, _) = self,
+              name != nil || comment != nil || isPublic != nil else {
+            return nil
+        }
+        return .updatePlaylist(id: id, name: name, comment: comment, isPublic: isPublic, appending: [], removing: [])
+    }
+}
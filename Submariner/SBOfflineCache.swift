@@ -0,0 +1,237 @@
+//
+//  SBOfflineCache.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import Combine
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBOfflineCache")
+
+/// Keeps track of tracks downloaded from servers (local tracks with a remote track), so they fit in a size limit.
+///
+/// The total size of downloads is kept as a running total in the defaults, so nothing has to look at every file to know
+/// it. When downloads go over the limit, the ones that were played longest ago get deleted, except for tracks (or tracks
+/// in albums) that are starred on the server, and tracks that are playing, whether as the download or the remote track.
+@objc class SBOfflineCache: NSObject, ObservableObject {
+    @objc static let shared = SBOfflineCache()
+
+    static let usageKey = "offlineCacheUsage"
+
+    /// Downloads from servers, which are what count against the limit.
+    static let downloadedPredicate = NSPredicate(format: "(server == nil) && (remoteTrack != nil)")
+    /// Downloads that can be deleted to make room.
+    static let evictablePredicate = NSPredicate(format: "(server == nil) && (remoteTrack != nil) && (isPlaying == NO) && (remoteTrack.isPlaying == NO) && (remoteTrack.starred == nil) && (remoteTrack.album.starred == nil)")
+
+    private let lock = NSObject()
+    private var evictionScheduled = false
+    private var limitObserver: NSKeyValueObservation?
+    private weak var managedObjectContext: NSManagedObjectContext?
+
+    // For the settings view; these are only updated on the main thread.
+    @Published private(set) var publishedUsage: Int64 = 0
+    @Published private(set) var publishedHitRate: Double = 0
+
+    private override init() {
+        super.init()
+        publishedUsage = usage ?? 0
+    }
+
+    // #MARK: - Statistics
+
+    private var _hits = 0
+    private var _misses = 0
+    private var _bytesEvicted: Int64 = 0
+
+    /// Plays of server tracks that were already downloaded.
+    @objc var hits: Int {
+        synchronized(lock) { _hits }
+    }
+
+    /// Plays of server tracks that had to be streamed.
+    @objc var misses: Int {
+        synchronized(lock) { _misses }
+    }
+
+    @objc var hitRate: Double {
+        synchronized(lock) {
+            _hits + _misses == 0 ? 0 : Double(_hits) / Double(_hits + _misses)
+        }
+    }
+
+    /// Bytes deleted to stay under the limit since launch.
+    @objc var bytesEvicted: Int64 {
+        synchronized(lock) { _bytesEvicted }
+    }
+
+    /// Total size of downloads, or nil if it's never been counted.
+    var usage: Int64? {
+        guard let number = UserDefaults.standard.object(forKey: SBOfflineCache.usageKey) as? NSNumber else {
+            return nil
+        }
+        return number.int64Value
+    }
+
+    private func setUsage(_ newUsage: Int64) {
+        let clamped = max(0, newUsage)
+        UserDefaults.standard.set(NSNumber(value: clamped), forKey: SBOfflineCache.usageKey)
+        DispatchQueue.main.async {
+            self.publishedUsage = clamped
+        }
+    }
+
+    private func publishHitRate() {
+        let hitRate = self.hitRate
+        DispatchQueue.main.async {
+            self.publishedHitRate = hitRate
+        }
+    }
+
+    func logStatistics() {
+        let formatter = ByteCountFormatter()
+        let usageString = formatter.string(fromByteCount: usage ?? 0)
+        let limitString = UserDefaults.standard.offlineCacheLimit == 0 ? "no limit" : formatter.string(fromByteCount: UserDefaults.standard.offlineCacheLimit)
+        logger.info("Downloads use \(usageString, privacy: .public) of \(limitString, privacy: .public), \(self.hits) hits and \(self.misses) misses (\(self.hitRate * 100, format: .fixed(precision: 1))%), \(formatter.string(fromByteCount: self.bytesEvicted), privacy: .public) evicted")
+    }
+
+    // #MARK: - Updating
+
+    /// Starts enforcing the limit, both now and when it changes.
+    @objc func start(managedObjectContext: NSManagedObjectContext) {
+        self.managedObjectContext = managedObjectContext
+        limitObserver = UserDefaults.standard.observe(\.offlineCacheLimit) { [weak self] _, _ in
+            DispatchQueue.main.async {
+                self?.evictIfNeeded()
+            }
+        }
+        evictIfNeeded()
+    }
+
+    /// Records a play of a track, counting it as a hit or miss if it's from a server.
+    ///
+    /// This must be called on the main thread.
+    @objc func recordAccess(track: SBTrack) {
+        let downloaded: SBTrack?
+        if track.server != nil {
+            downloaded = track.localTrack
+        } else if track.remoteTrack != nil {
+            downloaded = track
+        } else {
+            // imported directly, nothing to do with a server
+            return
+        }
+
+        synchronized(lock) {
+            if downloaded != nil {
+                _hits += 1
+            } else {
+                _misses += 1
+            }
+        }
+        downloaded?.lastAccessDate = Date()
+        publishHitRate()
+    }
+
+    /// Counts a new download. Call from whatever context the download was inserted in.
+    func didAdd(track: SBTrack, bytes: Int64) {
+        track.lastAccessDate = Date()
+        // if we never counted, the next eviction will count everything, including this
+        if let usage = self.usage {
+            setUsage(usage + bytes)
+        }
+    }
+
+    /// Counts a download being deleted by something that isn't eviction.
+    func didRemove(bytes: Int64) {
+        if let usage = self.usage {
+            setUsage(usage - bytes)
+        }
+    }
+
+    /// Counts downloads again. This uses the size stored in the track, only looking at files that don't have one.
+    ///
+    /// This must be called from the context's thread, with everything else that should count saved to the context.
+    func recalculateUsage(in context: NSManagedObjectContext) {
+        let start = Date()
+        // the sum below comes from the store, which the writer might not have caught up with
+        do {
+            try SBPersistence.shared.flush()
+        } catch {
+            logger.error("Failed to write pending changes before counting: \(error, privacy: .public)")
+        }
+
+        let missingRequest: NSFetchRequest<SBTrack> = SBTrack.fetchRequest()
+        missingRequest.predicate = NSCompoundPredicate(andPredicateWithSubpredicates: [
+            SBOfflineCache.downloadedPredicate,
+            NSPredicate(format: "(size == nil) || (size == 0)")
+        ])
+        var backfilled = 0
+        var backfilledBytes: Int64 = 0
+        for track in (try? context.fetch(missingRequest)) ?? [] {
+            guard let path = track.path, let attributes = try? FileManager.default.attributesOfItem(atPath: path),
+                  let size = attributes[.size] as? NSNumber else {
+                continue
+            }
+            track.size = size
+            backfilled += 1
+            backfilledBytes += size.int64Value
+        }
+        let sum = NSExpressionDescription()
+        sum.name = "total"
+        sum.expression = NSExpression(forFunction: "sum:", arguments: [NSExpression(forKeyPath: "size")])
+        sum.expressionResultType = .integer64AttributeType
+        let sumRequest = NSFetchRequest<NSDictionary>(entityName: "Track")
+        sumRequest.predicate = SBOfflineCache.downloadedPredicate
+        sumRequest.resultType = .dictionaryResultType
+        sumRequest.propertiesToFetch = [sum]
+        // this comes from the store, so the sizes just backfilled aren't in it yet
+        let stored = ((try? context.fetch(sumRequest))?.first?["total"] as? NSNumber)?.int64Value ?? 0
+        let total = stored + backfilledBytes
+
+        setUsage(total)
+        logger.info("Counted \(total) bytes of downloads in \(Date().timeIntervalSince(start), format: .fixed(precision: 2)) s, \(backfilled) sizes backfilled")
+    }
+
+    /// Counts bytes deleted to stay under the limit.
+    func didEvict(bytes: Int64) {
+        synchronized(lock) {
+            _bytesEvicted += bytes
+        }
+        if let usage = self.usage {
+            setUsage(usage - bytes)
+        }
+    }
+
+    /// Schedules an eviction if downloads are over the limit, or if they've never been counted.
+    func evictIfNeeded() {
+        let limit = UserDefaults.standard.offlineCacheLimit
+        guard let managedObjectContext = self.managedObjectContext else {
+            return
+        }
+        if let usage = self.usage, limit == 0 || usage <= limit {
+            return
+        }
+        let shouldSchedule = synchronized(lock) { () -> Bool in
+            let shouldSchedule = !evictionScheduled
+            evictionScheduled = true
+            return shouldSchedule
+        }
+        guard shouldSchedule else {
+            return
+        }
+        // It must see which tracks are playing, which the player only sets in the main context
+        SBPersistence.shared.saveMainContext()
+        let operation = SBLibraryEvictOperation(managedObjectContext: managedObjectContext)
+        operation.completionBlock = {
+            self.synchronized(lock) {
+                self.evictionScheduled = false
+            }
+        }
+        // with imports, so nothing gets deleted from under them
+        OperationQueue.sharedDownloadQueue.addOperation(operation)
+    }
+}
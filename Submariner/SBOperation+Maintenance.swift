@@ -0,0 +1,192 @@
+//
+//  SBOperation+Maintenance.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBOperation+Maintenance")
+
+/// What a maintenance operation did, phase by phase, for the log.
+struct SBMaintenanceReport: CustomStringConvertible {
+    struct Phase {
+        let name: String
+        var rows = 0
+        var bytesFreed: Int64 = 0
+        var elapsed: TimeInterval = 0
+    }
+
+    let name: String
+    private(set) var phases: [Phase] = []
+
+    init(name: String) {
+        self.name = name
+    }
+
+    var rows: Int {
+        phases.reduce(0) { $0 + $1.rows }
+    }
+
+    var bytesFreed: Int64 {
+        phases.reduce(0) { $0 + $1.bytesFreed }
+    }
+
+    var elapsed: TimeInterval {
+        phases.reduce(0) { $0 + $1.elapsed }
+    }
+
+    /// Runs a phase, timing it. Running a phase with the same name again adds to it, for work done in batches.
+    mutating func run(_ name: String, _ body: (inout Phase) -> Void) {
+        var phase = Phase(name: name)
+        let start = Date()
+        body(&phase)
+        phase.elapsed = Date().timeIntervalSince(start)
+        if let i = phases.firstIndex(where: { $0.name == name }) {
+            phases[i].rows += phase.rows
+            phases[i].bytesFreed += phase.bytesFreed
+            phases[i].elapsed += phase.elapsed
+        } else {
+            phases.append(phase)
+        }
+    }
+
+    var description: String {
+        let formatter = ByteCountFormatter()
+        let phaseDescriptions = phases.map { phase in
+            String(format: "%@: %d rows, %@ freed, %.1f ms", phase.name, phase.rows,
+                   formatter.string(fromByteCount: phase.bytesFreed), phase.elapsed * 1000)
+        }
+        return String(format: "%@ touched %d rows, freed %@ in %.1f ms (%@)", name, rows,
+                      formatter.string(fromByteCount: bytesFreed), elapsed * 1000,
+                      phaseDescriptions.joined(separator: "; "))
+    }
+}
+
+extension SBOperation {
+    /// How many files to remove at once; more than this just makes the disk seek.
+    static let maxConcurrentFileOperations = 4
+
+    // #MARK: - Batch Requests
+
+    /// Deletes everything matching a predicate in the store, without loading any of it, returning how many were deleted.
+    ///
+    /// Anything pending in the threaded context should be saved first. Deletions are merged into the writer, main and
+    /// threaded contexts, so objects they have are turned into faults or removed.
+    @discardableResult func batchDelete(entityName: String, predicate: NSPredicate) -> Int {
+        let fetchRequest = NSFetchRequest<NSFetchRequestResult>(entityName: entityName)
+        fetchRequest.predicate = predicate
+        return batchDelete(NSBatchDeleteRequest(fetchRequest: fetchRequest))
+    }
+
+    /// Deletes objects by ID in the store, returning how many were deleted.
+    @discardableResult func batchDelete(objectIDs: [NSManagedObjectID]) -> Int {
+        guard !objectIDs.isEmpty else {
+            return 0
+        }
+        return batchDelete(NSBatchDeleteRequest(objectIDs: objectIDs))
+    }
+
+    private func batchDelete(_ request: NSBatchDeleteRequest) -> Int {
+        request.resultType = .resultTypeObjectIDs
+        guard let result = executeBatch(request) as? NSBatchDeleteResult,
+              let objectIDs = result.result as? [NSManagedObjectID] else {
+            return 0
+        }
+        mergeBatchChanges([NSDeletedObjectsKey: objectIDs])
+        return objectIDs.count
+    }
+
+    /// Sets properties on everything matching a predicate in the store, returning how many were changed.
+    @discardableResult func batchUpdate(entityName: String, predicate: NSPredicate, propertiesToUpdate: [AnyHashable: Any]) -> Int {
+        let request = NSBatchUpdateRequest(entityName: entityName)
+        request.predicate = predicate
+        request.propertiesToUpdate = propertiesToUpdate
+        request.resultType = .updatedObjectIDsResultType
+        guard let result = executeBatch(request) as? NSBatchUpdateResult,
+              let objectIDs = result.result as? [NSManagedObjectID] else {
+            return 0
+        }
+        mergeBatchChanges([NSUpdatedObjectsKey: objectIDs])
+        return objectIDs.count
+    }
+
+    private func executeBatch(_ request: NSPersistentStoreRequest) -> NSPersistentStoreResult? {
+        guard let coordinator = mainContext.persistentStoreCoordinator else {
+            return nil
+        }
+        // What the writer hasn't written yet would otherwise be missed, or undo what the request does when it is
+        do {
+            try SBPersistence.shared.flush()
+        } catch {
+            logger.error("Failed to write pending changes before a batch request: \(error, privacy: .public)")
+        }
+        // Batch requests go straight to the store, so they need a context on the coordinator, not a child context
+        let batchContext = NSManagedObjectContext(concurrencyType: .privateQueueConcurrencyType)
+        batchContext.persistentStoreCoordinator = coordinator
+        return batchContext.performAndWait {
+            do {
+                return try batchContext.execute(request)
+            } catch {
+                logger.error("Batch request failed: \(error, privacy: .public)")
+                return nil
+            }
+        }
+    }
+
+    private func mergeBatchChanges(_ changes: [AnyHashable: Any]) {
+        // The writer and main context are told by the persistence layer; the threaded context has to be told separately
+        SBPersistence.shared.storeDidChange(changes)
+        threadedContext.performAndWait {
+            NSManagedObjectContext.mergeChanges(fromRemoteContextSave: changes, into: [threadedContext])
+        }
+    }
+
+    // #MARK: - Files
+
+    /// Runs something for each item, but only a few at a time, for filesystem work.
+    static func concurrentlyPerform<T>(_ items: [T], _ body: (T) -> Void) {
+        guard !items.isEmpty else {
+            return
+        }
+        let lanes = min(SBOperation.maxConcurrentFileOperations, items.count)
+        // Each lane takes every nth item, so at most `lanes` are running.
+        DispatchQueue.concurrentPerform(iterations: lanes) { lane in
+            for i in stride(from: lane, to: items.count, by: lanes) {
+                body(items[i])
+            }
+        }
+    }
+
+    /// Removes files a few at a time, returning how many bytes were freed, and the paths that couldn't be removed.
+    ///
+    /// Files that don't exist count as removed.
+    func removeFiles(atPaths paths: [String]) -> (bytesFreed: Int64, failed: Set<String>) {
+        guard !paths.isEmpty else {
+            return (0, [])
+        }
+        let lock = NSLock()
+        var bytesFreed: Int64 = 0
+        var failed = Set<String>()
+        SBOperation.concurrentlyPerform(paths) { path in
+            guard let attributes = try? FileManager.default.attributesOfItem(atPath: path) else {
+                return
+            }
+            do {
+                try FileManager.default.removeItem(atPath: path)
+                lock.lock()
+                bytesFreed += (attributes[.size] as? NSNumber)?.int64Value ?? 0
+                lock.unlock()
+            } catch {
+                logger.warning("Failed to remove \(path, privacy: .public), because of \(error, privacy: .public)")
+                lock.lock()
+                failed.insert(path)
+                lock.unlock()
+            }
+        }
+        return (bytesFreed, failed)
+    }
+}
@@ -23,9 +23,10 @@ class SBOperation: Operation, ObservableObject, Identifiable {
     init(managedObjectContext: NSManagedObjectContext, name: String, author: String? = nil) {
         self.mainContext = managedObjectContext
         self.threadedContext = NSManagedObjectContext(concurrencyType: .privateQueueConcurrencyType)
-        // For automatic merging to work, seems we need to associate with the parent MOC,
-        // rather than attaching to the persistent store coordinator.
-        self.threadedContext.parent = managedObjectContext
+        // Saving into the writer instead of the context we were made from means saving never waits on the main thread.
+        // The writer only has what the main context saved, so whoever makes an operation that needs unsaved changes
+        // from the UI has to save them first, i.e. with SBPersistence.saveMainContext.
+        self.threadedContext.parent = SBPersistence.shared.writerContext
         self.threadedContext.automaticallyMergesChangesFromParent = true
         self.threadedContext.mergePolicy = self.mainContext.mergePolicy
         self.threadedContext.retainsRegisteredObjects = true
@@ -52,6 +53,13 @@ class SBOperation: Operation, ObservableObject, Identifiable {
         case determinate(n: Float, outOf: Float)
     }
     
+    // #MARK: - Telemetry
+    
+    let metrics = SBOperationMetrics()
+    /// Set by whatever queues the operation, for seeing how long it waits behind others.
+    var enqueuedDate: Date?
+    private var recordedFinish = false
+    
     // #MARK: - Concurrency
     
     private var _isExecuting = false
@@ -76,6 +84,10 @@ class SBOperation: Operation, ObservableObject, Identifiable {
             self.didChangeValue(forKey: "isFinished")
             return
         }
+        if let enqueuedDate = self.enqueuedDate {
+            metrics.add(since: enqueuedDate, to: .queueWait)
+        }
+        SBOperationTelemetry.shared.begin(self)
         Thread.detachNewThread {
             self.main()
         }
@@ -92,6 +104,10 @@ class SBOperation: Operation, ObservableObject, Identifiable {
         isFinished = true
         self.didChangeValue(forKey: "isExecuting")
         self.didChangeValue(forKey: "isFinished")
+        if !recordedFinish {
+            recordedFinish = true
+            SBOperationTelemetry.shared.finish(self)
+        }
         DispatchQueue.main.async {
             NotificationCenter.default.post(name: .SBSubsonicOperationFinished, object: self)
         }
@@ -103,12 +119,22 @@ class SBOperation: Operation, ObservableObject, Identifiable {
         if self.threadedContext.hasChanges {
             logger.info("Changes to Core Data will be saved...")
             do {
-                // Merging is now done by NSManagedObjectContext.automaticallyMergesChangesFromParent
-                try self.threadedContext.performAndWait {
-                    try self.threadedContext.save()
+                // This only hands the changes to the writer; it writes them to the store and the main context later
+                let changes = try metrics.measure(.save) {
+                    try self.threadedContext.performAndWait {
+                        let context = self.threadedContext
+                        // The main context has to get the same IDs the store will have for these
+                        try context.obtainPermanentIDs(for: Array(context.insertedObjects))
+                        let inserted = Set(context.insertedObjects.map { $0.objectID })
+                        let updated = Set(context.updatedObjects.map { $0.objectID })
+                        let deleted = Set(context.deletedObjects.map { $0.objectID })
+                        metrics.add(objects: inserted.count + updated.count + deleted.count)
+                        try context.save()
+                        return (inserted, updated, deleted)
+                    }
                 }
-                try self.mainContext.performAndWait {
-                    try self.mainContext.save()
+                metrics.measure(.merge) {
+                    SBPersistence.shared.operationDidSave(inserted: changes.0, updated: changes.1, deleted: changes.2)
                 }
             } catch {
                 logger.error("Failed to save: \(error, privacy: .public)")
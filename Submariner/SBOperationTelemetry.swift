@@ -0,0 +1,304 @@
+//
+//  SBOperationTelemetry.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBOperationTelemetry")
+
+/// Where an operation's time went, and how much it moved, filled in as it runs.
+///
+/// Phases measured with `measure(_:_:)` can nest on the same thread, i.e. a save in the middle of a parse. The time
+/// of the inner phase only counts towards it, not the outer one, so the phases add up to the total.
+class SBOperationMetrics {
+    enum Phase: String, CaseIterable {
+        case queueWait
+        case build
+        case firstByte
+        case transfer
+        case parse
+        case merge
+        case save
+        case notify
+    }
+
+    /// What the operation was doing, i.e. the request type, for summarizing similar operations together.
+    var endpoint: String?
+
+    private let lock = NSLock()
+    private(set) var durations: [Phase: TimeInterval] = [:]
+    private(set) var bytes: Int64 = 0
+    private(set) var objects = 0
+    // time spent in nested phases, for each phase being measured
+    private var nested: [TimeInterval] = []
+
+    let signpostID = SBOperationTelemetry.signposter.makeSignpostID()
+    var intervalState: OSSignpostIntervalState?
+    let created = Date()
+    var started: Date?
+
+    func add(_ duration: TimeInterval, to phase: Phase) {
+        lock.lock()
+        durations[phase, default: 0] += duration
+        lock.unlock()
+        SBOperationTelemetry.signposter.emitEvent("Phase", id: signpostID, "\(phase.rawValue, privacy: .public) \(duration * 1000, format: .fixed(precision: 1)) ms")
+    }
+
+    func add(since start: Date, to phase: Phase) {
+        add(Date().timeIntervalSince(start), to: phase)
+    }
+
+    func add(bytes: Int64) {
+        lock.lock()
+        self.bytes += bytes
+        lock.unlock()
+    }
+
+    func add(objects: Int) {
+        lock.lock()
+        self.objects += objects
+        lock.unlock()
+    }
+
+    @discardableResult func measure<T>(_ phase: Phase, _ body: () throws -> T) rethrows -> T {
+        let state = SBOperationTelemetry.signposter.beginInterval("Phase", id: signpostID, "\(phase.rawValue, privacy: .public)")
+        lock.lock()
+        nested.append(0)
+        lock.unlock()
+        let start = Date()
+        defer {
+            let elapsed = Date().timeIntervalSince(start)
+            lock.lock()
+            let inner = nested.popLast() ?? 0
+            if !nested.isEmpty {
+                nested[nested.count - 1] += elapsed
+            }
+            durations[phase, default: 0] += max(0, elapsed - inner)
+            lock.unlock()
+            SBOperationTelemetry.signposter.endInterval("Phase", state)
+        }
+        return try body()
+    }
+
+    /// Takes the time to first byte, transfer time and size from a finished task.
+    func add(taskMetrics: URLSessionTaskMetrics) {
+        guard let transaction = taskMetrics.transactionMetrics.last else {
+            return
+        }
+        if let requestStart = transaction.requestStartDate ?? transaction.fetchStartDate,
+           let responseStart = transaction.responseStartDate {
+            add(responseStart.timeIntervalSince(requestStart), to: .firstByte)
+            if let responseEnd = transaction.responseEndDate {
+                add(responseEnd.timeIntervalSince(responseStart), to: .transfer)
+            }
+        }
+        add(bytes: transaction.countOfResponseBodyBytesReceived)
+    }
+
+    fileprivate var snapshot: (durations: [Phase: TimeInterval], bytes: Int64, objects: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+        return (durations, bytes, objects)
+    }
+}
+
+/// Collects what every operation recorded in its metrics, so it's possible to tell where a slow refresh spent its time.
+///
+/// - Each operation and phase is a signpost, for Instruments.
+/// - Each finished operation is appended as a line of JSON to `~/Library/Logs/Submariner/Operations.jsonl`, if the
+///   `recordOperationTelemetry` default has been turned on. The file is rotated once it gets big.
+/// - A rolling summary of the median and 95th percentile of each phase, for each kind of operation and endpoint, is
+///   logged and written to `Operations Summary.json` next to it every so often.
+class SBOperationTelemetry {
+    static let shared = SBOperationTelemetry()
+
+    static let signposter = OSSignposter(subsystem: Bundle.main.bundleIdentifier!, category: "Operations")
+
+    /// How many of the latest operations of a kind the summary covers.
+    static let samplesKept = 256
+    /// How many operations between writing the summary.
+    static let summaryInterval = 100
+    static let maxLogSize: UInt64 = 8 * 1024 * 1024
+
+    static var directory: URL {
+        // not mixed in with the real logs
+        if SBAppDelegate.isRunningTests {
+            return SBAppDelegate.libraryDirectory.appendingPathComponent("Logs", isDirectory: true)
+        }
+        return FileManager.default.urls(for: .libraryDirectory, in: .userDomainMask).first!
+            .appendingPathComponent("Logs/Submariner", isDirectory: true)
+    }
+
+    static var logURL: URL {
+        directory.appendingPathComponent("Operations.jsonl")
+    }
+
+    static var summaryURL: URL {
+        directory.appendingPathComponent("Operations Summary.json")
+    }
+
+    // all state is only touched on here
+    private let queue = DispatchQueue(label: "SBOperationTelemetry", qos: .utility)
+    private var logHandle: FileHandle?
+    // kind and endpoint -> phase (or "total") -> latest durations in ms, oldest first
+    private var samples: [String: [String: [Double]]] = [:]
+    private var recordsSinceSummary = 0
+
+    private let dateFormatter = ISO8601DateFormatter()
+
+    private init() {
+        dateFormatter.formatOptions = [.withInternetDateTime, .withFractionalSeconds]
+    }
+
+    // #MARK: - Recording
+
+    func begin(_ operation: SBOperation) {
+        let metrics = operation.metrics
+        metrics.started = Date()
+        metrics.intervalState = SBOperationTelemetry.signposter.beginInterval("Operation", id: metrics.signpostID, "\(String(describing: type(of: operation)), privacy: .public) \(metrics.endpoint ?? "", privacy: .public)")
+    }
+
+    func finish(_ operation: SBOperation) {
+        let metrics = operation.metrics
+        if let intervalState = metrics.intervalState {
+            SBOperationTelemetry.signposter.endInterval("Operation", intervalState)
+        }
+        let kind = String(describing: type(of: operation))
+        let snapshot = metrics.snapshot
+        let finished = Date()
+        let total = finished.timeIntervalSince(metrics.started ?? metrics.created) + (snapshot.durations[.queueWait] ?? 0)
+
+        var record: [String: Any] = [
+            "date": dateFormatter.string(from: finished),
+            "kind": kind,
+            "totalMs": total * 1000,
+            "bytes": snapshot.bytes,
+            "objects": snapshot.objects,
+        ]
+        if let endpoint = metrics.endpoint {
+            record["endpoint"] = endpoint
+        }
+        var phases: [String: Double] = [:]
+        for (phase, duration) in snapshot.durations {
+            phases[phase.rawValue] = duration * 1000
+        }
+        record["phasesMs"] = phases
+
+        let key = metrics.endpoint.map { "\(kind) \($0)" } ?? kind
+        queue.async {
+            self.addSamples(phases.merging(["total": total * 1000]) { a, _ in a }, for: key)
+            if UserDefaults.standard.recordOperationTelemetry {
+                self.append(record)
+            }
+            self.recordsSinceSummary += 1
+            if self.recordsSinceSummary >= SBOperationTelemetry.summaryInterval {
+                self.recordsSinceSummary = 0
+                self.writeSummary()
+            }
+        }
+    }
+
+    private func addSamples(_ phases: [String: Double], for key: String) {
+        var keySamples = samples[key] ?? [:]
+        for (phase, milliseconds) in phases {
+            var phaseSamples = keySamples[phase] ?? []
+            phaseSamples.append(milliseconds)
+            if phaseSamples.count > SBOperationTelemetry.samplesKept {
+                phaseSamples.removeFirst(phaseSamples.count - SBOperationTelemetry.samplesKept)
+            }
+            keySamples[phase] = phaseSamples
+        }
+        samples[key] = keySamples
+    }
+
+    private func append(_ record: [String: Any]) {
+        guard var line = try? JSONSerialization.data(withJSONObject: record, options: [.sortedKeys]) else {
+            return
+        }
+        line.append(0x0A) // newline
+        do {
+            if logHandle == nil {
+                try FileManager.default.createDirectory(at: SBOperationTelemetry.directory, withIntermediateDirectories: true)
+                if !FileManager.default.fileExists(atPath: SBOperationTelemetry.logURL.path) {
+                    FileManager.default.createFile(atPath: SBOperationTelemetry.logURL.path, contents: nil)
+                }
+                logHandle = try FileHandle(forWritingTo: SBOperationTelemetry.logURL)
+            }
+            guard let logHandle = self.logHandle else {
+                return
+            }
+            let size = try logHandle.seekToEnd()
+            if size > SBOperationTelemetry.maxLogSize {
+                rotate()
+                append(record)
+                return
+            }
+            try logHandle.write(contentsOf: line)
+        } catch {
+            logger.error("Couldn't write operation telemetry: \(error, privacy: .public)")
+            try? logHandle?.close()
+            logHandle = nil
+        }
+    }
+
+    /// Keeps one old log around, so there's always a full log's worth.
+    private func rotate() {
+        try? logHandle?.close()
+        logHandle = nil
+        let oldURL = SBOperationTelemetry.logURL.appendingPathExtension("1")
+        try? FileManager.default.removeItem(at: oldURL)
+        try? FileManager.default.moveItem(at: SBOperationTelemetry.logURL, to: oldURL)
+    }
+
+    // #MARK: - Summary
+
+    private static func percentile(_ sorted: [Double], _ fraction: Double) -> Double {
+        guard !sorted.isEmpty else {
+            return 0
+        }
+        let index = Int((Double(sorted.count - 1) * fraction).rounded())
+        return sorted[index]
+    }
+
+    /// The median and 95th percentile in milliseconds for each phase, for each kind of operation and endpoint.
+    func summary() -> [String: [String: [String: Double]]] {
+        queue.sync {
+            makeSummary()
+        }
+    }
+
+    private func makeSummary() -> [String: [String: [String: Double]]] {
+        samples.mapValues { phases in
+            phases.mapValues { values in
+                let sorted = values.sorted()
+                return [
+                    "count": Double(sorted.count),
+                    "p50": SBOperationTelemetry.percentile(sorted, 0.5),
+                    "p95": SBOperationTelemetry.percentile(sorted, 0.95),
+                ]
+            }
+        }
+    }
+
+    private func writeSummary() {
+        let summary = makeSummary()
+        for (key, phases) in summary.sorted(by: { $0.key < $1.key }) {
+            let description = phases.sorted { $0.key < $1.key }.map { phase, stats in
+                String(format: "%@ %.1f/%.1f", phase, stats["p50"] ?? 0, stats["p95"] ?? 0)
+            }.joined(separator: ", ")
+            logger.info("\(key, privacy: .public) p50/p95 ms: \(description, privacy: .public)")
+        }
+        do {
+            try FileManager.default.createDirectory(at: SBOperationTelemetry.directory, withIntermediateDirectories: true)
+            let data = try JSONSerialization.data(withJSONObject: summary, options: [.prettyPrinted, .sortedKeys])
+            try data.write(to: SBOperationTelemetry.summaryURL, options: [.atomic])
+        } catch {
+            logger.error("Couldn't write operation summary: \(error, privacy: .public)")
+        }
+    }
+}
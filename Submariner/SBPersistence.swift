@@ -0,0 +1,297 @@
+//
+//  SBPersistence.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBPersistence")
+
+extension NSNotification.Name {
+    /// Posted on the main thread once changes saved in the background are in the main context.
+    ///
+    /// The user info has arrays of object IDs under `NSInsertedObjectsKey`, `NSUpdatedObjectsKey` and
+    /// `NSDeletedObjectsKey`, like a remote context save.
+    static let SBPersistenceDidMergeChanges = NSNotification.Name("SBPersistenceDidMergeChanges")
+}
+
+/// Writes changes to the store in the background, so neither operations nor the UI wait on SQLite.
+///
+/// - The writer context is the only one attached to the store coordinator. The main context and every operation's
+///   threaded context are its children, so saving one only hands its changes to the writer.
+/// - The writer writes whatever it has at most every `writeInterval`, so saves from operations running at once end up
+///   in the same transaction.
+/// - What operations saved is merged into the main context asynchronously, at most every `mergeInterval`.
+/// - Time the main thread spends saving and merging is measured, and logged every so often.
+class SBPersistence {
+    static let shared = SBPersistence()
+
+    static let writeInterval: TimeInterval = 0.25
+    static let mergeInterval: TimeInterval = 0.1
+    /// How many writes between logging how long things took.
+    static let reportInterval = 100
+
+    private(set) var writerContext: NSManagedObjectContext!
+    private(set) var mainContext: NSManagedObjectContext!
+
+    private var observers: [NSObjectProtocol] = []
+
+    // guards everything up to the main thread only state
+    private let lock = NSLock()
+    private var writeScheduled = false
+    private var mergeScheduled = false
+    private var pendingInserted = Set<NSManagedObjectID>()
+    private var pendingUpdated = Set<NSManagedObjectID>()
+    private var pendingDeleted = Set<NSManagedObjectID>()
+    private var writes = 0
+    private var objectsWritten = 0
+    private var writeTime: TimeInterval = 0
+
+    // only touched on the main thread
+    private var lastMerge = Date.distantPast
+    private var saveStarted: Date?
+    private var mainThreadSaves = 0
+    private var mainThreadSaveTime: TimeInterval = 0
+    private var merges = 0
+    private var objectsMerged = 0
+    private var mainThreadMergeTime: TimeInterval = 0
+    private var longestOnMainThread: TimeInterval = 0
+
+    private init() {
+    }
+
+    deinit {
+        for observer in observers {
+            NotificationCenter.default.removeObserver(observer)
+        }
+    }
+
+    // #MARK: - Contexts
+
+    /// Makes the writer on the coordinator, returning the main context for the UI on top of it.
+    func start(coordinator: NSPersistentStoreCoordinator) -> NSManagedObjectContext {
+        let writerContext = NSManagedObjectContext(concurrencyType: .privateQueueConcurrencyType)
+        writerContext.persistentStoreCoordinator = coordinator
+        // Nothing else writes to the store except batch requests, which flush first, so what's in memory is newest
+        writerContext.mergePolicy = NSMergePolicy.mergeByPropertyObjectTrump
+        writerContext.name = "Writer"
+        self.writerContext = writerContext
+
+        // must be main queue for SwiftUI
+        let mainContext = NSManagedObjectContext(concurrencyType: .mainQueueConcurrencyType)
+        mainContext.parent = writerContext
+        // Changes from operations are merged by us, so they can be throttled
+        mainContext.automaticallyMergesChangesFromParent = false
+        mainContext.name = "Main"
+        self.mainContext = mainContext
+
+        observers.append(NotificationCenter.default.addObserver(forName: .NSManagedObjectContextWillSave, object: mainContext, queue: nil) { [weak self] _ in
+            self?.mainContextWillSave()
+        })
+        observers.append(NotificationCenter.default.addObserver(forName: .NSManagedObjectContextDidSave, object: mainContext, queue: nil) { [weak self] _ in
+            self?.mainContextDidSave()
+        })
+        return mainContext
+    }
+
+    private func mainContextWillSave() {
+        saveStarted = Date()
+        // Otherwise objects inserted in the main context would keep temporary IDs after the writer stores them
+        let inserted = Array(mainContext.insertedObjects.filter { $0.objectID.isTemporaryID })
+        if !inserted.isEmpty {
+            do {
+                try mainContext.obtainPermanentIDs(for: inserted)
+            } catch {
+                logger.error("Couldn't get permanent IDs for the main context: \(error, privacy: .public)")
+            }
+        }
+    }
+
+    private func mainContextDidSave() {
+        if let saveStarted = self.saveStarted {
+            let elapsed = Date().timeIntervalSince(saveStarted)
+            mainThreadSaves += 1
+            mainThreadSaveTime += elapsed
+            longestOnMainThread = max(longestOnMainThread, elapsed)
+            self.saveStarted = nil
+        }
+        scheduleWrite()
+    }
+
+    // #MARK: - Writing
+
+    /// Tells us an operation saved its threaded context into the writer, with the IDs of what it changed.
+    ///
+    /// The changes get written with whatever else comes in soon, and merged into the main context after that.
+    func operationDidSave(inserted: Set<NSManagedObjectID>, updated: Set<NSManagedObjectID>, deleted: Set<NSManagedObjectID>) {
+        enqueueMerge(inserted: inserted, updated: updated, deleted: deleted)
+        scheduleWrite()
+    }
+
+    private func scheduleWrite() {
+        lock.lock()
+        let alreadyScheduled = writeScheduled
+        writeScheduled = true
+        lock.unlock()
+        guard !alreadyScheduled else {
+            return
+        }
+        DispatchQueue.global(qos: .utility).asyncAfter(deadline: .now() + SBPersistence.writeInterval) {
+            self.writerContext.perform {
+                self.write()
+            }
+        }
+    }
+
+    // on the writer's queue
+    private func write() {
+        lock.lock()
+        // anything saved into the writer from now on needs another write
+        writeScheduled = false
+        lock.unlock()
+        guard writerContext.hasChanges else {
+            return
+        }
+        let objects = writerContext.insertedObjects.count + writerContext.updatedObjects.count + writerContext.deletedObjects.count
+        let state = SBOperationTelemetry.signposter.beginInterval("Write", "\(objects) objects")
+        let start = Date()
+        do {
+            try writerContext.save()
+        } catch {
+            // still in the writer, so the next write tries them again
+            logger.error("Failed to write to the store: \(error, privacy: .public)")
+        }
+        let elapsed = Date().timeIntervalSince(start)
+        SBOperationTelemetry.signposter.endInterval("Write", state)
+
+        lock.lock()
+        writes += 1
+        objectsWritten += objects
+        writeTime += elapsed
+        let report = writes % SBPersistence.reportInterval == 0
+        lock.unlock()
+        if report {
+            DispatchQueue.main.async {
+                self.logStatistics()
+            }
+        }
+    }
+
+    /// Hands what the UI has changed but not saved to the writer, so an operation about to start can see it.
+    ///
+    /// Operations' contexts are children of the writer, not the main context, so they only see what's been saved.
+    /// This must be called on the main thread.
+    func saveMainContext() {
+        guard mainContext.hasChanges else {
+            return
+        }
+        do {
+            try mainContext.save()
+        } catch {
+            logger.error("Failed to save the main context: \(error, privacy: .public)")
+        }
+    }
+
+    /// Writes everything the writer has to the store now, for things that read the store directly or are quitting.
+    func flush() throws {
+        try writerContext.performAndWait {
+            if writerContext.hasChanges {
+                try writerContext.save()
+            }
+        }
+    }
+
+    /// Brings the writer and main context up to date with changes made straight to the store, i.e. batch requests.
+    func storeDidChange(_ changes: [AnyHashable: Any]) {
+        writerContext.performAndWait {
+            NSManagedObjectContext.mergeChanges(fromRemoteContextSave: changes, into: [writerContext])
+        }
+        enqueueMerge(inserted: Set(changes[NSInsertedObjectsKey] as? [NSManagedObjectID] ?? []),
+                     updated: Set(changes[NSUpdatedObjectsKey] as? [NSManagedObjectID] ?? []),
+                     deleted: Set(changes[NSDeletedObjectsKey] as? [NSManagedObjectID] ?? []))
+    }
+
+    // #MARK: - Merging
+
+    private func enqueueMerge(inserted: Set<NSManagedObjectID>, updated: Set<NSManagedObjectID>, deleted: Set<NSManagedObjectID>) {
+        guard !inserted.isEmpty || !updated.isEmpty || !deleted.isEmpty else {
+            return
+        }
+        lock.lock()
+        pendingInserted.formUnion(inserted)
+        pendingUpdated.formUnion(updated)
+        pendingDeleted.formUnion(deleted)
+        let alreadyScheduled = mergeScheduled
+        mergeScheduled = true
+        lock.unlock()
+        guard !alreadyScheduled else {
+            return
+        }
+        DispatchQueue.main.async {
+            // Right away if it's been a while, so notifications posted after saving see the changes
+            let wait = SBPersistence.mergeInterval - Date().timeIntervalSince(self.lastMerge)
+            if wait > 0 {
+                DispatchQueue.main.asyncAfter(deadline: .now() + wait) {
+                    self.merge()
+                }
+            } else {
+                self.merge()
+            }
+        }
+    }
+
+    // on the main thread
+    private func merge() {
+        lock.lock()
+        let deleted = pendingDeleted
+        let inserted = pendingInserted.subtracting(deleted)
+        let updated = pendingUpdated.subtracting(deleted).subtracting(inserted)
+        pendingInserted = []
+        pendingUpdated = []
+        pendingDeleted = []
+        mergeScheduled = false
+        lock.unlock()
+
+        let changes: [AnyHashable: Any] = [
+            NSInsertedObjectsKey: Array(inserted),
+            NSUpdatedObjectsKey: Array(updated),
+            NSDeletedObjectsKey: Array(deleted),
+        ]
+        let objects = inserted.count + updated.count + deleted.count
+        let state = SBOperationTelemetry.signposter.beginInterval("Merge", "\(objects) objects")
+        let start = Date()
+        NSManagedObjectContext.mergeChanges(fromRemoteContextSave: changes, into: [mainContext])
+        let elapsed = Date().timeIntervalSince(start)
+        SBOperationTelemetry.signposter.endInterval("Merge", state)
+        lastMerge = Date()
+        merges += 1
+        objectsMerged += objects
+        mainThreadMergeTime += elapsed
+        longestOnMainThread = max(longestOnMainThread, elapsed)
+
+        // Operations used to save the main context along with their own, so unsaved edits from the UI still go with them
+        if mainContext.hasChanges {
+            do {
+                try mainContext.save()
+            } catch {
+                logger.error("Failed to save the main context: \(error, privacy: .public)")
+            }
+        }
+
+        NotificationCenter.default.post(name: .SBPersistenceDidMergeChanges, object: self, userInfo: changes)
+    }
+
+    // #MARK: - Statistics
+
+    // on the main thread
+    private func logStatistics() {
+        lock.lock()
+        let writes = self.writes, objectsWritten = self.objectsWritten, writeTime = self.writeTime
+        lock.unlock()
+        logger.info("\(writes) writes of \(objectsWritten) objects took \(writeTime * 1000, format: .fixed(precision: 1)) ms in the background; on the main thread, \(self.mainThreadSaves) saves took \(self.mainThreadSaveTime * 1000, format: .fixed(precision: 1)) ms and \(self.merges) merges of \(self.objectsMerged) objects took \(self.mainThreadMergeTime * 1000, format: .fixed(precision: 1)) ms, longest \(self.longestOnMainThread * 1000, format: .fixed(precision: 1)) ms")
+    }
+}
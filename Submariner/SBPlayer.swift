@@ -35,6 +35,11 @@ extension NSNotification.Name {
     var playerStatusObserver: NSKeyValueObservation?
     var playRateObserver: NSKeyValueObservation?
     
+    // Tracks being cached while they play, by track
+    private var streamingDownloads: [NSManagedObjectID: SBStreamingDownloadOperation] = [:]
+    // What the current item plays from. The resource loader only holds it weakly, and it has to outlive the download.
+    private var playingDownload: SBStreamingDownloadOperation?
+    
     private override init() {
         super.init()
         
@@ -581,6 +586,9 @@ extension NSNotification.Name {
             return
         }
         
+        // before it might start getting downloaded, so it counts as a miss
+        SBOfflineCache.shared.recordAccess(track: track)
+        
         if !self.playRemote(track: track) {
             // this is very unusual if it happens
             showTrackNoURLAlert()
@@ -612,6 +620,11 @@ extension NSNotification.Name {
     
     private func playRemote(track: SBTrack) -> Bool {
         remotePlayer.replaceCurrentItem(with: nil)
+        // skipped before it finished downloading, so don't keep fetching it
+        if let playingDownload = self.playingDownload, playingDownload.trackID != track.objectID {
+            playingDownload.cancel()
+        }
+        playingDownload = nil
         
         if let url = track.localTrack?.streamURL() ?? track.streamURL() {
             // XXX: Debug?
@@ -633,7 +646,15 @@ extension NSNotification.Name {
                 }
             }
             
-            let asset = AVURLAsset(url: url, options: options)
+            let asset: AVURLAsset
+            if let download = streamingDownload(for: track) {
+                // Play from the download that'll end up in the cache, instead of fetching the track twice
+                asset = AVURLAsset(url: download.assetURL, options: options)
+                asset.resourceLoader.setDelegate(download, queue: download.queue)
+                playingDownload = download
+            } else {
+                asset = AVURLAsset(url: url, options: options)
+            }
             let newItem = AVPlayerItem(asset: asset)
             
             remotePlayer.replaceCurrentItem(with: newItem)
@@ -771,6 +792,8 @@ extension NSNotification.Name {
     @objc func stop() {
         synchronized(self) {
             remotePlayer.replaceCurrentItem(with: nil)
+            playingDownload?.cancel()
+            playingDownload = nil
             
             unplayAllTracks()
             currentIndex = nil
@@ -979,6 +1002,26 @@ extension NSNotification.Name {
         }
     }
     
+    /// Gets the download to play a track from if it should be cached, starting one if needed.
+    private func streamingDownload(for track: SBTrack) -> SBStreamingDownloadOperation? {
+        guard UserDefaults.standard.enableCacheStreaming, track.isLocal != true, track.localTrack == nil,
+              let managedObjectContext = track.managedObjectContext,
+              SBStreamingDownloadOperation.canStream(track: track) else {
+            return nil
+        }
+        if let download = streamingDownloads[track.objectID] {
+            return download
+        }
+        let download = SBStreamingDownloadOperation(managedObjectContext: managedObjectContext, track: track)
+        let trackID = track.objectID
+        download.completion = { [weak self] in
+            self?.streamingDownloads[trackID] = nil
+        }
+        streamingDownloads[trackID] = download
+        download.start()
+        return download
+    }
+    
     private func cacheTrack() {
         if UserDefaults.standard.enableCacheStreaming {
             if let currentTrack = self.currentTrack {
@@ -987,8 +1030,13 @@ extension NSNotification.Name {
                     return
                 }
                 
+                // Already being cached as it plays.
+                if streamingDownloads[currentTrack.objectID] != nil {
+                    return
+                }
+                
                 if let op = SBSubsonicDownloadOperation(managedObjectContext: currentTrack.managedObjectContext, trackID: currentTrack.objectID) {
-                    OperationQueue.sharedDownloadQueue.addOperation(op)
+                    SBDownloadManager.shared.add(op)
                 }
             }
         }
@@ -9,63 +9,181 @@
 
 import Foundation
 import CoreData
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBPlaylist")
 
 @objc(SBPlaylist)
 public class SBPlaylist: SBResource {
     @objc var resources = NSSet()
     
-    // #MARK: - Core Data NSSet backwards compatibility
+    // Tracks resolved from the entries. Table bindings ask for tracks constantly, so only do it when they change.
+    private var cachedTracks: [SBTrack]?
+    
+    // #MARK: - Track ordering
     
     override public class func keyPathsForValuesAffectingValue(forKey key: String) -> Set<String> {
         if key == "tracks" {
-            return Set(["trackIDs"])
-        } else if key == "trackIDs" {
-            return Set(["tracks"])
+            return Set(["entries"])
         }
         return super.keyPathsForValuesAffectingValue(forKey: key)
     }
     
+    // Invalidate before observers are told, so they see the new tracks. Changes merged from other contexts come through here too.
+    public override func didChangeValue(forKey key: String) {
+        if key == "entries" {
+            cachedTracks = nil
+        }
+        super.didChangeValue(forKey: key)
+    }
+    
+    public override func didChange(_ changeKind: NSKeyValueChange, valuesAt indexes: IndexSet, forKey key: String) {
+        if key == "entries" {
+            cachedTracks = nil
+        }
+        super.didChange(changeKind, valuesAt: indexes, forKey: key)
+    }
+    
+    public override func didTurnIntoFault() {
+        cachedTracks = nil
+        super.didTurnIntoFault()
+    }
+    
     @objc dynamic var tracks: [SBTrack]? {
         get {
-            // If tracks get deleted, compactMap means we can skip over them if they turn out to not exist anymore, without complicated schemes
-            return trackIDs?.compactMap {
-                if let moc = self.managedObjectContext,
-                   let oid = moc.persistentStoreCoordinator?.managedObjectID(forURIRepresentation: $0) {
-                    return moc.object(with: oid) as? SBTrack
-                }
-                return nil
+            if let cachedTracks = self.cachedTracks {
+                return cachedTracks
             }
+            guard let entries = self.entries?.array as? [SBPlaylistEntry] else {
+                return []
+            }
+            let startDate = Date()
+            faultInEntries(entries)
+            // Entries are deleted with their track, but one could still be waiting to be processed.
+            let resolved = entries.compactMap { $0.track }
+            cachedTracks = resolved
+            logger.debug("Resolved \(resolved.count) tracks for playlist in \(Date().timeIntervalSince(startDate) * 1000, format: .fixed(precision: 1)) ms")
+            return resolved
         }
         set {
+            removeAllEntries()
             if let tracks = newValue {
-                self.trackIDs = tracks.map { $0.objectID.uriRepresentation() }
+                add(tracks: tracks)
             }
         }
     }
     
+    /// Loads every entry in one fetch, so resolving their tracks doesn't take a round trip per entry.
+    private func faultInEntries(_ entries: [SBPlaylistEntry]) {
+        guard let moc = self.managedObjectContext, entries.contains(where: { $0.isFault }) else {
+            return
+        }
+        let fetchRequest = NSFetchRequest<SBPlaylistEntry>(entityName: "PlaylistEntry")
+        fetchRequest.predicate = NSPredicate(format: "playlist == %@", self)
+        fetchRequest.returnsObjectsAsFaults = false
+        _ = try? moc.fetch(fetchRequest)
+    }
+    
+    /// Loads the given tracks (i.e. the rows a table is about to show) in one fetch, instead of a fault per row.
+    func prefetch(tracks: [SBTrack]) {
+        let faults = tracks.filter { $0.isFault }
+        guard let moc = self.managedObjectContext, !faults.isEmpty else {
+            return
+        }
+        let fetchRequest: NSFetchRequest<SBTrack> = SBTrack.fetchRequest()
+        fetchRequest.predicate = NSPredicate(format: "self IN %@", faults)
+        fetchRequest.returnsObjectsAsFaults = false
+        fetchRequest.relationshipKeyPathsForPrefetching = ["album"]
+        _ = try? moc.fetch(fetchRequest)
+    }
+    
+    private var mutableEntries: NSMutableOrderedSet {
+        mutableOrderedSetValue(forKey: "entries")
+    }
+    
+    private func makeEntries(tracks: [SBTrack]) -> [SBPlaylistEntry] {
+        guard let moc = self.managedObjectContext else {
+            return []
+        }
+        return tracks.map { SBPlaylistEntry(track: $0, insertInto: moc) }
+    }
+    
+    private func removeAllEntries() {
+        guard let existing = self.entries?.array as? [SBPlaylistEntry], !existing.isEmpty else {
+            return
+        }
+        self.entries = NSOrderedSet()
+        existing.forEach { $0.managedObjectContext?.delete($0) }
+        cachedTracks = nil
+    }
+    
     func add(track: SBTrack) {
-        ensureTrackIDsNotNil()
-        trackIDs?.append(track.objectID.uriRepresentation())
+        add(tracks: [track])
     }
     
     @objc(addTracks:) func add(tracks: [SBTrack]) {
-        ensureTrackIDsNotNil()
-        let additionalIDs = tracks.map { $0.objectID.uriRepresentation() }
-        trackIDs?.append(contentsOf: additionalIDs)
+        mutableEntries.addObjects(from: makeEntries(tracks: tracks))
+        cachedTracks = nil
     }
     
     func add(tracks: [SBTrack], at row: Int) {
-        ensureTrackIDsNotNil()
-        let additionalIDs = tracks.map { $0.objectID.uriRepresentation() }
-        trackIDs?.insert(contentsOf: additionalIDs, at: row)
+        let newEntries = makeEntries(tracks: tracks)
+        mutableEntries.insert(newEntries, at: IndexSet(integersIn: row..<(row + newEntries.count)))
+        cachedTracks = nil
     }
     
     func remove(indices: IndexSet) {
-        trackIDs?.remove(atOffsets: indices)
+        let removed = mutableEntries.objects(at: indices)
+        mutableEntries.removeObjects(at: indices)
+        for case let entry as SBPlaylistEntry in removed {
+            entry.managedObjectContext?.delete(entry)
+        }
+        cachedTracks = nil
     }
     
+    /// Makes the tracks match the given ones, only inserting and deleting the entries that differ.
+    ///
+    /// Syncing a big playlist where a few tracks changed then only writes those, instead of every entry.
+    /// - Returns: How many entries were inserted and removed.
+    @discardableResult func update(tracks newTracks: [SBTrack]) -> (inserted: Int, removed: Int) {
+        guard let moc = self.managedObjectContext else {
+            return (0, 0)
+        }
+        let existing = self.entries?.array as? [SBPlaylistEntry] ?? []
+        faultInEntries(existing)
+        let difference = newTracks.map { Optional($0.objectID) }.difference(from: existing.map { $0.track?.objectID })
+        guard !difference.isEmpty else {
+            return (0, 0)
+        }
+
+        var removedOffsets = IndexSet()
+        var insertedOffsets = IndexSet()
+        for change in difference {
+            switch change {
+            case .remove(let offset, _, _):
+                removedOffsets.insert(offset)
+            case .insert(let offset, _, _):
+                insertedOffsets.insert(offset)
+            }
+        }
+        // removals are offsets into the old order, and insertions into the new one, so they have to go in that order
+        let removed = mutableEntries.objects(at: removedOffsets)
+        mutableEntries.removeObjects(at: removedOffsets)
+        for case let entry as SBPlaylistEntry in removed {
+            moc.delete(entry)
+        }
+        let inserted = insertedOffsets.map { SBPlaylistEntry(track: newTracks[$0], insertInto: moc) }
+        mutableEntries.insert(inserted, at: insertedOffsets)
+        cachedTracks = nil
+        return (insertedOffsets.count, removedOffsets.count)
+    }
+
     @objc(moveIndices:toRow:) func moveTracks(fromOffsets indices: IndexSet, toOffset row: Int) -> IndexSet? {
-        return trackIDs?.moveReturningNewIndices(fromOffsets: indices, toOffset: row)
+        var entries = self.entries?.array ?? []
+        let newIndices = entries.moveReturningNewIndices(fromOffsets: indices, toOffset: row)
+        self.entries = NSOrderedSet(array: entries)
+        cachedTracks = nil
+        return newIndices
     }
     
     // #MARK: - Core Data insert compatibility shim
@@ -74,14 +192,4 @@ public class SBPlaylist: SBResource {
         let entity = NSEntityDescription.entity(forEntityName: "Playlist", in: context)
         return NSEntityDescription.insertNewObject(forEntityName: entity!.name!, into: context) as! SBPlaylist
     }
-    
-    private func ensureTrackIDsNotNil() {
-        if trackIDs == nil {
-            trackIDs = []
-        }
-    }
-    
-    public override func awakeFromInsert() {
-        ensureTrackIDsNotNil()
-    }
 }
@@ -0,0 +1,113 @@
+//
+//  SBPlaylistCache.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBPlaylistCache")
+
+/// Decides when a server playlist's tracks need fetching, using when the list of playlists says each one changed.
+///
+/// - Selecting a playlist shows the tracks stored for it right away, since they're in the store.
+/// - If they're as of the last change the server told us about, and not too old, they aren't fetched again.
+/// - Otherwise they're fetched in the background, and updated in place when they come back.
+/// - Selecting a playlist that's already being fetched doesn't fetch it again.
+/// - How often the stored tracks could be used is logged.
+///
+/// This is only used from the main thread.
+class SBPlaylistCache {
+    static let shared = SBPlaylistCache()
+
+    /// After this, tracks are fetched again anyways, i.e. for smart playlists, or if the list of playlists is old.
+    static let maxAge: TimeInterval = 10 * 60
+
+    enum State: String {
+        /// Nothing stored yet.
+        case missing
+        /// Stored, but the server has changed it since, or it's been a while.
+        case stale
+        /// Stored and as of the last change.
+        case current
+    }
+
+    private var inFlight = Set<NSManagedObjectID>()
+
+    private(set) var hits = 0
+    private(set) var staleHits = 0
+    private(set) var misses = 0
+    private(set) var joined = 0
+
+    private init() {
+    }
+
+    func state(of playlist: SBPlaylist) -> State {
+        guard let fetched = playlist.entriesFetched else {
+            return .missing
+        }
+        if Date().timeIntervalSince(fetched) > SBPlaylistCache.maxAge {
+            return .stale
+        }
+        // only a server that says when it changed can say it didn't
+        if let changed = playlist.serverChanged, changed != playlist.entriesChanged {
+            return .stale
+        }
+        if let songCount = playlist.songCount?.intValue, songCount != playlist.entries?.count {
+            return .stale
+        }
+        return .current
+    }
+
+    /// Fetches a playlist's tracks if what's stored isn't current.
+    func load(_ playlist: SBPlaylist) {
+        guard let server = playlist.server, let playlistID = playlist.itemId else {
+            return
+        }
+        let state = self.state(of: playlist)
+        switch state {
+        case .current:
+            hits += 1
+        case .stale:
+            staleHits += 1
+        case .missing:
+            misses += 1
+        }
+        let total = hits + staleHits + misses
+        logger.info("Playlist \(playlistID, privacy: .public) is \(state.rawValue, privacy: .public) (\(self.hits) current, \(self.staleHits) stale, \(self.misses) missing, \(self.joined) already being fetched, \(Double(self.hits) / Double(total) * 100, format: .fixed(precision: 1))% not fetched)")
+        guard state != .current else {
+            return
+        }
+
+        let objectID = playlist.objectID
+        guard !inFlight.contains(objectID) else {
+            joined += 1
+            return
+        }
+        inFlight.insert(objectID)
+        let request = SBSubsonicRequestOperation(server: server, request: .getPlaylist(id: playlistID))
+        // It's done when the parser is, or if it never got that far, when the request is done.
+        var handedOff = false
+        let customization = request.customization
+        request.customization = { operation in
+            handedOff = true
+            customization?(operation)
+            operation.completionBlock = {
+                DispatchQueue.main.async {
+                    self.inFlight.remove(objectID)
+                }
+            }
+        }
+        request.completionBlock = {
+            if !handedOff {
+                DispatchQueue.main.async {
+                    self.inFlight.remove(objectID)
+                }
+            }
+        }
+        SBServerScheduler.shared.add(request)
+    }
+}
@@ -31,6 +31,7 @@ import Cocoa
     }
     
     private var selectionObserver: NSKeyValueObservation?
+    private var boundsObserver: NSObjectProtocol?
     
     override func loadView() {
         super.loadView()
@@ -42,10 +43,38 @@ import Cocoa
                 NotificationCenter.default.post(name: .SBTrackSelectionChanged, object: self.tracksController.selectedObjects)
             }
         }
+        
+        if let clipView = tracksTableView.enclosingScrollView?.contentView {
+            clipView.postsBoundsChangedNotifications = true
+            boundsObserver = NotificationCenter.default.addObserver(forName: NSView.boundsDidChangeNotification, object: clipView, queue: .main) { [weak self] _ in
+                self?.prefetchVisibleTracks()
+            }
+        }
+    }
+    
+    deinit {
+        if let boundsObserver = self.boundsObserver {
+            NotificationCenter.default.removeObserver(boundsObserver)
+        }
     }
     
     override func viewDidAppear() {
         NotificationCenter.default.post(name: .SBTrackSelectionChanged, object: self.tracksController.selectedObjects)
+        prefetchVisibleTracks()
+    }
+    
+    /// Loads the visible rows, and a screenful either side, in one go, so scrolling a big playlist doesn't fault row by row.
+    private func prefetchVisibleTracks() {
+        guard let playlist = self.playlist, let tracks = self.tracks else {
+            return
+        }
+        let visible = tracksTableView.rows(in: tracksTableView.visibleRect)
+        let start = max(0, visible.location - visible.length)
+        let end = min(tracks.count, NSMaxRange(visible) + visible.length)
+        guard start < end else {
+            return
+        }
+        playlist.prefetch(tracks: Array(tracks[start..<end]))
     }
     
     // #MARK: - Properties
@@ -134,6 +163,9 @@ import Cocoa
     }
     
     func tableView(_ tableView: NSTableView, acceptDrop info: any NSDraggingInfo, row: Int, dropOperation: NSTableView.DropOperation) -> Bool {
+        // what the server has, so only what changed gets sent
+        let oldTracks = tracks
+        
         // XXX: For some reason, draggingSourceOperationMask has all bits set?
         if let sourceTable = info.draggingSource as? SBTableView, sourceTable == tracksTableView {
             let indices = info.draggingPasteboard.rowIndices()
@@ -147,9 +179,9 @@ import Cocoa
         tracksController.rearrangeObjects()
         tracksTableView.reloadData()
         
-        // submit changes to server, this uses createPlaylist behind the scenes since we can reorder with it
+        // submit changes to server, which replaces the playlist if the change can't be made by removing and appending
         if let server = playlist.server, let playlistID = playlist.itemId {
-            server.updatePlaylist(ID: playlistID, tracks: tracks)
+            server.updatePlaylist(ID: playlistID, from: oldTracks, to: tracks)
         }
         return true
     }
@@ -0,0 +1,19 @@
+//
+//  SBPlaylistEntry.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+import CoreData
+
+/// A position in a playlist. Playlists can have the same track more than once, so they can't order tracks directly.
+@objc(SBPlaylistEntry)
+public class SBPlaylistEntry: NSManagedObject {
+    convenience init(track: SBTrack, insertInto context: NSManagedObjectContext) {
+        self.init(entity: SBPlaylistEntry.entity(), insertInto: context)
+        self.track = track
+    }
+}
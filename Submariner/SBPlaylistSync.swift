@@ -0,0 +1,165 @@
+//
+//  SBPlaylistSync.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBPlaylistSync")
+
+/// Works out the least to send to get a playlist on the server from one order of tracks to another.
+///
+/// `updatePlaylist` can only remove tracks by index and append them at the end, so whatever isn't removed has to be
+/// the start of the new order. The longest start of the new order that's in the old one, in the same order, is kept.
+/// The rest of the old tracks are removed, and the rest of the new ones appended. If that's more to send than every
+/// track, i.e. a track moved to near the top, the playlist is replaced instead.
+///
+/// Either way, it's split into requests small enough for the server to take. Without form POST, the parameters go
+/// in the URL, which servers tend to limit to 8 KB or so.
+enum SBPlaylistSync {
+    /// For the parameters of a request sent as a URL, leaving room for the rest of it.
+    static let maxQueryBytes = 6 * 1024
+    /// For the parameters of a request sent as a form, which servers limit too, just much higher.
+    static let maxFormBytes = 512 * 1024
+
+    struct Edit {
+        /// Indices in the old order, highest first, so later requests' indices still point at the same tracks.
+        let removing: [Int]
+        let appending: [String]
+
+        var isEmpty: Bool {
+            removing.isEmpty && appending.isEmpty
+        }
+    }
+
+    static func maxBytes(for server: SBServer) -> Int {
+        server.supportsFormPost.boolValue ? maxFormBytes : maxQueryBytes
+    }
+
+    // #MARK: - Sizes
+
+    private static func bytes(removing index: Int) -> Int {
+        "songIndexToRemove=&".utf8.count + String(index).utf8.count
+    }
+
+    private static func bytes(appending trackID: String) -> Int {
+        "songIdToAdd=&".utf8.count + trackID.utf8.count
+    }
+
+    private static func bytes(replacing trackID: String) -> Int {
+        "songId=&".utf8.count + trackID.utf8.count
+    }
+
+    /// Roughly how much a mutation's tracks add to a request, for seeing if two can be combined.
+    static func trackBytes(of mutation: SBMutationOutbox.Mutation) -> Int {
+        switch mutation {
+        case .replacePlaylist(_, let trackIDs), .createPlaylist(_, let trackIDs):
+            return trackIDs.reduce(0) { $0 + bytes(replacing: $1) }
+        case .updatePlaylist(_, _, _, _, let appending, let removing):
+            return appending.reduce(0) { $0 + bytes(appending: $1) } + removing.reduce(0) { $0 + bytes(removing: $1) }
+        default:
+            return 0
+        }
+    }
+
+    // #MARK: - Editing
+
+    /// The removals and appends that turn the old order into the new one.
+    static func edit(from old: [String], to new: [String]) -> Edit {
+        // Greedily matching each new track to the next one in the old order gets the longest start that can be kept
+        var kept = IndexSet()
+        var keptCount = 0
+        var position = 0
+        for trackID in new {
+            guard let found = old[position...].firstIndex(of: trackID) else {
+                break
+            }
+            kept.insert(found)
+            keptCount += 1
+            position = found + 1
+        }
+        let removing = old.indices.reversed().filter { !kept.contains($0) }
+        return Edit(removing: removing, appending: Array(new[keptCount...]))
+    }
+
+    /// The mutations that get a playlist from the old order to the new one, split to fit in requests.
+    static func mutations(id: String, from old: [String], to new: [String], maxBytes: Int) -> [SBMutationOutbox.Mutation] {
+        let edit = self.edit(from: old, to: new)
+        guard !edit.isEmpty else {
+            return []
+        }
+        let editBytes = edit.removing.reduce(0) { $0 + bytes(removing: $1) } + edit.appending.reduce(0) { $0 + bytes(appending: $1) }
+        let replaceBytes = new.reduce(0) { $0 + bytes(replacing: $1) }
+
+        let mutations: [SBMutationOutbox.Mutation]
+        if editBytes <= replaceBytes {
+            mutations = chunks(id: id, removing: edit.removing, appending: edit.appending, maxBytes: maxBytes)
+        } else {
+            // the first request replaces, and the rest append to it
+            var first: [String] = []
+            var firstBytes = 0
+            for trackID in new {
+                guard firstBytes + bytes(replacing: trackID) <= maxBytes || first.isEmpty else {
+                    break
+                }
+                first.append(trackID)
+                firstBytes += bytes(replacing: trackID)
+            }
+            mutations = [.replacePlaylist(id: id, trackIDs: first)]
+                + chunks(id: id, removing: [], appending: Array(new[first.count...]), maxBytes: maxBytes)
+        }
+        logger.info("Syncing playlist \(id, privacy: .public) from \(old.count) to \(new.count) tracks: \(edit.removing.count) removed and \(edit.appending.count) appended is \(editBytes) bytes, replacing is \(replaceBytes) bytes, sending \(mutations.count) requests")
+        return mutations
+    }
+
+    /// Splits track changes into updates that each fit, removals first.
+    ///
+    /// The server removes before it appends within a request, so one can have the last of the removals and the first
+    /// of the appends. Removals must be highest index first, so the ones in later requests aren't shifted.
+    static func chunks(id: String, name: String? = nil, comment: String? = nil, isPublic: Bool? = nil,
+                       removing: [Int], appending: [String], maxBytes: Int) -> [SBMutationOutbox.Mutation] {
+        var mutations: [SBMutationOutbox.Mutation] = []
+        var chunkRemoving: [Int] = []
+        var chunkAppending: [String] = []
+        var chunkBytes = 0
+
+        func endChunk() {
+            // details go with the first
+            let isFirst = mutations.isEmpty
+            mutations.append(.updatePlaylist(id: id,
+                                             name: isFirst ? name : nil,
+                                             comment: isFirst ? comment : nil,
+                                             isPublic: isFirst ? isPublic : nil,
+                                             appending: chunkAppending,
+                                             removing: chunkRemoving))
+            chunkRemoving = []
+            chunkAppending = []
+            chunkBytes = 0
+        }
+
+        for index in removing {
+            let size = bytes(removing: index)
+            if chunkBytes + size > maxBytes && chunkBytes > 0 {
+                endChunk()
+            }
+            chunkRemoving.append(index)
+            chunkBytes += size
+        }
+        for trackID in appending {
+            let size = bytes(appending: trackID)
+            if chunkBytes + size > maxBytes && chunkBytes > 0 {
+                endChunk()
+            }
+            chunkAppending.append(trackID)
+            chunkBytes += size
+        }
+        if chunkBytes > 0 || (mutations.isEmpty && (name != nil || comment != nil || isPublic != nil)) {
+            endChunk()
+        }
+        return mutations
+    }
+}
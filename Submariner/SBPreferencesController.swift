@@ -107,6 +107,10 @@ class SBPreferencesController: NSWindowController {
         @AppStorage("deleteAfterPlay") var deleteOnEnd = false
         @AppStorage("SkipIncrement") var skipBySeconds = 5.0
         @AppStorage("playerBehavior") var whenQueueing = 0
+        @AppStorage("offlineCacheLimit") var downloadLimit = 0
+        @ObservedObject var offlineCache = SBOfflineCache.shared
+        
+        static let gigabyte = 1024 * 1024 * 1024
 
         var body: some View {
             Form {
@@ -115,6 +119,22 @@ class SBPreferencesController: NSWindowController {
                     Toggle("Delete track from tracklist when completed", isOn: $deleteOnEnd)
                     Spacer()
                 }
+                Section {
+                    Picker(selection: $downloadLimit, label: Text("Limit downloaded tracks to")) {
+                        Text("No limit").tag(0)
+                        Text("1 GB").tag(PlayerView.gigabyte)
+                        Text("5 GB").tag(5 * PlayerView.gigabyte)
+                        Text("10 GB").tag(10 * PlayerView.gigabyte)
+                        Text("25 GB").tag(25 * PlayerView.gigabyte)
+                        Text("50 GB").tag(50 * PlayerView.gigabyte)
+                    }
+                    Text("Using \(ByteCountFormatter.string(fromByteCount: offlineCache.publishedUsage, countStyle: .file)), \(offlineCache.publishedHitRate, format: .percent.precision(.fractionLength(0))) of plays were already downloaded")
+                        .font(.caption)
+                        .foregroundColor(.secondary)
+                    Text("Least recently played tracks are deleted first. Starred tracks and albums are kept.")
+                        .font(.caption)
+                        .foregroundColor(.secondary)
+                }
                 Section {
                     Picker(selection: $whenQueueing, label: Text("When queueing multiple tracks")) {
                         Text("Append to tracklist").tag(0)
@@ -149,6 +169,7 @@ class SBPreferencesController: NSWindowController {
         @AppStorage("scrobbleToServer") var scrobble = false
         @AppStorage("autoRefreshNowPlaying") var autoRefreshNowPlaying = false
         @AppStorage("MaxCoverSize") var coverSize = 300
+        @AppStorage("maxConcurrentDownloads") var maxConcurrentDownloads = 3
 
         var body: some View {
             Form {
@@ -162,6 +183,11 @@ class SBPreferencesController: NSWindowController {
                         Text("300x300").tag(300)
                         Text("600x600").tag(600)
                     }
+                    Picker(selection: $maxConcurrentDownloads, label: Text("Tracks to download at once")) {
+                        ForEach(1...6, id: \.self) { count in
+                            Text("\(count)").tag(count)
+                        }
+                    }
                 }
                 Section {
                     Toggle("Scrobble tracks to server", isOn: $scrobble)
@@ -0,0 +1,456 @@
+//
+//  SBSearchIndex.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBSearchIndex")
+
+extension NSNotification.Name {
+    static let SBSearchIndexChanged = NSNotification.Name("SBSearchIndexChanged")
+}
+
+/// An in-memory index of words in the local library's track, album, artist, and genre names.
+///
+/// Words are folded for case and diacritics, and searches match the start of words, so searching is a lookup rather
+/// than a substring scan of every track. The index is built in the background at launch, then kept up to date from what
+/// gets saved to the main context, which is where imports and parsing end up. If it ever looks out of date (i.e. a
+/// result that no longer exists), it gets rebuilt in the background.
+@objc class SBSearchIndex: NSObject {
+    @objc static let shared = SBSearchIndex()
+
+    /// Searches that match more than this only return the best matches.
+    static let maxResults = 5000
+
+    private struct Field: OptionSet {
+        let rawValue: UInt8
+
+        static let title = Field(rawValue: 1 << 0)
+        static let artist = Field(rawValue: 1 << 1)
+        static let album = Field(rawValue: 1 << 2)
+        static let genre = Field(rawValue: 1 << 3)
+
+        // A match in the name counts for more than one in the genre
+        var weight: Int {
+            var weight = 0
+            if contains(.title) { weight = max(weight, 4) }
+            if contains(.artist) { weight = max(weight, 3) }
+            if contains(.album) { weight = max(weight, 2) }
+            if contains(.genre) { weight = max(weight, 1) }
+            return weight
+        }
+    }
+
+    /// The words in each field of a track or artist.
+    private struct Document {
+        let objectID: NSManagedObjectID
+        var words: [String: Field] = [:]
+
+        init(objectID: NSManagedObjectID) {
+            self.objectID = objectID
+        }
+
+        mutating func add(_ string: String?, as field: Field) {
+            for word in SBSearchIndex.words(in: string) {
+                words[word, default: []].insert(field)
+            }
+        }
+    }
+
+    /// An inverted index for one kind of object. Documents are numbered, so postings stay small.
+    private class Table {
+        private var objectIDs: [NSManagedObjectID?] = []
+        private var numbers: [NSManagedObjectID: Int32] = [:]
+        private var freeNumbers: [Int32] = []
+        private var documentWords: [Int32: [String]] = [:]
+        private var postings: [String: [Int32: Field]] = [:]
+        // for prefix lookups, sorted again lazily after words are added or go away
+        private var sortedWords: [String]?
+
+        var count: Int {
+            numbers.count
+        }
+
+        func update(_ document: Document) {
+            remove(document.objectID)
+            guard !document.words.isEmpty else {
+                return
+            }
+            let number: Int32
+            if let free = freeNumbers.popLast() {
+                number = free
+                objectIDs[Int(number)] = document.objectID
+            } else {
+                number = Int32(objectIDs.count)
+                objectIDs.append(document.objectID)
+            }
+            numbers[document.objectID] = number
+            documentWords[number] = Array(document.words.keys)
+            for (word, fields) in document.words {
+                if postings[word] == nil {
+                    sortedWords = nil
+                }
+                postings[word, default: [:]][number] = fields
+            }
+        }
+
+        func remove(_ objectID: NSManagedObjectID) {
+            guard let number = numbers.removeValue(forKey: objectID) else {
+                return
+            }
+            for word in documentWords.removeValue(forKey: number) ?? [] {
+                postings[word]?.removeValue(forKey: number)
+                if postings[word]?.isEmpty == true {
+                    postings.removeValue(forKey: word)
+                    sortedWords = nil
+                }
+            }
+            objectIDs[Int(number)] = nil
+            freeNumbers.append(number)
+        }
+
+        /// Words starting with the prefix, by binary searching the sorted words.
+        private func words(withPrefix prefix: String) -> ArraySlice<String> {
+            if sortedWords == nil {
+                sortedWords = postings.keys.sorted()
+            }
+            let words = sortedWords!
+            var low = 0
+            var high = words.count
+            while low < high {
+                let middle = (low + high) / 2
+                if words[middle] < prefix {
+                    low = middle + 1
+                } else {
+                    high = middle
+                }
+            }
+            var end = low
+            while end < words.count && words[end].hasPrefix(prefix) {
+                end += 1
+            }
+            return words[low..<end]
+        }
+
+        /// Documents matching every term, best first.
+        func search(terms: [String], limit: Int) -> [NSManagedObjectID] {
+            var scores: [Int32: Int]?
+            for term in terms {
+                var termScores: [Int32: Int] = [:]
+                for word in words(withPrefix: term) {
+                    // a whole word beats the start of one
+                    let bonus = word == term ? 2 : 1
+                    for (number, fields) in postings[word] ?? [:] {
+                        termScores[number] = max(termScores[number] ?? 0, fields.weight * bonus)
+                    }
+                }
+                if let previous = scores {
+                    scores = previous.filter { termScores[$0.key] != nil }
+                        .reduce(into: [:]) { result, entry in result[entry.key] = entry.value + termScores[entry.key]! }
+                } else {
+                    scores = termScores
+                }
+                if scores!.isEmpty {
+                    return []
+                }
+            }
+            let ranked = (scores ?? [:]).sorted { a, b in
+                a.value != b.value ? a.value > b.value : a.key < b.key
+            }
+            return ranked.prefix(limit).compactMap { objectIDs[Int($0.key)] }
+        }
+    }
+
+    private let queue = DispatchQueue(label: "Search index")
+    private var trackTable = Table()
+    private var artistTable = Table()
+    // Changes saved while a rebuild is going on, to apply once it's done
+    private var changesDuringBuild: [(Bool, Document?, NSManagedObjectID)]?
+    private var isBuilding = false
+    private var mainContext: NSManagedObjectContext?
+    private var saveObserver: NSObjectProtocol?
+    private var mergeObserver: NSObjectProtocol?
+
+    /// If the index has been built. Until then, searches should fall back to filtering.
+    @objc private(set) var isReady = false
+
+    private override init() {
+        super.init()
+    }
+
+    // #MARK: - Words
+
+    static func words(in string: String?) -> [String] {
+        guard let string = string, !string.isEmpty else {
+            return []
+        }
+        return string.folding(options: [.caseInsensitive, .diacriticInsensitive, .widthInsensitive], locale: nil)
+            .components(separatedBy: CharacterSet.alphanumerics.inverted)
+            .filter { !$0.isEmpty }
+    }
+
+    private static func document(for track: SBTrack) -> Document {
+        var document = Document(objectID: track.objectID)
+        document.add(track.itemName, as: .title)
+        document.add(track.artistName, as: .artist)
+        document.add(track.album?.artist?.itemName, as: .artist)
+        document.add(track.album?.itemName, as: .album)
+        document.add(track.genre, as: .genre)
+        return document
+    }
+
+    private static func document(for artist: SBArtist) -> Document {
+        var document = Document(objectID: artist.objectID)
+        document.add(artist.itemName, as: .title)
+        return document
+    }
+
+    // #MARK: - Building
+
+    /// Builds the index in the background, then keeps it up to date with what gets saved to the context.
+    @objc(startWithManagedObjectContext:) func start(managedObjectContext: NSManagedObjectContext) {
+        mainContext = managedObjectContext
+        saveObserver = NotificationCenter.default.addObserver(forName: .NSManagedObjectContextDidSave,
+                                                              object: managedObjectContext,
+                                                              queue: nil) { [weak self] notification in
+            self?.contextDidSave(notification)
+        }
+        // What operations save reaches the main context by merging instead
+        mergeObserver = NotificationCenter.default.addObserver(forName: .SBPersistenceDidMergeChanges,
+                                                               object: nil,
+                                                               queue: nil) { [weak self] notification in
+            self?.changesMerged(notification)
+        }
+        rebuild()
+    }
+
+    /// Throws away the index and builds it again from the store, in the background.
+    @objc func rebuild() {
+        guard let coordinator = mainContext?.persistentStoreCoordinator else {
+            return
+        }
+        let startBuilding = queue.sync { () -> Bool in
+            if isBuilding {
+                return false
+            }
+            isBuilding = true
+            changesDuringBuild = []
+            return true
+        }
+        guard startBuilding else {
+            return
+        }
+        // The build reads the store, so what's only made it as far as the writer context has to be written first
+        do {
+            try SBPersistence.shared.flush()
+        } catch {
+            logger.error("Couldn't write changes before rebuilding the search index: \(error, privacy: .public)")
+        }
+
+        let context = NSManagedObjectContext(concurrencyType: .privateQueueConcurrencyType)
+        context.persistentStoreCoordinator = coordinator
+        context.perform {
+            let startDate = Date()
+            let newTracks = Table()
+            let newArtists = Table()
+
+            let objectIDDescription = NSExpressionDescription()
+            objectIDDescription.name = "objectID"
+            objectIDDescription.expression = NSExpression.expressionForEvaluatedObject()
+            objectIDDescription.expressionResultType = .objectIDAttributeType
+
+            // Dictionaries, so the whole library doesn't need to be made into objects
+            let trackRequest = NSFetchRequest<NSDictionary>(entityName: "Track")
+            trackRequest.predicate = NSPredicate(format: "isLocal == YES")
+            trackRequest.resultType = .dictionaryResultType
+            trackRequest.propertiesToFetch = [objectIDDescription, "itemName", "artistName", "album.itemName", "album.artist.itemName", "genre"]
+            for result in (try? context.fetch(trackRequest)) ?? [] {
+                guard let objectID = result["objectID"] as? NSManagedObjectID else {
+                    continue
+                }
+                var document = Document(objectID: objectID)
+                document.add(result["itemName"] as? String, as: .title)
+                document.add(result["artistName"] as? String, as: .artist)
+                document.add(result["album.artist.itemName"] as? String, as: .artist)
+                document.add(result["album.itemName"] as? String, as: .album)
+                document.add(result["genre"] as? String, as: .genre)
+                newTracks.update(document)
+            }
+
+            let artistRequest = NSFetchRequest<NSDictionary>(entityName: "Artist")
+            artistRequest.predicate = NSPredicate(format: "server == nil")
+            artistRequest.resultType = .dictionaryResultType
+            artistRequest.propertiesToFetch = [objectIDDescription, "itemName"]
+            for result in (try? context.fetch(artistRequest)) ?? [] {
+                guard let objectID = result["objectID"] as? NSManagedObjectID else {
+                    continue
+                }
+                var document = Document(objectID: objectID)
+                document.add(result["itemName"] as? String, as: .title)
+                newArtists.update(document)
+            }
+
+            self.queue.sync {
+                self.trackTable = newTracks
+                self.artistTable = newArtists
+                for (isTrack, document, objectID) in self.changesDuringBuild ?? [] {
+                    self.apply(isTrack: isTrack, document: document, objectID: objectID)
+                }
+                self.changesDuringBuild = nil
+                self.isBuilding = false
+            }
+            logger.info("Indexed \(newTracks.count) tracks and \(newArtists.count) artists in \(Date().timeIntervalSince(startDate), format: .fixed(precision: 2)) seconds")
+
+            DispatchQueue.main.async {
+                self.isReady = true
+                NotificationCenter.default.post(name: .SBSearchIndexChanged, object: self)
+            }
+        }
+    }
+
+    // #MARK: - Keeping up to date
+
+    // must be on queue
+    private func apply(isTrack: Bool, document: Document?, objectID: NSManagedObjectID) {
+        let table = isTrack ? trackTable : artistTable
+        if let document = document {
+            table.update(document)
+        } else {
+            table.remove(objectID)
+        }
+    }
+
+    // must be on queue
+    private func record(isTrack: Bool, document: Document?, objectID: NSManagedObjectID) {
+        if changesDuringBuild != nil {
+            changesDuringBuild!.append((isTrack, document, objectID))
+        }
+        apply(isTrack: isTrack, document: document, objectID: objectID)
+    }
+
+    private func contextDidSave(_ notification: Notification) {
+        guard let context = mainContext, let userInfo = notification.userInfo else {
+            return
+        }
+        let inserted = userInfo[NSInsertedObjectsKey] as? Set<NSManagedObject> ?? []
+        let updated = userInfo[NSUpdatedObjectsKey] as? Set<NSManagedObject> ?? []
+        let deleted = userInfo[NSDeletedObjectsKey] as? Set<NSManagedObject> ?? []
+
+        context.perform {
+            self.index(inserted: inserted, updated: updated, deleted: deleted)
+        }
+    }
+
+    // posted on the main thread, which the main context is on
+    private func changesMerged(_ notification: Notification) {
+        guard let context = mainContext, let userInfo = notification.userInfo else {
+            return
+        }
+        func objects(_ key: String) -> Set<NSManagedObject> {
+            Set((userInfo[key] as? [NSManagedObjectID] ?? []).map { context.object(with: $0) })
+        }
+        index(inserted: objects(NSInsertedObjectsKey), updated: objects(NSUpdatedObjectsKey), deleted: objects(NSDeletedObjectsKey))
+    }
+
+    // must be on the main context's queue
+    private func index(inserted: Set<NSManagedObject>, updated: Set<NSManagedObject>, deleted: Set<NSManagedObject>) {
+        // nil documents mean removing it from the index
+        var changes: [(Bool, Document?, NSManagedObjectID)] = []
+        var tracksToIndex = Set<SBTrack>()
+        for object in inserted.union(updated) {
+            switch object {
+            case let track as SBTrack:
+                tracksToIndex.insert(track)
+            case let album as SBAlbum where album.isLocal?.boolValue == true:
+                // renaming an album or artist changes what its tracks match
+                tracksToIndex.formUnion(album.tracks as? Set<SBTrack> ?? [])
+            case let artist as SBArtist:
+                if artist.server == nil {
+                    changes.append((false, SBSearchIndex.document(for: artist), artist.objectID))
+                    for case let album as SBAlbum in artist.albums ?? [] {
+                        tracksToIndex.formUnion(album.tracks as? Set<SBTrack> ?? [])
+                    }
+                } else {
+                    changes.append((false, nil, artist.objectID))
+                }
+            default:
+                break
+            }
+        }
+        for track in tracksToIndex {
+            let isIndexed = track.isLocal?.boolValue == true
+            changes.append((true, isIndexed ? SBSearchIndex.document(for: track) : nil, track.objectID))
+        }
+        for object in deleted {
+            if object is SBTrack {
+                changes.append((true, nil, object.objectID))
+            } else if object is SBArtist {
+                changes.append((false, nil, object.objectID))
+            }
+        }
+        guard !changes.isEmpty else {
+            return
+        }
+
+        self.queue.async {
+            for (isTrack, document, objectID) in changes {
+                self.record(isTrack: isTrack, document: document, objectID: objectID)
+            }
+            DispatchQueue.main.async {
+                NotificationCenter.default.post(name: .SBSearchIndexChanged, object: self)
+            }
+        }
+    }
+
+    // #MARK: - Searching
+
+    /// The objects for IDs from the index, in one fetch instead of a trip to the store for each, in the same order.
+    private func objects<T: NSManagedObject>(_ objectIDs: [NSManagedObjectID], in context: NSManagedObjectContext) -> [T] {
+        guard !objectIDs.isEmpty, let entityName = objectIDs.first?.entity.name else {
+            return []
+        }
+        let fetchRequest = NSFetchRequest<T>(entityName: entityName)
+        fetchRequest.predicate = NSPredicate(format: "self IN %@", objectIDs)
+        fetchRequest.returnsObjectsAsFaults = false
+        let fetched = (try? context.fetch(fetchRequest)) ?? []
+        let byID = Dictionary(fetched.map { ($0.objectID, $0) }, uniquingKeysWith: { first, _ in first })
+        let objects = objectIDs.compactMap { byID[$0] }
+        if objects.count < objectIDs.count {
+            logger.warning("Search index had items that no longer exist, rebuilding it")
+            rebuild()
+        }
+        return objects
+    }
+
+    /// Local tracks matching every word in the query, best matches first.
+    @objc(tracksMatching:inManagedObjectContext:) func tracks(matching query: String, in context: NSManagedObjectContext) -> [SBTrack] {
+        let terms = SBSearchIndex.words(in: query)
+        guard !terms.isEmpty else {
+            return []
+        }
+        let startDate = Date()
+        let objectIDs = queue.sync {
+            trackTable.search(terms: terms, limit: SBSearchIndex.maxResults)
+        }
+        let searchedDate = Date()
+        let tracks: [SBTrack] = objects(objectIDs, in: context)
+        logger.debug("Found \(objectIDs.count) tracks for \"\(query, privacy: .public)\" in \(searchedDate.timeIntervalSince(startDate) * 1000, format: .fixed(precision: 1)) ms, loaded them in \(Date().timeIntervalSince(searchedDate) * 1000, format: .fixed(precision: 1)) ms")
+        return tracks
+    }
+
+    /// IDs of local artists matching every word in the query, i.e. for filtering.
+    @objc(artistIDsMatching:) func artistIDs(matching query: String) -> Set<NSManagedObjectID> {
+        let terms = SBSearchIndex.words(in: query)
+        guard !terms.isEmpty else {
+            return []
+        }
+        return queue.sync {
+            Set(artistTable.search(terms: terms, limit: Int.max))
+        }
+    }
+}
@@ -27,6 +27,12 @@ import Cocoa
     
     var returnedTracks = 0
     
+    /// Where the page being loaded starts and how many tracks it asked for, so it can be cached.
+    var pageOffset = 0
+    var pageCount = 0
+    /// When the user asked for the page being loaded, to see how long it took to show up.
+    var askedDate: Date?
+    
     /// Used for bindings and contains the actual tracks fetched from `fetchTracks:`.
     @objc var tracks: [SBTrack] = []
     let query: QueryType
@@ -39,8 +45,19 @@ import Cocoa
     /// Updates the tracks array after getting the results.
     ///
     /// This has to be done on the main thread, as the parse operation that builds the list runs off the main thread.
+    /// Only tracks added since the last call are fetched, so each page costs the same no matter how many came before.
     func fetchTracks(managedObjectContext: NSManagedObjectContext) {
-        tracks = tracksToFetch.map { trackID in
+        guard tracks.count < tracksToFetch.count else {
+            return
+        }
+        let newTrackIDs = Array(tracksToFetch[tracks.count...])
+        // Fill them in with one fetch, instead of a fault firing for each row the table draws
+        let fetchRequest = NSFetchRequest<SBTrack>(entityName: "Track")
+        fetchRequest.predicate = NSPredicate(format: "self IN %@", newTrackIDs)
+        fetchRequest.returnsObjectsAsFaults = false
+        _ = try? managedObjectContext.fetch(fetchRequest)
+        
+        tracks += newTrackIDs.map { trackID in
             managedObjectContext.object(with: trackID) as! SBTrack
         }
     }
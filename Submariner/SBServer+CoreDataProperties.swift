@@ -20,6 +20,7 @@ extension SBServer {
     @NSManaged public var apiVersion: String?
     @NSManaged public var licenseEmail: String?
     @NSManaged public var useTokenAuth: NSNumber?
+    @NSManaged public var lastArtistsDate: Date?
     @NSManaged public var lastIndexesDate: Date?
     @NSManaged public var licenseDate: Date?
     @NSManaged public var url: String?
@@ -33,6 +34,24 @@ extension SBServer {
     @NSManaged public var home: SBHome?
     @NSManaged public var indexes: NSSet?
     @NSManaged public var directories: NSSet?
+    @NSManaged public var albums: NSSet?
+
+}
+
+// MARK: Generated accessors for albums
+extension SBServer {
+
+    @objc(addAlbumsObject:)
+    @NSManaged public func addToAlbums(_ value: SBAlbum)
+
+    @objc(removeAlbumsObject:)
+    @NSManaged public func removeFromAlbums(_ value: SBAlbum)
+
+    @objc(addAlbums:)
+    @NSManaged public func addToAlbums(_ values: NSSet)
+
+    @objc(removeAlbums:)
+    @NSManaged public func removeFromAlbums(_ values: NSSet)
 
 }
 
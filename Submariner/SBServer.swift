@@ -427,66 +427,80 @@ public class SBServer: SBResource {
     
     @objc func getArtists() {
         let request = SBSubsonicRequestOperation(server: self, request: .getArtists)
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     @objc(getArtist:) func get(artist: SBArtist) {
         guard let artistId = artist.itemId else { return }
         let request = SBSubsonicRequestOperation(server: self, request: .getArtist(id: artistId))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     @objc(getAlbum:) func get(album: SBAlbum) {
         guard let albumId = album.itemId else { return }
         let request = SBSubsonicRequestOperation(server: self, request: .getAlbum(id: albumId))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     func getTrack(trackID: String) {
         let request = SBSubsonicRequestOperation(server: self, request: .getTrack(id: trackID))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     func getCover(id: String, for albumID: String?) {
-        let request = SBSubsonicRequestOperation(server: self, request: .getCoverArt(id: id, forAlbumId: albumID))
-        OperationQueue.sharedServerQueue.addOperation(request)
-    }
-    
-    @objc func getAlbumListFor(type: SBAlbumListType) {
-        let request = SBSubsonicRequestOperation(server: self, request: .getAlbumList(type: type))
-        OperationQueue.sharedServerQueue.addOperation(request)
-    }
-    
-    @objc func updateAlbumListFor(type: SBAlbumListType) {
-        let request = SBSubsonicRequestOperation(server: self, request: .updateAlbumList(type: type))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        // This dedupes and rate limits cover fetches across every request
+        SBCoverFetcher.shared.fetch(coverID: id, albumID: albumID, server: self)
+    }
+    
+    /// Requests a page of an album list. The first page replaces what's in the server home, later ones add to it.
+    ///
+    /// If `isStale` returns true by the time the response is parsed, the page is thrown away instead.
+    @discardableResult func getAlbumList(type: SBAlbumListType, offset: Int, count: Int, isStale: (() -> Bool)? = nil) -> SBSubsonicRequestOperation {
+        let requestType: SBSubsonicRequestType = offset == 0
+            ? .getAlbumList(type: type, count: count)
+            : .updateAlbumList(type: type, offset: offset, count: count)
+        let request = SBSubsonicRequestOperation(server: self, request: requestType)
+        if let isStale = isStale {
+            let customization = request.customization
+            request.customization = { operation in
+                customization?(operation)
+                operation.isStale = isStale
+            }
+        }
+        SBServerScheduler.shared.add(request)
+        return request
     }
     
     @objc func getServerDirectories() {
         let request = SBSubsonicRequestOperation(server: self, request: .getDirectories)
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     func getServerDirectory(id: String) {
         let request = SBSubsonicRequestOperation(server: self, request: .getDirectory(id: id))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     // #MARK: - Subsonic Client (Playlists)
     
     @objc func getServerPlaylists() {
         let request = SBSubsonicRequestOperation(server: self, request: .getPlaylists)
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     @objc func createPlaylist(name: String, tracks: [SBTrack]) {
-        let request = SBSubsonicRequestOperation(server: self, request: .createPlaylist(name: name, tracks: tracks))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBMutationOutbox.shared.add(.createPlaylist(name: name, trackIDs: tracks.compactMap { $0.itemId }), for: self)
     }
     
-    @objc func updatePlaylist(ID: String, tracks: [SBTrack]) {
-        let request = SBSubsonicRequestOperation(server: self, request: .replacePlaylist(id: ID, tracks: tracks))
-        OperationQueue.sharedServerQueue.addOperation(request)
+    /// Changes the tracks of a playlist, sending only what changed from the order the server has.
+    func updatePlaylist(ID: String, from oldTracks: [SBTrack], to newTracks: [SBTrack]) {
+        let mutations = SBPlaylistSync.mutations(id: ID,
+                                                 from: oldTracks.compactMap { $0.itemId },
+                                                 to: newTracks.compactMap { $0.itemId },
+                                                 maxBytes: SBPlaylistSync.maxBytes(for: self))
+        for mutation in mutations {
+            SBMutationOutbox.shared.add(mutation, for: self)
+        }
     }
     
     // public ommited because Bool? not in objc
@@ -495,8 +509,7 @@ public class SBServer: SBResource {
                               comment: String? = nil,
                               appending: [SBTrack]? = nil,
                               removing: [Int]? = nil) {
-        let request = SBSubsonicRequestOperation(server: self, request: .updatePlaylist(id: ID, name: name, comment: comment, isPublic: nil, appending: appending, removing: removing))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        updatePlaylist(ID: ID, name: name, comment: comment, isPublic: nil, appending: appending, removing: removing)
     }
     
     func updatePlaylist(ID: String,
@@ -505,98 +518,98 @@ public class SBServer: SBResource {
                         isPublic: Bool?,
                         appending: [SBTrack]? = nil,
                         removing: [Int]? = nil) {
-        let request = SBSubsonicRequestOperation(server: self, request: .updatePlaylist(id: ID, name: name, comment: comment, isPublic: isPublic, appending: appending, removing: removing))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        // highest index first, so if it's split, what later requests remove hasn't moved
+        let mutations = SBPlaylistSync.chunks(id: ID, name: name, comment: comment, isPublic: isPublic,
+                                              removing: (removing ?? []).sorted(by: >),
+                                              appending: appending?.compactMap { $0.itemId } ?? [],
+                                              maxBytes: SBPlaylistSync.maxBytes(for: self))
+        for mutation in mutations {
+            SBMutationOutbox.shared.add(mutation, for: self)
+        }
     }
     
     @objc func deletePlaylist(ID: String) {
-        let request = SBSubsonicRequestOperation(server: self, request: .deletePlaylist(id: ID))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBMutationOutbox.shared.add(.deletePlaylist(id: ID), for: self)
     }
     
     @objc func getPlaylistTracks(_ playlist: SBPlaylist) {
-        guard let playlistId = playlist.itemId else { return }
-        let request = SBSubsonicRequestOperation(server: self, request: .getPlaylist(id: playlistId))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        // only if what's stored isn't as of the last change
+        SBPlaylistCache.shared.load(playlist)
     }
     
     // #MARK: - Subsonic Client (Podcasts)
     
     @objc func getServerPodcasts() {
         let request = SBSubsonicRequestOperation(server: self, request: .getPodcasts)
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     // #MARK: - Subsonic Client (Now Playing)
     
     @objc func getNowPlaying() {
-        if self.supportsNowPlaying == true {
-            let request = SBSubsonicRequestOperation(server: self, request: .getNowPlaying)
-            OperationQueue.sharedServerQueue.addOperation(request)
-        }
+        SBServerPoller.shared.refresh(.nowPlaying, server: self)
     }
     
     func scrobble(id: String) {
-        let request = SBSubsonicRequestOperation(server: self, request: .scrobble(id: id))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBMutationOutbox.shared.add(.scrobble(plays: [.init(id: id, time: Date())]), for: self)
     }
     
     // #MARK: - Subsonic Client (Search)
     
     @objc func search(query: String) {
-        let request = SBSubsonicRequestOperation(server: self, request: .search(query: query))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerSearchPipeline.shared.search(query: query, server: self)
     }
     
     func updateSearch(existingResult: SBSearchResult) {
-        let request = SBSubsonicRequestOperation(server: self, request: .updateSearch(existingResult: existingResult))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerSearchPipeline.shared.loadMore(existingResult, server: self)
     }
     
     @objc(getTopTracksForArtistName:) func getTopTracks(artistName: String) {
+        SBServerSearchPipeline.shared.supersede(with: .topTracksFor(artistName: artistName), server: self)
         let request = SBSubsonicRequestOperation(server: self, request: .getTopTracks(artistName: artistName))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     @objc func getSimilarTracks(to artist: SBArtist) {
+        SBServerSearchPipeline.shared.supersede(with: .similarTo(artist: artist), server: self)
         let request = SBSubsonicRequestOperation(server: self, request: .getSimilarTracks(artist: artist))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     @objc func getStarred() {
+        SBServerSearchPipeline.shared.supersede(with: .starred, server: self)
         let request = SBSubsonicRequestOperation(server: self, request: .getStarred)
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
     }
     
     // #MARK: - Subsonic Client (Rating)
     
     @objc(setRating:forID:) func setRating(_ rating: Int, id: String) {
-        let request = SBSubsonicRequestOperation(server: self, request: .setRating(id: id, rating: rating))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBMutationOutbox.shared.add(.setRating(id: id, rating: rating), for: self)
     }
     
     func star(tracks: [SBTrack] = [], albums: [SBAlbum] = [], artists: [SBArtist] = [], directories: [SBDirectory] = []) {
-        let request = SBSubsonicRequestOperation(server: self,
-                                                 request: .star(tracks: tracks, albums: albums, artists: artists, directories: directories))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBMutationOutbox.shared.add(.star(ids: tracks.compactMap { $0.itemId } + directories.compactMap { $0.itemId },
+                                          albumIDs: albums.compactMap { $0.itemId },
+                                          artistIDs: artists.compactMap { $0.itemId }), for: self)
     }
     
     func unstar(tracks: [SBTrack] = [], albums: [SBAlbum] = [], artists: [SBArtist] = [], directories: [SBDirectory] = []) {
-        let request = SBSubsonicRequestOperation(server: self,
-                                                 request: .unstar(tracks: tracks, albums: albums, artists: artists, directories: directories))
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBMutationOutbox.shared.add(.unstar(ids: tracks.compactMap { $0.itemId } + directories.compactMap { $0.itemId },
+                                            albumIDs: albums.compactMap { $0.itemId },
+                                            artistIDs: artists.compactMap { $0.itemId }), for: self)
     }
     
     // #MARK: - Subsonic Client (Library Scan)
     
     @objc func scanLibrary() {
         let request = SBSubsonicRequestOperation(server: self, request: .scanLibrary)
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerScheduler.shared.add(request)
+        SBServerPoller.shared.followScan(server: self)
     }
     
     @objc func getScanStatus() {
-        let request = SBSubsonicRequestOperation(server: self, request: .getScanStatus)
-        OperationQueue.sharedServerQueue.addOperation(request)
+        SBServerPoller.shared.refresh(.scanStatus, server: self)
     }
     
     // #MARK: - Core Data insert compatibility shim
@@ -40,6 +40,7 @@
 
 @class SBDatabaseController;
 @class SBCollectionView;
+@class SBAlbumListPager;
 
 @interface SBServerHomeController : SBServerViewController <MGScopeBarDelegate, NSTableViewDataSource, NSTableViewDelegate, NSCollectionViewDataSource, NSCollectionViewDelegate> {
     IBOutlet MGScopeBar *scopeBar;
@@ -50,7 +51,7 @@
     
     NSMutableArray *scopeGroups;
     NSArray *albumSortDescriptor;
-    BOOL shouldInfiniteScroll;
+    SBAlbumListPager *albumListPager;
 }
 
 - (IBAction)reloadSelected:(id)sender;
@@ -50,7 +50,7 @@
 
 
 
-@interface SBServerHomeController ()
+@interface SBServerHomeController () <SBCollectionViewPrefetching>
 - (void)subsonicCoversUpdatedNotification:(NSNotification *)notification;
 @end
 
@@ -78,8 +78,6 @@
     if (self) {
         scopeGroups = [[NSMutableArray alloc] init];
         
-        shouldInfiniteScroll = NO;
-        
         // XXX: Does it make sense to do a year sort for this view?
         NSSortDescriptor *albumYearDescriptor = [NSSortDescriptor sortDescriptorWithKey:@"year" ascending:YES];
         NSSortDescriptor *albumNameDescriptor = [NSSortDescriptor sortDescriptorWithKey:@"itemName" ascending:YES selector: @selector(caseInsensitiveCompare:)];
@@ -95,7 +93,6 @@
 
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self forKeyPath:@"SBSubsonicCoversUpdatedNotification"];
-    [[NSNotificationCenter defaultCenter] removeObserver:self forKeyPath:@"SBSubsonicAlbumsUpdated"];
     [[NSNotificationCenter defaultCenter] removeObserver:self forKeyPath:NSViewBoundsDidChangeNotification];
     
     [[NSUserDefaults standardUserDefaults] removeObserver: self forKeyPath: @"albumSortOrder"];
@@ -164,11 +161,6 @@
                                                  name:@"SBSubsonicCoversUpdatedNotification"
                                                object:nil];
     
-    [[NSNotificationCenter defaultCenter] addObserver:self
-                                             selector:@selector(subsonicAlbumsUpdatedNotification:)
-                                                 name:@"SBSubsonicAlbumsUpdatedNotification"
-                                               object:nil];
-    
     [albumsController addObserver:self
                       forKeyPath:@"arrangedObjects"
                       options:NSKeyValueObservingOptionNew
@@ -223,7 +215,15 @@
 
 
 - (void) reloadServersWithType: (SBAlbumListType)albumListType {
-    [self.server getAlbumListForType:albumListType];
+    if (self.server == nil) {
+        return;
+    }
+    // the server can change out from under us
+    if (albumListPager == nil || albumListPager.server != self.server) {
+        albumListPager = [[SBAlbumListPager alloc] initWithServer: self.server];
+    }
+    [albumListPager scrolledToItem: -1 viewportItems: albumsCollectionView.itemsPerViewport];
+    [albumListPager reloadWithType: albumListType];
 }
 
 
@@ -304,33 +304,10 @@
 #pragma mark - 
 #pragma mark Notification
 
-- (void)loadWhenAtBottom {
-    if (!self->shouldInfiniteScroll) {
-        return;
-    }
-    
-    NSScrollView *scrollView = self->albumsCollectionView.enclosingScrollView;
-    NSView *documentView = scrollView.documentView;
-    NSClipView *clipView = scrollView.contentView;
-    
-    CGFloat verticalPosition = clipView.bounds.origin.y + clipView.bounds.size.height;
-    if (verticalPosition == documentView.bounds.size.height) {
-        self->shouldInfiniteScroll = NO;
-        [self.server updateAlbumListForType: [self currentAlbumListType]];
-    }
-}
-
 - (void)albumClipViewBoundsChanged:(NSNotification *)notification {
-    [self loadWhenAtBottom];
-}
-
-- (void)subsonicAlbumsUpdatedNotification:(NSNotification *)notification {
-    // No need to reload with observation, but do increment our infinite scroll state
-    NSNumber *count = notification.userInfo[@"count"];
-    shouldInfiniteScroll = count.intValue > 0;
-    dispatch_async(dispatch_get_main_queue(), ^{
-        [self loadWhenAtBottom];
-    });
+    // The pager loads ahead of this, so the next page is usually there before the bottom is
+    [albumListPager scrolledToItem: albumsCollectionView.lastVisibleItem
+                     viewportItems: albumsCollectionView.itemsPerViewport];
 }
 
 - (void)subsonicCoversUpdatedNotification:(NSNotification *)notification {
@@ -340,6 +317,17 @@
 
 #pragma mark - NSCollectionView Data Source
 
+- (void)collectionView:(NSCollectionView *)collectionView prefetchItemsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths {
+    NSArray *albums = albumsController.arrangedObjects;
+    NSMutableArray *toPrefetch = [NSMutableArray arrayWithCapacity: indexPaths.count];
+    for (NSIndexPath *indexPath in indexPaths) {
+        if (indexPath.item < albums.count) {
+            [toPrefetch addObject: albums[indexPath.item]];
+        }
+    }
+    [[SBCoverCache shared] prefetchAlbums: toPrefetch pixelSize: albumsCollectionView.coverPixelSize];
+}
+
 - (NSInteger)collectionView:(NSCollectionView *)collectionView numberOfItemsInSection:(NSInteger)section {
     return [albumsController.arrangedObjects count];
 }
@@ -41,7 +41,7 @@
 
 
 
-@interface SBServerLibraryController ()
+@interface SBServerLibraryController () <SBCollectionViewPrefetching>
 - (void)subsonicCoversUpdatedNotification:(NSNotification *)notification;
 - (void)subsonicTracksUpdatedNotification:(NSNotification *)notification;
 @end
@@ -432,6 +432,17 @@
 
 #pragma mark - NSCollectionView Data Source
 
+- (void)collectionView:(NSCollectionView *)collectionView prefetchItemsAtIndexPaths:(NSArray<NSIndexPath *> *)indexPaths {
+    NSArray *albums = albumsController.arrangedObjects;
+    NSMutableArray *toPrefetch = [NSMutableArray arrayWithCapacity: indexPaths.count];
+    for (NSIndexPath *indexPath in indexPaths) {
+        if (indexPath.item < albums.count) {
+            [toPrefetch addObject: albums[indexPath.item]];
+        }
+    }
+    [[SBCoverCache shared] prefetchAlbums: toPrefetch pixelSize: albumsCollectionView.coverPixelSize];
+}
+
 - (NSInteger)collectionView:(NSCollectionView *)collectionView numberOfItemsInSection:(NSInteger)section {
     return [albumsController.arrangedObjects count];
 }
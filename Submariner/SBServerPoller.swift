@@ -0,0 +1,305 @@
+//
+//  SBServerPoller.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBServerPoller")
+
+/// Polls servers for what changes without us doing anything: who's playing what, and how a library scan is going.
+///
+/// - Each server and endpoint has at most one request out. Asking again while it's out waits for that one instead.
+/// - Now playing is polled while something shows it and auto-refresh is on. It's polled more often while it's changing,
+///   less the longer it doesn't, and less again while the app can't be seen.
+/// - Scan status is polled from when a scan starts until the server says it's done, less often as it goes on.
+/// - Failures back off, so an unreachable server isn't asked every few seconds.
+/// - Requests made and joined, and rows written or left alone because they hadn't changed, are logged.
+///
+/// This is only used from the main thread.
+class SBServerPoller {
+    static let shared = SBServerPoller()
+
+    /// Now playing while it's changing.
+    static let activeInterval: TimeInterval = 15
+    /// Now playing once it stops changing, growing to `maxIdleInterval`.
+    static let idleInterval: TimeInterval = 30
+    static let maxIdleInterval: TimeInterval = 2 * 60
+    /// How much longer to wait while the app is hidden or covered up.
+    static let hiddenFactor = 4.0
+    static let scanInitialInterval: TimeInterval = 2
+    static let scanMaxInterval: TimeInterval = 30
+    static let backoffFactor = 1.5
+    static let maxFailureInterval: TimeInterval = 5 * 60
+    /// How many polls between logging the counts.
+    static let reportInterval = 50
+
+    enum Endpoint: String {
+        case nowPlaying
+        case scanStatus
+
+        var requestType: SBSubsonicRequestType {
+            switch self {
+            case .nowPlaying:
+                return .getNowPlaying
+            case .scanStatus:
+                return .getScanStatus
+            }
+        }
+    }
+
+    private struct Key: Hashable {
+        let server: NSManagedObjectID
+        let endpoint: Endpoint
+    }
+
+    private enum Outcome {
+        case failed
+        case done(writes: Int, unchanged: Int, scanning: Bool?)
+    }
+
+    private class Poll {
+        let server: SBServer
+        let endpoint: Endpoint
+        var inFlight = false
+        var next: DispatchWorkItem?
+        var interval: TimeInterval
+        var failures = 0
+        /// How many things are showing now playing for the server.
+        var watchers = 0
+        /// If a scan is going on that we're following.
+        var scanning = false
+
+        // for the log
+        var requests = 0
+        var joined = 0
+        var writes = 0
+        var unchanged = 0
+
+        init(server: SBServer, endpoint: Endpoint) {
+            self.server = server
+            self.endpoint = endpoint
+            self.interval = endpoint == .scanStatus ? SBServerPoller.scanInitialInterval : SBServerPoller.idleInterval
+        }
+
+        /// If it should be polled again on its own.
+        var isRepeating: Bool {
+            switch endpoint {
+            case .nowPlaying:
+                return watchers > 0 && UserDefaults.standard.autoRefreshNowPlaying
+            case .scanStatus:
+                return scanning
+            }
+        }
+    }
+
+    private var polls: [Key: Poll] = [:]
+    private var appVisible = true
+    private var pollsSinceReport = 0
+
+    private var occlusionObserver: NSObjectProtocol?
+    private var autoRefreshObserver: NSKeyValueObservation?
+
+    private init() {
+        occlusionObserver = NotificationCenter.default.addObserver(forName: NSApplication.didChangeOcclusionStateNotification, object: nil, queue: .main) { [weak self] _ in
+            self?.visibilityChanged()
+        }
+        autoRefreshObserver = UserDefaults.standard.observe(\.autoRefreshNowPlaying) { [weak self] _, _ in
+            DispatchQueue.main.async {
+                self?.rescheduleAll()
+            }
+        }
+    }
+
+    // #MARK: - Asking
+
+    private func poll(for server: SBServer, _ endpoint: Endpoint) -> Poll {
+        let key = Key(server: server.objectID, endpoint: endpoint)
+        if let existing = polls[key] {
+            return existing
+        }
+        let new = Poll(server: server, endpoint: endpoint)
+        polls[key] = new
+        return new
+    }
+
+    /// Starts polling now playing for something that shows it, with a refresh right away.
+    func watchNowPlaying(server: SBServer) {
+        let poll = self.poll(for: server, .nowPlaying)
+        poll.watchers += 1
+        // it was probably a while since the last one
+        poll.interval = SBServerPoller.idleInterval
+        send(poll)
+    }
+
+    /// Stops polling now playing for something that doesn't show it anymore.
+    func unwatchNowPlaying(server: SBServer) {
+        let poll = self.poll(for: server, .nowPlaying)
+        poll.watchers = max(0, poll.watchers - 1)
+        if !poll.isRepeating {
+            poll.next?.cancel()
+            poll.next = nil
+        }
+    }
+
+    /// Polls right away, or waits for the request already out.
+    func refresh(_ endpoint: Endpoint, server: SBServer) {
+        send(poll(for: server, endpoint))
+    }
+
+    /// Follows a scan the server just started until it's done.
+    func followScan(server: SBServer) {
+        let poll = self.poll(for: server, .scanStatus)
+        poll.scanning = true
+        poll.interval = SBServerPoller.scanInitialInterval
+        schedule(poll)
+    }
+
+    // #MARK: - Polling
+
+    private func send(_ poll: Poll) {
+        poll.next?.cancel()
+        poll.next = nil
+        guard !poll.inFlight else {
+            poll.joined += 1
+            return
+        }
+        if poll.endpoint == .nowPlaying && poll.server.supportsNowPlaying != true {
+            return
+        }
+
+        poll.inFlight = true
+        poll.requests += 1
+        let request = SBSubsonicRequestOperation(server: poll.server, request: poll.endpoint.requestType)
+        // failing is handled by backing off, which a dialog every poll would get in the way of
+        request.presentsErrors = false
+        // The poll is done when the parser is, or if it never got that far, when the request is done.
+        var handedOff = false
+        let customization = request.customization
+        request.customization = { operation in
+            handedOff = true
+            customization?(operation)
+            operation.completionBlock = { [weak operation] in
+                let outcome = Outcome.done(writes: operation?.syncWrites ?? 0,
+                                           unchanged: operation?.syncUnchanged ?? 0,
+                                           scanning: operation?.scanning)
+                DispatchQueue.main.async {
+                    self.finished(poll, outcome)
+                }
+            }
+        }
+        request.completionBlock = {
+            if !handedOff {
+                DispatchQueue.main.async {
+                    self.finished(poll, .failed)
+                }
+            }
+        }
+        SBServerScheduler.shared.add(request)
+    }
+
+    private func finished(_ poll: Poll, _ outcome: Outcome) {
+        poll.inFlight = false
+
+        switch outcome {
+        case .failed:
+            poll.failures += 1
+        case .done(let writes, let unchanged, let scanning):
+            poll.failures = 0
+            poll.writes += writes
+            poll.unchanged += unchanged
+            switch poll.endpoint {
+            case .nowPlaying:
+                poll.interval = writes > 0
+                    ? SBServerPoller.activeInterval
+                    : min(max(poll.interval * SBServerPoller.backoffFactor, SBServerPoller.idleInterval), SBServerPoller.maxIdleInterval)
+            case .scanStatus:
+                if scanning == true {
+                    poll.interval = min(poll.interval * SBServerPoller.backoffFactor, SBServerPoller.scanMaxInterval)
+                } else if poll.scanning {
+                    logger.info("Scan on \(poll.server.resourceName ?? "server", privacy: .public) is done after \(poll.requests) polls")
+                    poll.scanning = false
+                }
+            }
+        }
+
+        pollsSinceReport += 1
+        if pollsSinceReport >= SBServerPoller.reportInterval {
+            pollsSinceReport = 0
+            logStatistics()
+        }
+        schedule(poll)
+    }
+
+    private func schedule(_ poll: Poll) {
+        poll.next?.cancel()
+        poll.next = nil
+        guard poll.isRepeating else {
+            return
+        }
+        var delay = poll.interval
+        if poll.failures > 0 {
+            delay = min(delay * pow(2, Double(poll.failures)), SBServerPoller.maxFailureInterval)
+        }
+        if !appVisible && poll.endpoint == .nowPlaying {
+            delay *= SBServerPoller.hiddenFactor
+        }
+        let work = DispatchWorkItem { [weak self] in
+            self?.send(poll)
+        }
+        poll.next = work
+        DispatchQueue.main.asyncAfter(deadline: .now() + delay, execute: work)
+    }
+
+    private func rescheduleAll() {
+        for poll in polls.values where !poll.inFlight {
+            schedule(poll)
+        }
+    }
+
+    private func visibilityChanged() {
+        let visible = NSApp.occlusionState.contains(.visible)
+        guard visible != appVisible else {
+            return
+        }
+        appVisible = visible
+        if visible {
+            // what's shown could be well out of date by now
+            for poll in polls.values where poll.endpoint == .nowPlaying && poll.isRepeating {
+                send(poll)
+            }
+        } else {
+            rescheduleAll()
+        }
+    }
+
+    // #MARK: - Statistics
+
+    struct Counts {
+        let requests: Int
+        let joined: Int
+        let writes: Int
+        let unchanged: Int
+        let inFlight: Bool
+        let repeating: Bool
+    }
+
+    /// What's been counted for polling a server's endpoint so far, or nil if it hasn't been.
+    func counts(for server: SBServer, _ endpoint: Endpoint) -> Counts? {
+        guard let poll = polls[Key(server: server.objectID, endpoint: endpoint)] else {
+            return nil
+        }
+        return Counts(requests: poll.requests, joined: poll.joined, writes: poll.writes, unchanged: poll.unchanged,
+                      inFlight: poll.inFlight, repeating: poll.isRepeating)
+    }
+
+    private func logStatistics() {
+        for poll in polls.values where poll.requests > 0 {
+            logger.info("\(poll.endpoint.rawValue, privacy: .public) for \(poll.server.resourceName ?? "server", privacy: .public): \(poll.requests) requests, \(poll.joined) joined one already out, \(poll.writes) rows written, \(poll.unchanged) rows unchanged, polling every \(poll.interval, format: .fixed(precision: 1)) s")
+        }
+    }
+}
@@ -0,0 +1,183 @@
+//
+//  SBServerScheduler.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBServerScheduler")
+
+/// Decides where server requests and the parsing of their responses run.
+///
+/// Each server gets its own queues, so a slow server doesn't hold up the others:
+///
+/// - An interactive lane for requests the user is waiting on, up to `maxConcurrentServerRequests` at once.
+/// - A background lane for covers, scrobbles and the like, with half as many, so it can't crowd out the interactive lane.
+/// - A serial lane for changes to the server (playlists, stars, ratings), so they reach it in the order they were made.
+///   Otherwise i.e. removing by index from a playlist could run before the request that put those tracks there.
+/// - A serial parsing queue, since merging responses for the same server at once would race on the same objects.
+///
+/// Maintenance operations that have to finish before anything gets parsed (i.e. backfills at startup) go through
+/// `addMaintenance(_:)`, which runs them on the shared server queue and makes parsing wait for them.
+@objc class SBServerScheduler: NSObject {
+    @objc static let shared = SBServerScheduler()
+
+    private class Queues {
+        let interactive: OperationQueue
+        let background: OperationQueue
+        let mutations: OperationQueue
+        let parsing: OperationQueue
+
+        init(name: String, limit: Int) {
+            interactive = OperationQueue()
+            interactive.name = "\(name) (interactive)"
+            interactive.maxConcurrentOperationCount = limit
+            background = OperationQueue()
+            background.name = "\(name) (background)"
+            background.maxConcurrentOperationCount = max(1, limit / 2)
+            mutations = OperationQueue()
+            mutations.name = "\(name) (mutations)"
+            mutations.maxConcurrentOperationCount = 1
+            parsing = OperationQueue()
+            parsing.name = "\(name) (parsing)"
+            parsing.maxConcurrentOperationCount = 1
+        }
+
+        var all: [OperationQueue] { [interactive, background, mutations, parsing] }
+    }
+
+    private let lock = NSLock()
+    private var queues: [NSManagedObjectID: Queues] = [:]
+    private var maintenanceOperations: [Operation] = []
+    private var countObservers: [NSKeyValueObservation] = []
+
+    /// The number of operations queued or running across every server, for activity indicators. KVO compliant.
+    @objc dynamic private(set) var operationCount: Int = 0
+
+    private override init() {
+        super.init()
+        observeCount(of: OperationQueue.sharedServerQueue)
+    }
+
+    // #MARK: - Queues
+
+    private func queues(for server: NSManagedObjectID) -> Queues {
+        lock.lock()
+        defer { lock.unlock() }
+        if let existing = queues[server] {
+            return existing
+        }
+        let limit = max(1, UserDefaults.standard.maxConcurrentServerRequests)
+        let new = Queues(name: "Server \(server.uriRepresentation().lastPathComponent)", limit: limit)
+        queues[server] = new
+        logger.info("Created queues for \(server.uriRepresentation(), privacy: .public) with \(limit) concurrent requests")
+        new.all.forEach { observeCount(of: $0) }
+        return new
+    }
+
+    private func observeCount(of queue: OperationQueue) {
+        countObservers.append(queue.observe(\.operationCount) { [weak self] _, _ in
+            DispatchQueue.main.async {
+                self?.updateOperationCount()
+            }
+        })
+    }
+
+    private func updateOperationCount() {
+        lock.lock()
+        let serverQueues = queues.values.flatMap { $0.all }
+        lock.unlock()
+        let count = serverQueues.reduce(OperationQueue.sharedServerQueue.operationCount) { $0 + $1.operationCount }
+        if count != operationCount {
+            operationCount = count
+        }
+    }
+
+    // #MARK: - Scheduling
+
+    func add(_ request: SBSubsonicRequestOperation) {
+        let type = request.request
+        request.queuePriority = type.priority
+        request.qualityOfService = type.isInteractive ? .userInitiated : .utility
+        request.enqueuedDate = Date()
+
+        let serverQueues = queues(for: request.server.objectID)
+        let queue: OperationQueue
+        if type.isMutation {
+            queue = serverQueues.mutations
+        } else if type.isInteractive {
+            queue = serverQueues.interactive
+        } else {
+            queue = serverQueues.background
+        }
+        queue.addOperation(request)
+    }
+
+    func add(_ parsing: SBSubsonicParsingOperation) {
+        parsing.queuePriority = parsing.requestType.priority
+        parsing.qualityOfService = parsing.requestType.isInteractive ? .userInitiated : .utility
+        parsing.enqueuedDate = Date()
+
+        lock.lock()
+        maintenanceOperations.removeAll { $0.isFinished }
+        for maintenance in maintenanceOperations {
+            parsing.addDependency(maintenance)
+        }
+        lock.unlock()
+
+        queues(for: parsing.serverID).parsing.addOperation(parsing)
+    }
+
+    /// Runs an operation that has to finish before any response is parsed.
+    func addMaintenance(_ operation: Operation) {
+        lock.lock()
+        maintenanceOperations.append(operation)
+        lock.unlock()
+
+        (operation as? SBOperation)?.enqueuedDate = Date()
+        OperationQueue.sharedServerQueue.addOperation(operation)
+    }
+}
+
+extension SBSubsonicRequestType {
+    /// If the user is likely waiting on the result, as opposed to traffic that can happen whenever.
+    var isInteractive: Bool {
+        switch self {
+        case .getCoverArt(_, _), .scrobble(_, _), .getScanStatus:
+            return false
+        default:
+            return true
+        }
+    }
+
+    /// If it changes something on the server, where running it before or alongside another change could give a
+    /// different result.
+    var isMutation: Bool {
+        switch self {
+        case .createPlaylist(_, _), .replacePlaylist(_, _), .updatePlaylist(_, _, _, _, _, _), .deletePlaylist(_),
+             .setRating(_, _), .star(_, _, _), .unstar(_, _, _):
+            return true
+        default:
+            return false
+        }
+    }
+
+    /// Browsing and user actions go first, then library-wide syncs, then background traffic.
+    var priority: Operation.QueuePriority {
+        switch self {
+        case .getArtist(_), .getAlbum(_), .getTrack(_), .getDirectory(_), .getPlaylist(_),
+             .search(_, _), .updateSearch(_, _), .getTopTracks(_), .getSimilarTracks(_),
+             .setRating(_, _), .star(_, _, _), .unstar(_, _, _),
+             .createPlaylist(_, _), .replacePlaylist(_, _), .updatePlaylist(_, _, _, _, _, _), .deletePlaylist(_):
+            return .high
+        case .getCoverArt(_, _), .scrobble(_, _), .getScanStatus:
+            return .low
+        default:
+            return .normal
+        }
+    }
+}
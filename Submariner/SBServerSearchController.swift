@@ -65,15 +65,13 @@ fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, catego
     override func loadView() {
         super.loadView()
         
-        resultObserver = NotificationCenter.default.addObserver(forName: .SBSubsonicSearchResultUpdated, object: nil, queue: nil) { notification in
-            DispatchQueue.main.async {
-                if let results = notification.object as! SBSearchResult? {
-                    results.fetchTracks(managedObjectContext: self.managedObjectContext)
-                    self.searchResult = results
-                    self.shouldInfiniteScroll = results.paginatable && results.returnedTracks > 0;
-                    // Load more tracks if we still haven't filled the visible table
-                    self.loadWhenAtBottom()
-                }
+        // The pipeline only passes on results for what was last asked for, with their tracks already fetched
+        resultObserver = NotificationCenter.default.addObserver(forName: .SBServerSearchResultReady, object: nil, queue: .main) { notification in
+            if let results = notification.object as! SBSearchResult? {
+                self.searchResult = results
+                self.shouldInfiniteScroll = results.paginatable && results.returnedTracks > 0;
+                // Load more tracks if we still haven't filled the visible table
+                self.loadWhenAtBottom()
             }
         }
         
@@ -0,0 +1,301 @@
+//
+//  SBServerSearchPipeline.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBServerSearchPipeline")
+
+extension NSNotification.Name {
+    /// Posted on the main thread with the SBSearchResult the search controller should show, with its tracks fetched.
+    static let SBServerSearchResultReady = NSNotification.Name("SBServerSearchResultReady")
+}
+
+/// Gets results for the server search controller, so it only ever sees the ones for what the user last asked for.
+///
+/// - Searches that need the server are debounced, so only the last of a burst is sent.
+/// - Asking for something else cancels the search in flight. If its response already arrived, it's thrown away.
+/// - Pages are cached by server, query and offset, so going back to a search doesn't ask the server again.
+/// - If a shorter query's results were cached in full, a query starting with it is answered from those.
+/// - The first page is small, so it shows up sooner. Later pages are bigger, and only their own tracks get fetched.
+///
+/// This is only used from the main thread.
+class SBServerSearchPipeline {
+    static let shared = SBServerSearchPipeline()
+
+    static let debounceInterval: TimeInterval = 0.2
+    static let firstPageSize = 40
+    static let pageSize = 100
+    static let cacheLimit = 64
+    /// The library on the server changes, so results only stay good for so long.
+    static let cacheExpiry: TimeInterval = 5 * 60
+
+    private struct Key: Hashable {
+        let server: URL
+        let query: String
+        let offset: Int
+    }
+
+    private struct Page {
+        let trackIDs: [NSManagedObjectID]
+        let requested: Int
+        let returned: Int
+        let date = Date()
+
+        /// If the server ran out before the page was full, this is everything for the query.
+        var isComplete: Bool {
+            returned < requested
+        }
+    }
+
+    /// Read by the parser on its own thread, to see if the user moved on.
+    private class Ticket {
+        private let lock = NSLock()
+        private var cancelled = false
+
+        var isCancelled: Bool {
+            lock.lock()
+            defer { lock.unlock() }
+            return cancelled
+        }
+
+        func cancel() {
+            lock.lock()
+            cancelled = true
+            lock.unlock()
+        }
+    }
+
+    private struct InFlight {
+        let operation: SBSubsonicRequestOperation
+        let ticket: Ticket
+        let result: SBSearchResult
+    }
+
+    private struct Current {
+        let query: SBSearchResult.QueryType
+        let server: SBServer
+    }
+
+    // least recently used first
+    private var cache: [Key: Page] = [:]
+    private var recency: [Key] = []
+
+    /// Each server's search waiting out the debounce, so typing in one doesn't cancel another's.
+    private var pendingSearches: [URL: DispatchWorkItem] = [:]
+    private var inFlight: [URL: InFlight] = [:]
+    /// What each server's search controller should be showing.
+    private var current: [URL: Current] = [:]
+
+    private(set) var hits = 0
+    private(set) var prefixHits = 0
+    private(set) var misses = 0
+    private(set) var superseded = 0
+
+    private var observer: NSObjectProtocol?
+
+    private init() {
+        observer = NotificationCenter.default.addObserver(forName: .SBSubsonicSearchResultUpdated, object: nil, queue: .main) { [weak self] notification in
+            self?.resultUpdated(notification)
+        }
+    }
+
+    // #MARK: - Requests
+
+    /// Searches for tracks, from the cache if it can, and after a moment from the server if it can't.
+    func search(query: String, server: SBServer) {
+        let asked = Date()
+        let serverURL = server.objectID.uriRepresentation()
+        supersede(with: .search(query: query), server: server)
+
+        let result = SBSearchResult(query: .search(query: query))
+        result.askedDate = asked
+        if let page = cachedPage(Key(server: serverURL, query: query, offset: 0)) {
+            hits += 1
+            deliver(page, to: result, server: server, source: "cache")
+            return
+        }
+        if let page = prefixPage(query: query, server: server) {
+            prefixHits += 1
+            store(page, for: Key(server: serverURL, query: query, offset: 0))
+            deliver(page, to: result, server: server, source: "a shorter query")
+            return
+        }
+
+        let work = DispatchWorkItem { [weak self] in
+            guard let self = self else {
+                return
+            }
+            self.pendingSearches[serverURL] = nil
+            self.misses += 1
+            self.send(result, offset: 0, count: SBServerSearchPipeline.firstPageSize, server: server)
+        }
+        pendingSearches[serverURL] = work
+        DispatchQueue.main.asyncAfter(deadline: .now() + SBServerSearchPipeline.debounceInterval, execute: work)
+    }
+
+    /// Gets the next page of a search, from the cache if it can.
+    func loadMore(_ result: SBSearchResult, server: SBServer) {
+        guard case .search(let query) = result.query, current[server.objectID.uriRepresentation()]?.query == result.query else {
+            return
+        }
+        let serverURL = server.objectID.uriRepresentation()
+        if inFlight[serverURL]?.result === result {
+            return
+        }
+        result.askedDate = Date()
+        let offset = result.tracks.count
+        if let page = cachedPage(Key(server: serverURL, query: query, offset: offset)) {
+            hits += 1
+            deliver(page, to: result, server: server, source: "cache")
+            return
+        }
+        misses += 1
+        send(result, offset: offset, count: SBServerSearchPipeline.pageSize, server: server)
+    }
+
+    /// Makes a query the one to show, so results for anything asked for before it don't replace it.
+    ///
+    /// Anything but a search goes to the server as usual, this just has to be called first.
+    func supersede(with query: SBSearchResult.QueryType, server: SBServer) {
+        let serverURL = server.objectID.uriRepresentation()
+        current[serverURL] = Current(query: query, server: server)
+        pendingSearches.removeValue(forKey: serverURL)?.cancel()
+        if let inFlight = self.inFlight.removeValue(forKey: serverURL) {
+            inFlight.ticket.cancel()
+            inFlight.operation.cancel()
+            superseded += 1
+        }
+    }
+
+    private func send(_ result: SBSearchResult, offset: Int, count: Int, server: SBServer) {
+        guard case .search(let query) = result.query else {
+            return
+        }
+        result.pageOffset = offset
+        result.pageCount = count
+        let requestType: SBSubsonicRequestType = offset == 0
+            ? .search(query: query, count: count)
+            : .updateSearch(existingResult: result, count: count)
+        let ticket = Ticket()
+        let request = SBSubsonicRequestOperation(server: server, request: requestType)
+        request.customization = { operation in
+            operation.currentSearch = result
+            operation.isStale = { ticket.isCancelled }
+        }
+        inFlight[server.objectID.uriRepresentation()] = InFlight(operation: request, ticket: ticket, result: result)
+        SBServerScheduler.shared.add(request)
+    }
+
+    // #MARK: - Results
+
+    private func resultUpdated(_ notification: Notification) {
+        guard let result = notification.object as? SBSearchResult,
+              let serverID = notification.userInfo?["serverID"] as? NSManagedObjectID else {
+            return
+        }
+        let serverURL = serverID.uriRepresentation()
+        let wasInFlight = inFlight[serverURL]?.result === result
+        if wasInFlight {
+            inFlight[serverURL] = nil
+        }
+        guard let current = self.current[serverURL], current.query == result.query else {
+            logger.info("Dropping results for \(String(describing: result.query), privacy: .public), since something else was asked for")
+            return
+        }
+        guard let context = current.server.managedObjectContext else {
+            return
+        }
+        result.fetchTracks(managedObjectContext: context)
+
+        // Only the pipeline's own pages know what they asked for
+        if wasInFlight, case .search(let query) = result.query {
+            let trackIDs = result.tracks[result.pageOffset...].map { $0.objectID }
+            let page = Page(trackIDs: Array(trackIDs), requested: result.pageCount, returned: result.returnedTracks)
+            store(page, for: Key(server: serverURL, query: query, offset: result.pageOffset))
+        }
+        post(result, source: "server")
+    }
+
+    private func deliver(_ page: Page, to result: SBSearchResult, server: SBServer, source: String) {
+        guard let context = server.managedObjectContext else {
+            return
+        }
+        result.tracksToFetch += page.trackIDs
+        result.returnedTracks = page.returned
+        result.fetchTracks(managedObjectContext: context)
+        post(result, source: source)
+    }
+
+    private func post(_ result: SBSearchResult, source: String) {
+        if let askedDate = result.askedDate {
+            let latency = Date().timeIntervalSince(askedDate) * 1000
+            logger.info("Showing \(result.tracks.count) tracks for \(String(describing: result.query), privacy: .public) from \(source, privacy: .public), \(latency, format: .fixed(precision: 1)) ms after asking (\(self.hits) cache hits, \(self.prefixHits) prefix hits, \(self.misses) misses, \(self.superseded) superseded)")
+            result.askedDate = nil
+        }
+        NotificationCenter.default.post(name: .SBServerSearchResultReady, object: result)
+    }
+
+    // #MARK: - Cache
+
+    private func cachedPage(_ key: Key) -> Page? {
+        guard let page = cache[key] else {
+            return nil
+        }
+        guard Date().timeIntervalSince(page.date) < SBServerSearchPipeline.cacheExpiry else {
+            cache[key] = nil
+            recency.removeAll { $0 == key }
+            return nil
+        }
+        recency.removeAll { $0 == key }
+        recency.append(key)
+        return page
+    }
+
+    private func store(_ page: Page, for key: Key) {
+        if cache.updateValue(page, forKey: key) != nil {
+            recency.removeAll { $0 == key }
+        }
+        recency.append(key)
+        while recency.count > SBServerSearchPipeline.cacheLimit {
+            cache[recency.removeFirst()] = nil
+        }
+    }
+
+    /// Answers a query from the complete results of a shorter one it starts with.
+    ///
+    /// Servers match each word of a search against titles, albums and artists, so adding to the query can only narrow
+    /// what it matches. Filtering the shorter query's tracks the same way gets the same tracks without asking.
+    private func prefixPage(query: String, server: SBServer) -> Page? {
+        guard let context = server.managedObjectContext else {
+            return nil
+        }
+        let serverURL = server.objectID.uriRepresentation()
+        let candidates = cache.keys.filter { key in
+            key.server == serverURL && key.offset == 0 && !key.query.isEmpty
+                && key.query.count < query.count && query.hasPrefix(key.query)
+        }
+        // the longest has the fewest tracks to go through
+        guard let key = candidates.max(by: { $0.query.count < $1.query.count }),
+              let shorter = cachedPage(key), shorter.isComplete else {
+            return nil
+        }
+        let words = query.split(separator: " ").map(String.init)
+        let trackIDs = shorter.trackIDs.filter { trackID in
+            guard let track = try? context.existingObject(with: trackID) as? SBTrack else {
+                return false
+            }
+            let fields = [track.itemName, track.albumString, track.artistString].compactMap { $0 }
+            return words.allSatisfy { word in
+                fields.contains { $0.range(of: word, options: [.caseInsensitive, .diacriticInsensitive]) != nil }
+            }
+        }
+        // still complete, since nothing past what the shorter query got could match
+        return Page(trackIDs: trackIDs, requested: SBServerSearchPipeline.firstPageSize, returned: trackIDs.count)
+    }
+}
@@ -0,0 +1,81 @@
+//
+//  SBServerSessionPool.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import CoreData
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBServerSessionPool")
+
+/// Hands out one long-lived `URLSession` per server, so requests reuse connections and TLS sessions.
+///
+/// Creating a session per request means every request pays for a new connection and handshake, which adds up quickly
+/// with things like a grid of covers. Keep-alive is the default for URLSession, and HTTP/2 is negotiated when the server
+/// supports it, as long as the session sticks around to benefit.
+///
+/// Sessions are never invalidated, so tasks that need their own delegate should set `URLSessionTask.delegate`.
+/// The session's delegate only collects metrics, to keep track of how often connections are reused.
+class SBServerSessionPool: NSObject, URLSessionTaskDelegate {
+    static let shared = SBServerSessionPool()
+
+    private let lock = NSLock()
+    private var sessions: [NSManagedObjectID: URLSession] = [:]
+
+    // Counters for every session, to see how well connections are reused.
+    private(set) var connectionsOpened = 0
+    private(set) var requestsServed = 0
+
+    var reuseRatio: Double {
+        lock.lock()
+        defer { lock.unlock() }
+        return requestsServed > 0 ? 1 - (Double(connectionsOpened) / Double(requestsServed)) : 0
+    }
+
+    private override init() {
+        super.init()
+    }
+
+    func session(for server: NSManagedObjectID) -> URLSession {
+        lock.lock()
+        defer { lock.unlock() }
+        if let existing = sessions[server] {
+            return existing
+        }
+
+        let configuration = URLSessionConfiguration.default
+        // Enough for both of the scheduler's lanes, plus downloads
+        configuration.httpMaximumConnectionsPerHost = max(1, UserDefaults.standard.maxConcurrentServerRequests) * 2
+            + max(1, UserDefaults.standard.maxConcurrentDownloads)
+        configuration.httpShouldUsePipelining = false
+        let session = URLSession(configuration: configuration, delegate: self, delegateQueue: nil)
+        session.sessionDescription = server.uriRepresentation().absoluteString
+        sessions[server] = session
+        return session
+    }
+
+    // #MARK: - URLSession Delegate
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didFinishCollecting metrics: URLSessionTaskMetrics) {
+        // Redirects and retries show up as separate transactions, count each of them
+        let fetched = metrics.transactionMetrics.filter { $0.resourceFetchType == .networkLoad }
+        let opened = fetched.filter { !$0.isReusedConnection }.count
+
+        lock.lock()
+        connectionsOpened += opened
+        requestsServed += fetched.count
+        let totalOpened = connectionsOpened
+        let totalServed = requestsServed
+        lock.unlock()
+
+        if let last = fetched.last {
+            logger.debug("Request used \(last.protocolName ?? "unknown protocol", privacy: .public), \(last.isReusedConnection ? "reused" : "new", privacy: .public) connection")
+        }
+        if totalServed > 0 && totalServed % 50 == 0 {
+            logger.info("Opened \(totalOpened) connections for \(totalServed) requests")
+        }
+    }
+}
@@ -20,14 +20,7 @@ extension NSNotification.Name {
     // As such, it could be made more consistent eventually.
     
     @objc func refreshNowPlaying() {
-        let fetchRequest = NSFetchRequest<SBNowPlaying>(entityName: "NowPlaying")
-        fetchRequest.includesPropertyValues = false
-        
-        try? self.managedObjectContext.fetch(fetchRequest).forEach { nowPlaying in
-            self.managedObjectContext.delete(nowPlaying)
-        }
-        self.managedObjectContext.processPendingChanges()
-        
+        // Rows are updated in place, so there's no need to clear them out first
         server?.getNowPlaying()
     }
     
@@ -76,9 +69,6 @@ extension NSNotification.Name {
         view = NSHostingView(rootView: rootView)
         // don't refresh since we'll do it in didAppear
         
-        autoRefreshObserver = UserDefaults.standard.observe(\.autoRefreshNowPlaying) { (defaults, change) in
-            self.startTimer()
-        }
         // we don't need SBSubsonicNowPlayingUpdatedNotification because SwiftUI pulls from the fetch request
         coverObserver = NotificationCenter.default.addObserver(forName: .SBSubsonicCoversUpdated,
                                                object: nil,
@@ -87,44 +77,54 @@ extension NSNotification.Name {
             // TODO: Disabled due to propensity for causing infinite loops, figure out a better way for real
             //self.refreshNowPlaying()
         }
-        startTimer()
     }
     
     override func viewDidAppear() {
         super.viewDidAppear()
         
-        // update it if we become visible
-        refreshNowPlaying()
+        // update it if we become visible, and keep it updated while we are
+        isShowing = true
+        if let server = server {
+            SBServerPoller.shared.watchNowPlaying(server: server)
+        }
+    }
+    
+    override func viewDidDisappear() {
+        super.viewDidDisappear()
+        
+        isShowing = false
+        if let server = server {
+            SBServerPoller.shared.unwatchNowPlaying(server: server)
+        }
     }
     
     // #MARK: - Server Getter/Setter
     
-    @objc @Published var server: SBServer?
+    private var isShowing = false
+    
+    @objc @Published var server: SBServer? {
+        didSet {
+            // if the sidebar is open and we switch servers, poll the new one instead
+            guard isShowing, oldValue != server else {
+                return
+            }
+            if let oldValue = oldValue {
+                SBServerPoller.shared.unwatchNowPlaying(server: oldValue)
+            }
+            if let server = server {
+                SBServerPoller.shared.watchNowPlaying(server: server)
+            }
+        }
+    }
     
-    // #MARK: - Observers and Timers
+    // #MARK: - Observers
     
     var coverObserver: Any?
-    var autoRefreshObserver: NSKeyValueObservation?
-    var autoRefreshTimer: Timer?
     
     deinit {
         if let coverObserver = coverObserver {
             NotificationCenter.default.removeObserver(coverObserver)
         }
-        autoRefreshObserver?.invalidate()
-        autoRefreshTimer?.invalidate()
-    }
-    
-    func startTimer() {
-        if UserDefaults.standard.autoRefreshNowPlaying {
-            let interval = TimeInterval(30)
-            autoRefreshTimer?.invalidate()
-            autoRefreshTimer = Timer(timeInterval: interval, repeats: true) { timer in
-                self.refreshNowPlaying()
-            }
-        } else {
-            autoRefreshTimer?.invalidate()
-        }
     }
     
     // #MARK: - SwiftUI Views
@@ -273,12 +273,8 @@ extension NSNotification.Name {
                     }
                     .listStyle(.inset(alternatesRowBackgrounds: true))
                     .onChange(of: serverUsersController.server) { newValue in
+                        // the controller starts polling the new server itself
                         updatePredicate(server: newValue)
-                        // if the sidebar is open and we switch servers, make sure we have the latest if it makes sense
-                        if (self.serverUsersController.databaseController?.isServerUsersShown == true) {
-                            // hopefully this doesn't trigger for unsupported servers...
-                            serverUsersController.refreshNowPlaying()
-                        }
                     }
                     // the bottom bar is 41px into content area, so
                     HStack {
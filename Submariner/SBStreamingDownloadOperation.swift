@@ -0,0 +1,419 @@
+//
+//  SBStreamingDownloadOperation.swift
+//  Submariner
+//
+//  Created by Submariner Developers on 2026-10-17.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Cocoa
+import AVFoundation
+import UniformTypeIdentifiers
+import os
+
+fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBStreamingDownloadOperation")
+
+/// Downloads a track once, playing it from the download as it arrives, and importing it when it's done.
+///
+/// The player's asset uses a URL with our own scheme, so AVFoundation asks us for the bytes it wants. Those come from a
+/// file we fill in from the server with range requests. If the player wants something past what's downloaded (i.e. a
+/// seek), the download moves there, then goes back for whatever it skipped. Nothing is fetched twice.
+///
+/// Once it's done, a copy goes to the import, and the player keeps being served from the file, which stays around for
+/// as long as the operation does. The player has to keep it around for as long as the item is playing, since the
+/// resource loader doesn't.
+class SBStreamingDownloadOperation: SBOperation, AVAssetResourceLoaderDelegate, URLSessionDataDelegate {
+    static let scheme = "submariner-cache"
+
+    /// If the player wants data this far ahead of where the download is, don't wait for it to get there.
+    static let seekThreshold: Int64 = 512 * 1024
+    /// Most bytes to hand AVFoundation at once.
+    static let maxResponseLength = 1024 * 1024
+
+    let trackID: NSManagedObjectID
+    let assetURL: URL
+    /// Where the resource loader gets called; everything here happens on it.
+    let queue = DispatchQueue(label: "Streaming download")
+    /// Called on the main queue when finished, successfully or not.
+    var completion: (() -> Void)?
+
+    private let remoteURL: URL
+    private let serverID: NSManagedObjectID
+    private let username: String?
+    private let password: String?
+    private let contentType: String?
+
+    private let fileURL = URL.temporaryFile()
+    private var fileHandle: FileHandle?
+    private var contentLength: Int64?
+    private var responseMIMEType: String?
+    // byte offsets we have in the file
+    private var available = IndexSet()
+    private var pending: [AVAssetResourceLoadingRequest] = []
+
+    private var task: URLSessionDataTask?
+    // where the next byte from the task goes in the file
+    private var taskOffset: Int64 = 0
+    private var bytesFetched: Int64 = 0
+    private var isDone = false
+
+    private let byteCountFormatter = ByteCountFormatter()
+
+    /// If the track can be played from a download. When the server transcodes, what's played isn't the file, so it's
+    /// better to download the file separately.
+    static func canStream(track: SBTrack) -> Bool {
+        return track.server != nil
+            && track.transcodedType == nil
+            && UserDefaults.standard.integer(forKey: "maxBitRate") == 0
+            && track.downloadURL() != nil
+    }
+
+    // must be called on the main thread, with a track that passes canStream
+    init(managedObjectContext mainContext: NSManagedObjectContext, track: SBTrack) {
+        trackID = track.objectID
+        remoteURL = track.downloadURL()!
+        serverID = track.server!.objectID
+        username = track.server?.username
+        password = track.server?.password
+        contentType = track.macOSCompatibleContentType()
+
+        var components = URLComponents(url: remoteURL, resolvingAgainstBaseURL: false)!
+        components.scheme = SBStreamingDownloadOperation.scheme
+        assetURL = components.url!
+
+        let activityName = String.init(format: "Downloading %@%@%@",
+                                       Locale.current.quotationBeginDelimiter ?? "\"",
+                                       track.itemName ?? "",
+                                       Locale.current.quotationEndDelimiter ?? "\"")
+        super.init(managedObjectContext: mainContext, name: activityName)
+        self.operationInfo = "Pending Request..."
+    }
+
+    deinit {
+        try? fileHandle?.close()
+        try? FileManager.default.removeItem(at: fileURL)
+    }
+
+    override func main() {
+        queue.async {
+            do {
+                FileManager.default.createFile(atPath: self.fileURL.path, contents: nil)
+                self.fileHandle = try FileHandle(forUpdating: self.fileURL)
+            } catch {
+                self.fail(error)
+                return
+            }
+            self.scheduleFetch()
+        }
+    }
+
+    // #MARK: - Fetching
+
+    // must be on queue
+    private var missingRanges: [Range<Int>] {
+        guard let contentLength = self.contentLength else {
+            // until the server says how long it is, everything past what we have is missing
+            return [(available.rangeView.last?.upperBound ?? 0)..<Int.max]
+        }
+        return IndexSet(integersIn: 0..<Int(contentLength)).subtracting(available).rangeView.map { $0 }
+    }
+
+    /// Makes sure the download is heading where the player needs it, or to the next gap if the player is happy.
+    // must be on queue
+    private func scheduleFetch() {
+        guard !isDone, fileHandle != nil else {
+            return
+        }
+        let missing = missingRanges
+        guard !missing.isEmpty else {
+            complete()
+            return
+        }
+
+        // where the player is reading from, if it's waiting on something we don't have
+        let wanted = pending.compactMap { request -> Int64? in
+            guard let offset = request.dataRequest?.currentOffset, !available.contains(Int(offset)) else {
+                return nil
+            }
+            return offset
+        }.min()
+
+        if let task = self.task {
+            guard let wanted = wanted else {
+                return
+            }
+            // close enough, the download will get there soon
+            if wanted >= taskOffset && wanted - taskOffset < SBStreamingDownloadOperation.seekThreshold {
+                return
+            }
+            logger.info("Player wants offset \(wanted), but download is at \(self.taskOffset), moving download")
+            self.task = nil
+            task.cancel()
+        }
+
+        // Fetch up to the next part we already have, so nothing is fetched twice
+        let range: Range<Int>
+        if let wanted = wanted, let gap = missing.first(where: { $0.contains(Int(wanted)) }) {
+            range = Int(wanted)..<gap.upperBound
+        } else {
+            range = missing.first!
+        }
+        startTask(range: range)
+    }
+
+    // must be on queue
+    private func startTask(range: Range<Int>) {
+        var request = URLRequest(url: remoteURL, cachePolicy: .reloadIgnoringLocalCacheData, timeoutInterval: 30)
+        if range.upperBound == Int.max {
+            request.setValue("bytes=\(range.lowerBound)-", forHTTPHeaderField: "Range")
+        } else {
+            request.setValue("bytes=\(range.lowerBound)-\(range.upperBound - 1)", forHTTPHeaderField: "Range")
+        }
+        let session = SBServerSessionPool.shared.session(for: serverID)
+        let task = session.dataTask(with: request)
+        task.delegate = self
+        taskOffset = Int64(range.lowerBound)
+        self.task = task
+        task.resume()
+    }
+
+    // must be on queue
+    private func write(_ data: Data) {
+        guard let fileHandle = self.fileHandle else {
+            return
+        }
+        do {
+            try fileHandle.seek(toOffset: UInt64(taskOffset))
+            try fileHandle.write(contentsOf: data)
+        } catch {
+            fail(error)
+            return
+        }
+        available.insert(integersIn: Int(taskOffset)..<(Int(taskOffset) + data.count))
+        taskOffset += Int64(data.count)
+        bytesFetched += Int64(data.count)
+
+        if let contentLength = self.contentLength {
+            let fetched = Float(available.count)
+            let total = Float(contentLength)
+            let info = "Downloaded \(byteCountFormatter.string(fromByteCount: Int64(available.count)))/\(byteCountFormatter.string(fromByteCount: contentLength))"
+            DispatchQueue.main.async {
+                self.progress = .determinate(n: fetched, outOf: total)
+                self.operationInfo = info
+            }
+        }
+        serve()
+    }
+
+    /// Stops downloading, i.e. if the track was skipped. Does nothing if it's already done.
+    override func cancel() {
+        super.cancel()
+        queue.async {
+            guard !self.isDone else {
+                return
+            }
+            logger.info("Cancelling streaming download after \(self.bytesFetched) bytes")
+            self.fail(CocoaError(.userCancelled))
+        }
+    }
+
+    // must be on queue
+    private func complete() {
+        isDone = true
+        // The file stays open, so the player can still seek around in it once the download is done
+        serve()
+
+        logger.info("Fetched \(self.bytesFetched) bytes for a \(self.contentLength ?? 0) byte track")
+
+        // SBImportOperation needs an audio file extension.
+        var mimeType = contentType ?? responseMIMEType
+        if mimeType == "application/x-download" {
+            mimeType = nil
+        }
+        let fileType = UTType(mimeType: mimeType ?? "audio/mp3") ?? UTType.mp3
+        let importFile = URL.temporaryFile().appendingPathExtension(for: fileType)
+        do {
+            // the import moves it, and we still need ours
+            try FileManager.default.copyItem(at: fileURL, to: importFile)
+        } catch {
+            logger.error("Couldn't copy downloaded track for import: \(error, privacy: .public)")
+            done()
+            return
+        }
+
+        DispatchQueue.main.async {
+            self.operationInfo = "Importing track..."
+            if let importOperation = SBImportOperation(managedObjectContext: self.mainContext, file: importFile, remoteTrackID: self.trackID) {
+                OperationQueue.sharedDownloadQueue.addOperation(importOperation)
+            }
+        }
+        done()
+    }
+
+    // must be on queue
+    private func fail(_ error: Error) {
+        logger.error("Failed streaming download: \(error, privacy: .public)")
+        isDone = true
+        task?.cancel()
+        task = nil
+        pending.forEach { $0.finishLoading(with: error) }
+        pending.removeAll()
+        try? fileHandle?.close()
+        fileHandle = nil
+        try? FileManager.default.removeItem(at: fileURL)
+        done()
+    }
+
+    private func done() {
+        DispatchQueue.main.async {
+            self.completion?()
+        }
+        finish()
+    }
+
+    // #MARK: - Serving the player
+
+    // must be on queue
+    private func serve() {
+        pending.removeAll { request in
+            if request.isCancelled {
+                return true
+            }
+            guard let contentLength = self.contentLength else {
+                // we can't say anything until the server does
+                return false
+            }
+            if let information = request.contentInformationRequest {
+                if let mimeType = contentType ?? responseMIMEType, let type = UTType(mimeType: mimeType) {
+                    information.contentType = type.identifier
+                }
+                information.contentLength = contentLength
+                information.isByteRangeAccessSupported = true
+            }
+            guard let dataRequest = request.dataRequest else {
+                request.finishLoading()
+                return true
+            }
+
+            let end = dataRequest.requestsAllDataToEndOfResource
+                ? contentLength
+                : min(contentLength, dataRequest.requestedOffset + Int64(dataRequest.requestedLength))
+            while dataRequest.currentOffset < end {
+                let start = Int(dataRequest.currentOffset)
+                // only what we have from here on without a gap
+                guard let range = available.rangeView(of: start..<Int(end)).first, range.lowerBound == start,
+                      let fileHandle = self.fileHandle else {
+                    break
+                }
+                let length = min(range.count, SBStreamingDownloadOperation.maxResponseLength)
+                do {
+                    try fileHandle.seek(toOffset: UInt64(start))
+                    guard let data = try fileHandle.read(upToCount: length), !data.isEmpty else {
+                        break
+                    }
+                    dataRequest.respond(with: data)
+                } catch {
+                    request.finishLoading(with: error)
+                    return true
+                }
+            }
+            if dataRequest.currentOffset >= end {
+                request.finishLoading()
+                return true
+            }
+            return false
+        }
+    }
+
+    // #MARK: - AVAssetResourceLoader Delegate
+
+    func resourceLoader(_ resourceLoader: AVAssetResourceLoader, shouldWaitForLoadingOfRequestedResource loadingRequest: AVAssetResourceLoadingRequest) -> Bool {
+        guard !isDone || fileHandle != nil else {
+            // failed or cancelled, so there's nothing to serve
+            return false
+        }
+        pending.append(loadingRequest)
+        serve()
+        scheduleFetch()
+        return true
+    }
+
+    func resourceLoader(_ resourceLoader: AVAssetResourceLoader, didCancel loadingRequest: AVAssetResourceLoadingRequest) {
+        pending.removeAll { $0 === loadingRequest }
+    }
+
+    // #MARK: - URLSession Delegate
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didReceive challenge: URLAuthenticationChallenge, completionHandler: @escaping (URLSession.AuthChallengeDisposition, URLCredential?) -> Void) {
+        if challenge.previousFailureCount == 0, let username = self.username, let password = self.password {
+            let credential = URLCredential(user: username, password: password, persistence: .none)
+            completionHandler(.useCredential, credential)
+        } else {
+            completionHandler(.cancelAuthenticationChallenge, nil)
+        }
+    }
+
+    func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive response: URLResponse, completionHandler: @escaping (URLSession.ResponseDisposition) -> Void) {
+        queue.async {
+            guard dataTask === self.task else {
+                completionHandler(.cancel)
+                return
+            }
+            guard let response = response as? HTTPURLResponse, response.statusCode == 200 || response.statusCode == 206 else {
+                completionHandler(.cancel)
+                self.fail(URLError(.badServerResponse))
+                return
+            }
+            // Subsonic errors come back as a successful response with XML
+            if let mimeType = response.mimeType, mimeType.hasSuffix("xml") || mimeType.hasSuffix("json") {
+                completionHandler(.cancel)
+                self.fail(URLError(.cannotDecodeContentData))
+                return
+            }
+            self.responseMIMEType = response.mimeType
+
+            if response.statusCode == 206,
+               let contentRange = response.value(forHTTPHeaderField: "Content-Range"),
+               let total = contentRange.split(separator: "/").last.flatMap({ Int64($0) }) {
+                self.contentLength = total
+            } else {
+                // the server ignored the range, so this is the whole file from the start
+                self.taskOffset = 0
+                if response.expectedContentLength != NSURLSessionTransferSizeUnknown {
+                    self.contentLength = response.expectedContentLength
+                }
+            }
+            completionHandler(.allow)
+            self.serve()
+        }
+    }
+
+    func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive data: Data) {
+        queue.async {
+            guard dataTask === self.task else {
+                return
+            }
+            self.write(data)
+        }
+    }
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didCompleteWithError error: Error?) {
+        queue.async {
+            // tasks we moved away from don't matter
+            guard task === self.task else {
+                return
+            }
+            self.task = nil
+            if let error = error {
+                self.fail(error)
+                return
+            }
+            if self.contentLength == nil {
+                // no length up front, so the end of the response is the end of the file
+                self.contentLength = Int64(self.available.count)
+            }
+            self.serve()
+            self.scheduleFetch()
+        }
+    }
+}
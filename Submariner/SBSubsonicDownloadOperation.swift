@@ -12,107 +12,345 @@ import os
 
 fileprivate let logger = Logger(subsystem: Bundle.main.bundleIdentifier!, category: "SBSubsonicDownloadOperation")
 
-@objc class SBSubsonicDownloadOperation: SBOperation, URLSessionDelegate, URLSessionTaskDelegate, URLSessionDownloadDelegate {
+/// Downloads a track from a server into the local library. These should be added to `SBDownloadManager`.
+///
+/// The download goes into a partial file named after the track, so if the connection drops (or the app quits), it picks
+/// up from where it left off with a range request instead of starting over. Transient failures are retried with backoff.
+@objc class SBSubsonicDownloadOperation: SBOperation, URLSessionDataDelegate {
+    /// How many times to try again after a failure before giving up.
+    static let maxRetries = 5
+    /// The first retry waits this long, then it doubles each time.
+    static let initialRetryDelay: TimeInterval = 1
+
+    static let partialDownloadsDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("Partial Downloads", isDirectory: true)
+
     private let track: SBTrack
-    
+    @objc let trackID: NSManagedObjectID
+    @objc let serverID: NSManagedObjectID?
+
+    private let url: URL?
+    private let username: String?
+    private let password: String?
+    private let partialFile: URL?
+
+    // everything after main starts happens on this queue
+    private let queue = DispatchQueue(label: "Track download")
+    private var task: URLSessionDataTask?
+    private var fileHandle: FileHandle?
+    private var responseMIMEType: String?
+    private var bytesWritten: Int64 = 0
+    private var bytesExpected: Int64?
+    private var retries = 0
+    private var lastError: Error?
+
     @objc init!(managedObjectContext mainContext: NSManagedObjectContext!, trackID: NSManagedObjectID) {
         // Reconstitute the track because Core Data objects can't cross thread boundaries.
         track = mainContext.object(with: trackID) as! SBTrack
-        
+        self.trackID = trackID
+        // Get everything the download needs here, while we're still on the main thread
+        serverID = track.server?.objectID
+        url = track.downloadURL()
+        username = track.server?.username
+        password = track.server?.password
+        if let serverID = serverID, let itemId = track.itemId {
+            // stable between launches, so a partial download can be picked up again
+            let name = "\(serverID.uriRepresentation().lastPathComponent)-\(itemId)"
+                .replacingOccurrences(of: "/", with: "_")
+            partialFile = SBSubsonicDownloadOperation.partialDownloadsDirectory.appendingPathComponent(name + ".part")
+        } else {
+            partialFile = nil
+        }
+
         let activityName = String.init(format: "Downloading %@%@%@",
                                        Locale.current.quotationBeginDelimiter ?? "\"",
                                        track.itemName!,
                                        Locale.current.quotationEndDelimiter ?? "\"")
-        
+
         super.init(managedObjectContext: mainContext, name: activityName)
         self.operationInfo = "Pending Request..."
         self.progress = .none
     }
-    
+
     override func main() {
-        if track.localTrack != nil {
+        let alreadyDownloaded = mainContext.performAndWait {
+            track.localTrack != nil
+        }
+        if alreadyDownloaded {
             // We don't need to redownload the track.
             self.finish()
             return
         }
-        autoreleasepool {
-            // We don't need to do any transformation here,
-            // as downloadURL will get the auth params from SBServer.
-            let url = track.downloadURL()!
+        guard serverID != nil, let partialFile = self.partialFile, url != nil else {
+            logger.error("Track to download doesn't have a server")
+            self.finish()
+            return
+        }
+        queue.async {
+            do {
+                try FileManager.default.createDirectory(at: SBSubsonicDownloadOperation.partialDownloadsDirectory, withIntermediateDirectories: true)
+                if !FileManager.default.fileExists(atPath: partialFile.path) {
+                    FileManager.default.createFile(atPath: partialFile.path, contents: nil)
+                }
+                self.fileHandle = try FileHandle(forUpdating: partialFile)
+            } catch {
+                self.fail(error)
+                return
+            }
+            self.startTask()
+        }
+    }
+
+    override func cancel() {
+        super.cancel()
+        queue.async {
+            // the partial file stays, so it can be resumed later
+            self.task?.cancel()
+        }
+    }
+
+    // #MARK: - Transfer
+
+    // must be on queue
+    private func startTask() {
+        guard let fileHandle = self.fileHandle, let url = self.url, let serverID = self.serverID else {
+            return
+        }
+        let resumeOffset = (try? fileHandle.seekToEnd()) ?? 0
+        bytesWritten = Int64(resumeOffset)
+
+        // We don't need to do any transformation here,
+        // as downloadURL will get the auth params from SBServer.
+        var request = URLRequest(url: url, cachePolicy: .reloadIgnoringLocalCacheData, timeoutInterval: 30)
+        if resumeOffset > 0 {
+            logger.info("Resuming download at byte \(resumeOffset) from URL: \(url)")
+            request.setValue("bytes=\(resumeOffset)-", forHTTPHeaderField: "Range")
+        } else {
             logger.info("Downloading track at URL: \(url)")
-            let request = URLRequest(url: url, cachePolicy: .useProtocolCachePolicy, timeoutInterval: 30)
-            let configuration = URLSessionConfiguration.default
-            let session = URLSession(configuration: configuration, delegate: self, delegateQueue: nil)
-            let task = session.downloadTask(with: request)
-            task.resume()
         }
+        // The session is shared with other requests to the server, so we're only the delegate for our own task
+        let session = SBServerSessionPool.shared.session(for: serverID)
+        let task = session.dataTask(with: request)
+        task.delegate = self
+        self.task = task
+        task.resume()
     }
-    
-    // #MARK: -
-    // #MARK: NSURLSession Delegate (Auth)
-    
-    func urlSession(_ session: URLSession, task: URLSessionTask, didReceive challenge: URLAuthenticationChallenge, completionHandler: @escaping (URLSession.AuthChallengeDisposition, URLCredential?) -> Void) {
-        if (challenge.previousFailureCount == 0) {
-            if let server = track.server, let username = server.username, let password = server.password {
-                let credential = URLCredential(user: username,
-                                               password: password,
-                                               persistence: .none)
-                
-                completionHandler(.useCredential, credential)
+
+    /// If a failure is worth trying again, i.e. the network and not the server saying no.
+    private func isTransient(_ error: Error) -> Bool {
+        guard let urlError = error as? URLError else {
+            return false
+        }
+        switch urlError.code {
+        case .timedOut, .networkConnectionLost, .notConnectedToInternet, .cannotConnectToHost,
+             .cannotFindHost, .dnsLookupFailed, .resourceUnavailable, .dataNotAllowed, .secureConnectionFailed:
+            return true
+        case .badServerResponse:
+            // 5xx, or starting over after a bad range; see didReceive response
+            return true
+        default:
+            return false
+        }
+    }
+
+    // must be on queue
+    private func retryOrFail(_ error: Error) {
+        task = nil
+        guard !isCancelled else {
+            fail(error)
+            return
+        }
+        guard isTransient(error), retries < SBSubsonicDownloadOperation.maxRetries else {
+            fail(error)
+            return
+        }
+        let delay = SBSubsonicDownloadOperation.initialRetryDelay * pow(2, Double(retries))
+        retries += 1
+        logger.warning("Download failed with \(error, privacy: .public), retry \(self.retries) in \(delay) s")
+        DispatchQueue.main.async {
+            self.operationInfo = "Connection lost, trying again..."
+        }
+        queue.asyncAfter(deadline: .now() + delay) {
+            guard !self.isCancelled else {
+                self.fail(error)
+                return
             }
-        } else {
-            completionHandler(.cancelAuthenticationChallenge, nil)
+            self.startTask()
         }
     }
-    
-    // #MARK: -
-    // #MARK: NSURLSession Delegate (State)
-    
-    func urlSession(_ session: URLSession, task: URLSessionTask, didCompleteWithError error: Error?) {
-        if let error = error {
+
+    // must be on queue
+    private func fail(_ error: Error) {
+        try? fileHandle?.close()
+        fileHandle = nil
+        if isCancelled {
+            logger.info("Download cancelled, keeping \(self.bytesWritten) bytes to resume later")
+        } else {
             logger.error("Failure downloading track with URLSession, error \(error, privacy: .public)")
             DispatchQueue.main.async {
                 NSApp.presentError(error)
             }
-            self.finish()
-            session.invalidateAndCancel()
         }
+        self.finish()
     }
-    
-    func urlSession(_ session: URLSession, downloadTask: URLSessionDownloadTask, didFinishDownloadingTo location: URL) {
+
+    // must be on queue
+    private func complete() {
+        // The connection can end early without an error, which would import a truncated file
+        if let bytesExpected = self.bytesExpected, bytesWritten != bytesExpected {
+            logger.warning("Download ended at \(self.bytesWritten) bytes, expected \(bytesExpected)")
+            if bytesWritten > bytesExpected {
+                // more than the file has, so what we have can't be trusted
+                try? fileHandle?.truncate(atOffset: 0)
+            }
+            retryOrFail(URLError(.networkConnectionLost))
+            return
+        }
+        try? fileHandle?.close()
+        fileHandle = nil
+        guard let partialFile = self.partialFile else {
+            return
+        }
+
         // Success
         DispatchQueue.main.async {
             self.operationInfo = "Importing track..."
+            self.progress = .indeterminate(n: 0)
         }
-        
+
         // SBImportOperation needs an audio file extension. Rename the file.
-        var proposedMimeType = downloadTask.response?.mimeType
+        var proposedMimeType = responseMIMEType
         if proposedMimeType == "application/x-download" {
             // XXX: get a better one
             proposedMimeType = nil
         }
         let fileType = UTType(mimeType: proposedMimeType ?? "audio/mp3") ?? UTType.mp3
         let temporaryFile = URL.temporaryFile().appendingPathExtension(for: fileType)
-        try! FileManager.default.moveItem(at: location, to: temporaryFile)
-        
-        // Now import.
+        do {
+            try FileManager.default.moveItem(at: partialFile, to: temporaryFile)
+        } catch {
+            fail(error)
+            return
+        }
+
+        // Now import. It runs on its own queue, so the next download doesn't have to wait for it.
         if let importOperation = SBImportOperation(managedObjectContext: mainContext, file: temporaryFile, remoteTrackID: track.objectID) {
             OperationQueue.sharedDownloadQueue.addOperation(importOperation)
         }
-        
+
         self.finish()
-        session.finishTasksAndInvalidate()
     }
-    
+
+    // #MARK: -
+    // #MARK: NSURLSession Delegate (Auth)
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didReceive challenge: URLAuthenticationChallenge, completionHandler: @escaping (URLSession.AuthChallengeDisposition, URLCredential?) -> Void) {
+        if challenge.previousFailureCount == 0, let username = self.username, let password = self.password {
+            let credential = URLCredential(user: username,
+                                           password: password,
+                                           persistence: .none)
+
+            completionHandler(.useCredential, credential)
+        } else {
+            completionHandler(.cancelAuthenticationChallenge, nil)
+        }
+    }
+
+    // #MARK: -
+    // #MARK: NSURLSession Delegate (State)
+
+    func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive response: URLResponse, completionHandler: @escaping (URLSession.ResponseDisposition) -> Void) {
+        queue.async {
+            guard let response = response as? HTTPURLResponse, let fileHandle = self.fileHandle else {
+                completionHandler(.cancel)
+                return
+            }
+            // Subsonic errors come back as a successful response with XML, which shouldn't end up in the file
+            if let mimeType = response.mimeType, mimeType.hasSuffix("xml") || mimeType.hasSuffix("json") {
+                completionHandler(.cancel)
+                self.lastError = URLError(.cannotDecodeContentData)
+                return
+            }
+            switch response.statusCode {
+            case 206:
+                // what we asked for, so the partial file gets added to
+                if let contentRange = response.value(forHTTPHeaderField: "Content-Range"),
+                   let total = contentRange.split(separator: "/").last.flatMap({ Int64($0) }) {
+                    self.bytesExpected = total
+                }
+            case 200:
+                // the server ignored the range (or there wasn't one), so start the file over
+                do {
+                    try fileHandle.truncate(atOffset: 0)
+                } catch {
+                    completionHandler(.cancel)
+                    self.lastError = error
+                    return
+                }
+                self.bytesWritten = 0
+                if response.expectedContentLength != NSURLSessionTransferSizeUnknown {
+                    self.bytesExpected = response.expectedContentLength
+                }
+            case 416:
+                // the partial file doesn't fit what the server has (i.e. the track changed), so start over
+                try? fileHandle.truncate(atOffset: 0)
+                completionHandler(.cancel)
+                self.lastError = URLError(.badServerResponse)
+                return
+            case 500...599:
+                completionHandler(.cancel)
+                self.lastError = URLError(.badServerResponse)
+                return
+            default:
+                completionHandler(.cancel)
+                self.lastError = URLError(.fileDoesNotExist)
+                return
+            }
+            self.responseMIMEType = response.mimeType
+            completionHandler(.allow)
+        }
+    }
+
+    func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive data: Data) {
+        queue.async {
+            guard let fileHandle = self.fileHandle else {
+                return
+            }
+            do {
+                try fileHandle.write(contentsOf: data)
+            } catch {
+                self.lastError = error
+                dataTask.cancel()
+                return
+            }
+            self.bytesWritten += Int64(data.count)
+            SBDownloadManager.shared.record(bytes: data.count)
+            self.updateProgress()
+        }
+    }
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didCompleteWithError error: Error?) {
+        queue.async {
+            // an error of our own (i.e. a bad response) is more useful than the cancellation it causes
+            if let error = self.lastError ?? error {
+                self.lastError = nil
+                self.retryOrFail(error)
+                return
+            }
+            self.complete()
+        }
+    }
+
     // #MARK: -
     // #MARK: NSURLSession Delegate (Progress)
-    
+
     private let byteCountFormatter = MeasurementFormatter()
-    
-    func urlSession(_ session: URLSession, downloadTask: URLSessionDownloadTask, didWriteData bytesWritten: Int64, totalBytesWritten: Int64, totalBytesExpectedToWrite: Int64) {
+
+    // must be on queue
+    private func updateProgress() {
+        let totalBytesWritten = bytesWritten
         let totalWritten = Measurement<UnitInformationStorage>(value: Double(totalBytesWritten), unit: .bytes).converted(to: .megabytes)
-        
-        if totalBytesExpectedToWrite != NSURLSessionTransferSizeUnknown {
+
+        if let totalBytesExpectedToWrite = bytesExpected {
             let totalToWrite = Measurement<UnitInformationStorage>(value: Double(totalBytesExpectedToWrite), unit: .bytes)
                 .converted(to: .megabytes)
             DispatchQueue.main.async {
@@ -34,10 +34,15 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     let requestType: SBSubsonicRequestType
     var server: SBServer!
     let xmlData: Data?
+    // If set, the response is parsed as it arrives instead of from xmlData, and saved in chunks.
+    let xmlStream: InputStream?
     let mimeType: String?
+    let serverID: NSManagedObjectID
     
     // state
     var errored: Bool = false
+    /// The Subsonic error the response had (they come with HTTP 200), or why it couldn't be parsed.
+    private(set) var responseError: Error?
     
     // state for selected object
     var currentPlaylist: SBPlaylist?
@@ -51,11 +56,23 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     var currentAlbumID: String?
     var currentCoverID: String?
     
+    /// If this returns true when parsing would start, the response is thrown away, i.e. the user moved on.
+    var isStale: (() -> Bool)?
+    
     // state for deleting elements not in this list
     var playlistsReturned: [SBPlaylist] = []
     var artistsReturned: [SBArtist] = []
     var albumsReturned: [SBAlbum] = []
     var tracksReturned: [SBTrack] = []
+    // In the order the server gave them, only handed to the search once saving gives new ones their permanent IDs
+    var searchTracksReturned: [SBTrack] = []
+    // the above from chunks that have already been saved, since only the IDs survive a reset
+    private var savedPlaylistIDs = Set<NSManagedObjectID>()
+    private var savedArtistIDs = Set<NSManagedObjectID>()
+    private var savedAlbumIDs = Set<NSManagedObjectID>()
+    private var savedTrackIDs = Set<NSManagedObjectID>()
+    // The playlist's tracks in the server's order, applied as a diff at the end. IDs, since they survive a reset.
+    private var playlistTrackIDsReturned: [String] = []
 
     // This is for coalescing cover fetches, since we might keep fetching the same ID.
     // The mapping is albumID: coverID; note that at least Navidrome has separate coverArt entries
@@ -63,67 +80,138 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     // vestigal since we care about the album's cover in the UI. This means first match wins.
     var coversToFetch: [String: String] = [:]
     
+    // Delta sync state for getArtists/getIndexes
+    // Set when the server says nothing changed since the last sync, so there's nothing to merge.
+    private var unchangedSinceLastSync = false
+    // Only recorded after the whole response is merged, so a failed sync isn't skipped next time.
+    private var indexModifiedDate: Date?
+    // Artists whose album count doesn't match what we have, to refresh after the sync.
+    private var artistIDsToRefresh = Set<String>()
+    // So a big change doesn't queue a request for every artist at once
+    static let maxArtistRefreshes = 50
+    private struct SyncCounts {
+        var inserted = 0
+        var updated = 0
+        var unchanged = 0
+        var removed = 0
+    }
+    private var syncCounts = SyncCounts()
+    private var parseStartDate = Date()
+    // Now playing rows the response still has, so the rest can be removed
+    private var nowPlayingReturned = Set<NSManagedObjectID>()
+    
+    /// How many objects the sync wrote, for pollers that want to know if anything changed.
+    var syncWrites: Int {
+        syncCounts.inserted + syncCounts.updated + syncCounts.removed
+    }
+    /// How many objects the sync didn't write, because they were already right.
+    var syncUnchanged: Int {
+        syncCounts.unchanged
+    }
+    /// If getScanStatus said the server is still scanning.
+    private(set) var scanning: Bool?
+    /// How many lookups by ID the prefetched objects answered, and how many had to fetch from the store one at a time.
+    var cachedLookups: Int {
+        trackMap.hits + artistMap.hits + albumMap.hits + directoryMap.hits
+    }
+    var fetchedLookups: Int {
+        trackMap.misses + artistMap.misses + albumMap.misses + directoryMap.misses
+    }
+    
+    // Objects referenced by the response, fetched in bulk before parsing, and any created during it.
+    // This avoids a single-row fetch for every element, which adds up quickly on large responses.
+    private let trackMap = SBIdentityMap<SBTrack>()
+    private let artistMap = SBIdentityMap<SBArtist>()
+    private let albumMap = SBIdentityMap<SBAlbum>()
+    private let directoryMap = SBIdentityMap<SBDirectory>()
+    
+    // When streaming, elements are queued up and handled a chunk at a time, so the chunk's objects can be prefetched,
+    // and the context saved and reset after it. This keeps memory flat regardless of how large the response is.
+    static let streamingChunkSize = 1000
+    
+    private enum PendingElement {
+        case start(name: String, attributes: [String: String])
+        case end(name: String)
+    }
+    private var pendingElements: [PendingElement] = []
+    private var chunksSaved = 0
+    
     init!(managedObjectContext mainContext: NSManagedObjectContext!,
           requestType: SBSubsonicRequestType,
           server: NSManagedObjectID,
           xml: Data?,
+          xmlStream: InputStream? = nil,
           mimeType: String?) {
         self.requestType = requestType
         self.xmlData = xml
+        self.xmlStream = xmlStream
         self.mimeType = mimeType
+        self.serverID = server
         
         super.init(managedObjectContext: mainContext, name: "Parsing Subsonic Request", author: "Request \(requestType)")
         self.server = threadedContext.object(with: server) as? SBServer
+        metrics.endpoint = requestType.name
+        if let xml = xml {
+            metrics.add(bytes: Int64(xml.count))
+        }
+        if xmlStream != nil {
+            // We refetch what we need after each chunk, holding onto everything defeats the point
+            self.threadedContext.retainsRegisteredObjects = false
+        }
     }
     
     // #MARK: - NSOperation
     
     override func main() {
-        synchronized(server) {
-            defer {
-                self.finish()
-                self.saveThreadedContext()
-            }
-            do {
-                if let mimeType = self.mimeType, mimeType.hasPrefix("image/") {
+        // Parsing is serialized per server by the scheduler, so there's no need to lock here
+        parseStartDate = Date()
+        defer {
+            // if we didn't read it all, this lets the request stop writing to it
+            self.xmlStream?.close()
+            // saved first, so the save counts towards this operation
+            self.saveThreadedContext()
+            self.finish()
+        }
+        do {
+            if let mimeType = self.mimeType, mimeType.hasPrefix("image/") {
+                try metrics.measure(.parse) {
                     try mainImportCover()
-                } else if let mimeType = self.mimeType, mimeType.contains("xml") {
-                    // Navidrome and Subsonic differ by using application/ or text/
-                    try mainXML()
-                } else if let mimeType = self.mimeType, mimeType.contains("json") {
-                    logger.error("Submariner doesn't support JSON")
                 }
-            } catch {
-                DispatchQueue.main.async {
-                    NSApplication.shared.presentError(error)
+            } else if let mimeType = self.mimeType, mimeType.contains("xml") {
+                // Navidrome and Subsonic differ by using application/ or text/
+                // Saves and notifications along the way count as their own phases
+                try metrics.measure(.parse) {
+                    try mainXML()
                 }
+            } else if let mimeType = self.mimeType, mimeType.contains("json") {
+                logger.error("Submariner doesn't support JSON")
+            }
+        } catch {
+            DispatchQueue.main.async {
+                NSApplication.shared.presentError(error)
             }
         }
     }
     
     // TODO: These should be factored out into separate classes
     private func mainImportCover() throws {
-        let coversDir = SBAppDelegate.coverDirectory.appendingPathComponent(server.resourceName!)
-        
-        if !FileManager.default.fileExists(atPath: coversDir.path) {
-            try FileManager.default.createDirectory(at: coversDir, withIntermediateDirectories: true)
-        }
-        
         if let currentCoverID = self.currentCoverID, let data = self.xmlData {
-            // we know mimeType is not null coming from main. worst case, ID3 covers are usually JPEG
-            let fileType = UTType(mimeType: self.mimeType!) ?? data.guessImageType() ?? UTType.jpeg
-            let fileName = coversDir.appendingPathComponent(currentCoverID, conformingTo: fileType)
-            try data.write(to: fileName, options: [.atomic])
-            logger.info("Wrote cover file \(fileName, privacy: .public)")
+            SBCoverCache.shared.invalidate(coverID: currentCoverID)
             
+            // nothing to keep the file around for if there's no cover
             if let cover = fetchCover(coverID: currentCoverID) {
+                // we know mimeType is not null coming from main. worst case, ID3 covers are usually JPEG
+                let fileType = UTType(mimeType: self.mimeType!) ?? data.guessImageType() ?? UTType.jpeg
+                // Covers with the same image (i.e. every track of an album on Navidrome) share a file
+                let stored = try SBCoverStore.shared.write(data, type: fileType)
                 // reset album in weird circumstance where it's not associated
                 if let currentAlbumID = self.currentAlbumID, let album = fetchAlbum(id: currentAlbumID) {
                     cover.album = album
                     album.cover = cover
                 }
-                cover.imagePath = fileName.lastPathComponent as NSString
-                logger.info("Set cover \(currentCoverID, privacy: .public) to file \(fileName, privacy: .public)")
+                cover.imagePath = nil
+                cover.file = SBCoverStore.shared.file(for: stored, in: threadedContext)
+                logger.info("Set cover \(currentCoverID, privacy: .public) to stored file \(stored.name, privacy: .public)")
             }
         }
         
@@ -134,10 +222,58 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     }
     
     private func mainXML() throws {
-        if let data = self.xmlData {
+        if let isStale = self.isStale, isStale() {
+            logger.info("Skipping stale response for \(String(describing: self.requestType), privacy: .public)")
+            return
+        }
+        if let stream = self.xmlStream {
+            let startDate = Date()
+            
+            let parser = XMLParser(stream: stream)
+            parser.delegate = self
+            parser.parse()
+            
+            let parseTime = Date().timeIntervalSince(startDate) * 1000
+            let peakResident = Measurement<UnitInformationStorage>(value: Double(peakResidentSize()), unit: .bytes).converted(to: .megabytes)
+            logger.info("Streamed response for \(String(describing: self.requestType), privacy: .public): parse and merge \(parseTime, format: .fixed(precision: 1)) ms over \(self.chunksSaved) saved chunks, peak resident size \(peakResident.value, format: .fixed(precision: 1)) MB")
+        } else if let data = self.xmlData {
+            let startDate = Date()
+            prefetchObjects(data: data)
+            let prefetchDate = Date()
+            
             let parser = XMLParser(data: data)
             parser.delegate = self
             parser.parse()
+            
+            let prefetchTime = prefetchDate.timeIntervalSince(startDate) * 1000
+            let parseTime = Date().timeIntervalSince(prefetchDate) * 1000
+            logger.info("Parsed \(data.count) bytes for \(String(describing: self.requestType), privacy: .public): prefetch \(prefetchTime, format: .fixed(precision: 1)) ms, parse and merge \(parseTime, format: .fixed(precision: 1)) ms, \(self.cachedLookups) cached lookups, \(self.fetchedLookups) fetched")
+        }
+    }
+    
+    /// Collects every ID the response refers to, then fetches the existing objects for them in a few batches.
+    private func prefetchObjects(data: Data) {
+        let collector = SBSubsonicIDCollector()
+        let parser = XMLParser(data: data)
+        parser.delegate = collector
+        parser.parse()
+        
+        prefetchObjects(collector: collector)
+    }
+    
+    private func prefetchObjects(collector: SBSubsonicIDCollector) {
+        do {
+            try trackMap.prefetch(ids: collector.trackIDs, in: threadedContext, entityName: "Track",
+                                  predicate: NSPredicate(format: "server == %@", server))
+            try artistMap.prefetch(ids: collector.artistIDs, in: threadedContext, entityName: "Artist",
+                                   predicate: NSPredicate(format: "server == %@", server))
+            try albumMap.prefetch(ids: collector.albumIDs, in: threadedContext, entityName: "Album",
+                                  predicate: NSPredicate(format: "server == %@", server))
+            try directoryMap.prefetch(ids: collector.directoryIDs, in: threadedContext, entityName: "Directory",
+                                      predicate: NSPredicate(format: "server == %@", server))
+        } catch {
+            // Not fatal, the lookups will just fall back to fetching individually.
+            logger.error("Failed to prefetch objects: \(error, privacy: .public)")
         }
     }
     
@@ -153,6 +289,9 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     private func parseElementError(attributeDict: [String: String]) {
         logger.error("Subsonic error element, code \(attributeDict["code"] ?? "unknown", privacy: .public), \(attributeDict["message"] ?? "", privacy: .public)")
         errored = true
+        let code = attributeDict["code"].flatMap { Int($0) } ?? 0
+        let message = attributeDict["message"] ?? "The server returned error \(code)."
+        responseError = NSError(domain: "SBSubsonicErrorDomain", code: code, userInfo: [NSLocalizedDescriptionKey: message])
         if attributeDict["code"] == "70" { // Not found
             // delete the object we're requesting since it doesn't exist
             // that, or we need to mark the feature as unsupported so we don't do it again
@@ -163,7 +302,11 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
                 return
             }
             
-            if let currentPlaylistID = self.currentPlaylistID {
+            if case .getCoverArt(id: let coverID, forAlbumId: _) = requestType {
+                // currentAlbumID is set for covers too, but it's the cover that's missing, not the album
+                SBCoverFetcher.shared.markMissing(coverID: coverID, server: serverID)
+                return
+            } else if let currentPlaylistID = self.currentPlaylistID {
                 logger.info("Didn't find playlist on server w/ ID of \(currentPlaylistID, privacy: .public)")
                 if let playlistToDelete = fetchPlaylist(id: currentPlaylistID) {
                     logger.info("Removing playlist that wasn't found on server w/ ID of \(currentPlaylistID, privacy: .public)")
@@ -174,6 +317,7 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
                 logger.info("Didn't find artist on server w/ ID of \(currentArtistID, privacy: .public)")
                 if let artistToDelete = fetchArtist(id: currentArtistID) {
                     logger.info("Removing artist that wasn't found on server w/ ID of \(currentArtistID, privacy: .public)")
+                    artistMap.remove(artistToDelete)
                     threadedContext.delete(artistToDelete)
                 }
                 return
@@ -181,6 +325,7 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
                 logger.info("Didn't find album on server w/ ID of \(currentAlbumID, privacy: .public)")
                 if let albumToDelete = fetchAlbum(id: currentAlbumID) {
                     logger.info("Removing album that wasn't found on server w/ ID of \(currentAlbumID, privacy: .public)")
+                    albumMap.remove(albumToDelete)
                     threadedContext.delete(albumToDelete)
                 }
                 return
@@ -191,10 +336,21 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     }
     
     private func parseElementIndexes(attributeDict: [String: String]) {
-        if let timestampString = attributeDict["timestamp"],
+        // lastModified is what the API documents (in ms), timestamp is from servers that predate it
+        if let lastModifiedString = attributeDict["lastModified"],
+           let lastModified = Double(lastModifiedString) {
+            indexModifiedDate = Date(timeIntervalSince1970: lastModified / 1000)
+        } else if let timestampString = attributeDict["timestamp"],
            let timestamp = Double(timestampString) {
-            let date = Date(timeIntervalSince1970: timestamp)
-            server.lastIndexesDate = date
+            indexModifiedDate = Date(timeIntervalSince1970: timestamp)
+        }
+        
+        // getIndexes takes ifModifiedSince and returns an empty index for this, getArtists needs us to check
+        if case .getArtists = requestType,
+           let indexModifiedDate = self.indexModifiedDate, let lastArtistsDate = server.lastArtistsDate,
+           abs(indexModifiedDate.timeIntervalSince(lastArtistsDate)) < 0.001 {
+            logger.info("Artists haven't changed since \(lastArtistsDate, privacy: .public), skipping merge")
+            unchangedSinceLastSync = true
         }
     }
     
@@ -255,18 +411,31 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         if let id = attributeDict["id"], let name = attributeDict["name"] {
             if let existingArtist = fetchArtist(id: id) {
                 artistsReturned.append(existingArtist)
-                updateArtist(existingArtist, attributes: attributeDict)
-                // as we don't do it in updateTrackDependencies
-                server.addToIndexes(existingArtist)
+                // Most artists won't have changed, and leaving them alone keeps them out of the save
+                if existingArtist.server != server || artistDiffers(existingArtist, attributes: attributeDict) {
+                    updateArtist(existingArtist, attributes: attributeDict)
+                    // as we don't do it in updateTrackDependencies
+                    server.addToIndexes(existingArtist)
+                    syncCounts.updated += 1
+                } else {
+                    syncCounts.unchanged += 1
+                }
+                updateAlbumCount(existingArtist, id: id, attributes: attributeDict)
             } else if let existingArtist = fetchArtist(name: name) {
                 artistsReturned.append(existingArtist)
                 updateArtist(existingArtist, attributes: attributeDict)
+                // the ID may have changed, so make sure later lookups by ID find it
+                artistMap.insert(existingArtist)
                 // as we don't do it in updateTrackDependencies
                 server.addToIndexes(existingArtist)
+                updateAlbumCount(existingArtist, id: id, attributes: attributeDict)
+                syncCounts.updated += 1
             } else {
                 logger.info("Creating new artist with ID: \(id, privacy: .public) and name \(name, privacy: .public)")
                 let artist = createArtist(attributes: attributeDict)
+                updateAlbumCount(artist, id: id, attributes: attributeDict)
                 artistsReturned.append(artist)
+                syncCounts.inserted += 1
             }
         }
     }
@@ -274,7 +443,7 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     private func parseElementAlbumList(attributeDict: [String: String]) {
         // Clear the ServerHome controller if we're not appending
         // Note that it's weird to append to it because albums is a Set, not an Array, so it has no ordering
-        if case .getAlbumList(type: _) = requestType {
+        if case .getAlbumList(type: _, count: _) = requestType {
             server.home?.albums = nil
         }
     }
@@ -301,10 +470,16 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
             
             var album = fetchAlbum(id: id, artist: artist)
             if let album = album {
-                updateAlbum(album, attributes: attributeDict)
+                if albumDiffers(album, attributes: attributeDict) {
+                    updateAlbum(album, attributes: attributeDict)
+                    syncCounts.updated += 1
+                } else {
+                    syncCounts.unchanged += 1
+                }
             } else {
                 logger.info("Creating new album with ID: \(id, privacy: .public) for artist ID \(artistId, privacy: .public)")
                 album = createAlbum(attributes: attributeDict)
+                syncCounts.inserted += 1
             }
             
             // for future song elements under this one
@@ -370,9 +545,11 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
             if let id = attributeDict["id"] {
                 currentPlaylist = fetchPlaylist(id: id)
             }
-            
-            // empty it out so we can update from server
-            currentPlaylist?.trackIDs = []
+            if let currentPlaylist = self.currentPlaylist {
+                updatePlaylist(currentPlaylist, attributes: attributeDict)
+            }
+            // the entries are updated from the tracks returned at the end
+            playlistTrackIDsReturned = []
         default:
             logger.warning("Invalid request type \(String(describing: self.requestType)) for playlist element")
         }
@@ -384,17 +561,14 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
                 logger.info("Adding track (and updating) with ID: \(id, privacy: .public) to playlist \(currentPlaylist.itemId ?? "(no ID?)", privacy: .public)")
                 
                 updateTrackDependenciesForTag(track, attributeDict: attributeDict, shouldFetchAlbumArt: false)
-                
-                currentPlaylist.add(track: track)
             } else {
                 // if the track doesn't exist yet, it'll be born without context. provide that context (artist/album/cover)
                 // FIXME: Should we update *existing* tracks regardless? For previous cases they were pulled anew...
                 logger.info("Creating new track with ID: \(id, privacy: .public) for playlist \(currentPlaylist.itemId ?? "(no ID?)", privacy: .public)")
                 let track = createTrack(attributes: attributeDict)
                 updateTrackDependenciesForTag(track, attributeDict: attributeDict, shouldFetchAlbumArt: false)
-                
-                currentPlaylist.add(track: track)
             }
+            playlistTrackIDsReturned.append(id)
         } else {
             logger.warning("No current playlist, even though we have an entry element?")
         }
@@ -409,25 +583,46 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
             return
         }
         
-        // XXX: really weird for more than track since we can't use the normal constuctors we have in the class
-        let nowPlaying = createNowPlaying(attributes: attributeDict)
-        var attachedTrack: SBTrack?
+        guard let id = attributeDict["id"] else {
+            return
+        }
+        var attachedTrack = fetchTrack(id: id)
+        if attachedTrack == nil {
+            logger.info("Creating track ID \(id, privacy: .public) for now playing entry")
+            attachedTrack = createTrack(attributes: attributeDict)
+        }
+        guard let track = attachedTrack else {
+            return
+        }
+        updateTrackDependenciesForTag(track, attributeDict: attributeDict)
         
-        if let id = attributeDict["id"] {
-            attachedTrack = fetchTrack(id: id)
-            if attachedTrack == nil {
-                logger.info("Creating track ID \(id, privacy: .public) for now playing entry")
-                attachedTrack = createTrack(attributes: attributeDict)
+        // Rows are kept between polls, so only what changed gets written and redrawn
+        let username = attributeDict["username"]
+        let existing = (server.nowPlayings as? Set<SBNowPlaying>)?.first { nowPlaying in
+            nowPlaying.username == username && nowPlaying.track == track && !nowPlayingReturned.contains(nowPlaying.objectID)
+        }
+        if let nowPlaying = existing {
+            nowPlayingReturned.insert(nowPlaying.objectID)
+            let minutesAgo = attributeDict["minutesAgo"].flatMap { Int($0) }
+            if nowPlaying.minutesAgo?.intValue != minutesAgo {
+                nowPlaying.minutesAgo = minutesAgo.map { NSNumber(value: $0) }
+                syncCounts.updated += 1
+            } else {
+                syncCounts.unchanged += 1
             }
+            return
         }
-        nowPlaying.track = attachedTrack
-        attachedTrack?.addToNowPlaying(nowPlaying)
         
-        updateTrackDependenciesForTag(attachedTrack!, attributeDict: attributeDict)
+        // XXX: really weird for more than track since we can't use the normal constuctors we have in the class
+        let nowPlaying = createNowPlaying(attributes: attributeDict)
+        nowPlaying.track = track
+        track.addToNowPlaying(nowPlaying)
         
         // do it here
         nowPlaying.server = server
         server.addToNowPlayings(nowPlaying)
+        nowPlayingReturned.insert(nowPlaying.objectID)
+        syncCounts.inserted += 1
     }
     
     private func parseElementEntry(attributeDict: [String: String]) {
@@ -451,13 +646,13 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
                 // but does mean we have to wait for it to show up in other contexts before we can fetch it
                 updateTrackDependenciesForTag(track, attributeDict: attributeDict, shouldFetchAlbumArt: false)
                 // objc version did some check in playlist, which didn't make sense
-                currentSearch.tracksToFetch.append(track.objectID)
+                searchTracksReturned.append(track)
                 tracksReturned.append(track)
             } else {
                 logger.info("Creating track ID \(id, privacy: .public) for search")
                 let track = createTrack(attributes: attributeDict)
                 updateTrackDependenciesForTag(track, attributeDict: attributeDict, shouldFetchAlbumArt: false)
-                currentSearch.tracksToFetch.append(track.objectID)
+                searchTracksReturned.append(track)
                 tracksReturned.append(track)
             }
         } else if let currentAlbum = self.currentAlbum, let id = attributeDict["id"], let name = attributeDict["title"] {
@@ -517,9 +712,11 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         if let scanningString = attributeDict["scanning"] {
             // The initial scan starts with false, it seems
             if scanningString == "true" || requestType == .scanLibrary {
+                scanning = true
                 // FIXME: include "count" and others in a message
                 postServerNotification(.SBSubsonicLibraryScanProgress)
             } else {
+                scanning = false
                 postServerNotification(.SBSubsonicLibraryScanDone)
             }
         }
@@ -553,10 +750,99 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         }
     }
     
+    // #MARK: - Streaming
+    
+    /// Handles the elements queued up so far with their objects prefetched, then saves them.
+    ///
+    /// If `resetting`, the context is reset afterwards to free the chunk's objects. Any state that refers to objects is
+    /// either kept as object IDs, or refetched after the reset.
+    private func flushPendingElements(resetting: Bool) {
+        let collector = SBSubsonicIDCollector()
+        for case .start(let name, let attributes) in pendingElements {
+            collector.collect(elementName: name, attributes: attributes)
+        }
+        prefetchObjects(collector: collector)
+        
+        for element in pendingElements {
+            switch element {
+            case .start(let name, let attributes):
+                handleStartElement(name, attributeDict: attributes)
+            case .end(let name):
+                handleEndElement(name)
+            }
+        }
+        pendingElements.removeAll()
+        
+        if resetting {
+            saveAndResetContext()
+        }
+    }
+    
+    private func saveAndResetContext() {
+        threadedContext.processPendingChanges()
+        // Temporary IDs won't mean anything after a reset, so get the real ones before we hold onto them
+        do {
+            try threadedContext.obtainPermanentIDs(for: Array(threadedContext.insertedObjects))
+        } catch {
+            logger.error("Failed to obtain permanent IDs for chunk: \(error, privacy: .public)")
+        }
+        
+        savedPlaylistIDs.formUnion(playlistsReturned.map { $0.objectID })
+        savedArtistIDs.formUnion(artistsReturned.map { $0.objectID })
+        savedAlbumIDs.formUnion(albumsReturned.map { $0.objectID })
+        savedTrackIDs.formUnion(tracksReturned.map { $0.objectID })
+        playlistsReturned.removeAll()
+        artistsReturned.removeAll()
+        albumsReturned.removeAll()
+        tracksReturned.removeAll()
+        
+        let currentPlaylistID = currentPlaylist?.objectID
+        let currentArtistID = currentArtist?.objectID
+        let currentAlbumID = currentAlbum?.objectID
+        let currentPodcastID = currentPodcast?.objectID
+        
+        saveThreadedContext()
+        threadedContext.reset()
+        chunksSaved += 1
+        
+        trackMap.removeAll()
+        artistMap.removeAll()
+        albumMap.removeAll()
+        directoryMap.removeAll()
+        
+        server = threadedContext.object(with: serverID) as? SBServer
+        currentPlaylist = currentPlaylistID.flatMap { threadedContext.object(with: $0) as? SBPlaylist }
+        currentArtist = currentArtistID.flatMap { threadedContext.object(with: $0) as? SBArtist }
+        currentAlbum = currentAlbumID.flatMap { threadedContext.object(with: $0) as? SBAlbum }
+        currentPodcast = currentPodcastID.flatMap { threadedContext.object(with: $0) as? SBPodcast }
+    }
+    
     // #MARK: - XML delegate
     
     func parser(_ parser: XMLParser, didStartElement elementName: String, namespaceURI: String?, qualifiedName qName: String?, attributes attributeDict: [String : String] = [:]) {
+        if xmlStream != nil {
+            pendingElements.append(.start(name: elementName, attributes: attributeDict))
+            if pendingElements.count >= SBSubsonicParsingOperation.streamingChunkSize {
+                flushPendingElements(resetting: true)
+            }
+        } else {
+            handleStartElement(elementName, attributeDict: attributeDict)
+        }
+    }
+    
+    func parser(_ parser: XMLParser, didEndElement elementName: String, namespaceURI: String?, qualifiedName qName: String?) {
+        if xmlStream != nil {
+            pendingElements.append(.end(name: elementName))
+        } else {
+            handleEndElement(elementName)
+        }
+    }
+    
+    private func handleStartElement(_ elementName: String, attributeDict: [String: String]) {
         logger.debug("Encountered XML element \(elementName, privacy: .public)")
+        if unchangedSinceLastSync {
+            return
+        }
         if elementName == "subsonic-response" {
             parseElementSubsonicResponse(attributeDict: attributeDict)
         } else if elementName == "error" {
@@ -617,12 +903,100 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         }
     }
     
-    func parser(_ parser: XMLParser, didEndElement elementName: String, namespaceURI: String?, qualifiedName qName: String?) {
+    private func handleEndElement(_ elementName: String) {
         if elementName == "podcast" {
             currentPodcast = nil
         }
     }
     
+    // #MARK: - Delta sync
+    
+    private func artistDiffers(_ artist: SBArtist, attributes: [String: String]) -> Bool {
+        return artist.itemName != attributes["name"]
+            || artist.itemId != attributes["id"]
+            || (attributes["sortName"] != nil && artist.sortName != attributes["sortName"])
+            || (attributes["musicBrainzId"] != nil && artist.musicBrainzId != attributes["musicBrainzId"])
+            || artist.starred != attributes["starred"]?.dateTimeFromISO()
+    }
+    
+    /// Keeps the album count the server reported, and for getArtists, notes the artists where it changed to refresh.
+    ///
+    /// The local albums can't be compared against, since they're only what's been browsed (or a search found), not
+    /// every album the artist has. The count only moves on once getArtist has fetched the albums, so an artist that
+    /// didn't get refreshed is tried again next sync.
+    private func updateAlbumCount(_ artist: SBArtist, id: String, attributes: [String: String]) {
+        guard let albumCountString = attributes["albumCount"], let albumCount = Int(albumCountString) else {
+            return
+        }
+        if case .getArtists = requestType, let previous = artist.albumCount?.intValue {
+            if previous != albumCount {
+                artistIDsToRefresh.insert(id)
+            }
+            return
+        }
+        // a first sync only records the counts, or it would refresh every artist
+        if artist.albumCount?.intValue != albumCount {
+            artist.albumCount = NSNumber(value: albumCount)
+        }
+    }
+    
+    private func albumDiffers(_ album: SBAlbum, attributes: [String: String]) -> Bool {
+        return (attributes["name"] != nil && album.itemName != attributes["name"])
+            || (attributes["year"] != nil && album.year?.stringValue != attributes["year"])
+            || (attributes["sortName"] != nil && album.sortName != attributes["sortName"])
+            || (attributes["musicBrainzId"] != nil && album.musicBrainzId != attributes["musicBrainzId"])
+            || (attributes["explicitStatus"] != nil && album.explicit != attributes["explicitStatus"])
+            || (attributes["playCount"] != nil && album.playCount?.stringValue != attributes["playCount"])
+            || album.played != attributes["played"]?.dateTimeFromISO()
+            || album.starred != attributes["starred"]?.dateTimeFromISO()
+    }
+    
+    /// Records how far the index has been synced, and logs what the sync did.
+    private func finishSync() {
+        switch requestType {
+        case .getArtists:
+            // Artists still to refresh are only found by merging, so the next sync can't skip that as unchanged until
+            // they've all been refreshed. Otherwise any past the limit would wait for the server to change again.
+            if let indexModifiedDate = self.indexModifiedDate, artistIDsToRefresh.isEmpty {
+                server.lastArtistsDate = indexModifiedDate
+            }
+        case .getDirectories:
+            if let indexModifiedDate = self.indexModifiedDate {
+                server.lastIndexesDate = indexModifiedDate
+            }
+        case .getArtist(_), .getAlbumList(_, _), .updateAlbumList(_, _, _), .getNowPlaying, .getPlaylist(_):
+            break
+        default:
+            return
+        }
+        
+        let duration = Date().timeIntervalSince(parseStartDate) * 1000
+        logger.info("Synced \(String(describing: self.requestType), privacy: .public) in \(duration, format: .fixed(precision: 1)) ms\(self.unchangedSinceLastSync ? " (unchanged)" : "", privacy: .public): \(self.syncCounts.inserted) new, \(self.syncCounts.updated) updated, \(self.syncCounts.unchanged) unchanged, \(self.syncCounts.removed) removed, \(self.artistIDsToRefresh.count) artists with changed albums")
+    }
+    
+    /// Refetches artists whose album counts changed, which getArtists itself doesn't tell us the details of.
+    private func refreshChangedArtists() {
+        guard !artistIDsToRefresh.isEmpty else {
+            return
+        }
+        // in a stable order, so each sync works through the next ones instead of picking at random
+        let toRefresh = artistIDsToRefresh.sorted().prefix(SBSubsonicParsingOperation.maxArtistRefreshes)
+        if artistIDsToRefresh.count > toRefresh.count {
+            logger.info("Only refreshing \(toRefresh.count) of \(self.artistIDsToRefresh.count) changed artists, the rest will be on the next sync")
+        }
+        // Make the requests from the main context, so they outlive this operation's
+        let serverID = self.serverID
+        mainContext.perform {
+            guard let server = self.mainContext.object(with: serverID) as? SBServer else {
+                return
+            }
+            for artistID in toRefresh {
+                let request = SBSubsonicRequestOperation(server: server, request: .getArtist(id: artistID))
+                SBServerScheduler.shared.add(request)
+            }
+        }
+    }
+    
     private func postServerNotification(_ notificationName: NSNotification.Name, userInfo: [AnyHashable: Any]? = nil) {
         NotificationCenter.default.post(name: notificationName, object: server.objectID, userInfo: userInfo)
     }
@@ -630,39 +1004,70 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     func parserDidEndDocument(_ parser: XMLParser) {
         logger.info("Finished XML processing")
         
+        if xmlStream != nil {
+            // the last chunk stays around, since the cleanup below needs it
+            flushPendingElements(resetting: false)
+        }
+        
+        let playlistIDsReturned = savedPlaylistIDs.union(playlistsReturned.map { $0.objectID })
+        let artistIDsReturned = savedArtistIDs.union(artistsReturned.map { $0.objectID })
+        let albumIDsReturned = savedAlbumIDs.union(albumsReturned.map { $0.objectID })
+        let trackIDsReturned = savedTrackIDs.union(tracksReturned.map { $0.objectID })
+        
         // Do some cleanup before we post notifications.
         switch requestType {
         case .getPlaylists:
             let playlistRequest: NSFetchRequest<SBPlaylist> = SBPlaylist.fetchRequest()
-            playlistRequest.predicate = NSPredicate(format: "(server == %@) && (NOT (self IN %@))", server, playlistsReturned)
+            playlistRequest.predicate = NSPredicate(format: "(server == %@) && (NOT (self IN %@))", server, Array(playlistIDsReturned))
             if let playlists = try? threadedContext.fetch(playlistRequest) {
                 for playlist in playlists {
                     logger.info("Removing artist not in list \(playlist.itemId ?? "<nil>", privacy: .public) name \(playlist.resourceName ?? "<nil>")")
                     threadedContext.delete(playlist)
                 }
             }
-        case .getArtists:
+        case .getArtists where !unchangedSinceLastSync:
             // purge artists not returned, since unlike getIndexes, getArtists returns the full list
             let artistRequest: NSFetchRequest<SBArtist> = SBArtist.fetchRequest()
-            artistRequest.predicate = NSPredicate(format: "(server == %@) && (NOT (self IN %@))", server, artistsReturned)
+            artistRequest.predicate = NSPredicate(format: "(server == %@) && (NOT (self IN %@))", server, Array(artistIDsReturned))
             if let artists = try? threadedContext.fetch(artistRequest) {
                 for artist in artists {
                     logger.info("Removing artist not in list \(artist.itemId ?? "<nil>", privacy: .public) name \(artist.itemName ?? "<nil>")")
                     threadedContext.delete(artist)
+                    syncCounts.removed += 1
                 }
             }
         case .getArtist(_):
             // purge albums not returned to deal with ID transition
             if let currentArtist = self.currentArtist, let albums = currentArtist.albums as? Set<SBAlbum> {
-                let difference = albums.subtracting(Set(albumsReturned))
+                let difference = albums.filter { !albumIDsReturned.contains($0.objectID) }
                 for album in difference {
                     currentArtist.removeFromAlbums(album)
                 }
             }
+        case .getPlaylist(_):
+            // only the entries that differ from what the server has are touched
+            if let currentPlaylist = self.currentPlaylist {
+                try? trackMap.prefetch(ids: Set(playlistTrackIDsReturned), in: threadedContext, entityName: "Track",
+                                       predicate: NSPredicate(format: "server == %@", server))
+                let tracks = playlistTrackIDsReturned.compactMap { fetchTrack(id: $0) }
+                let changes = currentPlaylist.update(tracks: tracks)
+                syncCounts.inserted += changes.inserted
+                syncCounts.removed += changes.removed
+                syncCounts.unchanged += tracks.count - changes.inserted
+                // the tracks are now as of when the server says it last changed
+                currentPlaylist.entriesChanged = currentPlaylist.serverChanged
+                currentPlaylist.entriesFetched = Date()
+            }
+        case .getNowPlaying:
+            // whoever stopped playing
+            for case let nowPlaying as SBNowPlaying in server.nowPlayings ?? [] where !nowPlayingReturned.contains(nowPlaying.objectID) {
+                threadedContext.delete(nowPlaying)
+                syncCounts.removed += 1
+            }
         case .getAlbum(id: _):
             // purge songs not returned
             if let currentAlbum = self.currentAlbum, let tracks = currentAlbum.tracks as? Set<SBTrack> {
-                let difference = tracks.subtracting(Set(tracksReturned))
+                let difference = tracks.filter { !trackIDsReturned.contains($0.objectID) }
                 for track in difference {
                     currentAlbum.removeFromTracks(track)
                 }
@@ -671,6 +1076,8 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
             break
         }
         
+        finishSync()
+        
         // We might have added/removed a bunch of items to the DB,
         // but if we post notifications before updating the DB,
         // we'll get weirdness in the UI. We'll save again at the
@@ -678,12 +1085,30 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         threadedContext.processPendingChanges()
         saveThreadedContext()
         
+        // A new track's ID is temporary until it's saved, and the main context could never resolve that one
+        if let currentSearch = self.currentSearch, !searchTracksReturned.isEmpty {
+            if searchTracksReturned.contains(where: { $0.objectID.isTemporaryID }) {
+                try? threadedContext.obtainPermanentIDs(for: searchTracksReturned.filter { $0.objectID.isTemporaryID })
+            }
+            currentSearch.tracksToFetch += searchTracksReturned.map { $0.objectID }
+            searchTracksReturned.removeAll()
+        }
+        
         // If we have covers to fetch, do it after updating the DB,
         // or we'll have issues with the path getting unset
         for (albumID, coverID) in coversToFetch {
             server.getCover(id: coverID, for: albumID)
         }
         
+        refreshChangedArtists()
+        
+        metrics.measure(.notify) {
+            postNotifications()
+        }
+    }
+    
+    /// Tells the UI what changed, once it's saved.
+    private func postNotifications() {
         switch requestType {
         case .ping where !errored:
             postServerNotification(.SBSubsonicConnectionSucceeded)
@@ -695,8 +1120,8 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
             postServerNotification(.SBSubsonicPlaylistsCreated)
         case .getNowPlaying:
             postServerNotification(.SBSubsonicNowPlayingUpdated)
-        case .search(_), .getTopTracks(artistName: _), .getSimilarTracks(artist: _), .updateSearch(existingResult: _), .getStarred:
-            NotificationCenter.default.post(name: .SBSubsonicSearchResultUpdated, object: currentSearch)
+        case .search(_, _), .getTopTracks(artistName: _), .getSimilarTracks(artist: _), .updateSearch(_, _), .getStarred:
+            NotificationCenter.default.post(name: .SBSubsonicSearchResultUpdated, object: currentSearch, userInfo: ["serverID": serverID])
         case .getPodcasts:
             postServerNotification(.SBSubsonicPodcastsUpdated)
         case .replacePlaylist(_, _):
@@ -707,8 +1132,19 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
             postServerNotification(.SBSubsonicIndexesUpdated)
         case .getArtist(_):
             postServerNotification(.SBSubsonicAlbumsUpdated)
-        case .getAlbumList(type: _), .updateAlbumList(type: _):
-            let userInfo = ["count": NSNumber(integerLiteral: albumsReturned.count)]
+        case .getAlbumList(type: _, count: _), .updateAlbumList(type: _, offset: _, count: _):
+            // so whoever's paging knows which page this was
+            var listType = SBAlbumListType.random
+            var offset = 0
+            if case .getAlbumList(type: let type, count: _) = requestType {
+                listType = type
+            } else if case .updateAlbumList(type: let type, offset: let pageOffset, count: _) = requestType {
+                listType = type
+                offset = pageOffset
+            }
+            let userInfo = ["count": NSNumber(integerLiteral: savedAlbumIDs.count + albumsReturned.count),
+                            "offset": NSNumber(integerLiteral: offset),
+                            "type": NSNumber(integerLiteral: listType.rawValue)]
             postServerNotification(.SBSubsonicAlbumsUpdated, userInfo: userInfo)
         case .getAlbum(_):
             postServerNotification(.SBSubsonicTracksUpdated)
@@ -719,6 +1155,9 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     
     func parser(_ parser: XMLParser, parseErrorOccurred parseError: Error) {
         logger.error("XML parsing error \(parseError, privacy: .public)")
+        if responseError == nil {
+            responseError = parseError
+        }
         DispatchQueue.main.async {
             NSApp.presentError(parseError)
         }
@@ -728,11 +1167,16 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     // TODO: These might make more sense on their Core Data classes.
     
     private func fetchDirectory(id: String) -> SBDirectory? {
+        if let candidates = directoryMap.candidates(for: id) {
+            return candidates.first
+        }
+        
         let fetchRequest = NSFetchRequest<SBDirectory>(entityName: "Directory")
         fetchRequest.predicate = NSPredicate(format: "(itemId == %@) && (server == %@)", id, server)
-        let results = try? threadedContext.fetch(fetchRequest)
+        let results = (try? threadedContext.fetch(fetchRequest)) ?? []
+        directoryMap.record(results, for: id)
         
-        return results?.first
+        return results.first
     }
     
     private func fetchGroup(groupName: String) -> SBGroup? {
@@ -744,11 +1188,16 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     }
     
     private func fetchArtist(id: String) -> SBArtist? {
+        if let candidates = artistMap.candidates(for: id) {
+            return candidates.first
+        }
+        
         let fetchRequest = NSFetchRequest<SBArtist>(entityName: "Artist")
         fetchRequest.predicate = NSPredicate(format: "(itemId == %@) && (server == %@)", id, server)
-        let results = try? threadedContext.fetch(fetchRequest)
+        let results = (try? threadedContext.fetch(fetchRequest)) ?? []
+        artistMap.record(results, for: id)
         
-        return results?.first
+        return results.first
     }
     
     private func fetchArtist(name: String) -> SBArtist? {
@@ -760,18 +1209,30 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     }
     
     private func fetchAlbum(id: String, artist: SBArtist? = nil) -> SBAlbum? {
+        if let candidates = albumMap.candidates(for: id) {
+            // Same conditions as the predicates below, but in memory.
+            let found = candidates.first { album in
+                return artist == nil || album.artist == artist
+            }
+            // One for another artist doesn't mean there isn't one for this artist, unless the store was asked
+            if found != nil || albumMap.isKnown(id) {
+                return found
+            }
+        }
+        
+        // Be careful to keep it with the same server; two Navidrome instances
+        // can have the same album ID for the same album. (server, itemId) is indexed.
         let fetchRequest = NSFetchRequest<SBAlbum>(entityName: "Album")
         if let artist = artist {
-            fetchRequest.predicate = NSPredicate(format: "(itemId == %@) && (artist == %@)", id, artist)
+            fetchRequest.predicate = NSPredicate(format: "(server == %@) && (itemId == %@) && (artist == %@)", server, id, artist)
         } else {
-            // Be careful to keep it with the same server; two Navidrome instances
-            // can have the same album ID for the same album.
-            // The second condition should be written as "ALL tracks.server == %@",
-            // but Core Data doesn't like that. See https://stackoverflow.com/a/47762233
-            // for the workaround used.
-            fetchRequest.predicate = NSPredicate(format: "(itemId == %@) && SUBQUERY(tracks, $X, $X.server == %@).@count == tracks.@count", id, server)
+            fetchRequest.predicate = NSPredicate(format: "(server == %@) && (itemId == %@)", server, id)
         }
         let results = try? threadedContext.fetch(fetchRequest)
+        // Only record the hit, since a miss here is specific to the artist.
+        if let album = results?.first {
+            albumMap.insert(album)
+        }
         
         return results?.first
     }
@@ -779,9 +1240,9 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
     private func fetchAlbum(name: String, artist: SBArtist? = nil) -> SBAlbum? {
         let fetchRequest = NSFetchRequest<SBAlbum>(entityName: "Album")
         if let artist = artist {
-            fetchRequest.predicate = NSPredicate(format: "(itemName == %@) && (artist == %@)", name, artist)
+            fetchRequest.predicate = NSPredicate(format: "(server == %@) && (itemName == %@) && (artist == %@)", server, name, artist)
         } else {
-            fetchRequest.predicate = NSPredicate(format: "(itemName == %@) && SUBQUERY(tracks, $X, $X.server == %@).@count == tracks.@count", name, server)
+            fetchRequest.predicate = NSPredicate(format: "(server == %@) && (itemName == %@)", server, name)
         }
         let results = try? threadedContext.fetch(fetchRequest)
         
@@ -797,16 +1258,17 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         return results?.first
     }
     
-    private func fetchTrack(id: String, album: SBAlbum? = nil) -> SBTrack? {
-        let fetchRequest = NSFetchRequest<SBTrack>(entityName: "Track")
-        if let album = album {
-            fetchRequest.predicate = NSPredicate(format: "(server == %@) && (itemId == %@) && (album == %@)", server, id, album)
-        } else {
-            fetchRequest.predicate = NSPredicate(format: "(server == %@) && (itemId == %@)", server, id)
+    private func fetchTrack(id: String) -> SBTrack? {
+        if let candidates = trackMap.candidates(for: id) {
+            return candidates.first
         }
-        let results = try? threadedContext.fetch(fetchRequest)
         
-        return results?.first
+        let fetchRequest = NSFetchRequest<SBTrack>(entityName: "Track")
+        fetchRequest.predicate = NSPredicate(format: "(server == %@) && (itemId == %@)", server, id)
+        let results = (try? threadedContext.fetch(fetchRequest)) ?? []
+        trackMap.record(results, for: id)
+        
+        return results.first
     }
     
     private func fetchPlaylist(id: String) -> SBPlaylist? {
@@ -892,6 +1354,7 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         artist.isLocal = false
         server.addToIndexes(artist)
         artist.server = server
+        artistMap.insert(artist)
         
         return artist
     }
@@ -933,6 +1396,9 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         // don't assume cover yet
         
         album.isLocal = false
+        album.server = server
+        server.addToAlbums(album)
+        albumMap.insert(album)
         
         return album
     }
@@ -1000,6 +1466,7 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         // would this mess up hierarchy? just filter on if parentDirectory == nil
         server.addToDirectories(directory)
         directory.isLocal = false
+        directoryMap.insert(directory)
         
         return directory
     }
@@ -1023,6 +1490,7 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
                 attachedArtist!.isLocal = false
                 attachedArtist!.server = server
                 server.addToIndexes(attachedArtist!)
+                artistMap.insert(attachedArtist!)
             }
         }
         
@@ -1037,6 +1505,9 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
                 attachedAlbum!.itemId = albumID
                 attachedAlbum!.itemName = albumName
                 attachedAlbum!.isLocal = false
+                attachedAlbum!.server = server
+                server.addToAlbums(attachedAlbum!)
+                albumMap.insert(attachedAlbum!)
                 if let attachedArtist = attachedArtist {
                     attachedAlbum?.artist = attachedArtist
                     attachedArtist.addToAlbums(attachedAlbum!)
@@ -1183,6 +1654,7 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         server.addToTracks(track)
         
         updateTrack(track, attributes: attributes)
+        trackMap.insert(track)
         
         return track
     }
@@ -1204,6 +1676,19 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         if let name = attributes["name"] {
             playlist.resourceName = name
         }
+        // what the cache compares against, only written when it changed so unchanged playlists aren't saved again
+        let changed = attributes["changed"]?.dateTimeFromISO()
+        if playlist.serverChanged != changed {
+            playlist.serverChanged = changed
+        }
+        let songCount = attributes["songCount"].flatMap { Int($0) }
+        if playlist.songCount?.intValue != songCount {
+            playlist.songCount = songCount.map { NSNumber(value: $0) }
+        }
+        let duration = attributes["duration"].flatMap { Int($0) }
+        if playlist.duration?.intValue != duration {
+            playlist.duration = duration.map { NSNumber(value: $0) }
+        }
     }
     
     private func createPlaylist(attributes: [String: String]) -> SBPlaylist {
@@ -1328,3 +1813,72 @@ class SBSubsonicParsingOperation: SBOperation, XMLParserDelegate {
         return episode
     }
 }
+
+/// Gathers the IDs of every object a response refers to, so they can be fetched in bulk before the real parse.
+///
+/// This errs on the side of collecting too much; an extra ID in a batched fetch is cheap, a missed one is just an individual fetch.
+fileprivate class SBSubsonicIDCollector: NSObject, XMLParserDelegate {
+    var trackIDs = Set<String>()
+    var artistIDs = Set<String>()
+    var albumIDs = Set<String>()
+    var directoryIDs = Set<String>()
+    
+    func parser(_ parser: XMLParser, didStartElement elementName: String, namespaceURI: String?, qualifiedName qName: String?, attributes attributeDict: [String : String] = [:]) {
+        collect(elementName: elementName, attributes: attributeDict)
+    }
+    
+    func collect(elementName: String, attributes attributeDict: [String: String]) {
+        switch elementName {
+        case "song", "entry", "child":
+            if let id = attributeDict["id"] {
+                if attributeDict["isDir"] == "true" {
+                    directoryIDs.insert(id)
+                } else {
+                    trackIDs.insert(id)
+                }
+            }
+        case "artist":
+            // could be either depending on if it's getIndexes or getArtists
+            if let id = attributeDict["id"] {
+                artistIDs.insert(id)
+                directoryIDs.insert(id)
+            }
+        case "album":
+            if let id = attributeDict["id"] {
+                albumIDs.insert(id)
+            }
+        case "directory":
+            if let id = attributeDict["id"] {
+                directoryIDs.insert(id)
+            }
+        case "episode":
+            if let streamID = attributeDict["streamId"] {
+                trackIDs.insert(streamID)
+            }
+        default:
+            break
+        }
+        
+        if let artistID = attributeDict["artistId"] {
+            artistIDs.insert(artistID)
+        }
+        if let albumID = attributeDict["albumId"] {
+            albumIDs.insert(albumID)
+        }
+        if let parentID = attributeDict["parent"] {
+            directoryIDs.insert(parentID)
+        }
+    }
+}
+
+/// The most memory the process has had resident at once, for comparing the effects of streaming.
+fileprivate func peakResidentSize() -> UInt64 {
+    var info = mach_task_basic_info()
+    var count = mach_msg_type_number_t(MemoryLayout<mach_task_basic_info>.size / MemoryLayout<natural_t>.size)
+    let result = withUnsafeMutablePointer(to: &info) {
+        $0.withMemoryRebound(to: integer_t.self, capacity: Int(count)) {
+            task_info(mach_task_self_, task_flavor_t(MACH_TASK_BASIC_INFO), $0, &count)
+        }
+    }
+    return result == KERN_SUCCESS ? info.resident_size_max : 0
+}
@@ -19,6 +19,12 @@ class SBSubsonicRequestOperation: SBOperation {
     var parameters: [URLQueryItem] = []
     let request: SBSubsonicRequestType
     var customization: ParsingCustomization? = nil
+    /// Callers that retry on their own (i.e. the outbox) turn this off, so the user isn't told about every attempt.
+    var presentsErrors = true
+    /// Called once with nil if the server took the request, or the error if it didn't, i.e. it couldn't be reached or
+    /// the response says it failed. For responses that get parsed, that's once the parser has checked the status. Not
+    /// called if it never ran, which `isAwaitingDelivery` tells after it finishes.
+    var deliveryHandler: ((Error?) -> Void)? = nil
     var endpoint: String! // XXX: Make into let
     // Note that POST method is supported by almost all servers, even Subsonic,
     // but OpenSubsonic API says to check for the extension first.
@@ -34,7 +40,10 @@ class SBSubsonicRequestOperation: SBOperation {
         super.init(managedObjectContext: server.managedObjectContext!, name: baseName)
         self.server = threadedContext.object(with: server.objectID) as? SBServer
         
-        buildUrl()
+        metrics.endpoint = request.name
+        metrics.measure(.build) {
+            buildUrl()
+        }
         
         DispatchQueue.main.async {
             self.name = "\(baseName): \(self.endpoint!)"
@@ -52,8 +61,7 @@ class SBSubsonicRequestOperation: SBOperation {
     }
     
     private func request(url: URL, type: SBSubsonicRequestType, customization: ParsingCustomization? = nil) {
-        let config = URLSessionConfiguration.default
-        let session = URLSession(configuration: config)
+        let session = SBServerSessionPool.shared.session(for: self.server.objectID)
         var request = URLRequest(url: url)
         if self.usesPost {
             request.httpMethod = "POST"
@@ -62,82 +70,33 @@ class SBSubsonicRequestOperation: SBOperation {
         }
         // No auth header needed since we just pass them over query string
         
-        let task = session.dataTask(with: request) { data, response, error in
-            if self.usesPost {
-                logger.info("Handling POST URL \(url, privacy: .public)")
-            } else {
-                // sensitive because &p= contains user password
-                logger.info("Handling URL \(url, privacy: .sensitive)")
-                logger.info("\tAPI endpoint \(url.path, privacy: .public)")
-            }
-            
-            defer { self.finish() }
-            
-            if let error = error {
-                DispatchQueue.main.async {
-                    NSApp.presentError(error)
-                }
-                return
-            } else if let response = response as? HTTPURLResponse {
-                logger.info("\tStatus code is \(response.statusCode)")
-                // Note that Subsonic and Navidrome return app-level error bodies in HTTP 200
-                switch (response.statusCode) {
-                case 404, 410, 501:
-                    // For unsupported features, it may vary. 404 is used for features that
-                    // seem unknown to the server in Subsonic and Navidrome. Navidrome at least
-                    // uses 501 for features that may be implemented in the future, and 410 for
-                    // features that will never be implemented. OwnCloud Music returns a 200 with
-                    // a code 70 Subsonic error instead, so we handle that in the response parser.
-                    self.server.markNotSupported(feature: type)
-                    return
-                case 429:
-                    // Newer versions of Navidrome back getCoverArt w/ third-party APIs.
-                    // As such, it rate limits API requests that can invoke them.
-                    // Instead of bothering the user, retry the request later.
-
-                    // Retry-After is seconds or a specific date
-                    let retryAfter = response.value(forHTTPHeaderField: "Retry-After")
-                    logger.info("Retrying w/ Retry-After value \(retryAfter ?? "<nil>")")
-
-                    if let retryAfter = retryAfter,
-                       let specificDate = retryAfter.dateTimeFromHTTP() {
-                        _ = Timer(fire: specificDate, interval: 0, repeats: false) { timer in
-                            self.request(url: url, type: type, customization: customization)
-                            timer.invalidate()
-                        }
-                    } else {
-                        // handle if Retry-After is valid, invalid, or missing
-                        let seconds = TimeInterval(retryAfter ?? "5") ?? 5
-                        _ = Timer(timeInterval: seconds, repeats: false) { timer in
-                            self.request(url: url, type: type, customization: customization)
-                            timer.invalidate()
-                        }
-                    }
-                    return
-                case 200: // OK, continue
-                    break
-                default:
-                    let message = "HTTP \(response.statusCode) for \(url.path)"
-                    let userInfo = [NSLocalizedDescriptionKey: message]
-                    // XXX: Right domain?
-                    let error = NSError(domain: NSURLErrorDomain, code: response.statusCode, userInfo: userInfo)
-                    DispatchQueue.main.async {
-                        NSApp.presentError(error)
-                    }
-                    return
-                }
+        let task: URLSessionDataTask
+        if type.prefersStreaming {
+            task = streamingTask(session: session, request: request, url: url, type: type, customization: customization)
+        } else {
+            task = session.dataTask(with: request) { data, response, error in
+                self.logRequest(url: url)
                 
-                if let operation = SBSubsonicParsingOperation(managedObjectContext: self.mainContext,
-                                                              requestType: type,
-                                                              server: self.server.objectID,
-                                                              xml: data,
-                                                              mimeType: response.mimeType) {
-                    if let customization = customization {
-                        customization(operation)
+                if let error = error {
+                    self.failed(error)
+                    self.finish()
+                    return
+                } else if let response = response as? HTTPURLResponse {
+                    switch self.disposition(for: response, url: url, type: type) {
+                    case .parse:
+                        self.parse(response: response, type: type, customization: customization, data: data, stream: nil)
+                    case .done:
+                        self.delivered()
+                    case .failed(let error):
+                        self.failed(error)
+                    case .retry(after: let delay):
+                        self.retry(after: delay, url: url, type: type, customization: customization)
+                        return
                     }
-                    OperationQueue.sharedServerQueue.addOperation(operation)
                 }
+                self.finish()
             }
+            task.delegate = SBTaskMetricsCollector(metrics: metrics)
         }
         progressObserver = task.progress.observe(\.fractionCompleted, changeHandler: { progress, change in
             DispatchQueue.main.async {
@@ -147,7 +106,204 @@ class SBSubsonicRequestOperation: SBOperation {
         task.resume()
     }
     
+    /// Makes a task that hands the body to the parser as it arrives, instead of buffering all of it first.
+    ///
+    /// This operation finishes once the response headers arrive, so it doesn't hold a network slot while the parser
+    /// works through the body at its own pace.
+    private func streamingTask(session: URLSession, request: URLRequest, url: URL, type: SBSubsonicRequestType, customization: ParsingCustomization?) -> URLSessionDataTask {
+        let streamingResponse = SBSubsonicStreamingResponse()
+        streamingResponse.onResponse = { response, stream in
+            self.logRequest(url: url)
+            
+            guard let response = response as? HTTPURLResponse else {
+                self.finish()
+                return false
+            }
+            switch self.disposition(for: response, url: url, type: type) {
+            case .parse:
+                let parsing = self.parse(response: response, type: type, customization: customization, data: nil, stream: stream)
+                self.finish()
+                return parsing
+            case .done:
+                self.delivered()
+                self.finish()
+                return false
+            case .failed(let error):
+                self.failed(error)
+                self.finish()
+                return false
+            case .retry(after: let delay):
+                self.retry(after: delay, url: url, type: type, customization: customization)
+                return false
+            }
+        }
+        streamingResponse.onComplete = { error, responded in
+            // Cancellation is us giving up on the response, i.e. the parser stopped reading
+            if let error = error, (error as? URLError)?.code != .cancelled {
+                self.failed(error)
+            }
+            if !responded {
+                self.logRequest(url: url)
+                self.finish()
+            }
+        }
+        
+        streamingResponse.metrics = metrics
+        let task = session.dataTask(with: request)
+        task.delegate = streamingResponse
+        return task
+    }
+    
+    private func logRequest(url: URL) {
+        if self.usesPost {
+            logger.info("Handling POST URL \(url, privacy: .public)")
+        } else {
+            // sensitive because &p= contains user password
+            logger.info("Handling URL \(url, privacy: .sensitive)")
+            logger.info("\tAPI endpoint \(url.path, privacy: .public)")
+        }
+    }
+    
+    private enum ResponseDisposition {
+        case parse
+        case done
+        case failed(Error)
+        case retry(after: TimeInterval)
+    }
+    
+    /// If the delivery handler hasn't been called and won't be, i.e. it was cancelled before it was sent.
+    var isAwaitingDelivery: Bool {
+        deliveryHandler != nil
+    }
+    
+    private func delivered() {
+        let deliveryHandler = self.deliveryHandler
+        self.deliveryHandler = nil
+        deliveryHandler?(nil)
+    }
+    
+    private func failed(_ error: Error, presenting: Bool = true) {
+        if presenting && presentsErrors {
+            DispatchQueue.main.async {
+                NSApp.presentError(error)
+            }
+        }
+        let deliveryHandler = self.deliveryHandler
+        self.deliveryHandler = nil
+        deliveryHandler?(error)
+    }
+    
+    // Give up on being rate limited eventually, instead of holding a slot in the queue forever
+    static let maxRetries = 5
+    private var retries = 0
+    
+    /// Handles the status code, returning what to do with the body.
+    private func disposition(for response: HTTPURLResponse, url: URL, type: SBSubsonicRequestType) -> ResponseDisposition {
+        logger.info("\tStatus code is \(response.statusCode)")
+        // Note that Subsonic and Navidrome return app-level error bodies in HTTP 200
+        switch (response.statusCode) {
+        case 404, 410:
+            if case .getCoverArt(id: let id, forAlbumId: _) = type {
+                // Every server has the endpoint, so it's the cover that doesn't exist. It's not worth bugging the user.
+                SBCoverFetcher.shared.markMissing(coverID: id, server: self.server.objectID)
+                return .done
+            }
+            fallthrough
+        case 501:
+            // For unsupported features, it may vary. 404 is used for features that
+            // seem unknown to the server in Subsonic and Navidrome. Navidrome at least
+            // uses 501 for features that may be implemented in the future, and 410 for
+            // features that will never be implemented. OwnCloud Music returns a 200 with
+            // a code 70 Subsonic error instead, so we handle that in the response parser.
+            self.server.markNotSupported(feature: type)
+            return .done
+        case 429:
+            // Newer versions of Navidrome back getCoverArt w/ third-party APIs.
+            // As such, it rate limits API requests that can invoke them.
+            // Instead of bothering the user, retry the request later.
+
+            // Retry-After is seconds or a specific date
+            let retryAfter = response.value(forHTTPHeaderField: "Retry-After")
+            logger.info("Retrying w/ Retry-After value \(retryAfter ?? "<nil>")")
+
+            let delay: TimeInterval
+            if let retryAfter = retryAfter,
+               let specificDate = retryAfter.dateTimeFromHTTP() {
+                delay = max(0, specificDate.timeIntervalSinceNow)
+            } else {
+                // handle if Retry-After is valid, invalid, or missing
+                delay = TimeInterval(retryAfter ?? "5") ?? 5
+            }
+            // Other cover fetches would just get rate limited too
+            SBCoverFetcher.shared.rateLimited(server: self.server.objectID, until: Date(timeIntervalSinceNow: delay))
+            
+            if retries >= SBSubsonicRequestOperation.maxRetries {
+                logger.error("Giving up on \(url.path, privacy: .public) after \(self.retries) retries")
+                // Not worth telling the user, but whoever retries on their own should try again later
+                failed(URLError(.timedOut), presenting: false)
+                return .done
+            }
+            retries += 1
+            return .retry(after: delay)
+        case 200: // OK, continue
+            return .parse
+        default:
+            let message = "HTTP \(response.statusCode) for \(url.path)"
+            let userInfo = [NSLocalizedDescriptionKey: message]
+            // XXX: Right domain?
+            let error = NSError(domain: NSURLErrorDomain, code: response.statusCode, userInfo: userInfo)
+            return .failed(error)
+        }
+    }
+    
+    /// Sends the request again later. The operation keeps running until then, so it holds its place in the queue.
+    private func retry(after delay: TimeInterval, url: URL, type: SBSubsonicRequestType, customization: ParsingCustomization?) {
+        logger.info("Retrying \(url.path, privacy: .public) in \(delay, format: .fixed(precision: 1)) seconds")
+        DispatchQueue.global(qos: .utility).asyncAfter(deadline: .now() + delay) {
+            self.request(url: url, type: type, customization: customization)
+        }
+    }
+    
+    /// Hands the response to a parsing operation, returning if it did.
+    @discardableResult private func parse(response: HTTPURLResponse, type: SBSubsonicRequestType, customization: ParsingCustomization?, data: Data?, stream: InputStream?) -> Bool {
+        // whoever asked doesn't want it anymore
+        if isCancelled {
+            logger.info("Not parsing cancelled request \(String(describing: type), privacy: .public)")
+            // the server got it, even if nobody's going to look at what it said
+            delivered()
+            return false
+        }
+        if let operation = SBSubsonicParsingOperation(managedObjectContext: self.mainContext,
+                                                      requestType: type,
+                                                      server: self.server.objectID,
+                                                      xml: data,
+                                                      xmlStream: stream,
+                                                      mimeType: response.mimeType) {
+            if let customization = customization {
+                customization(operation)
+            }
+            // Subsonic errors come with HTTP 200, so it's only delivered if the parser didn't find one
+            if let deliveryHandler = self.deliveryHandler {
+                self.deliveryHandler = nil
+                let completion = operation.completionBlock
+                operation.completionBlock = { [weak operation] in
+                    completion?()
+                    deliveryHandler(operation?.responseError)
+                }
+            }
+            SBServerScheduler.shared.add(operation)
+            return true
+        }
+        delivered()
+        return false
+    }
+    
     override func main() {
+        if let enqueuedDate = self.enqueuedDate {
+            let waited = Date().timeIntervalSince(enqueuedDate) * 1000
+            logger.debug("Request \(String(describing: self.request), privacy: .public) waited \(waited, format: .fixed(precision: 1)) ms to start")
+        }
+        
         let queryParameters = self.usesPost ? [] : self.parameters
         guard let baseUrl = server.url else {
             logger.error("Base server URL was nil for request \(String(describing: self.request)), the server URL likely needs to be reset")
@@ -180,14 +336,15 @@ class SBSubsonicRequestOperation: SBOperation {
             }
         case .getPlaylists:
             endpoint = "getPlaylists"
-        case .getAlbumList(type: let type):
+        case .getAlbumList(type: let type, count: let count):
             parameters["type"] = type.subsonicParameter()
-            parameters["count"] = String(10)
+            parameters["count"] = String(count)
             endpoint = "getAlbumList2"
-        case .updateAlbumList(type: let type):
+        case .updateAlbumList(type: let type, offset: let offset, count: let count):
             parameters["type"] = type.subsonicParameter()
-            parameters["count"] = String(10)
-            parameters["offset"] = String(server.home?.albums?.count ?? 0)
+            parameters["count"] = String(count)
+            // more than one page can be out at once, so the offset can't come from what's been saved
+            parameters["offset"] = String(offset)
             endpoint = "getAlbumList2"
         case .getPlaylist(id: let id):
             parameters["id"] = id
@@ -201,18 +358,18 @@ class SBSubsonicRequestOperation: SBOperation {
             customization = { operation in
                 operation.currentPlaylistID = id
             }
-        case .createPlaylist(name: let name, tracks: let tracks):
+        case .createPlaylist(name: let name, trackIDs: let trackIDs):
             parameters["name"] = name
             
             // XXX: DRY this with update
-            parameters += tracks.map { track in URLQueryItem(name: "songId", value: track.itemId) }
+            parameters += trackIDs.map { trackID in URLQueryItem(name: "songId", value: trackID) }
             
             endpoint = "createPlaylist"
         case .getNowPlaying:
             endpoint = "getNowPlaying"
-        case .search(query: let query):
+        case .search(query: let query, count: let count):
             parameters["query"] = query
-            parameters["songCount"] = "100" // XXX: Configurable?
+            parameters["songCount"] = String(count)
             // We don't yet surface albums/artists, so this is just merely noise
             parameters["albumCount"] = "0"
             parameters["artistCount"] = "0"
@@ -220,11 +377,11 @@ class SBSubsonicRequestOperation: SBOperation {
             customization = { operation in
                 operation.currentSearch = SBSearchResult(query: .search(query: query))
             }
-        case .updateSearch(existingResult: let existingResult):
+        case .updateSearch(existingResult: let existingResult, count: let count):
             switch existingResult.query {
             case .search(let query):
                 parameters["query"] = query
-                parameters["songCount"] = "100"
+                parameters["songCount"] = String(count)
                 parameters["songOffset"] = String(existingResult.tracks.count)
                 parameters["albumCount"] = "0"
                 parameters["artistCount"] = "0"
@@ -242,19 +399,19 @@ class SBSubsonicRequestOperation: SBOperation {
             endpoint = "setRating"
         case .getPodcasts:
             endpoint = "getPodcasts"
-        case .scrobble(id: let id):
-            parameters["id"] = id
-            let currentTimeMS = Int64(Date().timeIntervalSince1970 * 1000)
-            parameters["time"] = String(currentTimeMS)
+        case .scrobble(ids: let ids, times: let times):
+            // Each play has its own time, since they can be sent long after they happened
+            parameters += ids.map { id in URLQueryItem(name: "id", value: id) }
+            parameters += times.map { time in URLQueryItem(name: "time", value: String(Int64(time.timeIntervalSince1970 * 1000))) }
             endpoint = "scrobble"
         case .scanLibrary:
             endpoint = "startScan"
         case .getScanStatus:
             endpoint = "getScanStatus"
-        case .replacePlaylist(id: let id, tracks: let tracks):
+        case .replacePlaylist(id: let id, trackIDs: let trackIDs):
             parameters["playlistId"] = id
             
-            parameters += tracks.map { track in URLQueryItem(name: "songId", value: track.itemId) }
+            parameters += trackIDs.map { trackID in URLQueryItem(name: "songId", value: trackID) }
             
             endpoint = "createPlaylist"
             customization = { operation in
@@ -272,7 +429,7 @@ class SBSubsonicRequestOperation: SBOperation {
                 parameters["public"] = "\(isPublic)"
             }
             
-            parameters += appending?.map { track in URLQueryItem(name: "songIdToAdd", value: track.itemId) } ?? []
+            parameters += appending?.map { trackID in URLQueryItem(name: "songIdToAdd", value: trackID) } ?? []
             parameters += removing?.map { index in URLQueryItem(name: "songIndexToRemove", value: "\(index)") } ?? []
             
             endpoint = "updatePlaylist"
@@ -297,22 +454,23 @@ class SBSubsonicRequestOperation: SBOperation {
             parameters["id"] = id
             endpoint = "getSong"
         case .getDirectories:
-            // XXX: there is a lastIndexDate param but since the changeover to ID3 tag primary, that's not relevant anymore
+            // The server returns an empty index if nothing changed since then, which saves both sides a lot of work
+            if let lastIndexesDate = server.lastIndexesDate {
+                parameters["ifModifiedSince"] = String(Int64(lastIndexesDate.timeIntervalSince1970 * 1000))
+            }
             endpoint = "getIndexes"
         case .getDirectory(id: let id):
             parameters["id"] = id
             endpoint = "getMusicDirectory"
-        case .star(tracks: let tracks, albums: let albums, artists: let artists, directories: let directories):
-            parameters += tracks.map { track in URLQueryItem(name: "id", value: track.itemId) }
-            parameters += directories.map { track in URLQueryItem(name: "id", value: track.itemId) }
-            parameters += albums.map { album in URLQueryItem(name: "albumId", value: album.itemId) }
-            parameters += artists.map { artist in URLQueryItem(name: "artistId", value: artist.itemId) }
+        case .star(ids: let ids, albumIDs: let albumIDs, artistIDs: let artistIDs):
+            parameters += ids.map { id in URLQueryItem(name: "id", value: id) }
+            parameters += albumIDs.map { albumID in URLQueryItem(name: "albumId", value: albumID) }
+            parameters += artistIDs.map { artistID in URLQueryItem(name: "artistId", value: artistID) }
             endpoint = "star"
-        case .unstar(tracks: let tracks, albums: let albums, artists: let artists, directories: let directories):
-            parameters += tracks.map { track in URLQueryItem(name: "id", value: track.itemId) }
-            parameters += directories.map { track in URLQueryItem(name: "id", value: track.itemId) }
-            parameters += albums.map { album in URLQueryItem(name: "albumId", value: album.itemId) }
-            parameters += artists.map { artist in URLQueryItem(name: "artistId", value: artist.itemId) }
+        case .unstar(ids: let ids, albumIDs: let albumIDs, artistIDs: let artistIDs):
+            parameters += ids.map { id in URLQueryItem(name: "id", value: id) }
+            parameters += albumIDs.map { albumID in URLQueryItem(name: "albumId", value: albumID) }
+            parameters += artistIDs.map { artistID in URLQueryItem(name: "artistId", value: artistID) }
             endpoint = "unstar"
         case .getTopTracks(let artistName):
             parameters["artist"] = artistName
@@ -334,3 +492,145 @@ class SBSubsonicRequestOperation: SBOperation {
         }
     }
 }
+
+// #MARK: - Streaming
+
+/// Feeds a response body into a bound stream pair as it arrives, so the parser can read it without it all being in memory.
+///
+/// Writes into the stream block until the parser has read enough to make room, and the parser might not have started
+/// yet, i.e. if it's waiting for another response from the same server to be parsed. Every task for a server shares
+/// the session's delegate queue, so writes happen on a queue of their own, and what arrives while they're blocked waits
+/// in memory. Blocking the delegate queue would hold up every other request for the server, including the one being
+/// parsed, which would never finish.
+class SBSubsonicStreamingResponse: NSObject, URLSessionDataDelegate {
+    static let bufferSize = 64 * 1024
+    /// How much can arrive ahead of the parser before the task is suspended, and how far it has to catch up before it
+    /// resumes. Without this, a fast server and a slow parse would hold the rest of the response in memory.
+    static let highWaterMark = 16 * bufferSize
+    static let lowWaterMark = 4 * bufferSize
+    
+    // only this touches the output stream once the response arrives
+    private let writeQueue = DispatchQueue(label: "SBSubsonicStreamingResponse", qos: .utility)
+    
+    private let pendingLock = NSLock()
+    private var pendingBytes = 0
+    private var suspended = false
+    /// The most that was waiting to be written at once, and how many times the task was suspended for it.
+    private(set) var peakPendingBytes = 0
+    private(set) var suspensions = 0
+    
+    /// Called with the response and the stream the body will be written to. Return false to cancel the request.
+    var onResponse: ((URLResponse, InputStream) -> Bool)?
+    /// Called when the request is done. The second parameter is if `onResponse` was called.
+    var onComplete: ((Error?, Bool) -> Void)?
+    
+    /// Gets the timings for the request once it's done.
+    var metrics: SBOperationMetrics?
+    
+    private var outputStream: OutputStream?
+    private var responded = false
+    
+    func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive response: URLResponse, completionHandler: @escaping (URLSession.ResponseDisposition) -> Void) {
+        var inputStream: InputStream?
+        var outputStream: OutputStream?
+        Stream.getBoundStreams(withBufferSize: SBSubsonicStreamingResponse.bufferSize, inputStream: &inputStream, outputStream: &outputStream)
+        guard let inputStream = inputStream, let outputStream = outputStream else {
+            completionHandler(.cancel)
+            return
+        }
+        
+        outputStream.open()
+        responded = true
+        if onResponse?(response, inputStream) == true {
+            self.outputStream = outputStream
+            completionHandler(.allow)
+        } else {
+            outputStream.close()
+            completionHandler(.cancel)
+        }
+    }
+    
+    func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive data: Data) {
+        pendingLock.lock()
+        pendingBytes += data.count
+        peakPendingBytes = max(peakPendingBytes, pendingBytes)
+        if !suspended && pendingBytes > SBSubsonicStreamingResponse.highWaterMark {
+            suspended = true
+            suspensions += 1
+            dataTask.suspend()
+        }
+        pendingLock.unlock()
+        
+        writeQueue.async {
+            self.write(data, dataTask: dataTask)
+            self.written(data.count, dataTask: dataTask)
+        }
+    }
+    
+    // on the write queue
+    private func written(_ count: Int, dataTask: URLSessionDataTask) {
+        pendingLock.lock()
+        pendingBytes -= count
+        if suspended && pendingBytes <= SBSubsonicStreamingResponse.lowWaterMark {
+            suspended = false
+            dataTask.resume()
+        }
+        pendingLock.unlock()
+    }
+    
+    // on the write queue
+    private func write(_ data: Data, dataTask: URLSessionDataTask) {
+        guard let outputStream = self.outputStream else {
+            return
+        }
+        let failed = data.withUnsafeBytes { (buffer: UnsafeRawBufferPointer) -> Bool in
+            guard let baseAddress = buffer.bindMemory(to: UInt8.self).baseAddress else {
+                return false
+            }
+            var offset = 0
+            while offset < buffer.count {
+                let written = outputStream.write(baseAddress.advanced(by: offset), maxLength: buffer.count - offset)
+                if written <= 0 {
+                    return true
+                }
+                offset += written
+            }
+            return false
+        }
+        if failed {
+            // The reading end is closed, so nobody wants the rest
+            outputStream.close()
+            self.outputStream = nil
+            dataTask.cancel()
+        }
+    }
+    
+    func urlSession(_ session: URLSession, task: URLSessionTask, didFinishCollecting taskMetrics: URLSessionTaskMetrics) {
+        metrics?.add(taskMetrics: taskMetrics)
+    }
+    
+    func urlSession(_ session: URLSession, task: URLSessionTask, didCompleteWithError error: Error?) {
+        // Closing marks the end of the document for the parser. If the request failed partway, the parser will fail on
+        // the truncated document and won't get to the cleanup that would delete what wasn't returned.
+        let responded = self.responded
+        writeQueue.async {
+            // after everything that arrived is written
+            self.outputStream?.close()
+            self.outputStream = nil
+            self.onComplete?(error, responded)
+        }
+    }
+}
+
+/// Passes a task's timings on to the operation that made it, for tasks whose body is handled by a completion handler.
+fileprivate class SBTaskMetricsCollector: NSObject, URLSessionTaskDelegate {
+    let metrics: SBOperationMetrics
+    
+    init(metrics: SBOperationMetrics) {
+        self.metrics = metrics
+    }
+    
+    func urlSession(_ session: URLSession, task: URLSessionTask, didFinishCollecting taskMetrics: URLSessionTaskMetrics) {
+        metrics.add(taskMetrics: taskMetrics)
+    }
+}
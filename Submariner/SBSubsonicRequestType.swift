@@ -16,32 +16,52 @@ enum SBSubsonicRequestType: Equatable {
     case getLicense
     case getCoverArt(id: String, forAlbumId: String?)
     case getPlaylists
-    case getAlbumList(type: SBAlbumListType)
-    case updateAlbumList(type: SBAlbumListType)
+    case getAlbumList(type: SBAlbumListType, count: Int)
+    case updateAlbumList(type: SBAlbumListType, offset: Int, count: Int)
     case getPlaylist(id: String)
     case deletePlaylist(id: String)
-    case createPlaylist(name: String, tracks: [SBTrack])
+    case createPlaylist(name: String, trackIDs: [String])
     case getNowPlaying
-    case search(query: String)
-    case updateSearch(existingResult: SBSearchResult)
+    case search(query: String, count: Int)
+    case updateSearch(existingResult: SBSearchResult, count: Int)
     case setRating(id: String, rating: Int)
     case getPodcasts
-    case scrobble(id: String)
+    case scrobble(ids: [String], times: [Date])
     case scanLibrary
     case getScanStatus
-    case replacePlaylist(id: String, tracks: [SBTrack])
-    case updatePlaylist(id: String, name: String?, comment: String?, isPublic: Bool?, appending: [SBTrack]?, removing: [Int]?)
+    case replacePlaylist(id: String, trackIDs: [String])
+    case updatePlaylist(id: String, name: String?, comment: String?, isPublic: Bool?, appending: [String]?, removing: [Int]?)
     case getArtists
     case getArtist(id: String)
     case getAlbum(id: String)
     case getTrack(id: String)
     case getDirectories
     case getDirectory(id: String)
-    case star(tracks: [SBTrack], albums: [SBAlbum], artists: [SBArtist], directories: [SBDirectory])
-    case unstar(tracks: [SBTrack], albums: [SBAlbum], artists: [SBArtist], directories: [SBDirectory])
+    /// IDs are tracks and directories, which are starred the same way.
+    case star(ids: [String], albumIDs: [String], artistIDs: [String])
+    case unstar(ids: [String], albumIDs: [String], artistIDs: [String])
     case getTopTracks(artistName: String)
     case getSimilarTracks(artist: SBArtist)
     case getStarred
+    
+    /// The name of the request without its parameters, for grouping requests of the same kind.
+    var name: String {
+        let description = String(describing: self)
+        return String(description.prefix { $0 != "(" })
+    }
+    
+    /// If the response can be big enough that it should be parsed as it arrives, instead of buffered in memory first.
+    ///
+    /// Responses that other state refers to by temporary object ID (i.e. search results) can't be streamed, since
+    /// streaming saves in chunks and resets the context between them.
+    var prefersStreaming: Bool {
+        switch self {
+        case .getArtists, .getDirectories, .getPlaylists, .getPlaylist(_):
+            return true
+        default:
+            return false
+        }
+    }
 }
 
 // TODO: Convert SBServerHomeController to Swift so we can have associated data for genre/year
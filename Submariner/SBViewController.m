@@ -219,7 +219,7 @@
                                                initWithManagedObjectContext: self.managedObjectContext
                                                trackID: [track objectID]];
             
-            [[NSOperationQueue sharedDownloadQueue] addOperation:op];
+            [[SBDownloadManager shared] addOperation:op];
         }
     }
 }
@@ -240,7 +240,7 @@
                                                initWithManagedObjectContext: self.managedObjectContext
                                                trackID: [track objectID]];
             
-            [[NSOperationQueue sharedDownloadQueue] addOperation:op];
+            [[SBDownloadManager shared] addOperation:op];
         }
     }
 }
@@ -390,7 +390,7 @@
                                            initWithManagedObjectContext:self.managedObjectContext
                                            trackID: [track objectID]];
         
-        [[NSOperationQueue sharedDownloadQueue] addOperation:op];
+        [[SBDownloadManager shared] addOperation:op];
         downloaded++;
     }
     if (databaseController != nil && downloaded > 0) {
@@ -54,4 +54,23 @@ extension UserDefaults {
     @objc dynamic var playRate: NSNumber {
         return NSNumber(value: float(forKey: "playRate"))
     }
+    
+    @objc dynamic var maxConcurrentServerRequests: Int {
+        return integer(forKey: "maxConcurrentServerRequests")
+    }
+    
+    /// How many tracks to download at once from each server.
+    @objc dynamic var maxConcurrentDownloads: Int {
+        return integer(forKey: "maxConcurrentDownloads")
+    }
+    
+    /// If timings for each operation are written to a log file, for collecting later.
+    @objc dynamic var recordOperationTelemetry: Bool {
+        return bool(forKey: "recordOperationTelemetry")
+    }
+    
+    /// The most bytes downloaded tracks can use, or 0 for no limit.
+    @objc dynamic var offlineCacheLimit: Int64 {
+        return (object(forKey: "offlineCacheLimit") as? NSNumber)?.int64Value ?? 0
+    }
 }
@@ -0,0 +1,138 @@
+//
+//  SBAlbumListPagerTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Pages the album list from a stand-in server that takes a while to answer, and counts what it was asked for.
+final class SBAlbumListPagerTests: XCTestCase {
+    static let albumCount = 1000
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+
+    private let lock = NSLock()
+    // offset and count of each page asked for, by list type
+    private var pagesRequested: [String: [(offset: Int, count: Int)]] = [:]
+    // offset and count of each page parsed, by list type
+    private var pagesLoaded: [Int: [(offset: Int, count: Int)]] = [:]
+    private var observer: NSObjectProtocol?
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("getAlbumList2") { [unowned self] request in
+            let type = request.parameter("type") ?? ""
+            let offset = Int(request.parameter("offset") ?? "0") ?? 0
+            let count = Int(request.parameter("size") ?? request.parameter("count") ?? "10") ?? 10
+            self.lock.lock()
+            self.pagesRequested[type, default: []].append((offset, count))
+            self.lock.unlock()
+
+            let albums = (offset..<min(offset + count, SBAlbumListPagerTests.albumCount)).map { i in
+                #"<album id="\#(type)-\#(i)" name="Album \#(i)" artist="Artist \#(i % 50)" artistId="artist-\#(i % 50)" songCount="10"/>"#
+            }
+            return .subsonic("<albumList2>\(albums.joined())</albumList2>")
+        }
+        server = makeServer(standIn: standIn)
+
+        observer = NotificationCenter.default.addObserver(forName: .SBSubsonicAlbumsUpdated, object: nil, queue: nil) { [unowned self] notification in
+            guard let type = (notification.userInfo?["type"] as? NSNumber)?.intValue,
+                  let offset = (notification.userInfo?["offset"] as? NSNumber)?.intValue,
+                  let count = (notification.userInfo?["count"] as? NSNumber)?.intValue else {
+                return
+            }
+            self.lock.lock()
+            self.pagesLoaded[type, default: []].append((offset, count))
+            self.lock.unlock()
+        }
+    }
+
+    override func tearDown() {
+        if let observer = self.observer {
+            NotificationCenter.default.removeObserver(observer)
+        }
+        standIn.stop()
+        removeServer(server)
+    }
+
+    private func requested(_ type: SBAlbumListType) -> [(offset: Int, count: Int)] {
+        lock.lock()
+        defer { lock.unlock() }
+        return pagesRequested[type.subsonicParameter()] ?? []
+    }
+
+    private func loaded(_ type: SBAlbumListType) -> [(offset: Int, count: Int)] {
+        lock.lock()
+        defer { lock.unlock() }
+        return pagesLoaded[type.rawValue] ?? []
+    }
+
+    // #MARK: - Tests
+
+    func testPagesAheadOfTheViewport() {
+        standIn.latency = 0.2
+        let pager = SBAlbumListPager(server: server)
+        pager.reload(type: .alphabetical)
+        wait { self.loaded(.alphabetical).count == 1 }
+
+        pager.scrolled(lastVisibleItem: 39, viewportItems: 40)
+        // pages keep coming until there's a page's worth past the viewport, then stop
+        wait { self.loaded(.alphabetical).count > 1 && self.loaded(.alphabetical).count == self.requested(.alphabetical).count }
+        settle(for: 1)
+
+        let pages = requested(.alphabetical).sorted { $0.offset < $1.offset }
+        XCTAssertEqual(pages.count, loaded(.alphabetical).count, "Nothing should be asked for once the lookahead is full")
+        XCTAssertLessThanOrEqual(standIn.maxInFlight, SBAlbumListPager.maxPagesInFlight)
+        // each page starts where the last one ended, so there are no gaps or overlaps
+        var expectedOffset = 0
+        for page in pages {
+            XCTAssertEqual(page.offset, expectedOffset)
+            XCTAssertGreaterThanOrEqual(page.count, SBAlbumListPager.minPageSize)
+            XCTAssertLessThanOrEqual(page.count, SBAlbumListPager.maxPageSize)
+            expectedOffset = page.offset + page.count
+        }
+        let lookahead = expectedOffset - 40
+        XCTAssertGreaterThanOrEqual(lookahead, 40 + pager.pageSize, "Not enough loaded past the viewport")
+        XCTAssertLessThan(lookahead, 40 + pager.pageSize * (1 + SBAlbumListPager.maxPagesInFlight), "Loaded too far past the viewport")
+    }
+
+    func testPagesGrowWithLatencyAndScrollSpeed() {
+        standIn.latency = 0.5
+        let pager = SBAlbumListPager(server: server)
+        pager.reload(type: .newest)
+        wait { self.loaded(.newest).count == 1 }
+
+        // fling through the list faster than the server can keep up with at a viewport a page
+        var item = 39
+        for _ in 0..<6 {
+            pager.scrolled(lastVisibleItem: item, viewportItems: 40)
+            settle(for: SBAlbumListPager.scrollSampleInterval + 0.05)
+            item += 150
+        }
+        XCTAssertGreaterThan(pager.pageSize, 40, "Pages should cover what's scrolled past while one loads")
+        wait(timeout: 20) { self.loaded(.newest).count == self.requested(.newest).count }
+        XCTAssertGreaterThan(requested(.newest).map { $0.count }.max() ?? 0, 40)
+        XCTAssertLessThanOrEqual(standIn.maxInFlight, SBAlbumListPager.maxPagesInFlight)
+    }
+
+    func testChangingTypeDropsPagesStillOut() {
+        standIn.latency = 0.5
+        let pager = SBAlbumListPager(server: server)
+        pager.reload(type: .random)
+        // wait for it to get to the server, so the response comes back after it's been dropped
+        wait { self.requested(.random).count == 1 }
+        pager.reload(type: .recent)
+        wait { self.loaded(.recent).count == 1 }
+        settle(for: 1)
+
+        XCTAssertEqual(requested(.random).count, 1)
+        XCTAssertTrue(loaded(.random).isEmpty, "A dropped page shouldn't be parsed into the new list")
+        let homeAlbums = server.home?.albums as? Set<SBAlbum> ?? []
+        XCTAssertFalse(homeAlbums.contains { $0.itemId?.hasPrefix("random-") == true })
+    }
+}
@@ -0,0 +1,134 @@
+//
+//  SBAlbumLookupTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Compares looking up albums by server and ID against the SUBQUERY over their tracks it replaced, on a big library.
+///
+/// This uses its own SQLite store instead of the app's in-memory one, since the point is what the store does with the
+/// (server, itemId) index.
+final class SBAlbumLookupTests: XCTestCase {
+    static let albumCount = 20_000
+    static let tracksPerAlbum = 3
+    static let lookups = 500
+
+    private static var storeDirectory: URL!
+    private static var context: NSManagedObjectContext!
+    private static var servers: [SBServer] = []
+
+    override class func setUp() {
+        storeDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("SBAlbumLookupTests \(UUID().uuidString)", isDirectory: true)
+        try! FileManager.default.createDirectory(at: storeDirectory, withIntermediateDirectories: true)
+        let model = (NSApp.delegate as! SBAppDelegate).managedObjectModel
+        let coordinator = NSPersistentStoreCoordinator(managedObjectModel: model)
+        _ = try! coordinator.addPersistentStore(type: .sqlite, at: storeDirectory.appendingPathComponent("Library.sqlite"))
+        context = NSManagedObjectContext(concurrencyType: .mainQueueConcurrencyType)
+        context.persistentStoreCoordinator = coordinator
+
+        // Two servers with the same album IDs, like two Navidrome instances with the same music
+        servers = (0..<2).map { i in
+            let server = SBServer.insertInManagedObjectContext(context: context)
+            server.resourceName = "Server \(i)"
+            return server
+        }
+        let startDate = Date()
+        for i in 0..<(albumCount / servers.count) {
+            for server in servers {
+                let album = SBAlbum.insertInManagedObjectContext(context: context)
+                album.itemId = "album-\(i)"
+                album.itemName = "Album \(i)"
+                album.isLocal = false
+                album.server = server
+                for j in 0..<tracksPerAlbum {
+                    let track = SBTrack.insertInManagedObjectContext(context: context)
+                    track.itemId = "track-\(i)-\(j)"
+                    track.server = server
+                    track.album = album
+                }
+            }
+            if i % 1000 == 999 {
+                try! context.save()
+                context.reset()
+                servers = servers.map { context.object(with: $0.objectID) as! SBServer }
+            }
+        }
+        try! context.save()
+        context.reset()
+        servers = servers.map { context.object(with: $0.objectID) as! SBServer }
+        print("Made \(albumCount) albums in \(String(format: "%.1f", Date().timeIntervalSince(startDate))) seconds")
+    }
+
+    override class func tearDown() {
+        context = nil
+        servers = []
+        try? FileManager.default.removeItem(at: storeDirectory)
+    }
+
+    // #MARK: - Lookups
+
+    /// How the parser looked albums up before they had a server.
+    private func subqueryPredicate(id: String, server: SBServer) -> NSPredicate {
+        NSPredicate(format: "(itemId == %@) && SUBQUERY(tracks, $X, $X.server == %@).@count == tracks.@count", id, server)
+    }
+
+    /// How the parser looks them up now.
+    private func serverPredicate(id: String, server: SBServer) -> NSPredicate {
+        NSPredicate(format: "(server == %@) && (itemId == %@)", server, id)
+    }
+
+    private func lookUp(_ predicate: (String, SBServer) -> NSPredicate) -> [NSManagedObjectID] {
+        var generator = SBPlaylistSyncTests.SeededGenerator(state: 1)
+        let context = SBAlbumLookupTests.context!
+        return (0..<SBAlbumLookupTests.lookups).compactMap { _ in
+            let id = "album-\(Int.random(in: 0..<(SBAlbumLookupTests.albumCount / 2), using: &generator))"
+            let server = SBAlbumLookupTests.servers.randomElement(using: &generator)!
+            let fetchRequest = NSFetchRequest<SBAlbum>(entityName: "Album")
+            fetchRequest.predicate = predicate(id, server)
+            let results = try! context.fetch(fetchRequest)
+            XCTAssertEqual(results.count, 1)
+            XCTAssertEqual(results.first?.server, server)
+            return results.first?.objectID
+        }
+    }
+
+    private func time(_ block: () -> Void) -> TimeInterval {
+        let startDate = Date()
+        block()
+        return Date().timeIntervalSince(startDate)
+    }
+
+    // #MARK: - Tests
+
+    func testLookupsFindTheSameAlbums() {
+        XCTAssertEqual(lookUp(serverPredicate), lookUp(subqueryPredicate))
+    }
+
+    func testServerLookupIsFaster() {
+        // warm the store's caches up for both, so neither pays for the first read
+        _ = lookUp(subqueryPredicate)
+        _ = lookUp(serverPredicate)
+
+        let before = time { _ = lookUp(subqueryPredicate) }
+        let after = time { _ = lookUp(serverPredicate) }
+        print("\(SBAlbumLookupTests.lookups) lookups in \(SBAlbumLookupTests.albumCount) albums: \(String(format: "%.1f", before * 1000)) ms with SUBQUERY, \(String(format: "%.1f", after * 1000)) ms by server")
+        XCTAssertLessThan(after, before)
+    }
+
+    func testBenchmarkSubqueryLookup() {
+        measure {
+            _ = lookUp(subqueryPredicate)
+        }
+    }
+
+    func testBenchmarkServerLookup() {
+        measure {
+            _ = lookUp(serverPredicate)
+        }
+    }
+}
@@ -0,0 +1,101 @@
+//
+//  SBArtistRefreshTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Syncs artists from a stand-in server where more artists' album counts changed than get refreshed at once, checking
+/// the rest are refreshed on the next syncs, even though the server says nothing changed since.
+final class SBArtistRefreshTests: XCTestCase {
+    static let artistCount = 120
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+
+    private let lock = NSLock()
+    private var albumCount = 1
+    private var lastModified: Int64 = 1_700_000_000_000
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("getArtists") { [unowned self] _ in
+            self.lock.lock()
+            defer { self.lock.unlock() }
+            let artists = (0..<SBArtistRefreshTests.artistCount).map { i in
+                #"<artist id="artist-\#(i)" name="Artist \#(i)" albumCount="\#(self.albumCount)"/>"#
+            }
+            return .subsonic(#"<artists ignoredArticles="The" lastModified="\#(self.lastModified)"><index name="A">\#(artists.joined())</index></artists>"#)
+        }
+        standIn.handle("getArtist") { [unowned self] request in
+            self.lock.lock()
+            defer { self.lock.unlock() }
+            let id = request.parameter("id") ?? ""
+            return .subsonic(#"<artist id="\#(id)" name="Artist \#(id.dropFirst("artist-".count))" albumCount="\#(self.albumCount)"/>"#)
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+    }
+
+    private func sync() {
+        var updated = false
+        let observer = NotificationCenter.default.addObserver(forName: .SBSubsonicIndexesUpdated, object: nil, queue: .main) { _ in
+            updated = true
+        }
+        server.getArtists()
+        wait(timeout: 30) { updated }
+        NotificationCenter.default.removeObserver(observer)
+    }
+
+    /// How many artists have the album count the server gives now, i.e. were refreshed.
+    private func refreshed() -> Int {
+        let fetchRequest = NSFetchRequest<SBArtist>(entityName: "Artist")
+        fetchRequest.predicate = NSPredicate(format: "server == %@ && albumCount == 2", server)
+        return (try? mainContext.count(for: fetchRequest)) ?? -1
+    }
+
+    func testChangedArtistsAreWorkedThroughAcrossSyncs() {
+        let limit = SBSubsonicParsingOperation.maxArtistRefreshes
+        let artistCount = SBArtistRefreshTests.artistCount
+        XCTAssertGreaterThan(artistCount, limit * 2, "There should be more than two syncs' worth")
+
+        // the first sync only records the counts
+        sync()
+        wait { self.server.lastArtistsDate != nil }
+        let firstDate = server.lastArtistsDate
+        settle(for: 0.5)
+        XCTAssertEqual(standIn.requests(for: "getArtist"), 0)
+
+        // every artist got another album
+        lock.lock()
+        albumCount = 2
+        lastModified += 60_000
+        let changedDate = Date(timeIntervalSince1970: Double(lastModified) / 1000)
+        lock.unlock()
+
+        // each sync refreshes as many as it can, and the server saying nothing changed since doesn't stop the rest
+        var expected = 0
+        while expected < artistCount {
+            sync()
+            expected = min(expected + limit, artistCount)
+            wait { self.standIn.requests(for: "getArtist") == expected }
+            wait { self.refreshed() == expected }
+            XCTAssertEqual(server.lastArtistsDate, firstDate, "Recorded as synced with artists still to refresh")
+        }
+
+        // once they're all done, it's synced up to the server's change, and there's nothing more to refresh
+        sync()
+        wait { self.server.lastArtistsDate == changedDate }
+        settle(for: 0.5)
+        XCTAssertEqual(standIn.requests(for: "getArtist"), artistCount)
+        XCTAssertEqual(standIn.requests(for: "getArtists"), 2 + (artistCount + limit - 1) / limit)
+    }
+}
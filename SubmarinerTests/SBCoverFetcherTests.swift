@@ -0,0 +1,103 @@
+//
+//  SBCoverFetcherTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Fetches covers from a stand-in server, checking the same cover isn't asked for twice at once, and that being rate
+/// limited holds off every cover fetch until the server's Retry-After.
+///
+/// Missing covers aren't tested, since they're remembered in the app's real preferences.
+final class SBCoverFetcherTests: XCTestCase {
+    // a 1x1 PNG
+    static let image = Data(base64Encoded: "iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAADUlEQVR42mP8z8DwHwAFBQIAX8jx0gAAAABJRU5ErkJggg==")!
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+
+    private let lock = NSLock()
+    // when each cover was asked for, in order
+    private var requestDates: [String: [Date]] = [:]
+    // covers to answer with a 429 the first time
+    private var rateLimitedCovers = Set<String>()
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("getCoverArt") { [unowned self] request in
+            let id = request.parameter("id") ?? ""
+            self.lock.lock()
+            defer { self.lock.unlock() }
+            self.requestDates[id, default: []].append(Date())
+            if self.rateLimitedCovers.remove(id) != nil {
+                return SBStandInServer.Response(status: 429, headers: ["Retry-After": "1"])
+            }
+            return .data(SBCoverFetcherTests.image, contentType: "image/png")
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+    }
+
+    private func dates(for coverID: String) -> [Date] {
+        lock.lock()
+        defer { lock.unlock() }
+        return requestDates[coverID] ?? []
+    }
+
+    // #MARK: - Tests
+
+    func testSameCoverIsFetchedOnceAtATime() {
+        standIn.latency = 0.5
+        let fetcher = SBCoverFetcher.shared
+        let coalescedBefore = fetcher.coalesced
+        let coverIDs = (0..<5).map { "cover-\($0)" }
+
+        // i.e. overlapping pages and a search all wanting the same covers
+        for _ in 0..<4 {
+            for coverID in coverIDs {
+                fetcher.fetch(coverID: coverID, albumID: nil, server: server)
+            }
+        }
+        wait { self.standIn.requests(for: "getCoverArt") == coverIDs.count }
+        settle(for: 1)
+
+        XCTAssertEqual(standIn.requests(for: "getCoverArt"), coverIDs.count)
+        XCTAssertEqual(fetcher.coalesced - coalescedBefore, coverIDs.count * 3)
+        for coverID in coverIDs {
+            XCTAssertEqual(dates(for: coverID).count, 1, "\(coverID) was fetched more than once")
+        }
+
+        // once they're done, they can be fetched again
+        fetcher.fetch(coverID: coverIDs[0], albumID: nil, server: server)
+        wait { self.dates(for: coverIDs[0]).count == 2 }
+    }
+
+    func testRateLimitingHoldsOffEveryCover() {
+        lock.lock()
+        rateLimitedCovers = ["limited"]
+        lock.unlock()
+        let fetcher = SBCoverFetcher.shared
+
+        fetcher.fetch(coverID: "limited", albumID: nil, server: server)
+        wait { self.dates(for: "limited").count == 1 }
+        // let the 429 get back to the client before asking for another
+        settle(for: 0.2)
+        fetcher.fetch(coverID: "other", albumID: nil, server: server)
+
+        wait { self.dates(for: "limited").count == 2 && self.dates(for: "other").count == 1 }
+        let limited = dates(for: "limited")
+        let other = dates(for: "other")
+        // the retry waits for the Retry-After, instead of never happening or going right away
+        XCTAssertGreaterThanOrEqual(limited[1].timeIntervalSince(limited[0]), 0.9)
+        // and so does a cover that hadn't been asked for yet, since it would be rate limited too
+        XCTAssertGreaterThanOrEqual(other[0].timeIntervalSince(limited[0]), 0.9)
+    }
+}
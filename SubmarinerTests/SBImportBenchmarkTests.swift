@@ -0,0 +1,112 @@
+//
+//  SBImportBenchmarkTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Imports a generated folder tree of tagged audio files, reporting how fast each stage of the import went.
+final class SBImportBenchmarkTests: XCTestCase {
+    static let artistCount = 10
+    static let albumsPerArtist = 5
+    static let tracksPerAlbum = 12
+    static var fileCount: Int {
+        artistCount * albumsPerArtist * tracksPerAlbum
+    }
+
+    private var sourceDirectory: URL!
+
+    override func setUpWithError() throws {
+        sourceDirectory = FileManager.default.temporaryDirectory.appendingPathComponent("SBImportBenchmarkTests \(UUID().uuidString)", isDirectory: true)
+        for artist in 0..<SBImportBenchmarkTests.artistCount {
+            for album in 0..<SBImportBenchmarkTests.albumsPerArtist {
+                let folder = sourceDirectory
+                    .appendingPathComponent("Artist \(artist)", isDirectory: true)
+                    .appendingPathComponent("Album \(artist)-\(album)", isDirectory: true)
+                try FileManager.default.createDirectory(at: folder, withIntermediateDirectories: true)
+                for track in 1...SBImportBenchmarkTests.tracksPerAlbum {
+                    let tags = SBTestAudio.Tags(title: "Track \(artist)-\(album)-\(track)",
+                                                artist: "Artist \(artist)",
+                                                album: "Album \(artist)-\(album)",
+                                                trackNumber: track)
+                    // a different tone each, so the files aren't all the same
+                    let audio = SBTestAudio.aiff(seconds: 1, frequency: 220 + Double(track * 20), tags: tags)
+                    try audio.write(to: folder.appendingPathComponent(String(format: "%02d Track.aiff", track)))
+                }
+            }
+        }
+        // the library the import adds to is made when the window is, but might not be saved yet
+        SBPersistence.shared.saveMainContext()
+    }
+
+    override func tearDown() {
+        try? FileManager.default.removeItem(at: sourceDirectory)
+        for entityName in ["Track", "Album", "Artist"] {
+            let fetchRequest = NSFetchRequest<NSManagedObject>(entityName: entityName)
+            fetchRequest.predicate = NSPredicate(format: "isLocal == YES")
+            for object in (try? mainContext.fetch(fetchRequest)) ?? [] {
+                mainContext.delete(object)
+            }
+        }
+        SBPersistence.shared.saveMainContext()
+    }
+
+    /// Copies the tree in. Linking instead would remember the folder in the app's real preferences.
+    private func importTree() -> SBImportOperation {
+        let importOperation = SBImportOperation(managedObjectContext: mainContext, files: [sourceDirectory], copyFiles: true)!
+        OperationQueue.sharedDownloadQueue.addOperation(importOperation)
+        wait(timeout: 300) { importOperation.isFinished }
+        // let the saved batches merge into the main context
+        settle(for: 1)
+        return importOperation
+    }
+
+    private func localTracks() -> [SBTrack] {
+        let fetchRequest: NSFetchRequest<SBTrack> = SBTrack.fetchRequest()
+        fetchRequest.predicate = NSPredicate(format: "(server == nil) && (isLocal == YES)")
+        return (try? mainContext.fetch(fetchRequest)) ?? []
+    }
+
+    private func report(_ importOperation: SBImportOperation) {
+        for statistics in [importOperation.metadataStatistics, importOperation.copyStatistics, importOperation.mergeStatistics] {
+            print(statistics)
+        }
+    }
+
+    // #MARK: - Tests
+
+    func testBenchmarkCopyingImport() {
+        let importOperation = importTree()
+        report(importOperation)
+
+        let fileCount = SBImportBenchmarkTests.fileCount
+        XCTAssertEqual(importOperation.metadataStatistics.files, fileCount)
+        XCTAssertEqual(importOperation.copyStatistics.files, fileCount)
+        XCTAssertEqual(importOperation.mergeStatistics.files, fileCount)
+        XCTAssertGreaterThan(importOperation.metadataStatistics.bytes, 0)
+        XCTAssertGreaterThan(importOperation.copyStatistics.bytes, 0)
+
+        // the tags ended up where they belong
+        let tracks = localTracks()
+        XCTAssertEqual(tracks.count, fileCount)
+        let albums = Set(tracks.compactMap { $0.album })
+        XCTAssertEqual(albums.count, SBImportBenchmarkTests.artistCount * SBImportBenchmarkTests.albumsPerArtist)
+        XCTAssertEqual(Set(albums.compactMap { $0.artist }).count, SBImportBenchmarkTests.artistCount)
+        for track in tracks {
+            guard let title = track.itemName, title.hasPrefix("Track ") else {
+                XCTFail("Untagged track \(track.itemName ?? "<nil>")")
+                continue
+            }
+            let numbers = title.dropFirst("Track ".count).split(separator: "-")
+            XCTAssertEqual(track.album?.itemName, "Album \(numbers[0])-\(numbers[1])")
+            XCTAssertEqual(track.album?.artist?.itemName, "Artist \(numbers[0])")
+            XCTAssertEqual(track.trackNumber?.intValue, Int(numbers[2]))
+            XCTAssertEqual(track.duration?.doubleValue ?? 0, 1, accuracy: 0.1)
+            XCTAssertEqual(track.isLinked?.boolValue, false)
+        }
+    }
+}
@@ -0,0 +1,131 @@
+//
+//  SBMutationOutboxTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Queues mutations, checking how they're combined before anything's sent, and which errors count against them.
+///
+/// The outbox isn't started in tests, and these never give the main queue a chance to flush it, so what's queued is
+/// just what the combining left.
+final class SBMutationOutboxTests: XCTestCase {
+    typealias Mutation = SBMutationOutbox.Mutation
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+    }
+
+    private var outbox: SBMutationOutbox {
+        SBMutationOutbox.shared
+    }
+
+    private func queued() -> [Mutation] {
+        outbox.queued(for: server)
+    }
+
+    // #MARK: - Tests
+
+    func testStarThenUnstarCancelsOut() {
+        outbox.add(.star(ids: ["track-1", "track-2"], albumIDs: ["album-1"], artistIDs: []), for: server)
+        outbox.add(.unstar(ids: ["track-1"], albumIDs: ["album-1"], artistIDs: []), for: server)
+        XCTAssertEqual(queued(), [.star(ids: ["track-2"], albumIDs: [], artistIDs: [])])
+
+        // a track and an artist with the same ID aren't the same thing
+        outbox.add(.unstar(ids: [], albumIDs: [], artistIDs: ["track-2"]), for: server)
+        XCTAssertEqual(queued(), [.star(ids: ["track-2"], albumIDs: [], artistIDs: []),
+                                  .unstar(ids: [], albumIDs: [], artistIDs: ["track-2"])])
+
+        outbox.add(.unstar(ids: ["track-2"], albumIDs: [], artistIDs: []), for: server)
+        outbox.add(.star(ids: [], albumIDs: [], artistIDs: ["track-2"]), for: server)
+        XCTAssertEqual(queued(), [])
+    }
+
+    func testStarsAndScrobblesAreChunked() {
+        let max = SBMutationOutbox.maxIDsPerRequest
+        let ids = (0..<(2 * max + max / 2)).map { "track-\($0)" }
+        outbox.add(.star(ids: ids, albumIDs: [], artistIDs: []), for: server)
+        XCTAssertEqual(queued().map { $0.count }, [max, max, max / 2])
+
+        // more fill the last one up before starting another
+        let more = (0..<max).map { "more-\($0)" }
+        outbox.add(.star(ids: more, albumIDs: [], artistIDs: []), for: server)
+        XCTAssertEqual(queued().map { $0.count }, [max, max, max, max / 2])
+        // starring the same thing again doesn't add to it
+        outbox.add(.star(ids: [ids[0], more[0]], albumIDs: [], artistIDs: []), for: server)
+        XCTAssertEqual(queued().map { $0.count }, [max, max, max, max / 2])
+        // and nothing was lost or reordered on the way
+        let starred = queued().flatMap { mutation -> [String] in
+            guard case .star(let ids, _, _) = mutation else {
+                XCTFail("Expected only stars, got \(mutation)")
+                return []
+            }
+            return ids
+        }
+        XCTAssertEqual(starred, ids + more)
+
+        let plays = (0..<(max + 1)).map { Mutation.Play(id: "track-\($0)", time: Date(timeIntervalSince1970: Double($0))) }
+        outbox.add(.scrobble(plays: plays), for: server)
+        XCTAssertEqual(queued().suffix(2), [.scrobble(plays: Array(plays.prefix(max))), .scrobble(plays: [plays[max]])])
+    }
+
+    func testPlaylistUpdatesAreMerged() {
+        outbox.add(.updatePlaylist(id: "list", name: "New Name", comment: nil, isPublic: nil, appending: ["a"], removing: []), for: server)
+        outbox.add(.updatePlaylist(id: "list", name: nil, comment: "Comment", isPublic: nil, appending: ["b"], removing: []), for: server)
+        XCTAssertEqual(queued(), [.updatePlaylist(id: "list", name: "New Name", comment: "Comment", isPublic: nil, appending: ["a", "b"], removing: [])])
+
+        // removing by index after appending would remove from a different playlist than the server's, so it waits
+        outbox.add(.updatePlaylist(id: "list", name: nil, comment: nil, isPublic: nil, appending: [], removing: [0]), for: server)
+        XCTAssertEqual(queued().count, 2)
+
+        // a change to another playlist in between doesn't stop the next one combining with that
+        outbox.add(.updatePlaylist(id: "other", name: "Other", comment: nil, isPublic: nil, appending: [], removing: []), for: server)
+        outbox.add(.updatePlaylist(id: "list", name: nil, comment: nil, isPublic: true, appending: ["c"], removing: []), for: server)
+        XCTAssertEqual(queued().count, 3)
+        XCTAssertEqual(queued()[1], .updatePlaylist(id: "list", name: nil, comment: nil, isPublic: true, appending: ["c"], removing: [0]))
+
+        // replacing the tracks leaves the details, and appending to that goes into the replacement
+        outbox.add(.replacePlaylist(id: "list", trackIDs: ["x", "y"]), for: server)
+        outbox.add(.updatePlaylist(id: "list", name: nil, comment: nil, isPublic: nil, appending: ["z"], removing: []), for: server)
+        XCTAssertEqual(queued(), [
+            .updatePlaylist(id: "list", name: "New Name", comment: "Comment", isPublic: nil, appending: [], removing: []),
+            .updatePlaylist(id: "list", name: nil, comment: nil, isPublic: true, appending: [], removing: []),
+            .updatePlaylist(id: "other", name: "Other", comment: nil, isPublic: nil, appending: [], removing: []),
+            .replacePlaylist(id: "list", trackIDs: ["x", "y", "z"]),
+        ])
+
+        // deleting it makes everything else for it moot
+        outbox.add(.deletePlaylist(id: "list"), for: server)
+        XCTAssertEqual(queued(), [
+            .updatePlaylist(id: "other", name: "Other", comment: nil, isPublic: nil, appending: [], removing: []),
+            .deletePlaylist(id: "list"),
+        ])
+    }
+
+    func testOnlyTheServerTurningItDownIsARejection() {
+        // what the request operation makes of an HTTP error status
+        XCTAssertTrue(SBMutationOutbox.isRejection(NSError(domain: NSURLErrorDomain, code: 500)))
+        XCTAssertTrue(SBMutationOutbox.isRejection(NSError(domain: NSURLErrorDomain, code: 404)))
+        XCTAssertTrue(SBMutationOutbox.isRejection(NSError(domain: "SBSubsonicErrorDomain", code: 50)))
+        XCTAssertTrue(SBMutationOutbox.isRejection(URLError(.badServerResponse)))
+
+        XCTAssertFalse(SBMutationOutbox.isRejection(URLError(.notConnectedToInternet)))
+        XCTAssertFalse(SBMutationOutbox.isRejection(URLError(.timedOut)))
+        XCTAssertFalse(SBMutationOutbox.isRejection(URLError(.networkConnectionLost)))
+        XCTAssertFalse(SBMutationOutbox.isRejection(URLError(.cannotConnectToHost)))
+        XCTAssertFalse(SBMutationOutbox.isRejection(CocoaError(.userCancelled)))
+    }
+}
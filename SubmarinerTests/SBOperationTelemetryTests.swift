@@ -0,0 +1,106 @@
+//
+//  SBOperationTelemetryTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Sends requests to a slow stand-in server, checking the timings each operation records end up in the JSON lines log
+/// and the rolling summary.
+final class SBOperationTelemetryTests: XCTestCase {
+    static let requestCount = 10
+    static let latency: TimeInterval = 0.2
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+    private var argumentDefaults: [String: Any] = [:]
+
+    override func setUpWithError() throws {
+        // The log is off unless asked for, so turn it on the way a launch argument would, leaving the real preferences alone
+        argumentDefaults = UserDefaults.standard.volatileDomain(forName: UserDefaults.argumentDomain)
+        UserDefaults.standard.setVolatileDomain(argumentDefaults.merging(["recordOperationTelemetry": true]) { _, new in new },
+                                                forName: UserDefaults.argumentDomain)
+        standIn = try SBStandInServer()
+        standIn.latency = SBOperationTelemetryTests.latency
+        standIn.handle("ping") { _ in
+            .subsonic()
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+        UserDefaults.standard.setVolatileDomain(argumentDefaults, forName: UserDefaults.argumentDomain)
+    }
+
+    private func records() -> [[String: Any]] {
+        guard let data = try? Data(contentsOf: SBOperationTelemetry.logURL) else {
+            return []
+        }
+        return data.split(separator: 0x0A).map { line in
+            let record = try? JSONSerialization.jsonObject(with: line) as? [String: Any]
+            XCTAssertNotNil(record, "Not a JSON object: \(String(decoding: line, as: UTF8.self))")
+            return record ?? [:]
+        }
+    }
+
+    private func pingRecords(after skipped: Int) -> [[String: Any]] {
+        records().dropFirst(skipped).filter {
+            $0["kind"] as? String == "SBSubsonicRequestOperation" && $0["endpoint"] as? String == "ping"
+        }
+    }
+
+    // #MARK: - Tests
+
+    func testLogIsOffByDefault() throws {
+        UserDefaults.standard.setVolatileDomain(argumentDefaults, forName: UserDefaults.argumentDomain)
+        try XCTSkipIf(UserDefaults.standard.persistentDomain(forName: Bundle.main.bundleIdentifier!)?["recordOperationTelemetry"] != nil,
+                      "The log was turned on or off in this Mac's preferences")
+        XCTAssertFalse(UserDefaults.standard.recordOperationTelemetry)
+
+        let skipped = records().count
+        SBServerScheduler.shared.add(SBSubsonicRequestOperation(server: server, request: .ping))
+        wait { self.standIn.requests(for: "ping") == 1 }
+        // long enough for the operation to finish and be recorded, if it were going to be
+        settle(for: 1)
+        XCTAssertEqual(records().count, skipped)
+    }
+
+    func testRecordsPhasesOfEachRequest() {
+        XCTAssertTrue(UserDefaults.standard.recordOperationTelemetry)
+        XCTAssertTrue(SBOperationTelemetry.logURL.path.hasPrefix(SBAppDelegate.libraryDirectory.path), "Tests shouldn't log to the real logs")
+        let skipped = records().count
+
+        for _ in 0..<SBOperationTelemetryTests.requestCount {
+            SBServerScheduler.shared.add(SBSubsonicRequestOperation(server: server, request: .ping))
+        }
+        wait(timeout: 30) { self.pingRecords(after: skipped).count == SBOperationTelemetryTests.requestCount }
+
+        let minimumMs = SBOperationTelemetryTests.latency * 1000 * 0.9
+        for record in pingRecords(after: skipped) {
+            XCTAssertNotNil(record["date"] as? String)
+            let phases = record["phasesMs"] as? [String: Double] ?? [:]
+            // the stand-in waits before answering, which is all time to first byte
+            XCTAssertGreaterThanOrEqual(phases["firstByte"] ?? 0, minimumMs)
+            XCTAssertNotNil(phases["build"])
+            XCTAssertGreaterThan(record["bytes"] as? Int ?? 0, 0)
+            XCTAssertGreaterThanOrEqual(record["totalMs"] as? Double ?? 0, phases["firstByte"] ?? .infinity)
+        }
+
+        // the parses of those responses are recorded too
+        wait { self.records().dropFirst(skipped).filter { $0["kind"] as? String == "SBSubsonicParsingOperation" }.count >= SBOperationTelemetryTests.requestCount }
+
+        let summary = SBOperationTelemetry.shared.summary()["SBSubsonicRequestOperation ping"]
+        let firstByte = summary?["firstByte"] ?? [:]
+        XCTAssertGreaterThanOrEqual(firstByte["count"] ?? 0, Double(SBOperationTelemetryTests.requestCount))
+        // other tests' pings can be in there too, but not enough to hide these
+        XCTAssertGreaterThanOrEqual(firstByte["p95"] ?? 0, minimumMs)
+        XCTAssertLessThanOrEqual(firstByte["p50"] ?? 0, firstByte["p95"] ?? 0)
+        XCTAssertLessThanOrEqual(summary?["total"]?["p50"] ?? 0, summary?["total"]?["p95"] ?? 0)
+    }
+}
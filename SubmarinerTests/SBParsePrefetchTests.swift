@@ -0,0 +1,147 @@
+//
+//  SBParsePrefetchTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Parses big getAlbumList2 and search3 responses from a stand-in server, checking every lookup by ID is answered by
+/// what was prefetched, and that parsing the same things again updates them instead of making duplicates.
+final class SBParsePrefetchTests: XCTestCase {
+    static let albumCount = 3000
+    static let songCount = 3000
+    static let perArtist = 10
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+
+    private let lock = NSLock()
+    private var albumNameSuffix = ""
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("getAlbumList2") { [unowned self] _ in
+            self.lock.lock()
+            let suffix = self.albumNameSuffix
+            self.lock.unlock()
+            let albums = (0..<SBParsePrefetchTests.albumCount).map { i in
+                let artist = i / SBParsePrefetchTests.perArtist
+                return #"<album id="album-\#(i)" name="Album \#(i)\#(suffix)" artist="Artist \#(artist)" artistId="artist-\#(artist)" songCount="10" duration="2400" created="2020-01-01T00:00:00.000Z"/>"#
+            }
+            return .subsonic("<albumList2>\(albums.joined())</albumList2>")
+        }
+        standIn.handle("search3") { _ in
+            var songs = (0..<SBParsePrefetchTests.songCount).map { i in
+                let album = i / SBParsePrefetchTests.perArtist
+                let artist = album / SBParsePrefetchTests.perArtist
+                return #"<song id="song-\#(i)" parent="album-\#(album)" title="Song \#(i)" album="Album \#(album)" artist="Artist \#(artist)" albumId="album-\#(album)" artistId="artist-\#(artist)" track="\#(i % 10 + 1)" duration="240" isDir="false"/>"#
+            }
+            // the same album ID under two artists, which is what used to be duplicated on the next parse
+            songs += (0..<4).map { i in
+                #"<song id="shared-\#(i)" parent="shared-album" title="Shared \#(i)" album="Shared" artist="Artist \#(i % 2)" albumId="shared-album" artistId="artist-\#(i % 2)" duration="240" isDir="false"/>"#
+            }
+            return .subsonic("<searchResult3>\(songs.joined())</searchResult3>")
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+    }
+
+    /// Requests and parses a response, returning the parse's lookups and how many objects it wrote.
+    private func parse(_ type: SBSubsonicRequestType) -> (cached: Int, fetched: Int, writes: Int, time: TimeInterval) {
+        var result: (cached: Int, fetched: Int, writes: Int, time: TimeInterval)?
+        let start = Date()
+        let request = SBSubsonicRequestOperation(server: server, request: type)
+        request.customization = { operation in
+            if case .search(let query, _) = type {
+                operation.currentSearch = SBSearchResult(query: .search(query: query))
+            }
+            operation.completionBlock = { [weak operation] in
+                self.lock.lock()
+                result = (operation?.cachedLookups ?? 0, operation?.fetchedLookups ?? -1, operation?.syncWrites ?? 0,
+                          Date().timeIntervalSince(start))
+                self.lock.unlock()
+            }
+        }
+        SBServerScheduler.shared.add(request)
+        wait(timeout: 60) {
+            lock.lock()
+            defer { lock.unlock() }
+            return result != nil
+        }
+        lock.lock()
+        defer { lock.unlock() }
+        return result ?? (0, -1, 0, 0)
+    }
+
+    private func count(_ entityName: String, _ format: String = "TRUEPREDICATE", _ arguments: CVarArg...) -> Int {
+        let fetchRequest = NSFetchRequest<NSManagedObject>(entityName: entityName)
+        fetchRequest.predicate = NSCompoundPredicate(andPredicateWithSubpredicates: [
+            NSPredicate(format: "server == %@", server),
+            NSPredicate(format: format, argumentArray: arguments),
+        ])
+        return (try? mainContext.count(for: fetchRequest)) ?? -1
+    }
+
+    // #MARK: - Tests
+
+    func testAlbumListIsLookedUpFromThePrefetch() {
+        let albumCount = SBParsePrefetchTests.albumCount
+        let artistCount = albumCount / SBParsePrefetchTests.perArtist
+
+        let first = parse(.getAlbumList(type: .newest, count: albumCount))
+        print("Parsed \(albumCount) new albums in \(String(format: "%.0f", first.time * 1000)) ms: \(first.cached) cached lookups, \(first.fetched) fetched")
+        XCTAssertEqual(first.fetched, 0)
+        XCTAssertGreaterThanOrEqual(first.cached, albumCount)
+        wait { self.count("Album") == albumCount }
+        XCTAssertEqual(count("Artist"), artistCount)
+
+        // renamed, so every album is written again, but none are added
+        lock.lock()
+        albumNameSuffix = " (Remastered)"
+        lock.unlock()
+        let renamed = parse(.getAlbumList(type: .newest, count: albumCount))
+        print("Parsed \(albumCount) changed albums in \(String(format: "%.0f", renamed.time * 1000)) ms: \(renamed.cached) cached lookups, \(renamed.fetched) fetched")
+        XCTAssertEqual(renamed.fetched, 0)
+        XCTAssertEqual(renamed.writes, albumCount)
+        wait { self.count("Album", "itemName ENDSWITH %@", " (Remastered)") == albumCount }
+        XCTAssertEqual(count("Album"), albumCount)
+        XCTAssertEqual(count("Artist"), artistCount)
+
+        // and the same again writes nothing
+        let unchanged = parse(.getAlbumList(type: .newest, count: albumCount))
+        XCTAssertEqual(unchanged.fetched, 0)
+        XCTAssertEqual(unchanged.writes, 0)
+        XCTAssertEqual(count("Album"), albumCount)
+    }
+
+    func testSearchResultsAreNotDuplicatedWhenParsedAgain() {
+        let songCount = SBParsePrefetchTests.songCount + 4
+
+        let first = parse(.search(query: "everything", count: songCount))
+        print("Parsed \(songCount) new songs in \(String(format: "%.0f", first.time * 1000)) ms: \(first.cached) cached lookups, \(first.fetched) fetched")
+        XCTAssertEqual(first.fetched, 0)
+        wait { self.count("Track") == songCount }
+        let albums = count("Album")
+        let artists = count("Artist")
+        let sharedAlbums = count("Album", "itemId == %@", "shared-album")
+        XCTAssertGreaterThanOrEqual(albums, SBParsePrefetchTests.songCount / SBParsePrefetchTests.perArtist)
+        XCTAssertGreaterThan(sharedAlbums, 0)
+
+        let again = parse(.search(query: "everything", count: songCount))
+        print("Parsed \(songCount) known songs in \(String(format: "%.0f", again.time * 1000)) ms: \(again.cached) cached lookups, \(again.fetched) fetched")
+        XCTAssertEqual(again.fetched, 0)
+        settle(for: 1)
+        XCTAssertEqual(count("Track"), songCount)
+        XCTAssertEqual(count("Album"), albums)
+        XCTAssertEqual(count("Artist"), artists)
+        XCTAssertEqual(count("Album", "itemId == %@", "shared-album"), sharedAlbums)
+    }
+}
@@ -0,0 +1,115 @@
+//
+//  SBPlaylistEntriesTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Opens, reorders and updates a 10,000 track playlist, checking the order its entries keep, and that converting a
+/// playlist from before entries keeps the order of its track URIs.
+final class SBPlaylistEntriesTests: XCTestCase {
+    static let trackCount = 10_000
+
+    private var tracks: [SBTrack] = []
+    private var playlist: SBPlaylist!
+
+    override func setUp() {
+        tracks = (0..<SBPlaylistEntriesTests.trackCount).map { i in
+            let track = SBTrack.insertInManagedObjectContext(context: mainContext)
+            track.itemName = "Track \(i)"
+            track.isLocal = true
+            return track
+        }
+        playlist = SBPlaylist.insertInManagedObjectContext(context: mainContext)
+        playlist.resourceName = "Big Playlist"
+        SBPersistence.shared.saveMainContext()
+    }
+
+    override func tearDown() {
+        mainContext.delete(playlist)
+        tracks.filter { $0.managedObjectContext != nil }.forEach { mainContext.delete($0) }
+        tracks.removeAll()
+        SBPersistence.shared.saveMainContext()
+    }
+
+    /// What opening the playlist in a new window costs, with nothing already loaded.
+    private func reopen() -> [SBTrack] {
+        SBPersistence.shared.saveMainContext()
+        mainContext.refresh(playlist, mergeChanges: false)
+        return playlist.tracks ?? []
+    }
+
+    // #MARK: - Tests
+
+    func testOpenReorderAndUpdate() {
+        var generator = SBPlaylistSyncTests.SeededGenerator(state: 11)
+        var expected = tracks.shuffled(using: &generator)
+        playlist.add(tracks: expected)
+
+        let openStart = Date()
+        XCTAssertEqual(reopen(), expected)
+        print("Opened a \(expected.count) track playlist in \(String(format: "%.0f", Date().timeIntervalSince(openStart) * 1000)) ms")
+
+        // dragging a few rows from all over to one place
+        let moved = IndexSet([0, 1, 500, 4_321, 9_998, 9_999])
+        let newRows = playlist.moveTracks(fromOffsets: moved, toOffset: 1_000)
+        let newExpectedRows = expected.moveReturningNewIndices(fromOffsets: moved, toOffset: 1_000)
+        XCTAssertEqual(newRows, newExpectedRows)
+        XCTAssertEqual(playlist.tracks, expected)
+        XCTAssertEqual(reopen(), expected)
+
+        // what a sync does when a few tracks changed on the server: some gone, some added, some moved
+        var updated = expected
+        for _ in 0..<50 {
+            updated.remove(at: Int.random(in: 0..<updated.count, using: &generator))
+        }
+        let reinserted = expected.suffix(50).filter { updated.contains($0) }
+        for track in reinserted {
+            updated.removeAll { $0 == track }
+        }
+        for track in reinserted {
+            updated.insert(track, at: Int.random(in: 0...updated.count, using: &generator))
+        }
+        for _ in 0..<20 {
+            let track = updated.remove(at: Int.random(in: 0..<updated.count, using: &generator))
+            updated.insert(track, at: Int.random(in: 0...updated.count, using: &generator))
+        }
+
+        let updateStart = Date()
+        let (inserted, removed) = playlist.update(tracks: updated)
+        print("Updated the playlist with \(inserted) entries inserted and \(removed) removed in \(String(format: "%.0f", Date().timeIntervalSince(updateStart) * 1000)) ms")
+        XCTAssertEqual(playlist.tracks, updated)
+        // only what differs is written, which is far from every entry
+        XCTAssertEqual(inserted - removed, updated.count - expected.count)
+        XCTAssertLessThanOrEqual(inserted, reinserted.count + 20)
+        XCTAssertEqual(reopen(), updated)
+        XCTAssertEqual(playlist.entries?.count, updated.count)
+
+        // and the same tracks again change nothing
+        XCTAssertTrue(playlist.update(tracks: updated) == (0, 0))
+    }
+
+    func testConvertingTrackURIsKeepsTheirOrder() {
+        var generator = SBPlaylistSyncTests.SeededGenerator(state: 17)
+        let expected = tracks.shuffled(using: &generator)
+        var uris = expected.map { $0.objectID.uriRepresentation() }
+        // a track that's gone since, which is skipped like the old getter did
+        let gone = SBTrack.insertInManagedObjectContext(context: mainContext)
+        SBPersistence.shared.saveMainContext()
+        uris.insert(gone.objectID.uriRepresentation(), at: uris.count / 2)
+        mainContext.delete(gone)
+        playlist.trackIDs = uris
+        SBPersistence.shared.saveMainContext()
+
+        let migration = SBLibraryMigratePlaylistEntriesOperation(managedObjectContext: mainContext)
+        SBServerScheduler.shared.addMaintenance(migration)
+        wait(timeout: 60) { migration.isFinished }
+
+        wait { self.playlist.trackIDs == nil }
+        XCTAssertEqual(reopen(), expected)
+    }
+}
@@ -0,0 +1,237 @@
+//
+//  SBPlaylistSyncTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Checks that syncing a playlist edit to the server, and applying one from it, end up with the same order, over
+/// randomized edits of big playlists. Also measures how long both take.
+final class SBPlaylistSyncTests: XCTestCase {
+    /// Seeded, so a failure can be reproduced.
+    struct SeededGenerator: RandomNumberGenerator {
+        var state: UInt64
+
+        // SplitMix64
+        mutating func next() -> UInt64 {
+            state &+= 0x9E3779B97F4A7C15
+            var z = state
+            z = (z ^ (z >> 30)) &* 0xBF58476D1CE4E5B9
+            z = (z ^ (z >> 27)) &* 0x94D049BB133111EB
+            return z ^ (z >> 31)
+        }
+    }
+
+    struct Workload {
+        let old: [String]
+        let new: [String]
+    }
+
+    static let poolSize = 3000
+
+    /// A playlist of random tracks (some more than once), and the same playlist after random edits.
+    static func workload(size: Int, edits: Int, using generator: inout SeededGenerator) -> Workload {
+        let pool = (0..<poolSize).map { "track-\($0)" }
+        let old = (0..<size).map { _ in pool.randomElement(using: &generator)! }
+        var new = old
+        for _ in 0..<edits {
+            switch Int.random(in: 0..<5, using: &generator) {
+            case 0 where !new.isEmpty: // remove
+                new.remove(at: Int.random(in: 0..<new.count, using: &generator))
+            case 1: // insert
+                new.insert(pool.randomElement(using: &generator)!, at: Int.random(in: 0...new.count, using: &generator))
+            case 2 where !new.isEmpty: // move
+                let track = new.remove(at: Int.random(in: 0..<new.count, using: &generator))
+                new.insert(track, at: Int.random(in: 0...new.count, using: &generator))
+            case 3: // append
+                new.append(pool.randomElement(using: &generator)!)
+            default: // drop from the end, like trimming a playlist
+                if !new.isEmpty {
+                    new.removeLast()
+                }
+            }
+        }
+        return Workload(old: old, new: new)
+    }
+
+    /// Applies mutations the way the server does: for each request, removals by index into the order before it, then
+    /// appends.
+    static func apply(_ mutations: [SBMutationOutbox.Mutation], to playlist: [String]) -> [String] {
+        var playlist = playlist
+        for mutation in mutations {
+            switch mutation {
+            case .replacePlaylist(_, let trackIDs):
+                playlist = trackIDs
+            case .updatePlaylist(_, _, _, _, let appending, let removing):
+                let removed = IndexSet(removing)
+                precondition(removed.count == removing.count, "Removed the same index twice")
+                precondition(removed.allSatisfy { $0 < playlist.count }, "Removed an index that isn't there")
+                playlist = playlist.enumerated().filter { !removed.contains($0.offset) }.map { $0.element } + appending
+            default:
+                XCTFail("Unexpected mutation \(mutation)")
+            }
+        }
+        return playlist
+    }
+
+    // #MARK: - Correctness
+
+    func testEditsMatchTheNewOrder() {
+        var generator = SeededGenerator(state: 2024)
+        for _ in 0..<500 {
+            let size = Int.random(in: 0..<400, using: &generator)
+            let workload = SBPlaylistSyncTests.workload(size: size, edits: Int.random(in: 0..<40, using: &generator), using: &generator)
+            let edit = SBPlaylistSync.edit(from: workload.old, to: workload.new)
+
+            // what's kept is the start of the new order, in the old order
+            let kept = workload.new.count - edit.appending.count
+            XCTAssertEqual(Array(workload.new[kept...]), edit.appending)
+            XCTAssertEqual(edit.removing, edit.removing.sorted(by: >))
+            XCTAssertEqual(workload.old.count - edit.removing.count, kept)
+
+            // a single request with all of it
+            let single = SBMutationOutbox.Mutation.updatePlaylist(id: "p", name: nil, comment: nil, isPublic: nil,
+                                                                  appending: edit.appending, removing: edit.removing)
+            XCTAssertEqual(SBPlaylistSyncTests.apply([single], to: workload.old), workload.new)
+        }
+    }
+
+    func testChunkedRequestsMatchTheNewOrder() {
+        var generator = SeededGenerator(state: 7)
+        // small enough that edits are split over a lot of requests
+        let limits = [96, 512, SBPlaylistSync.maxQueryBytes, SBPlaylistSync.maxFormBytes]
+        for _ in 0..<500 {
+            let size = Int.random(in: 0..<600, using: &generator)
+            let workload = SBPlaylistSyncTests.workload(size: size, edits: Int.random(in: 0..<200, using: &generator), using: &generator)
+            let maxBytes = limits.randomElement(using: &generator)!
+
+            let mutations = SBPlaylistSync.mutations(id: "p", from: workload.old, to: workload.new, maxBytes: maxBytes)
+            XCTAssertEqual(SBPlaylistSyncTests.apply(mutations, to: workload.old), workload.new,
+                           "\(workload.old.count) to \(workload.new.count) tracks in \(maxBytes) byte requests")
+            for mutation in mutations {
+                let bytes = SBPlaylistSync.trackBytes(of: mutation)
+                XCTAssertLessThanOrEqual(bytes, maxBytes)
+            }
+            if workload.old == workload.new {
+                XCTAssertTrue(mutations.isEmpty)
+            }
+        }
+    }
+
+    func testDetailsGoWithTheFirstChunk() {
+        let mutations = SBPlaylistSync.chunks(id: "p", name: "Renamed", comment: "Comment", isPublic: true,
+                                              removing: Array((0..<100).reversed()), appending: (0..<100).map { "track-\($0)" },
+                                              maxBytes: 512)
+        XCTAssertGreaterThan(mutations.count, 1)
+        for (i, mutation) in mutations.enumerated() {
+            guard case .updatePlaylist(_, let name, let comment, let isPublic, _, _) = mutation else {
+                XCTFail("Unexpected mutation \(mutation)")
+                continue
+            }
+            XCTAssertEqual(name, i == 0 ? "Renamed" : nil)
+            XCTAssertEqual(comment, i == 0 ? "Comment" : nil)
+            XCTAssertEqual(isPublic, i == 0 ? true : nil)
+        }
+        // details alone still make a request
+        XCTAssertEqual(SBPlaylistSync.chunks(id: "p", name: "Renamed", removing: [], appending: [], maxBytes: 512).count, 1)
+    }
+
+    // #MARK: - Applying what the server has
+
+    private var tracks: [String: SBTrack] = [:]
+    private var playlist: SBPlaylist!
+
+    private func makeTracks() {
+        let pool = (0..<SBPlaylistSyncTests.poolSize).map { "track-\($0)" }
+        for id in pool {
+            let track = SBTrack.insertInManagedObjectContext(context: mainContext)
+            track.itemId = id
+            tracks[id] = track
+        }
+        playlist = SBPlaylist.insertInManagedObjectContext(context: mainContext)
+    }
+
+    override func tearDown() {
+        if let playlist = self.playlist {
+            mainContext.delete(playlist)
+        }
+        tracks.values.forEach { mainContext.delete($0) }
+        mainContext.processPendingChanges()
+        tracks.removeAll()
+        playlist = nil
+    }
+
+    func testUpdateAgreesWithTheServer() {
+        makeTracks()
+        var generator = SeededGenerator(state: 99)
+        for _ in 0..<100 {
+            let size = Int.random(in: 0..<500, using: &generator)
+            let workload = SBPlaylistSyncTests.workload(size: size, edits: Int.random(in: 0..<100, using: &generator), using: &generator)
+            playlist.tracks = workload.old.map { tracks[$0]! }
+
+            // what the server ends up with, after we sent it the edit
+            let mutations = SBPlaylistSync.mutations(id: "p", from: workload.old, to: workload.new, maxBytes: SBPlaylistSync.maxQueryBytes)
+            let onServer = SBPlaylistSyncTests.apply(mutations, to: workload.old)
+            XCTAssertEqual(onServer, workload.new)
+
+            // ...and what we end up with, fetching it back
+            let entriesBefore = Set(playlist.entries?.array as? [SBPlaylistEntry] ?? [])
+            let (inserted, removed) = playlist.update(tracks: onServer.map { tracks[$0]! })
+            XCTAssertEqual(playlist.tracks?.map { $0.itemId! }, workload.new)
+            XCTAssertEqual(playlist.entries?.count, workload.new.count)
+
+            // entries that stayed are the same objects, so only the difference is written
+            let entriesAfter = Set(playlist.entries?.array as? [SBPlaylistEntry] ?? [])
+            XCTAssertEqual(entriesAfter.subtracting(entriesBefore).count, inserted)
+            XCTAssertEqual(entriesBefore.subtracting(entriesAfter).count, removed)
+            XCTAssertLessThanOrEqual(inserted + removed, workload.old.count + workload.new.count)
+            if workload.old == workload.new {
+                XCTAssertEqual(inserted + removed, 0)
+            }
+        }
+    }
+
+    // #MARK: - Benchmarks
+
+    func testBenchmarkSyncingEdits() {
+        var generator = SeededGenerator(state: 42)
+        let workloads = (0..<50).map { _ in
+            SBPlaylistSyncTests.workload(size: 2000, edits: 50, using: &generator)
+        }
+        var requests = 0
+        var bytes = 0
+        var replaceBytes = 0
+        measure {
+            requests = 0
+            bytes = 0
+            replaceBytes = 0
+            for workload in workloads {
+                let mutations = SBPlaylistSync.mutations(id: "p", from: workload.old, to: workload.new, maxBytes: SBPlaylistSync.maxQueryBytes)
+                requests += mutations.count
+                bytes += mutations.reduce(0) { $0 + SBPlaylistSync.trackBytes(of: $1) }
+                replaceBytes += SBPlaylistSync.trackBytes(of: .replacePlaylist(id: "p", trackIDs: workload.new))
+            }
+        }
+        // a handful of edits to a big playlist should cost a lot less to send than the whole thing
+        print("Syncing \(workloads.count) edits of 2000 track playlists: \(requests) requests, \(bytes) bytes, against \(replaceBytes) bytes replacing")
+        XCTAssertLessThan(bytes, replaceBytes)
+    }
+
+    func testBenchmarkApplyingServerOrder() {
+        makeTracks()
+        var generator = SeededGenerator(state: 43)
+        let workloads = (0..<10).map { _ in
+            SBPlaylistSyncTests.workload(size: 2000, edits: 50, using: &generator)
+        }
+        measure {
+            for workload in workloads {
+                playlist.tracks = workload.old.map { tracks[$0]! }
+                playlist.update(tracks: workload.new.map { tracks[$0]! })
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+//
+//  SBSearchIndexTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Searches local tracks through the index, which follows what's saved to the main context.
+final class SBSearchIndexTests: XCTestCase {
+    private var inserted: [NSManagedObject] = []
+
+    override func setUp() {
+        wait { SBSearchIndex.shared.isReady }
+    }
+
+    override func tearDown() {
+        // some tests delete their own
+        inserted.filter { $0.managedObjectContext != nil }.forEach { mainContext.delete($0) }
+        inserted.removeAll()
+        SBPersistence.shared.saveMainContext()
+    }
+
+    @discardableResult private func makeTrack(title: String, artist: String, album: String, genre: String? = nil) -> SBTrack {
+        let newArtist = SBArtist.insertInManagedObjectContext(context: mainContext)
+        newArtist.itemName = artist
+        newArtist.isLocal = true
+        let newAlbum = SBAlbum.insertInManagedObjectContext(context: mainContext)
+        newAlbum.itemName = album
+        newAlbum.isLocal = true
+        newAlbum.artist = newArtist
+        let track = SBTrack.insertInManagedObjectContext(context: mainContext)
+        track.itemName = title
+        track.artistName = artist
+        track.genre = genre
+        track.isLocal = true
+        track.album = newAlbum
+        inserted += [newArtist, newAlbum, track]
+        return track
+    }
+
+    private func search(_ query: String) -> [SBTrack] {
+        SBSearchIndex.shared.tracks(matching: query, in: mainContext)
+    }
+
+    // #MARK: - Tests
+
+    func testWordsAreFolded() {
+        XCTAssertEqual(SBSearchIndex.words(in: "Beyoncé — Crazy in Love (Remix)"), ["beyonce", "crazy", "in", "love", "remix"])
+        XCTAssertEqual(SBSearchIndex.words(in: "ＡＢＣ"), ["abc"])
+        XCTAssertEqual(SBSearchIndex.words(in: nil), [])
+    }
+
+    func testRanksBetterMatchesFirst() {
+        let title = makeTrack(title: "Blue Monday", artist: "New Order", album: "Power, Corruption & Lies", genre: "Synth-pop")
+        let artist = makeTrack(title: "Tinseltown in the Rain", artist: "The Blue Nile", album: "A Walk Across the Rooftops")
+        let genre = makeTrack(title: "Hoochie Coochie Man", artist: "Muddy Waters", album: "Hard Again", genre: "Blues")
+        SBPersistence.shared.saveMainContext()
+        wait { self.search("blue").count == 3 }
+
+        // a whole word in the title, then in the artist, then the start of one in the genre
+        XCTAssertEqual(search("blue"), [title, artist, genre])
+        XCTAssertEqual(search("BLÜE"), [title, artist, genre])
+        // every word has to match somewhere
+        XCTAssertEqual(search("blue order"), [title])
+        XCTAssertEqual(search("blue rooftops"), [artist])
+        XCTAssertEqual(search("blue jazz"), [])
+    }
+
+    func testFollowsSavedChanges() {
+        let track = makeTrack(title: "Ceremony", artist: "Joy Division", album: "Still")
+        SBPersistence.shared.saveMainContext()
+        wait { self.search("ceremony") == [track] }
+
+        track.itemName = "Atmosphere"
+        SBPersistence.shared.saveMainContext()
+        wait { self.search("atmosphere") == [track] }
+        XCTAssertEqual(search("ceremony"), [])
+
+        // renaming the album changes what its tracks match
+        track.album?.itemName = "Substance"
+        SBPersistence.shared.saveMainContext()
+        wait { self.search("substance") == [track] }
+
+        mainContext.delete(track)
+        SBPersistence.shared.saveMainContext()
+        wait { self.search("atmosphere").isEmpty }
+    }
+
+    func testBenchmarkSearchingALargeLibrary() {
+        let words = ["love", "night", "blue", "heart", "dream", "fire", "rain", "light", "river", "song", "dance", "gold",
+                     "moon", "road", "home", "city", "star", "wind", "stone", "sea"]
+        var generator = SBPlaylistSyncTests.SeededGenerator(state: 12)
+        let artists = (0..<200).map { i -> SBArtist in
+            let artist = SBArtist.insertInManagedObjectContext(context: mainContext)
+            artist.itemName = "\(words.randomElement(using: &generator)!.capitalized) Band \(i)"
+            artist.isLocal = true
+            return artist
+        }
+        let albums = (0..<2000).map { i -> SBAlbum in
+            let album = SBAlbum.insertInManagedObjectContext(context: mainContext)
+            album.itemName = "\(words.randomElement(using: &generator)!.capitalized) Album \(i)"
+            album.isLocal = true
+            album.artist = artists[i % artists.count]
+            return album
+        }
+        inserted += artists
+        inserted += albums
+        let trackCount = 20_000
+        for i in 0..<trackCount {
+            let track = SBTrack.insertInManagedObjectContext(context: mainContext)
+            let title = (0..<3).map { _ in words.randomElement(using: &generator)! }.joined(separator: " ")
+            track.itemName = "\(title) \(i)"
+            track.artistName = albums[i % albums.count].artist?.itemName
+            track.isLocal = true
+            track.album = albums[i % albums.count]
+            inserted.append(track)
+        }
+        let indexStart = Date()
+        SBPersistence.shared.saveMainContext()
+        wait(timeout: 60) { self.search("\(trackCount - 1)").count == 1 }
+        print("Indexed \(trackCount) tracks in \(String(format: "%.1f", Date().timeIntervalSince(indexStart))) seconds")
+
+        let queries = ["lo", "blue", "night rain", "heart band", "gold album", "stone sea 19", "d"]
+        measure {
+            for query in queries {
+                XCTAssertFalse(search(query).isEmpty, query)
+            }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+//
+//  SBServerPollerTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Polls a stand-in server that always says the same about who's playing what, and one that finishes a scan,
+/// checking polls share requests already out, don't write what hasn't changed, and stop when the scan does.
+final class SBServerPollerTests: XCTestCase {
+    static let nowPlaying = #"<nowPlaying><entry id="playing-1" title="Song" album="Album" albumId="playing-album" artist="Artist" artistId="playing-artist" duration="200" type="music" username="someone" minutesAgo="2" playerId="1"/></nowPlaying>"#
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+
+    private let lock = NSLock()
+    private var scanStatuses: [Bool] = []
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("getNowPlaying") { _ in
+            .subsonic(SBServerPollerTests.nowPlaying)
+        }
+        standIn.handle("getScanStatus") { [unowned self] _ in
+            self.lock.lock()
+            defer { self.lock.unlock() }
+            let scanning = self.scanStatuses.isEmpty ? false : self.scanStatuses.removeFirst()
+            return .subsonic(#"<scanStatus scanning="\#(scanning)" count="\#(scanning ? 100 : 200)"/>"#)
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+    }
+
+    private func counts(_ endpoint: SBServerPoller.Endpoint) -> SBServerPoller.Counts? {
+        SBServerPoller.shared.counts(for: server, endpoint)
+    }
+
+    /// Waits for every poll sent so far to be done.
+    private func waitForPolls(_ endpoint: SBServerPoller.Endpoint, requests: Int, timeout: TimeInterval = 10) {
+        wait(timeout: timeout) {
+            guard let counts = self.counts(endpoint) else {
+                return false
+            }
+            return counts.requests == requests && !counts.inFlight
+        }
+    }
+
+    // #MARK: - Tests
+
+    func testNowPlayingJoinsAndSkipsWhatHasNotChanged() {
+        let poller = SBServerPoller.shared
+        standIn.setLatency(0.5, for: "getNowPlaying")
+
+        // asking again while the first is out waits for that one
+        for _ in 0..<3 {
+            poller.refresh(.nowPlaying, server: server)
+        }
+        waitForPolls(.nowPlaying, requests: 1)
+        XCTAssertEqual(standIn.requests(for: "getNowPlaying"), 1)
+        XCTAssertEqual(counts(.nowPlaying)?.joined, 2)
+        // the first time, there's a row to insert
+        let firstWrites = counts(.nowPlaying)?.writes ?? 0
+        XCTAssertGreaterThan(firstWrites, 0)
+        wait { self.server.nowPlayings?.count == 1 }
+
+        // the same answer again doesn't write anything
+        poller.refresh(.nowPlaying, server: server)
+        waitForPolls(.nowPlaying, requests: 2)
+        XCTAssertEqual(standIn.requests(for: "getNowPlaying"), 2)
+        XCTAssertEqual(counts(.nowPlaying)?.writes, firstWrites)
+        XCTAssertEqual(counts(.nowPlaying)?.unchanged, 1)
+        XCTAssertEqual(server.nowPlayings?.count, 1)
+
+        // nothing's showing it, so it doesn't poll on its own
+        XCTAssertEqual(counts(.nowPlaying)?.repeating, false)
+    }
+
+    func testScanStatusStopsWhenTheScanIsDone() {
+        lock.lock()
+        scanStatuses = [true, true]
+        lock.unlock()
+
+        SBServerPoller.shared.followScan(server: server)
+        XCTAssertEqual(counts(.scanStatus)?.repeating, true)
+        // two polls still scanning, then the one that says it's done, each waiting longer than the last
+        let interval = SBServerPoller.scanInitialInterval
+        let expected = interval * (1 + SBServerPoller.backoffFactor + pow(SBServerPoller.backoffFactor, 2))
+        waitForPolls(.scanStatus, requests: 3, timeout: expected + 5)
+        XCTAssertEqual(counts(.scanStatus)?.repeating, false)
+
+        // and that's the last of them
+        settle(for: interval * pow(SBServerPoller.backoffFactor, 3) + 1)
+        XCTAssertEqual(standIn.requests(for: "getScanStatus"), 3)
+        XCTAssertEqual(counts(.scanStatus)?.requests, 3)
+    }
+}
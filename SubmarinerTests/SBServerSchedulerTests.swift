@@ -0,0 +1,120 @@
+//
+//  SBServerSchedulerTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Sends requests through the scheduler's lanes to a stand-in server, checking slow background traffic doesn't hold
+/// up what the user is waiting on, and that changes to the server go one at a time in order.
+final class SBServerSchedulerTests: XCTestCase {
+    static let backgroundLatency: TimeInterval = 3
+    /// How long a request the user is waiting on can take, which is well under one background response.
+    static let interactiveBound: TimeInterval = 1
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+    private var operations: [Operation] = []
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        operations.forEach { $0.cancel() }
+        operations.removeAll()
+        standIn.stop()
+        removeServer(server)
+    }
+
+    private func add(_ type: SBSubsonicRequestType, delivered: ((Error?) -> Void)? = nil) {
+        let request = SBSubsonicRequestOperation(server: server, request: type)
+        request.presentsErrors = false
+        request.deliveryHandler = delivered
+        operations.append(request)
+        SBServerScheduler.shared.add(request)
+    }
+
+    // #MARK: - Tests
+
+    func testInteractiveRequestsGetPastSlowBackgroundTraffic() {
+        standIn.setLatency(SBServerSchedulerTests.backgroundLatency, for: "scrobble")
+        let backgroundLimit = max(1, max(1, UserDefaults.standard.maxConcurrentServerRequests) / 2)
+        for i in 0..<(backgroundLimit * 4) {
+            add(.scrobble(ids: ["track-\(i)"], times: [Date()]))
+        }
+        // the background lane is full, with more waiting behind it
+        wait { self.standIn.requests(for: "scrobble") == backgroundLimit }
+
+        let lock = NSLock()
+        var deliveredAfter: TimeInterval?
+        let asked = Date()
+        add(.ping) { error in
+            XCTAssertNil(error)
+            lock.lock()
+            deliveredAfter = Date().timeIntervalSince(asked)
+            lock.unlock()
+        }
+        wait(timeout: SBServerSchedulerTests.backgroundLatency) {
+            lock.lock()
+            defer { lock.unlock() }
+            return deliveredAfter != nil
+        }
+
+        lock.lock()
+        defer { lock.unlock() }
+        print("Ping delivered \(String(format: "%.0f", (deliveredAfter ?? .infinity) * 1000)) ms after asking, behind \(backgroundLimit) slow background requests")
+        XCTAssertLessThan(deliveredAfter ?? .infinity, SBServerSchedulerTests.interactiveBound)
+        // and the background lane never took more than its share
+        XCTAssertEqual(standIn.requests(for: "scrobble"), backgroundLimit)
+    }
+
+    func testMutationsGoOneAtATimeInOrder() {
+        let mutationCount = 8
+        standIn.setLatency(0.1, for: "star")
+        standIn.setLatency(0.1, for: "unstar")
+        let lock = NSLock()
+        var received: [String] = []
+        var delivered: [String] = []
+        for endpoint in ["star", "unstar"] {
+            standIn.handle(endpoint) { request in
+                lock.lock()
+                received.append("\(endpoint) \(request.parameter("id") ?? "")")
+                lock.unlock()
+                return .subsonic()
+            }
+        }
+
+        var expected: [String] = []
+        for i in 0..<mutationCount {
+            let starring = i % 3 != 2
+            let name = "\(starring ? "star" : "unstar") track-\(i)"
+            expected.append(name)
+            let type: SBSubsonicRequestType = starring
+                ? .star(ids: ["track-\(i)"], albumIDs: [], artistIDs: [])
+                : .unstar(ids: ["track-\(i)"], albumIDs: [], artistIDs: [])
+            add(type) { error in
+                XCTAssertNil(error)
+                lock.lock()
+                delivered.append(name)
+                lock.unlock()
+            }
+        }
+        wait {
+            lock.lock()
+            defer { lock.unlock() }
+            return delivered.count == mutationCount
+        }
+
+        lock.lock()
+        defer { lock.unlock() }
+        XCTAssertEqual(received, expected)
+        XCTAssertEqual(delivered, expected)
+        XCTAssertEqual(standIn.maxInFlight, 1)
+    }
+}
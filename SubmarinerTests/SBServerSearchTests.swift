@@ -0,0 +1,65 @@
+//
+//  SBServerSearchTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Searches a stand-in server for tracks the library doesn't have yet, which the parse creates.
+final class SBServerSearchTests: XCTestCase {
+    static let songCount = 40
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+    private var observer: NSObjectProtocol?
+    private var results: [SBSearchResult] = []
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("search3") { request in
+            let query = request.parameter("query") ?? ""
+            let songs = (0..<SBServerSearchTests.songCount).map { i in
+                #"<song id="\#(query)-\#(i)" title="\#(query) \#(i)" album="Album" albumId="album-\#(query)" artist="Artist" artistId="artist-\#(query)" duration="180"/>"#
+            }
+            return .subsonic("<searchResult3>\(songs.joined())</searchResult3>")
+        }
+        server = makeServer(standIn: standIn)
+        observer = NotificationCenter.default.addObserver(forName: .SBServerSearchResultReady, object: nil, queue: nil) { [unowned self] notification in
+            if let result = notification.object as? SBSearchResult {
+                self.results.append(result)
+            }
+        }
+    }
+
+    override func tearDown() {
+        if let observer = self.observer {
+            NotificationCenter.default.removeObserver(observer)
+        }
+        standIn.stop()
+        removeServer(server)
+    }
+
+    func testNewTracksShowUpInResults() {
+        let query = "new-\(UUID().uuidString.prefix(8))"
+        SBServerSearchPipeline.shared.search(query: query, server: server)
+        wait { !self.results.isEmpty }
+
+        // none of these were in the library, so every one had a temporary ID while parsing
+        let tracks = results[0].tracks
+        XCTAssertEqual(tracks.count, SBServerSearchTests.songCount)
+        XCTAssertEqual(tracks.map { $0.itemId }, (0..<SBServerSearchTests.songCount).map { "\(query)-\($0)" })
+        XCTAssertTrue(tracks.allSatisfy { !$0.objectID.isTemporaryID })
+        // and they're the parsed tracks, not faults that can't be filled in
+        XCTAssertEqual(tracks.map { $0.itemName }, (0..<SBServerSearchTests.songCount).map { "\(query) \($0)" })
+
+        // the cached page has the same IDs, so asking again still finds them
+        SBServerSearchPipeline.shared.search(query: query, server: server)
+        wait { self.results.count == 2 }
+        XCTAssertEqual(results[1].tracks, tracks)
+        XCTAssertEqual(standIn.requests(for: "search3"), 1)
+    }
+}
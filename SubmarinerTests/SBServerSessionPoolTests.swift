@@ -0,0 +1,64 @@
+//
+//  SBServerSessionPoolTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Sends a burst of requests to a stand-in server, checking they share a few kept-alive connections.
+final class SBServerSessionPoolTests: XCTestCase {
+    static let requestCount = 60
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("ping") { _ in
+            .subsonic()
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+    }
+
+    func testSessionIsSharedPerServer() {
+        let pool = SBServerSessionPool.shared
+        XCTAssertTrue(pool.session(for: server.objectID) === pool.session(for: server.objectID))
+
+        let other = makeServer(standIn: standIn, name: "Other Stand-In")
+        XCTAssertFalse(pool.session(for: server.objectID) === pool.session(for: other.objectID))
+        removeServer(other)
+    }
+
+    func testRequestsReuseConnections() {
+        let pool = SBServerSessionPool.shared
+        let openedBefore = pool.connectionsOpened
+        let servedBefore = pool.requestsServed
+
+        for _ in 0..<SBServerSessionPoolTests.requestCount {
+            SBServerScheduler.shared.add(SBSubsonicRequestOperation(server: server, request: .ping))
+        }
+        wait { self.standIn.requests(for: "ping") == SBServerSessionPoolTests.requestCount }
+        // metrics come in after the response
+        wait { pool.requestsServed - servedBefore >= SBServerSessionPoolTests.requestCount }
+
+        let opened = pool.connectionsOpened - openedBefore
+        let served = pool.requestsServed - servedBefore
+        print("Opened \(opened) connections for \(served) requests, \(standIn.connectionsAccepted) accepted by the stand-in")
+        // what the client thinks it opened is what the server saw
+        XCTAssertEqual(opened, standIn.connectionsAccepted)
+        // no more than the session allows at once, however many requests there were
+        let configuration = pool.session(for: server.objectID).configuration
+        XCTAssertLessThanOrEqual(standIn.connectionsAccepted, configuration.httpMaximumConnectionsPerHost)
+        XCTAssertLessThan(standIn.connectionsAccepted, SBServerSessionPoolTests.requestCount / 4)
+        XCTAssertGreaterThan(1 - Double(opened) / Double(served), 0.75)
+    }
+}
@@ -0,0 +1,390 @@
+//
+//  SBStandInServer.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+import Network
+
+/// A small HTTP server on the loopback interface, standing in for a Subsonic server.
+///
+/// - Each endpoint (i.e. `ping` for `/rest/ping.view`) is answered by a handler. Endpoints without one get an empty
+///   successful Subsonic response.
+/// - Connections are kept alive, and byte ranges are honoured for successful responses.
+/// - Requests, bytes served and connections accepted are counted. Responses can be held back, and bodies sent slowly,
+///   to act like a slow server.
+final class SBStandInServer {
+    /// Most of a body to send at once.
+    static let chunkSize = 64 * 1024
+
+    struct Request {
+        let method: String
+        let path: String
+        let headers: [String: String]
+        let parameters: [URLQueryItem]
+
+        /// The endpoint, without `/rest/` and `.view`.
+        var endpoint: String {
+            var name = path
+            if name.hasPrefix("/rest/") {
+                name.removeFirst("/rest/".count)
+            }
+            if name.hasSuffix(".view") {
+                name.removeLast(".view".count)
+            }
+            return name
+        }
+
+        /// A parameter from the query string or the form body.
+        func parameter(_ name: String) -> String? {
+            parameters.first { $0.name == name }?.value
+        }
+
+        /// Every value of a parameter that can be repeated, in order.
+        func parameters(_ name: String) -> [String] {
+            parameters.filter { $0.name == name }.compactMap { $0.value }
+        }
+    }
+
+    struct Response {
+        var status = 200
+        var headers: [String: String] = [:]
+        var body = Data()
+
+        /// A successful Subsonic response, around the given elements.
+        static func subsonic(_ elements: String = "") -> Response {
+            let xml = """
+                <?xml version="1.0" encoding="UTF-8"?>
+                <subsonic-response xmlns="http://subsonic.org/restapi" status="ok" version="1.16.1">\(elements)</subsonic-response>
+                """
+            return Response(headers: ["Content-Type": "text/xml; charset=utf-8"], body: Data(xml.utf8))
+        }
+
+        static func data(_ body: Data, contentType: String) -> Response {
+            Response(headers: ["Content-Type": contentType], body: body)
+        }
+    }
+
+    typealias Handler = (Request) -> Response
+
+    var baseURL: URL {
+        URL(string: "http://127.0.0.1:\(listener.port!.rawValue)")!
+    }
+
+    private let listener: NWListener
+    private let queue = DispatchQueue(label: "SBStandInServer")
+
+    private let lock = NSLock()
+    private var handlers: [String: Handler] = [:]
+    private var _latency: TimeInterval = 0
+    private var endpointLatencies: [String: TimeInterval] = [:]
+    private var requestCounts: [String: Int] = [:]
+    private var _bytesPerSecond = 0
+    private var bytesServedCounts: [String: Int] = [:]
+    private var requestedRanges: [String: [Range<Int>]] = [:]
+    private var connections: [NWConnection] = []
+    private var _connectionsAccepted = 0
+    private var _inFlight = 0
+    private var _maxInFlight = 0
+
+    init() throws {
+        let parameters = NWParameters.tcp
+        parameters.requiredLocalEndpoint = NWEndpoint.hostPort(host: .ipv4(.loopback), port: .any)
+        listener = try NWListener(using: parameters)
+
+        let ready = DispatchSemaphore(value: 0)
+        var failure: Error?
+        listener.stateUpdateHandler = { state in
+            switch state {
+            case .ready:
+                ready.signal()
+            case .failed(let error):
+                failure = error
+                ready.signal()
+            default:
+                break
+            }
+        }
+        listener.newConnectionHandler = { [weak self] connection in
+            self?.accept(connection)
+        }
+        listener.start(queue: queue)
+        ready.wait()
+        listener.stateUpdateHandler = nil
+        if let failure = failure {
+            throw failure
+        }
+    }
+
+    deinit {
+        stop()
+    }
+
+    /// Stops listening, and closes the connections still open.
+    func stop() {
+        listener.cancel()
+        lock.lock()
+        let connections = self.connections
+        self.connections.removeAll()
+        lock.unlock()
+        connections.forEach { $0.cancel() }
+    }
+
+    // #MARK: - Configuring
+
+    /// Answers requests for an endpoint. Handlers are called on the server's own queue.
+    func handle(_ endpoint: String, with handler: @escaping Handler) {
+        lock.lock()
+        handlers[endpoint] = handler
+        lock.unlock()
+    }
+
+    /// How long every response waits before it's sent.
+    var latency: TimeInterval {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return _latency
+        }
+        set {
+            lock.lock()
+            _latency = newValue
+            lock.unlock()
+        }
+    }
+
+    /// Makes responses for one endpoint wait longer or shorter than the rest.
+    func setLatency(_ latency: TimeInterval, for endpoint: String) {
+        lock.lock()
+        endpointLatencies[endpoint] = latency
+        lock.unlock()
+    }
+
+    /// How fast bodies are sent, or 0 for as fast as they can go.
+    var bytesPerSecond: Int {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return _bytesPerSecond
+        }
+        set {
+            lock.lock()
+            _bytesPerSecond = newValue
+            lock.unlock()
+        }
+    }
+
+    // #MARK: - Counting
+
+    func requests(for endpoint: String) -> Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return requestCounts[endpoint] ?? 0
+    }
+
+    var totalRequests: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return requestCounts.values.reduce(0, +)
+    }
+
+    /// Bytes of response bodies sent for an endpoint, including ones the client hung up on partway.
+    func bytesServed(for endpoint: String) -> Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return bytesServedCounts[endpoint] ?? 0
+    }
+
+    /// The part of the whole body each successful response for an endpoint was for, in the order they were asked for.
+    func ranges(for endpoint: String) -> [Range<Int>] {
+        lock.lock()
+        defer { lock.unlock() }
+        return requestedRanges[endpoint] ?? []
+    }
+
+    var connectionsAccepted: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return _connectionsAccepted
+    }
+
+    /// The most requests that were waiting on a response at once.
+    var maxInFlight: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return _maxInFlight
+    }
+
+    // #MARK: - Connections
+
+    private func accept(_ connection: NWConnection) {
+        lock.lock()
+        connections.append(connection)
+        _connectionsAccepted += 1
+        lock.unlock()
+        connection.start(queue: queue)
+        receive(on: connection, buffer: Data())
+    }
+
+    /// Answers the requests in what's been received, one at a time, then waits for more.
+    private func receive(on connection: NWConnection, buffer: Data) {
+        if let (request, rest) = SBStandInServer.parse(buffer) {
+            respond(to: request, on: connection) {
+                self.receive(on: connection, buffer: rest)
+            }
+            return
+        }
+        connection.receive(minimumIncompleteLength: 1, maximumLength: 64 * 1024) { data, _, isComplete, error in
+            if let data = data, !data.isEmpty {
+                self.receive(on: connection, buffer: buffer + data)
+            } else if isComplete || error != nil {
+                connection.cancel()
+            } else {
+                self.receive(on: connection, buffer: buffer)
+            }
+        }
+    }
+
+    /// Takes one request off the front of what's been received, if all of it is there.
+    private static func parse(_ buffer: Data) -> (Request, Data)? {
+        guard let headerEnd = buffer.range(of: Data("\r\n\r\n".utf8)),
+              let head = String(data: buffer[buffer.startIndex..<headerEnd.lowerBound], encoding: .utf8) else {
+            return nil
+        }
+        var lines = head.components(separatedBy: "\r\n")
+        let requestLine = lines.removeFirst().split(separator: " ")
+        guard requestLine.count >= 2 else {
+            return nil
+        }
+        var headers: [String: String] = [:]
+        for line in lines {
+            guard let colon = line.firstIndex(of: ":") else {
+                continue
+            }
+            let name = line[..<colon].lowercased()
+            headers[name] = line[line.index(after: colon)...].trimmingCharacters(in: .whitespaces)
+        }
+        let bodyLength = headers["content-length"].flatMap { Int($0) } ?? 0
+        guard buffer.endIndex - headerEnd.upperBound >= bodyLength else {
+            return nil
+        }
+        let bodyEnd = headerEnd.upperBound + bodyLength
+        let body = buffer[headerEnd.upperBound..<bodyEnd]
+
+        let components = URLComponents(string: String(requestLine[1]))
+        var parameters = components?.queryItems ?? []
+        if headers["content-type"]?.hasPrefix("application/x-www-form-urlencoded") == true,
+           let form = String(data: body, encoding: .utf8) {
+            var formComponents = URLComponents()
+            // form bodies encode spaces as plus signs, which queries don't
+            formComponents.percentEncodedQuery = form.replacingOccurrences(of: "+", with: "%20")
+            parameters += formComponents.queryItems ?? []
+        }
+        let request = Request(method: String(requestLine[0]),
+                              path: components?.path ?? String(requestLine[1]),
+                              headers: headers,
+                              parameters: parameters)
+        return (request, Data(buffer[bodyEnd...]))
+    }
+
+    // must be on queue
+    private func respond(to request: Request, on connection: NWConnection, then next: @escaping () -> Void) {
+        lock.lock()
+        requestCounts[request.endpoint, default: 0] += 1
+        _inFlight += 1
+        _maxInFlight = max(_maxInFlight, _inFlight)
+        let handler = handlers[request.endpoint]
+        let latency = endpointLatencies[request.endpoint] ?? _latency
+        lock.unlock()
+
+        queue.asyncAfter(deadline: .now() + latency) {
+            var response = handler?(request) ?? .subsonic()
+            var served = 0..<response.body.count
+            if response.status == 200, let range = request.headers["range"].flatMap({ SBStandInServer.range($0, length: response.body.count) }) {
+                response.headers["Content-Range"] = "bytes \(range.lowerBound)-\(range.upperBound - 1)/\(response.body.count)"
+                response.status = 206
+                response.body = response.body.subdata(in: range)
+                served = range
+            }
+
+            if response.status == 200 || response.status == 206 {
+                self.lock.lock()
+                self.requestedRanges[request.endpoint, default: []].append(served)
+                self.lock.unlock()
+            }
+
+            var head = "HTTP/1.1 \(response.status) \(HTTPURLResponse.localizedString(forStatusCode: response.status).capitalized)\r\n"
+            response.headers["Content-Length"] = String(response.body.count)
+            response.headers["Accept-Ranges"] = "bytes"
+            for (name, value) in response.headers {
+                head += "\(name): \(value)\r\n"
+            }
+            head += "\r\n"
+
+            connection.send(content: Data(head.utf8), completion: .contentProcessed { error in
+                guard error == nil else {
+                    self.finished(request, on: connection, sent: false, then: next)
+                    return
+                }
+                self.send(response.body, from: 0, for: request, on: connection) { sent in
+                    self.finished(request, on: connection, sent: sent, then: next)
+                }
+            })
+        }
+    }
+
+    /// Sends a body a chunk at a time, at no more than `bytesPerSecond`, counting what's sent as it goes.
+    // must be on queue
+    private func send(_ body: Data, from offset: Int, for request: Request, on connection: NWConnection, completion: @escaping (Bool) -> Void) {
+        guard offset < body.count else {
+            completion(true)
+            return
+        }
+        lock.lock()
+        let bytesPerSecond = _bytesPerSecond
+        lock.unlock()
+        let chunkSize = bytesPerSecond > 0 ? max(1, min(SBStandInServer.chunkSize, bytesPerSecond / 10)) : body.count
+        let chunk = body.subdata(in: offset..<min(offset + chunkSize, body.count))
+        connection.send(content: chunk, completion: .contentProcessed { error in
+            guard error == nil else {
+                completion(false)
+                return
+            }
+            self.lock.lock()
+            self.bytesServedCounts[request.endpoint, default: 0] += chunk.count
+            self.lock.unlock()
+            let delay = bytesPerSecond > 0 ? Double(chunk.count) / Double(bytesPerSecond) : 0
+            self.queue.asyncAfter(deadline: .now() + delay) {
+                self.send(body, from: offset + chunk.count, for: request, on: connection, completion: completion)
+            }
+        })
+    }
+
+    // must be on queue
+    private func finished(_ request: Request, on connection: NWConnection, sent: Bool, then next: @escaping () -> Void) {
+        lock.lock()
+        _inFlight -= 1
+        lock.unlock()
+        if sent {
+            next()
+        } else {
+            connection.cancel()
+        }
+    }
+
+    /// The bytes a Range header asks for, if it's a single range that can be served.
+    private static func range(_ header: String, length: Int) -> Range<Int>? {
+        guard header.hasPrefix("bytes="), !header.contains(",") else {
+            return nil
+        }
+        let bounds = header.dropFirst("bytes=".count).split(separator: "-", omittingEmptySubsequences: false)
+        guard bounds.count == 2, let start = Int(bounds[0]), start < length else {
+            return nil
+        }
+        let end = bounds[1].isEmpty ? length : min(length, (Int(bounds[1]) ?? length - 1) + 1)
+        return start < end ? start..<end : nil
+    }
+}
@@ -0,0 +1,121 @@
+//
+//  SBStreamedParseMemoryTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Parses bigger and bigger getArtists responses from a stand-in server, watching how much memory the parse takes.
+///
+/// What's saved stays in the (in-memory) store, so resident size after a parse grows with the response no matter
+/// what. The streamed parse should only need a chunk's worth on top of that while it runs, however big the response.
+final class SBStreamedParseMemoryTests: XCTestCase {
+    static let artistCounts = [10_000, 40_000, 160_000]
+    /// How much more the biggest response can take on top of what it leaves behind than the smallest does.
+    static let allowedGrowth = 16 * 1024 * 1024
+
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+    private var body = Data()
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        standIn.handle("getArtists") { [unowned self] _ in
+            .data(self.body, contentType: "text/xml; charset=utf-8")
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+        body = Data()
+    }
+
+    /// A getArtists response with new IDs each time, so every parse inserts them all and deletes the last ones.
+    private func artists(count: Int, run: Int) -> Data {
+        var xml = #"<?xml version="1.0" encoding="UTF-8"?><subsonic-response xmlns="http://subsonic.org/restapi" status="ok" version="1.16.1"><artists ignoredArticles="The">"#
+        let perIndex = count / 26 + 1
+        for letter in 0..<26 {
+            let name = String(UnicodeScalar(UInt8(65 + letter)))
+            xml += #"<index name="\#(name)">"#
+            for i in (letter * perIndex)..<min((letter + 1) * perIndex, count) {
+                xml += #"<artist id="artist-\#(run)-\#(i)" name="\#(name) Artist \#(i)" albumCount="\#(i % 7 + 1)"/>"#
+            }
+            xml += "</index>"
+        }
+        xml += "</artists></subsonic-response>"
+        return Data(xml.utf8)
+    }
+
+    private func residentSize() -> UInt64 {
+        var info = mach_task_basic_info()
+        var count = mach_msg_type_number_t(MemoryLayout<mach_task_basic_info>.size / MemoryLayout<natural_t>.size)
+        let result = withUnsafeMutablePointer(to: &info) {
+            $0.withMemoryRebound(to: integer_t.self, capacity: Int(count)) {
+                task_info(mach_task_self_, task_flavor_t(MACH_TASK_BASIC_INFO), $0, &count)
+            }
+        }
+        return result == KERN_SUCCESS ? info.resident_size : 0
+    }
+
+    /// Fetches and parses the current body, returning the most memory resident while it did, and after.
+    private func parseArtists() -> (peak: UInt64, after: UInt64) {
+        // resident_size_max is for the whole process, so this samples the current size instead
+        let lock = NSLock()
+        var peak = residentSize()
+        let sampler = DispatchSource.makeTimerSource(queue: DispatchQueue.global(qos: .userInitiated))
+        sampler.schedule(deadline: .now(), repeating: .milliseconds(5))
+        sampler.setEventHandler {
+            let size = self.residentSize()
+            lock.lock()
+            peak = max(peak, size)
+            lock.unlock()
+        }
+
+        var updated = false
+        let observer = NotificationCenter.default.addObserver(forName: .SBSubsonicIndexesUpdated, object: nil, queue: nil) { _ in
+            updated = true
+        }
+        sampler.resume()
+        server.getArtists()
+        wait(timeout: 120) { updated }
+        // let what's saved merge into the main context, as it would before anything's shown
+        settle(for: 1)
+        sampler.cancel()
+        NotificationCenter.default.removeObserver(observer)
+
+        lock.lock()
+        defer { lock.unlock() }
+        return (peak, residentSize())
+    }
+
+    private func artistCount() -> Int {
+        let fetchRequest = NSFetchRequest<SBArtist>(entityName: "Artist")
+        fetchRequest.predicate = NSPredicate(format: "server == %@", server)
+        return (try? mainContext.count(for: fetchRequest)) ?? 0
+    }
+
+    // #MARK: - Tests
+
+    func testPeakMemoryStaysFlatAsResponsesGrow() {
+        var overheads: [Int] = []
+        for (run, count) in SBStreamedParseMemoryTests.artistCounts.enumerated() {
+            // made before measuring, since the stand-in is in the same process
+            body = artists(count: count, run: run)
+            let (peak, after) = parseArtists()
+            XCTAssertEqual(artistCount(), count)
+
+            let overhead = Int(peak) - Int(after)
+            overheads.append(overhead)
+            print("\(count) artists, \(body.count / 1024) KB response: peak \(peak / 1024 / 1024) MB, \(after / 1024 / 1024) MB after, \(max(overhead, 0) / 1024) KB more while parsing")
+        }
+        XCTAssertEqual(standIn.requests(for: "getArtists"), SBStreamedParseMemoryTests.artistCounts.count)
+        // the biggest response is 16 times the smallest, but shouldn't take much more to parse
+        XCTAssertLessThan(overheads.last!, max(overheads.first!, 0) + SBStreamedParseMemoryTests.allowedGrowth)
+    }
+}
@@ -0,0 +1,114 @@
+//
+//  SBStreamingDownloadTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+import AVFoundation
+@testable import Submariner
+
+/// Plays tracks from a streaming download of a stand-in server's file, counting the bytes it serves.
+final class SBStreamingDownloadTests: XCTestCase {
+    private var standIn: SBStandInServer!
+    private var server: SBServer!
+    private let audio = SBTestAudio.aiff(seconds: 30)
+
+    override func setUpWithError() throws {
+        standIn = try SBStandInServer()
+        let audio = self.audio
+        standIn.handle("download") { _ in
+            .data(audio, contentType: "audio/aiff")
+        }
+        // nothing should be played from stream.view, since that would be fetching the track twice
+        standIn.handle("stream") { _ in
+            SBStandInServer.Response(status: 500)
+        }
+        server = makeServer(standIn: standIn)
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        removeServer(server)
+    }
+
+    private func makeDownload() -> (SBStreamingDownloadOperation, AVURLAsset) {
+        let track = SBTrack.insertInManagedObjectContext(context: mainContext)
+        track.itemId = UUID().uuidString
+        track.itemName = "Sine"
+        track.contentType = "audio/aiff"
+        track.server = server
+        SBPersistence.shared.saveMainContext()
+        XCTAssertTrue(SBStreamingDownloadOperation.canStream(track: track))
+
+        let download = SBStreamingDownloadOperation(managedObjectContext: mainContext, track: track)
+        let asset = AVURLAsset(url: download.assetURL)
+        asset.resourceLoader.setDelegate(download, queue: download.queue)
+        return (download, asset)
+    }
+
+    private func loadDuration(of asset: AVURLAsset) -> CMTime {
+        var loaded = false
+        asset.loadValuesAsynchronously(forKeys: ["duration", "tracks"]) {
+            loaded = true
+        }
+        wait { loaded }
+        return asset.duration
+    }
+
+    // #MARK: - Tests
+
+    func testPlaysWhileFetchingEachByteOnce() {
+        let (download, asset) = makeDownload()
+        var finished = false
+        download.completion = {
+            finished = true
+        }
+        download.start()
+
+        XCTAssertEqual(loadDuration(of: asset).seconds, 30, accuracy: 0.1)
+        wait { finished }
+
+        XCTAssertEqual(standIn.requests(for: "stream"), 0)
+        XCTAssertEqual(standIn.ranges(for: "download"), [0..<audio.count])
+        XCTAssertEqual(standIn.bytesServed(for: "download"), audio.count)
+    }
+
+    func testSeekingMovesTheDownloadThenFillsTheGap() {
+        // slow enough that the player wants the end well before the download gets there
+        standIn.bytesPerSecond = 512 * 1024
+        let (download, asset) = makeDownload()
+        var finished = false
+        download.completion = {
+            finished = true
+        }
+        download.start()
+
+        let player = AVPlayer(playerItem: AVPlayerItem(asset: asset))
+        player.volume = 0
+        wait { player.currentItem?.status == .readyToPlay }
+        var sought = false
+        player.seek(to: CMTime(seconds: 25, preferredTimescale: 44100)) { _ in
+            sought = true
+        }
+        player.play()
+        wait { sought }
+        wait { player.currentTime().seconds > 25.2 }
+        player.pause()
+
+        // it moved to where the player was, instead of making it wait for everything before
+        let ranges = standIn.ranges(for: "download")
+        XCTAssertGreaterThan(ranges.count, 1)
+        XCTAssertFalse(finished, "The download shouldn't have finished before the player got what it wanted")
+
+        wait(timeout: 30) { finished }
+        XCTAssertEqual(standIn.requests(for: "stream"), 0)
+        // the gap is fetched from where the first request got to, not from the start again
+        let starts = standIn.ranges(for: "download").map { $0.lowerBound }
+        XCTAssertEqual(Set(starts).count, starts.count)
+        // only what was on the way when it moved is sent twice
+        XCTAssertLessThan(standIn.bytesServed(for: "download"), audio.count + 512 * 1024)
+    }
+}
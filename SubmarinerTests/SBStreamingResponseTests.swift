@@ -0,0 +1,99 @@
+//
+//  SBStreamingResponseTests.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Streams a big response from a stand-in server to a reader much slower than the server, checking what's waiting
+/// to be read stays bounded instead of growing with the response.
+final class SBStreamingResponseTests: XCTestCase {
+    static let bodySize = 16 * 1024 * 1024
+    static let readSize = 16 * 1024
+
+    private var standIn: SBStandInServer!
+    private var body = Data()
+
+    override func setUpWithError() throws {
+        // the same random block over and over, numbered so anything out of order shows up
+        var generator = SBPlaylistSyncTests.SeededGenerator(state: 3)
+        let block = (0..<SBStreamingResponseTests.readSize).map { _ in UInt8.random(in: 0...255, using: &generator) }
+        body = Data(capacity: SBStreamingResponseTests.bodySize)
+        for i in 0..<(SBStreamingResponseTests.bodySize / block.count) {
+            body.append(contentsOf: withUnsafeBytes(of: UInt32(i).bigEndian) { Array($0) })
+            body.append(contentsOf: block.dropFirst(4))
+        }
+        standIn = try SBStandInServer()
+        standIn.handle("getArtists") { [unowned self] _ in
+            .data(self.body, contentType: "text/xml; charset=utf-8")
+        }
+    }
+
+    override func tearDown() {
+        standIn.stop()
+        body = Data()
+    }
+
+    func testSlowReaderHoldsOffTheServer() {
+        let streamingResponse = SBSubsonicStreamingResponse()
+        let lock = NSLock()
+        var received = Data()
+        var done = false
+        var completed = false
+        var completionError: Error?
+
+        streamingResponse.onResponse = { _, stream in
+            // the parser, but slower
+            Thread.detachNewThread {
+                stream.open()
+                var buffer = [UInt8](repeating: 0, count: SBStreamingResponseTests.readSize)
+                while true {
+                    let read = stream.read(&buffer, maxLength: buffer.count)
+                    if read <= 0 {
+                        break
+                    }
+                    lock.lock()
+                    received.append(buffer, count: read)
+                    lock.unlock()
+                    Thread.sleep(forTimeInterval: 0.001)
+                }
+                stream.close()
+                lock.lock()
+                done = true
+                lock.unlock()
+            }
+            return true
+        }
+        streamingResponse.onComplete = { error, _ in
+            lock.lock()
+            completionError = error
+            completed = true
+            lock.unlock()
+        }
+
+        let session = URLSession(configuration: .ephemeral)
+        let task = session.dataTask(with: standIn.baseURL.appendingPathComponent("rest/getArtists.view"))
+        task.delegate = streamingResponse
+        task.resume()
+        wait(timeout: 120) {
+            lock.lock()
+            defer { lock.unlock() }
+            return done && completed
+        }
+        session.invalidateAndCancel()
+
+        lock.lock()
+        defer { lock.unlock() }
+        XCTAssertNil(completionError)
+        XCTAssertEqual(received, body)
+        print("At most \(streamingResponse.peakPendingBytes / 1024) KB waiting, suspended \(streamingResponse.suspensions) times")
+        // the reader couldn't keep up, so the task had to wait for it
+        XCTAssertGreaterThan(streamingResponse.suspensions, 0)
+        // a few chunks can still come in while the suspension takes effect, but nowhere near the whole response
+        XCTAssertLessThanOrEqual(streamingResponse.peakPendingBytes, 2 * SBSubsonicStreamingResponse.highWaterMark)
+    }
+}
@@ -0,0 +1,87 @@
+//
+//  SBTestAudio.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import Foundation
+
+/// Makes small audio files to serve and import, so tests don't need any checked in.
+enum SBTestAudio {
+    static let sampleRate = 44100
+
+    struct Tags {
+        var title: String
+        var artist: String
+        var album: String
+        var trackNumber: Int
+    }
+
+    /// A mono 16-bit AIFF of a sine wave, with ID3 tags if given.
+    static func aiff(seconds: Double, frequency: Double = 440, tags: Tags? = nil) -> Data {
+        let frames = Int(seconds * Double(sampleRate))
+
+        var common = Data()
+        common.appendBigEndian(UInt16(1)) // channels
+        common.appendBigEndian(UInt32(frames))
+        common.appendBigEndian(UInt16(16)) // bits per sample
+        // 44100 as an 80-bit extended float
+        common.append(contentsOf: [0x40, 0x0E, 0xAC, 0x44, 0, 0, 0, 0, 0, 0])
+
+        var sound = Data(capacity: 8 + frames * 2)
+        sound.appendBigEndian(UInt32(0)) // offset
+        sound.appendBigEndian(UInt32(0)) // block size
+        for frame in 0..<frames {
+            let sample = sin(2 * Double.pi * frequency * Double(frame) / Double(sampleRate)) * 0.25
+            sound.appendBigEndian(UInt16(bitPattern: Int16(sample * Double(Int16.max))))
+        }
+
+        var form = Data("AIFF".utf8)
+        form.appendChunk("COMM", common)
+        form.appendChunk("SSND", sound)
+        if let tags = tags {
+            form.appendChunk("ID3 ", id3(tags))
+        }
+        var file = Data()
+        file.appendChunk("FORM", form)
+        return file
+    }
+
+    /// An ID3v2.3 tag with text frames for the tags.
+    private static func id3(_ tags: Tags) -> Data {
+        var frames = Data()
+        for (id, text) in [("TIT2", tags.title), ("TPE1", tags.artist), ("TALB", tags.album), ("TRCK", String(tags.trackNumber))] {
+            // ISO 8859-1, which is enough for what tests make up
+            let body = Data([0]) + Data(text.utf8)
+            frames.append(contentsOf: Array(id.utf8))
+            frames.appendBigEndian(UInt32(body.count))
+            frames.appendBigEndian(UInt16(0)) // flags
+            frames.append(body)
+        }
+        var tag = Data("ID3".utf8)
+        tag.append(contentsOf: [3, 0, 0])
+        // the size is synchsafe, so only 7 bits of each byte are used
+        let size = frames.count
+        tag.append(contentsOf: [UInt8((size >> 21) & 0x7F), UInt8((size >> 14) & 0x7F), UInt8((size >> 7) & 0x7F), UInt8(size & 0x7F)])
+        tag.append(frames)
+        return tag
+    }
+}
+
+fileprivate extension Data {
+    mutating func appendBigEndian<T: FixedWidthInteger>(_ value: T) {
+        withUnsafeBytes(of: value.bigEndian) { append(contentsOf: $0) }
+    }
+
+    /// Appends an IFF chunk, padded to an even length.
+    mutating func appendChunk(_ id: String, _ body: Data) {
+        append(contentsOf: Array(id.utf8))
+        appendBigEndian(UInt32(body.count))
+        append(body)
+        if body.count % 2 == 1 {
+            append(0)
+        }
+    }
+}
@@ -0,0 +1,49 @@
+//
+//  SBTestSupport.swift
+//  SubmarinerTests
+//
+//  Created by Submariner Developers on 2026-10-18.
+//  Copyright © 2026 Submariner Developers. All rights reserved.
+//
+
+import XCTest
+@testable import Submariner
+
+/// Tests run inside the app, which uses an empty in-memory library and a temporary directory for its files while
+/// testing (see `SBAppDelegate.isRunningTests`).
+extension XCTestCase {
+    var mainContext: NSManagedObjectContext {
+        (NSApp.delegate as! SBAppDelegate).managedObjectContext
+    }
+
+    /// A server pointing at a stand-in, saved so operations can see it.
+    func makeServer(standIn: SBStandInServer, name: String = "Stand-In") -> SBServer {
+        let server = SBServer.insertInManagedObjectContext(context: mainContext)
+        server.resourceName = name
+        server.url = standIn.baseURL.absoluteString
+        server.username = "test"
+        // with the URL and username set, this stays in memory instead of going to the keychain
+        server.password = "test"
+        SBPersistence.shared.saveMainContext()
+        return server
+    }
+
+    func removeServer(_ server: SBServer) {
+        mainContext.delete(server)
+        SBPersistence.shared.saveMainContext()
+    }
+
+    /// Runs the main run loop until the condition holds, so whatever's waiting on the main queue gets to go.
+    func wait(timeout: TimeInterval = 10, file: StaticString = #filePath, line: UInt = #line, until condition: () -> Bool) {
+        let deadline = Date(timeIntervalSinceNow: timeout)
+        while !condition() && Date() < deadline {
+            RunLoop.main.run(until: Date(timeIntervalSinceNow: 0.01))
+        }
+        XCTAssertTrue(condition(), "Timed out after \(timeout) seconds", file: file, line: line)
+    }
+
+    /// Runs the main run loop for a while, i.e. to see that nothing else happens.
+    func settle(for interval: TimeInterval) {
+        RunLoop.main.run(until: Date(timeIntervalSinceNow: interval))
+    }
+}